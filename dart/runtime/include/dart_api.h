@@ -531,6 +531,67 @@ DART_EXPORT Dart_Handle Dart_AddGcEpilogueCallback(
 DART_EXPORT Dart_Handle Dart_RemoveGcEpilogueCallback(
     Dart_GcEpilogueCallback callback);
 
+// --- Garbage Collection Events ---
+
+typedef enum {
+  kGcNewSpace = 0,
+  kGcOldSpace
+} Dart_GcSpace;
+
+/**
+ * A garbage collection recorded by the VM. Times are in microseconds,
+ * sizes in bytes.
+ */
+typedef struct _Dart_GcEvent {
+  Dart_GcSpace space;
+  const char* reason;  /* Statically allocated, do not free. */
+  int64_t start;
+  int64_t end;
+  intptr_t used_before;
+  intptr_t used_after;
+  intptr_t promoted;  /* Bytes promoted to the old space. */
+} Dart_GcEvent;
+
+/**
+ * Gets the most recent garbage collections of the current isolate.
+ *
+ * The VM keeps a bounded number of events, older events are dropped.
+ *
+ * \param events An array to copy the events into, the oldest first.
+ * \param count On entry, the length of the events array. On return,
+ *   the number of events copied.
+ *
+ * \return Success if the events were copied.
+ */
+DART_EXPORT Dart_Handle Dart_GetGcEvents(Dart_GcEvent* events,
+                                         intptr_t* count);
+
+/**
+ * Pause time percentiles in microseconds of the garbage collections of
+ * one space.
+ */
+typedef struct _Dart_GcPauseHistogram {
+  intptr_t count;  /* The number of collections covered. */
+  int64_t p50;
+  int64_t p90;
+  int64_t p99;
+  int64_t max;
+} Dart_GcPauseHistogram;
+
+/**
+ * Computes the pause time percentiles of the garbage collections of a
+ * space over the events kept by the VM.
+ *
+ * \param space The collected space.
+ * \param histogram Receives the percentiles, all zero if no collections
+ *   of the space have been recorded.
+ *
+ * \return Success if the histogram was computed.
+ */
+DART_EXPORT Dart_Handle Dart_GetGcPauseHistogram(
+    Dart_GcSpace space,
+    Dart_GcPauseHistogram* histogram);
+
 // --- Heap Profiler ---
 
 /**
@@ -836,6 +897,13 @@ typedef int64_t Dart_Port;
  * mechanism for the delivery of inter-isolate messages.  It is the
  * responsibility of the embedder to call Dart_HandleMessage to
  * process the message.
+ *
+ * The callback is invoked on the thread posting the message, after the
+ * message has been queued and without holding any lock of the
+ * destination isolate.  It may therefore be invoked concurrently from
+ * several posting threads, and the message may already have been
+ * handled when it runs.  The callback has to be thread safe and should
+ * only wake up the thread running the destination isolate.
  */
 typedef void (*Dart_MessageNotifyCallback)(Dart_Isolate dest_isolate);
 
@@ -1645,6 +1713,32 @@ DART_EXPORT Dart_Handle Dart_NewExternalByteArray(uint8_t* data,
                                                   void* peer,
                                                   Dart_PeerFinalizer callback);
 
+/**
+ * Returns a ByteArray which references an external array of 8-bit bytes
+ * and which is transferred rather than copied when sent in a message.
+ *
+ * When such a ByteArray is posted to a port, the ownership of the
+ * external data passes to the message: the receiving isolate gets a
+ * ByteArray referencing the same data, and the sent ByteArray is left
+ * with a length of zero. The callback is only called once, by whoever
+ * owns the data last. If the message is received by a native port, the
+ * receiver of the Dart_CObject takes over the data and the callback. If
+ * the message is never delivered, e.g. because the port is closed, the
+ * callback is called when the message is discarded.
+ *
+ * \param value An array of 8-bit bytes. This array must not move.
+ * \param length The length of the array.
+ * \param peer An external pointer to associate with this byte array.
+ *
+ * \return The ByteArray object if no error occurs. Otherwise returns
+ *   an error handle.
+ */
+DART_EXPORT Dart_Handle Dart_NewTransferableExternalByteArray(
+    uint8_t* data,
+    intptr_t length,
+    void* peer,
+    Dart_PeerFinalizer callback);
+
 /**
  * Retrieves the peer pointer associated with an external ByteArray.
  */
@@ -141,10 +141,12 @@ DEFINE_NATIVE_ENTRY(SendPortImpl_sendInternal_, 3) {
   MessageWriter writer(&data, &allocator);
   writer.WriteMessage(obj);
 
+  Message* message = new Message(send_id.Value(), reply_id.Value(),
+                                 data, writer.BytesWritten(),
+                                 Message::kNormalPriority);
+  message->set_transferred_peers(writer.TakeTransferredPeers());
   // TODO(turnidge): Throw an exception when the return value is false?
-  PortMap::PostMessage(new Message(send_id.Value(), reply_id.Value(),
-                                   data, writer.BytesWritten(),
-                                   Message::kNormalPriority));
+  PortMap::PostMessage(message);
   return Object::null();
 }
 
@@ -1620,13 +1620,31 @@ void Assembler::StoreIntoObject(Register object,
                                 Register value) {
   ASSERT(object != value);
   movl(dest, value);
-  Label done;
-  StoreIntoObjectFilter(object, value, &done);
+  Label no_update, done;
+  StoreIntoObjectFilter(object, value, &no_update);
   // A store buffer update is required.
   if (value != EAX) pushl(EAX);  // Preserve EAX.
+  pushl(object);  // The stub looks up the page of the object.
   leal(EAX, dest);
   call(&StubCode::UpdateStoreBufferLabel());
+  popl(value);  // Drop the object, the value register is clobbered anyway.
   if (value != EAX) popl(EAX);  // Restore EAX.
+  Bind(&no_update);
+  // While the concurrent marker is running, record stores into old objects.
+  // The value register has been clobbered above and is used as scratch.
+  testl(object, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, &done, Assembler::kNearJump);
+  movl(value, FieldAddress(CTX, Context::isolate_offset()));
+  cmpl(Address(value, Isolate::marking_barrier_block_offset() +
+                      MarkingBarrierBlock::is_active_offset()),
+       Immediate(0));
+  j(EQUAL, &done, Assembler::kNearJump);
+  if (object != EAX) {
+    pushl(EAX);  // Preserve EAX.
+    movl(EAX, object);
+  }
+  call(&StubCode::MarkingBarrierLabel());
+  if (object != EAX) popl(EAX);  // Restore EAX.
   Bind(&done);
 }
 
@@ -1684,13 +1684,31 @@ void Assembler::StoreIntoObject(Register object,
                                 Register value) {
   ASSERT(object != value);
   movq(dest, value);
-  Label done;
-  StoreIntoObjectFilter(object, value, &done);
+  Label no_update, done;
+  StoreIntoObjectFilter(object, value, &no_update);
   // A store buffer update is required.
   if (value != RAX) pushq(RAX);
+  pushq(object);  // The stub looks up the page of the object.
   leaq(RAX, dest);
   call(&StubCode::UpdateStoreBufferLabel());
+  popq(value);  // Drop the object, the value register is clobbered anyway.
   if (value != RAX) popq(RAX);
+  Bind(&no_update);
+  // While the concurrent marker is running, record stores into old objects.
+  // The value register has been clobbered above and is used as scratch.
+  testl(object, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, &done, Assembler::kNearJump);
+  movq(value, FieldAddress(CTX, Context::isolate_offset()));
+  cmpl(Address(value, Isolate::marking_barrier_block_offset() +
+                      MarkingBarrierBlock::is_active_offset()),
+       Immediate(0));
+  j(EQUAL, &done, Assembler::kNearJump);
+  if (object != RAX) {
+    pushq(RAX);
+    movq(RAX, object);
+  }
+  call(&StubCode::MarkingBarrierLabel());
+  if (object != RAX) popq(RAX);
   Bind(&done);
 }
 
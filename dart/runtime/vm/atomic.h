@@ -0,0 +1,45 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_ATOMIC_H_
+#define VM_ATOMIC_H_
+
+#include "platform/globals.h"
+
+#include "vm/allocation.h"
+
+namespace dart {
+
+class AtomicOperations : public AllStatic {
+ public:
+  // Atomically fetch the value at p and increment the value at p.
+  // Returns the original value at p.
+  static uword FetchAndIncrement(uword* p);
+
+  // Atomically fetch the value at p and add value to the value at p.
+  // Returns the original value at p.
+  static uword FetchAndIncrementBy(uword* p, uword value);
+
+  // Atomically compare *ptr to old_value, and if equal, store new_value.
+  // Returns the original value at ptr. All of these operations act as full
+  // memory barriers.
+  static uword CompareAndSwapWord(uword* ptr, uword old_value, uword new_value);
+};
+
+
+}  // namespace dart
+
+#if defined(TARGET_OS_ANDROID)
+#include "vm/atomic_android.h"
+#elif defined(TARGET_OS_LINUX)
+#include "vm/atomic_linux.h"
+#elif defined(TARGET_OS_MACOS)
+#include "vm/atomic_macos.h"
+#elif defined(TARGET_OS_WINDOWS)
+#include "vm/atomic_win.h"
+#else
+#error Unknown target os.
+#endif
+
+#endif  // VM_ATOMIC_H_
@@ -0,0 +1,38 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "platform/assert.h"
+#include "vm/atomic.h"
+#include "vm/globals.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+UNIT_TEST_CASE(FetchAndIncrement) {
+  uword v = 42;
+  EXPECT_EQ(static_cast<uword>(42), AtomicOperations::FetchAndIncrement(&v));
+  EXPECT_EQ(static_cast<uword>(43), v);
+}
+
+
+UNIT_TEST_CASE(FetchAndIncrementBy) {
+  uword v = 42;
+  EXPECT_EQ(static_cast<uword>(42),
+            AtomicOperations::FetchAndIncrementBy(&v, 100));
+  EXPECT_EQ(static_cast<uword>(142), v);
+}
+
+
+UNIT_TEST_CASE(CompareAndSwapWord) {
+  uword v = 42;
+  EXPECT_EQ(static_cast<uword>(42),
+            AtomicOperations::CompareAndSwapWord(&v, 42, 0));
+  EXPECT_EQ(static_cast<uword>(0), v);
+  // A failed swap leaves the value untouched and returns the current value.
+  EXPECT_EQ(static_cast<uword>(0),
+            AtomicOperations::CompareAndSwapWord(&v, 42, 7));
+  EXPECT_EQ(static_cast<uword>(0), v);
+}
+
+}  // namespace dart
@@ -80,6 +80,31 @@ class BaseIsolate {
 #endif
   }
 
+  // Set while GC helper threads visit the heap of this isolate on its behalf.
+  // The no handle scope bookkeeping is not shared between threads and is
+  // suspended during that time. Helpers of different collectors may overlap,
+  // e.g. a scavenge during concurrent sweeping, hence the nesting count.
+  bool gc_helpers_active() const {
+#if defined(DEBUG)
+    return gc_helpers_count_ > 0;
+#else
+    return false;
+#endif
+  }
+
+  void IncrementGCHelpers() {
+#if defined(DEBUG)
+    gc_helpers_count_ += 1;
+#endif
+  }
+
+  void DecrementGCHelpers() {
+#if defined(DEBUG)
+    ASSERT(gc_helpers_count_ > 0);
+    gc_helpers_count_ -= 1;
+#endif
+  }
+
 #if defined(DEBUG)
   static void AssertCurrent(BaseIsolate* isolate);
 #endif
@@ -91,7 +116,8 @@ class BaseIsolate {
         current_zone_(NULL),
         top_handle_scope_(NULL),
         no_handle_scope_depth_(0),
-        no_gc_scope_depth_(0)
+        no_gc_scope_depth_(0),
+        gc_helpers_count_(0)
 #else
         current_zone_(NULL)
 #endif
@@ -107,6 +133,7 @@ class BaseIsolate {
   HandleScope* top_handle_scope_;
   int32_t no_handle_scope_depth_;
   int32_t no_gc_scope_depth_;
+  int32_t gc_helpers_count_;
 #endif
 
   DISALLOW_COPY_AND_ASSIGN(BaseIsolate);
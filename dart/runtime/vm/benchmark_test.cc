@@ -9,7 +9,11 @@
 #include "platform/assert.h"
 
 #include "vm/dart_api_impl.h"
+#include "vm/freelist.h"
+#include "vm/message_handler.h"
+#include "vm/port.h"
 #include "vm/stack_frame.h"
+#include "vm/thread.h"
 #include "vm/unit_test.h"
 
 namespace dart {
@@ -308,6 +312,46 @@ BENCHMARK(Dart2JSCompileAll) {
 }
 
 
+//
+// Measure allocation from the free list of a fragmented heap.
+//
+BENCHMARK(FreeListFragmented) {
+  const intptr_t kBlobSize = 32 * MB;
+  const intptr_t kMaxElementSize = 32 * KB;
+  const intptr_t kNumAllocations = 20000;
+  uword blob = reinterpret_cast<uword>(malloc(kBlobSize));
+  FreeList free_list;
+  // Free elements of varying sizes, separated by live objects.
+  uint32_t seed = 1;
+  uword current = blob;
+  while ((current + kMaxElementSize) < (blob + kBlobSize)) {
+    seed = seed * 1103515245 + 12345;
+    intptr_t size = Utils::RoundUp(
+        static_cast<intptr_t>(seed % kMaxElementSize) + kObjectAlignment,
+        kObjectAlignment);
+    free_list.Free(current, size);
+    current += size + kObjectAlignment;
+  }
+  Timer timer(true, "FreeListFragmented benchmark");
+  timer.Start();
+  intptr_t failed = 0;
+  for (intptr_t i = 0; i < kNumAllocations; i++) {
+    seed = seed * 1103515245 + 12345;
+    intptr_t size = Utils::RoundUp(
+        static_cast<intptr_t>(seed % (kMaxElementSize / 2)) + kObjectAlignment,
+        kObjectAlignment);
+    if (free_list.TryAllocate(size) == 0) {
+      failed++;
+    }
+  }
+  timer.Stop();
+  EXPECT(failed < kNumAllocations);
+  int64_t elapsed_time = timer.TotalElapsedTime();
+  benchmark->set_score(elapsed_time);
+  free(reinterpret_cast<void*>(blob));
+}
+
+
 //
 // Measure frame lookup during stack traversal.
 //
@@ -396,4 +440,120 @@ BENCHMARK(FrameLookup) {
   benchmark->set_score(elapsed_time);
 }
 
+
+//
+// Measure a floating point loop whose loop variable stays in an unboxed
+// double register, so that no Double is allocated per iteration.
+//
+BENCHMARK(UnboxedDoubleLoop) {
+  const intptr_t kNumIterations = 100000;
+  const char* kScriptChars =
+      "class Interest {\n"
+      "  static compound(principal, rate, years) {\n"
+      "    var v = principal;\n"
+      "    for (var i = 0; i < years; i++) {\n"
+      "      v = v * (1.0 + rate);\n"
+      "    }\n"
+      "    return v;\n"
+      "  }\n"
+      "}\n"
+      "warmup() {\n"
+      "  for (var i = 0; i < 5000; i++) Interest.compound(1.0, 0.0, 10);\n"
+      "}\n"
+      "benchmark(n) => Interest.compound(1.0, 0.0, n);\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("warmup"), 0, NULL);
+  EXPECT_VALID(result);
+
+  // New space allocates by bumping its top.
+  uword* new_space_top =
+      reinterpret_cast<uword*>(benchmark->isolate()->heap()->TopAddress());
+  const uword top_before = *new_space_top;
+  Timer timer(true, "Unboxed double loop benchmark");
+  timer.Start();
+  Dart_Handle args[1] = { Dart_NewInteger(kNumIterations) };
+  result = Dart_Invoke(lib, Dart_NewString("benchmark"), 1, args);
+  timer.Stop();
+  EXPECT_VALID(result);
+  double value = 0.0;
+  EXPECT_VALID(Dart_DoubleValue(result, &value));
+  EXPECT_EQ(1.0, value);
+  // Boxing the loop variable would allocate a Double per iteration.
+  const intptr_t allocated = *new_space_top - top_before;
+  EXPECT(allocated < (kNumIterations * Double::InstanceSize()) / 10);
+  int64_t elapsed_time = timer.TotalElapsedTime();
+  benchmark->set_score(elapsed_time);
+}
+
+
+class BenchmarkMessageHandler : public MessageHandler {
+ public:
+  BenchmarkMessageHandler() {}
+  bool HandleMessage(Message* message) { return true; }
+};
+
+
+// Posts messages to its own port from a separate thread.
+class BenchmarkPoster {
+ public:
+  static const intptr_t kNumMessages = 50000;
+
+  BenchmarkPoster(Dart_Port port, Monitor* monitor, intptr_t* running)
+      : port_(port), monitor_(monitor), running_(running) {}
+
+  static void Run(uword parameter) {
+    BenchmarkPoster* poster = reinterpret_cast<BenchmarkPoster*>(parameter);
+    for (intptr_t i = 0; i < kNumMessages; i++) {
+      uint8_t* data = reinterpret_cast<uint8_t*>(malloc(1));
+      data[0] = 0;
+      PortMap::PostMessage(new Message(
+          poster->port_, 0, data, 1, Message::kNormalPriority));
+    }
+    MonitorLocker ml(poster->monitor_);
+    (*poster->running_)--;
+    ml.Notify();
+  }
+
+ private:
+  Dart_Port port_;
+  Monitor* monitor_;
+  intptr_t* running_;
+};
+
+
+//
+// Measure posting messages from several threads at once, each to a port of
+// its own message handler.
+//
+BENCHMARK(PortMapPostMessage) {
+  const intptr_t kNumThreads = 8;
+  BenchmarkMessageHandler handlers[kNumThreads];
+  BenchmarkPoster* posters[kNumThreads];
+  Monitor monitor;
+  intptr_t running = kNumThreads;
+  for (intptr_t i = 0; i < kNumThreads; i++) {
+    posters[i] = new BenchmarkPoster(PortMap::CreatePort(&handlers[i]),
+                                     &monitor,
+                                     &running);
+  }
+  Timer timer(true, "PortMap post message benchmark");
+  timer.Start();
+  for (intptr_t i = 0; i < kNumThreads; i++) {
+    Thread::Start(BenchmarkPoster::Run, reinterpret_cast<uword>(posters[i]));
+  }
+  {
+    MonitorLocker ml(&monitor);
+    while (running > 0) {
+      ml.Wait();
+    }
+  }
+  timer.Stop();
+  for (intptr_t i = 0; i < kNumThreads; i++) {
+    PortMap::ClosePorts(&handlers[i]);
+    delete posters[i];
+  }
+  int64_t elapsed_time = timer.TotalElapsedTime();
+  benchmark->set_score(elapsed_time);
+}
+
 }  // namespace dart
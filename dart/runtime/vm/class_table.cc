@@ -14,7 +14,10 @@ namespace dart {
 DEFINE_FLAG(bool, print_class_table, false, "Print initial class table.");
 
 ClassTable::ClassTable()
-    : top_(kNumPredefinedCids), capacity_(0), table_(NULL) {
+    : top_(kNumPredefinedCids),
+      capacity_(0),
+      table_(NULL),
+      old_tables_(NULL) {
   if (Dart::vm_isolate() == NULL) {
     capacity_ = initial_capacity_;
     table_ = reinterpret_cast<RawClass**>(
@@ -37,10 +40,21 @@ ClassTable::ClassTable()
 
 
 ClassTable::~ClassTable() {
+  FreeOldTables();
   free(table_);
 }
 
 
+void ClassTable::FreeOldTables() {
+  while (old_tables_ != NULL) {
+    OldTable* next = old_tables_->next();
+    free(old_tables_->table());
+    delete old_tables_;
+    old_tables_ = next;
+  }
+}
+
+
 void ClassTable::Register(const Class& cls) {
   intptr_t index = cls.id();
   if (index != kIllegalCid) {
@@ -62,10 +76,12 @@ void ClassTable::Register(const Class& cls) {
       // Grow the capacity of the class table.
       intptr_t new_capacity = capacity_ + capacity_increment_;
       RawClass** new_table = reinterpret_cast<RawClass**>(
-          realloc(table_, new_capacity * sizeof(RawClass*)));  // NOLINT
+          malloc(new_capacity * sizeof(RawClass*)));  // NOLINT
+      memmove(new_table, table_, capacity_ * sizeof(RawClass*));
       for (intptr_t i = capacity_; i < new_capacity; i++) {
         new_table[i] = NULL;
       }
+      old_tables_ = new OldTable(table_, old_tables_);
       capacity_ = new_capacity;
       table_ = new_table;
     }
@@ -36,8 +36,19 @@ class ClassTable {
 
   intptr_t NumCids() const { return top_; }
 
+  // Used by the compactor to update the entry of a moved class.
+  void SetAt(intptr_t index, RawClass* raw_cls) {
+    ASSERT(IsValidIndex(index));
+    table_[index] = raw_cls;
+  }
+
   void Register(const Class& cls);
 
+  // Growing the table does not free the previous table right away, as it may
+  // still be read by a concurrent marker. The retired tables are released
+  // here at a point where no other thread accesses the class table.
+  void FreeOldTables();
+
   void VisitObjectPointers(ObjectPointerVisitor* visitor);
 
   void Print();
@@ -55,6 +66,18 @@ class ClassTable {
 
   RawClass** table_;
 
+  // Tables retired by growing the class table, see FreeOldTables.
+  class OldTable {
+   public:
+    OldTable(RawClass** table, OldTable* next) : table_(table), next_(next) {}
+    RawClass** table() const { return table_; }
+    OldTable* next() const { return next_; }
+   private:
+    RawClass** table_;
+    OldTable* next_;
+  };
+  OldTable* old_tables_;
+
   DISALLOW_COPY_AND_ASSIGN(ClassTable);
 };
 
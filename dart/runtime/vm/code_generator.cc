@@ -40,6 +40,16 @@ DEFINE_FLAG(bool, trace_patching, false, "Trace patching of code.");
 DEFINE_FLAG(bool, trace_runtime_calls, false, "Trace runtime calls");
 DEFINE_FLAG(int, optimization_counter_threshold, 2000,
     "Function's usage-counter value before it is optimized, -1 means never");
+DEFINE_FLAG(bool, deferred_optimization, false,
+    "Optimize hot functions at the end of the message being handled");
+DEFINE_FLAG(bool, use_osr, true,
+    "Replace unoptimized code running a hot loop by optimized code");
+DEFINE_FLAG(int, reoptimization_limit, 3,
+    "Number of times a function that deoptimized too often collects new "
+    "type feedback before it is never optimized again");
+DEFINE_FLAG(int, reoptimization_backoff, 10,
+    "Multiple of the optimization counter threshold a function that "
+    "deoptimized too often runs unoptimized before it is optimized again");
 DECLARE_FLAG(bool, enable_type_checks);
 DECLARE_FLAG(bool, trace_type_checks);
 DECLARE_FLAG(bool, report_usage_count);
@@ -988,6 +998,42 @@ DEFINE_RUNTIME_ENTRY(InlineCacheMissHandlerThreeArgs, 3) {
 }
 
 
+// Handles misses of the megamorphic lookup stub by adding the target for the
+// receiver class to the cache of the call.
+//   Arg0: Receiver object.
+//   Arg1: MegamorphicCache of the call.
+//   Returns: target function with compiled code or null.
+DEFINE_RUNTIME_ENTRY(MegamorphicCacheMissHandler, 2) {
+  ASSERT(arguments.Count() ==
+      kMegamorphicCacheMissHandlerRuntimeEntry.argument_count());
+  const Instance& receiver = Instance::CheckedHandle(arguments.At(0));
+  const MegamorphicCache& cache =
+      MegamorphicCache::CheckedHandle(arguments.At(1));
+  const Code& target_code =
+      Code::Handle(ResolveCompileInstanceCallTarget(isolate, receiver));
+  if (target_code.IsNull()) {
+    // Let the instance function lookup stub handle special cases:
+    // NoSuchMethod, closure calls.
+    arguments.SetReturn(Function::Handle());
+    return;
+  }
+  const Function& target_function =
+      Function::Handle(target_code.function());
+  ASSERT(!target_function.IsNull());
+  const intptr_t class_id = Class::Handle(receiver.clazz()).id();
+  if (cache.Lookup(class_id) == Function::null()) {
+    cache.Insert(class_id, target_function);
+  }
+  if (FLAG_trace_ic) {
+    OS::Print("MegamorphicCacheMissHandler adding <%s> id:%"Pd" -> <%s>\n",
+        Class::Handle(receiver.clazz()).ToCString(),
+        class_id,
+        target_function.ToCString());
+  }
+  arguments.SetReturn(target_function);
+}
+
+
 // Updates IC data for two arguments. Used by the equality operation when
 // the control flow bypasses regular inline cache (null arguments).
 //   Arg0: Receiver object.
@@ -1287,6 +1333,135 @@ DEFINE_RUNTIME_ENTRY(ClosureArgumentMismatch, 0) {
 }
 
 
+static void PrintCaller(const char* msg) {
+  DartFrameIterator iterator;
+  StackFrame* top_frame = iterator.NextFrame();
+  ASSERT(top_frame != NULL);
+  const Function& top_function = Function::Handle(
+      top_frame->LookupDartFunction());
+  OS::Print("Failed: '%s' %s @ %#"Px"\n",
+      msg, top_function.ToFullyQualifiedCString(), top_frame->pc());
+  StackFrame* caller_frame = iterator.NextFrame();
+  if (caller_frame != NULL) {
+    const Function& caller_function = Function::Handle(
+        caller_frame->LookupDartFunction());
+    const Code& code = Code::Handle(caller_frame->LookupDartCode());
+    OS::Print("  -> caller: %s (%s)\n",
+        caller_function.ToFullyQualifiedCString(),
+        code.is_optimized() ? "optimized" : "unoptimized");
+  }
+}
+
+
+static const intptr_t kLowInvocationCount = -100000000;
+
+
+// Returns false if function must not be optimized at this time, in which
+// case its usage counter is reset.
+static bool CanOptimizeFunction(const Function& function, Isolate* isolate) {
+  if (isolate->debugger()->IsActive()) {
+    // We cannot set breakpoints in optimized code, so do not optimize
+    // the function.
+    function.set_usage_counter(0);
+    return false;
+  }
+  if (function.deoptimization_counter() >=
+      FLAG_deoptimization_counter_threshold) {
+    if (function.reoptimization_counter() < FLAG_reoptimization_limit) {
+      // The type feedback that caused the deoptimizations is often collected
+      // before the program reaches a steady state. Discard it, run the
+      // unoptimized code for a while longer and decay the deoptimization
+      // counter so that the function is optimized again with fresh feedback.
+      if (FLAG_trace_failed_optimization_attempts) {
+        PrintCaller("Reoptimization Backoff");
+      }
+      function.set_reoptimization_counter(
+          function.reoptimization_counter() + 1);
+      function.set_deoptimization_counter(
+          function.deoptimization_counter() / 2);
+      const Code& unoptimized_code =
+          Code::Handle(function.unoptimized_code());
+      unoptimized_code.ResetIcDataAtCalls();
+      function.set_usage_counter(
+          -FLAG_reoptimization_backoff * FLAG_optimization_counter_threshold);
+      return false;
+    }
+    if (FLAG_trace_failed_optimization_attempts) {
+      PrintCaller("Too Many Deoptimizations");
+    }
+    function.set_usage_counter(kLowInvocationCount);
+    return false;
+  }
+  if ((FLAG_optimization_filter != NULL) &&
+      (strstr(function.ToFullyQualifiedCString(),
+              FLAG_optimization_filter) == NULL)) {
+    function.set_usage_counter(kLowInvocationCount);
+    return false;
+  }
+  return true;
+}
+
+
+// The stack check at the head of a loop in unoptimized code enters the
+// runtime when the usage counter of its function reaches the optimization
+// threshold. Compile optimized code entered at that loop and return to it
+// instead of the unoptimized code. The optimized code reuses the frame: all
+// parameters and locals are kept in the frame slots of the unoptimized code,
+// which are the incoming values of its graph.
+static void AttemptOnStackReplacement(Isolate* isolate) {
+  DartFrameIterator iterator;
+  StackFrame* frame = iterator.NextFrame();
+  ASSERT(frame != NULL);
+  const Code& code = Code::Handle(frame->LookupDartCode());
+  if (code.is_optimized()) {
+    return;
+  }
+  const Function& function = Function::Handle(code.function());
+  if (function.usage_counter() < FLAG_optimization_counter_threshold) {
+    return;
+  }
+  const intptr_t osr_id = code.GetOsrIdAtPc(frame->pc());
+  if (osr_id == Isolate::kNoDeoptId) {
+    return;
+  }
+  if (!CanOptimizeFunction(function, isolate)) {
+    return;
+  }
+  if (function.is_optimizable() && !function.HasOptimizedCode()) {
+    // Calls made after the loop also benefit from optimization.
+    const Error& error =
+        Error::Handle(Compiler::CompileOptimizedFunction(function));
+    if (!error.IsNull()) {
+      Exceptions::PropagateError(error);
+    }
+  }
+  if (!function.is_optimizable()) {
+    if (FLAG_trace_failed_optimization_attempts) {
+      PrintCaller("Not Optimizable");
+    }
+    function.set_usage_counter(kLowInvocationCount);
+    return;
+  }
+  const Object& result =
+      Object::Handle(Compiler::CompileOsrFunction(function, osr_id));
+  if (result.IsError()) {
+    Exceptions::PropagateError(Error::Cast(result));
+  }
+  if (result.IsNull()) {
+    function.set_usage_counter(kLowInvocationCount);
+    return;
+  }
+  const Code& osr_code = Code::Cast(result);
+  ASSERT(osr_code.is_optimized());
+  // Make the frame look like a frame of the optimized code and return to its
+  // entry, which only resizes the spill area of the frame.
+  frame->SetEntrypointMarker(
+      osr_code.EntryPoint() + AssemblerMacros::kOffsetOfSavedPCfromEntrypoint);
+  frame->set_pc(osr_code.EntryPoint());
+  function.set_usage_counter(0);
+}
+
+
 DEFINE_RUNTIME_ENTRY(StackOverflow, 0) {
   ASSERT(arguments.Count() ==
          kStackOverflowRuntimeEntry.argument_count());
@@ -1310,6 +1485,9 @@ DEFINE_RUNTIME_ENTRY(StackOverflow, 0) {
     }
     isolate->heap()->CollectGarbage(Heap::kNew);
   }
+  if (interrupt_bits & Isolate::kMarkingInterrupt) {
+    isolate->heap()->UpdateConcurrentMarking();
+  }
   if (interrupt_bits & Isolate::kMessageInterrupt) {
     isolate->message_handler()->HandleOOBMessages();
   }
@@ -1327,51 +1505,21 @@ DEFINE_RUNTIME_ENTRY(StackOverflow, 0) {
       }
     }
   }
-}
 
-
-static void PrintCaller(const char* msg) {
-  DartFrameIterator iterator;
-  StackFrame* top_frame = iterator.NextFrame();
-  ASSERT(top_frame != NULL);
-  const Function& top_function = Function::Handle(
-      top_frame->LookupDartFunction());
-  OS::Print("Failed: '%s' %s @ %#"Px"\n",
-      msg, top_function.ToFullyQualifiedCString(), top_frame->pc());
-  StackFrame* caller_frame = iterator.NextFrame();
-  if (caller_frame != NULL) {
-    const Function& caller_function = Function::Handle(
-        caller_frame->LookupDartFunction());
-    const Code& code = Code::Handle(caller_frame->LookupDartCode());
-    OS::Print("  -> caller: %s (%s)\n",
-        caller_function.ToFullyQualifiedCString(),
-        code.is_optimized() ? "optimized" : "unoptimized");
+  if (FLAG_use_osr) {
+    AttemptOnStackReplacement(isolate);
   }
 }
 
 
-
 // Only unoptimized code has invocation counter threshold checking.
 // Once the invocation counter threshold is reached any entry into the
 // unoptimized code is redirected to this function.
 DEFINE_RUNTIME_ENTRY(OptimizeInvokedFunction, 1) {
-  const intptr_t kLowInvocationCount = -100000000;
   ASSERT(arguments.Count() ==
          kOptimizeInvokedFunctionRuntimeEntry.argument_count());
   const Function& function = Function::CheckedHandle(arguments.At(0));
-  if (isolate->debugger()->IsActive()) {
-    // We cannot set breakpoints in optimized code, so do not optimize
-    // the function.
-    function.set_usage_counter(0);
-    return;
-  }
-  if (function.deoptimization_counter() >=
-      FLAG_deoptimization_counter_threshold) {
-    if (FLAG_trace_failed_optimization_attempts) {
-      PrintCaller("Too Many Deoptimizations");
-    }
-    // TODO(srdjan): Investigate excessive deoptimization.
-    function.set_usage_counter(kLowInvocationCount);
+  if (!CanOptimizeFunction(function, isolate)) {
     return;
   }
   if (function.HasOptimizedCode()) {
@@ -1386,13 +1534,13 @@ DEFINE_RUNTIME_ENTRY(OptimizeInvokedFunction, 1) {
     // that reoptimization was not already applied.
     return;
   }
-  if ((FLAG_optimization_filter != NULL) &&
-      (strstr(function.ToFullyQualifiedCString(),
-              FLAG_optimization_filter) == NULL)) {
-    function.set_usage_counter(kLowInvocationCount);
-    return;
-  }
   if (function.is_optimizable()) {
+    if (FLAG_deferred_optimization && Compiler::QueueOptimization(function)) {
+      // Keep running the unoptimized code until the end of the message. If
+      // the function gets hot again before then it is optimized right away.
+      function.set_usage_counter(0);
+      return;
+    }
     // Compilation patches the entry of unoptimized code.
     ASSERT(!function.HasOptimizedCode());
     const Error& error =
@@ -1644,7 +1792,8 @@ static intptr_t DeoptimizeWithDeoptInfo(const Code& code,
                                       Array::Handle(code.object_table()),
                                       num_args);
   for (intptr_t to_index = len - 1; to_index >= 0; to_index--) {
-    deopt_instructions[to_index]->Execute(&deopt_context, to_index);
+    deopt_instructions[to_index]->Execute(
+        &deopt_context, deopt_context.GetToFrameAddressAt(to_index));
   }
   if (FLAG_trace_deoptimization_verbose) {
     for (intptr_t i = 0; i < len; i++) {
@@ -1739,6 +1888,28 @@ DEFINE_RUNTIME_ENTRY(DeoptimizeMaterializeDoubles, 0) {
 
     delete current;
   }
+  // Materialize the objects whose allocation was sunk. Their field values
+  // may be the doubles and mints materialized above. The isolate keeps
+  // visiting the objects not yet materialized. Slots aliasing an object are
+  // filled once the object exists.
+  for (DeferredObject* deferred_object = isolate->deferred_objects();
+       deferred_object != NULL;
+       deferred_object = deferred_object->next()) {
+    if (!deferred_object->IsAlias()) deferred_object->Materialize();
+  }
+  for (DeferredObject* deferred_object = isolate->deferred_objects();
+       deferred_object != NULL;
+       deferred_object = deferred_object->next()) {
+    if (deferred_object->IsAlias()) deferred_object->Materialize();
+  }
+  DeferredObject* deferred_object = isolate->deferred_objects();
+  isolate->set_deferred_objects(NULL);
+  while (deferred_object != NULL) {
+    DeferredObject* current = deferred_object;
+    deferred_object = deferred_object->next();
+    delete current;
+  }
+
   // Since this is the only step where GC can occur during deoptimization,
   // use it to report the source line where deoptimization occured.
   if (FLAG_trace_deoptimization) {
@@ -48,7 +48,11 @@ DEFINE_FLAG(int, deoptimization_counter_threshold, 5,
     "How many times we allow deoptimization before we disallow"
     " certain optimizations");
 DEFINE_FLAG(bool, use_inlining, true, "Enable call-site inlining");
+DEFINE_FLAG(bool, allocation_sinking, true,
+    "Remove allocations of objects that do not escape optimized code.");
 DEFINE_FLAG(bool, range_analysis, true, "Enable range analysis");
+DEFINE_FLAG(bool, unbox_loop_phis, true,
+    "Speculatively unbox double loop phis whose entry value is unknown.");
 DEFINE_FLAG(bool, verify_compiler, false,
     "Enable compiler verification assertions");
 DECLARE_FLAG(bool, print_flow_graph);
@@ -115,9 +119,13 @@ static void InstallUnoptimizedCode(const Function& function) {
 }
 
 
-// Return false if bailed out.
+// Return false if bailed out. When compiling for on-stack replacement at the
+// loop stack check with deopt id osr_id, the optimized code is returned in
+// osr_code instead of being installed on the function.
 static bool CompileParsedFunctionHelper(const ParsedFunction& parsed_function,
-                                        bool optimized) {
+                                        bool optimized,
+                                        intptr_t osr_id,
+                                        Code* osr_code) {
   TimerScope timer(FLAG_compiler_stats, &CompilerStats::codegen_timer);
   bool is_compiled = false;
   Isolate* isolate = Isolate::Current();
@@ -139,7 +147,8 @@ static bool CompileParsedFunctionHelper(const ParsedFunction& parsed_function,
         // Transition to optimized code only from unoptimized code ...
         // for now.
         ASSERT(parsed_function.function().HasCode());
-        ASSERT(!parsed_function.function().HasOptimizedCode());
+        ASSERT((osr_id != Isolate::kNoDeoptId) ||
+               !parsed_function.function().HasOptimizedCode());
         // Extract type feedback before the graph is built, as the graph
         // builder uses it to attach it to nodes.
         // Do not use type feedback to optimize a function that was
@@ -155,7 +164,7 @@ static bool CompileParsedFunctionHelper(const ParsedFunction& parsed_function,
 
       // Build the flow graph.
       FlowGraphBuilder builder(parsed_function);
-      flow_graph = builder.BuildGraph(FlowGraphBuilder::kNotInlining);
+      flow_graph = builder.BuildGraph(FlowGraphBuilder::kNotInlining, osr_id);
 
       // Transform to SSA.
       if (optimized) flow_graph->ComputeSSA(0);  // Start at virtual register 0.
@@ -197,6 +206,19 @@ static bool CompileParsedFunctionHelper(const ParsedFunction& parsed_function,
         // Do optimizations that depend on the propagated type information.
         optimizer.OptimizeComputations();
 
+        // Code inserted into a loop pre-header deoptimizes to the pre-header
+        // goto, which does not exist in unoptimized code when the pre-header
+        // is the on-stack replacement entry.
+        const bool may_deoptimize_in_pre_headers =
+            !flow_graph->graph_entry()->IsCompiledForOsr() &&
+            (parsed_function.function().deoptimization_counter() <
+             (FLAG_deoptimization_counter_threshold - 1));
+
+        if (FLAG_unbox_loop_phis && may_deoptimize_in_pre_headers) {
+          flow_graph->ComputeUseLists();
+          optimizer.UnboxLoopPhis();
+        }
+
         // Unbox doubles.
         flow_graph->ComputeUseLists();
         optimizer.SelectRepresentations();
@@ -213,9 +235,9 @@ static bool CompileParsedFunctionHelper(const ParsedFunction& parsed_function,
         if (FLAG_common_subexpression_elimination) {
           DominatorBasedCSE::Optimize(flow_graph);
         }
-        if (FLAG_loop_invariant_code_motion &&
-            (parsed_function.function().deoptimization_counter() <
-             (FLAG_deoptimization_counter_threshold - 1))) {
+        if (FLAG_loop_invariant_code_motion && may_deoptimize_in_pre_headers) {
+          // Alias analysis of loads needs use lists.
+          flow_graph->ComputeUseLists();
           LICM::Optimize(flow_graph);
         }
 
@@ -227,6 +249,11 @@ static bool CompileParsedFunctionHelper(const ParsedFunction& parsed_function,
           optimizer.InferSmiRanges();
         }
 
+        if (FLAG_allocation_sinking) {
+          flow_graph->ComputeUseLists();
+          AllocationSinking::Optimize(flow_graph);
+        }
+
         // Perform register allocation on the SSA graph.
         FlowGraphAllocator allocator(*flow_graph);
         allocator.AllocateRegisters();
@@ -263,7 +290,11 @@ static bool CompileParsedFunctionHelper(const ParsedFunction& parsed_function,
       graph_compiler.FinalizeVarDescriptors(code);
       graph_compiler.FinalizeExceptionHandlers(code);
       graph_compiler.FinalizeComments(code);
-      if (optimized) {
+      if (osr_id != Isolate::kNoDeoptId) {
+        ASSERT(osr_code != NULL);
+        code.set_function(function);
+        *osr_code = code.raw();
+      } else if (optimized) {
         function.SetCode(code);
         CodePatcher::PatchEntry(Code::Handle(function.unoptimized_code()));
         if (FLAG_trace_compiler) {
@@ -405,7 +436,9 @@ static void DisassembleCode(const Function& function, bool optimized) {
 
 
 static RawError* CompileFunctionHelper(const Function& function,
-                                       bool optimized) {
+                                       bool optimized,
+                                       intptr_t osr_id,
+                                       Code* osr_code) {
   Isolate* isolate = Isolate::Current();
   LongJump* base = isolate->long_jump_base();
   LongJump jump;
@@ -421,15 +454,27 @@ static RawError* CompileFunctionHelper(const Function& function,
     ParsedFunction parsed_function(function);
     if (FLAG_trace_compiler) {
       OS::Print("Compiling %sfunction: '%s' @ token %"Pd"\n",
-                (optimized ? "optimized " : ""),
+                ((osr_id != Isolate::kNoDeoptId) ? "osr " :
+                 (optimized ? "optimized " : "")),
                 function.ToFullyQualifiedCString(),
                 function.token_pos());
     }
     Parser::ParseFunction(&parsed_function);
     parsed_function.AllocateVariables();
 
-    const bool success =
-        CompileParsedFunctionHelper(parsed_function, optimized);
+    const bool success = CompileParsedFunctionHelper(parsed_function,
+                                                     optimized,
+                                                     osr_id,
+                                                     osr_code);
+    if ((osr_id != Isolate::kNoDeoptId) && !success) {
+      // The caller keeps running the unoptimized code.
+      if (FLAG_trace_compiler) {
+        OS::Print("--> on-stack replacement failed for '%s'\n",
+                  function.ToFullyQualifiedCString());
+      }
+      isolate->set_long_jump_base(base);
+      return Error::null();
+    }
     if (optimized && !success) {
       // Optimizer bailed out. Disable optimizations and to never try again.
       if (FLAG_trace_compiler) {
@@ -443,6 +488,16 @@ static RawError* CompileFunctionHelper(const Function& function,
 
     ASSERT(success);
 
+    if (osr_id != Isolate::kNoDeoptId) {
+      if (FLAG_trace_compiler) {
+        OS::Print("--> '%s' osr entry: %#"Px"\n",
+                  function.ToFullyQualifiedCString(),
+                  osr_code->EntryPoint());
+      }
+      isolate->set_long_jump_base(base);
+      return Error::null();
+    }
+
     if (FLAG_trace_compiler) {
       OS::Print("--> '%s' entry: %#"Px"\n",
                 function.ToFullyQualifiedCString(),
@@ -476,12 +531,83 @@ static RawError* CompileFunctionHelper(const Function& function,
 
 
 RawError* Compiler::CompileFunction(const Function& function) {
-  return CompileFunctionHelper(function, false);  // Non-optimized.
+  return CompileFunctionHelper(function,
+                               false,  // Non-optimized.
+                               Isolate::kNoDeoptId,
+                               NULL);
 }
 
 
 RawError* Compiler::CompileOptimizedFunction(const Function& function) {
-  return CompileFunctionHelper(function, true);  // Optimized.
+  return CompileFunctionHelper(function,
+                               true,  // Optimized.
+                               Isolate::kNoDeoptId,
+                               NULL);
+}
+
+
+RawObject* Compiler::CompileOsrFunction(const Function& function,
+                                        intptr_t osr_id) {
+  ASSERT(osr_id != Isolate::kNoDeoptId);
+  Code& osr_code = Code::Handle();
+  const Error& error = Error::Handle(
+      CompileFunctionHelper(function, true, osr_id, &osr_code));
+  if (!error.IsNull()) {
+    return error.raw();
+  }
+  return osr_code.raw();
+}
+
+
+bool Compiler::QueueOptimization(const Function& function) {
+  Isolate* isolate = Isolate::Current();
+  GrowableObjectArray& pending =
+      GrowableObjectArray::Handle(isolate->pending_optimizations());
+  if (pending.IsNull()) {
+    pending = GrowableObjectArray::New(Heap::kOld);
+    isolate->set_pending_optimizations(pending.raw());
+  }
+  for (intptr_t i = 0; i < pending.Length(); i++) {
+    if (pending.At(i) == function.raw()) {
+      return false;
+    }
+  }
+  if (FLAG_trace_compiler) {
+    OS::Print("--> Queueing optimization of '%s'\n",
+              function.ToFullyQualifiedCString());
+  }
+  pending.Add(function);
+  return true;
+}
+
+
+RawError* Compiler::CompilePendingOptimizations() {
+  Isolate* isolate = Isolate::Current();
+  const GrowableObjectArray& pending =
+      GrowableObjectArray::Handle(isolate->pending_optimizations());
+  if (pending.IsNull()) {
+    return Error::null();
+  }
+  isolate->set_pending_optimizations(GrowableObjectArray::null());
+  Function& function = Function::Handle();
+  Error& error = Error::Handle();
+  for (intptr_t i = 0; i < pending.Length(); i++) {
+    function ^= pending.At(i);
+    // The function may have been optimized synchronously or become
+    // ineligible for optimization since it was queued.
+    if (function.HasOptimizedCode() ||
+        !function.is_optimizable() ||
+        (function.deoptimization_counter() >=
+         FLAG_deoptimization_counter_threshold) ||
+        isolate->debugger()->IsActive()) {
+      continue;
+    }
+    error = CompileOptimizedFunction(function);
+    if (!error.IsNull()) {
+      return error.raw();
+    }
+  }
+  return Error::null();
 }
 
 
@@ -493,7 +619,10 @@ RawError* Compiler::CompileParsedFunction(
   isolate->set_long_jump_base(&jump);
   if (setjmp(*jump.Set()) == 0) {
     // Non-optimized code generator.
-    CompileParsedFunctionHelper(parsed_function, false);
+    CompileParsedFunctionHelper(parsed_function,
+                                false,  // Non-optimized.
+                                Isolate::kNoDeoptId,
+                                NULL);
     isolate->set_long_jump_base(base);
     return Error::null();
   } else {
@@ -570,7 +699,10 @@ RawObject* Compiler::ExecuteOnce(SequenceNode* fragment) {
     parsed_function.AllocateVariables();
 
     // Non-optimized code generator.
-    CompileParsedFunctionHelper(parsed_function, false);
+    CompileParsedFunctionHelper(parsed_function,
+                                false,  // Non-optimized.
+                                Isolate::kNoDeoptId,
+                                NULL);
 
     GrowableArray<const Object*> arguments;  // no arguments.
     const Array& kNoArgumentNames = Array::Handle();
@@ -40,6 +40,28 @@ class Compiler : public AllStatic {
   // Returns Error::null() if there is no compilation error.
   static RawError* CompileOptimizedFunction(const Function& function);
 
+  // Generates optimized code for function that is entered from a running
+  // activation of its unoptimized code at the loop stack check with deopt id
+  // osr_id (on-stack replacement). The code is not installed on function.
+  //
+  // Returns the optimized Code, null if the optimizer bailed out, or an
+  // Error if there is a compilation error.
+  static RawObject* CompileOsrFunction(const Function& function,
+                                       intptr_t osr_id);
+
+  // Defers the optimization of function to the end of the message being
+  // handled by the current isolate, the unoptimized code keeps running in the
+  // meantime.
+  //
+  // Returns false if the optimization of function is already pending.
+  static bool QueueOptimization(const Function& function);
+
+  // Generates optimized code for the functions queued by QueueOptimization
+  // which are still eligible for optimization.
+  //
+  // Returns Error::null() if there is no compilation error.
+  static RawError* CompilePendingOptimizations();
+
   // Generates code for given parsed function (without parsing it again) and
   // sets its code field.
   //
@@ -5,12 +5,23 @@
 #include "platform/assert.h"
 #include "vm/class_finalizer.h"
 #include "vm/compiler.h"
+#include "vm/dart_entry.h"
 #include "vm/object.h"
 #include "vm/symbols.h"
 #include "vm/unit_test.h"
 
 namespace dart {
 
+DECLARE_FLAG(bool, deferred_optimization);
+DECLARE_FLAG(int, deoptimization_counter_threshold);
+DECLARE_FLAG(int, max_polymorphic_checks);
+DECLARE_FLAG(int, max_polymorphic_inlining_targets);
+DECLARE_FLAG(int, optimization_counter_threshold);
+DECLARE_FLAG(int, reoptimization_backoff);
+DECLARE_FLAG(int, reoptimization_limit);
+DECLARE_FLAG(bool, use_inlining);
+DECLARE_FLAG(bool, use_osr);
+
 // Compiler only implemented on IA32 and X64 now.
 #if defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64)
 
@@ -65,6 +76,637 @@ TEST_CASE(CompileFunction) {
   EXPECT(function_moo.HasCode());
 }
 
+
+// Pins the flags the optimization tests depend on, so that their expectations
+// do not depend on the command line. The flags are restored when the test is
+// done. Tests relying on OSR or deferred optimization enable them explicitly.
+class OptimizationFlagsScope : public ValueObject {
+ public:
+  explicit OptimizationFlagsScope(intptr_t optimization_counter_threshold)
+      : deferred_optimization_(FLAG_deferred_optimization),
+        deoptimization_counter_threshold_(
+            FLAG_deoptimization_counter_threshold),
+        max_polymorphic_checks_(FLAG_max_polymorphic_checks),
+        max_polymorphic_inlining_targets_(
+            FLAG_max_polymorphic_inlining_targets),
+        optimization_counter_threshold_(FLAG_optimization_counter_threshold),
+        reoptimization_backoff_(FLAG_reoptimization_backoff),
+        reoptimization_limit_(FLAG_reoptimization_limit),
+        use_inlining_(FLAG_use_inlining),
+        use_osr_(FLAG_use_osr) {
+    FLAG_deferred_optimization = false;
+    FLAG_deoptimization_counter_threshold = 5;
+    FLAG_max_polymorphic_checks = 4;
+    FLAG_max_polymorphic_inlining_targets = 4;
+    FLAG_optimization_counter_threshold = optimization_counter_threshold;
+    FLAG_reoptimization_backoff = 10;
+    FLAG_reoptimization_limit = 3;
+    FLAG_use_inlining = true;
+    FLAG_use_osr = false;
+  }
+
+  ~OptimizationFlagsScope() {
+    FLAG_deferred_optimization = deferred_optimization_;
+    FLAG_deoptimization_counter_threshold = deoptimization_counter_threshold_;
+    FLAG_max_polymorphic_checks = max_polymorphic_checks_;
+    FLAG_max_polymorphic_inlining_targets = max_polymorphic_inlining_targets_;
+    FLAG_optimization_counter_threshold = optimization_counter_threshold_;
+    FLAG_reoptimization_backoff = reoptimization_backoff_;
+    FLAG_reoptimization_limit = reoptimization_limit_;
+    FLAG_use_inlining = use_inlining_;
+    FLAG_use_osr = use_osr_;
+  }
+
+ private:
+  const bool deferred_optimization_;
+  const int deoptimization_counter_threshold_;
+  const int max_polymorphic_checks_;
+  const int max_polymorphic_inlining_targets_;
+  const int optimization_counter_threshold_;
+  const int reoptimization_backoff_;
+  const int reoptimization_limit_;
+  const bool use_inlining_;
+  const bool use_osr_;
+
+  DISALLOW_COPY_AND_ASSIGN(OptimizationFlagsScope);
+};
+
+
+static RawLibrary* TestLibrary() {
+  return Library::LookupLibrary(String::Handle(String::New(TestCase::url())));
+}
+
+
+// Looks up a static function of a class of the test script.
+static RawFunction* GetStaticFunction(const char* class_name,
+                                      const char* function_name) {
+  EXPECT(ClassFinalizer::FinalizePendingClasses());
+  const Class& cls = Class::Handle(Library::Handle(TestLibrary()).LookupClass(
+      String::Handle(Symbols::New(class_name))));
+  EXPECT(!cls.IsNull());
+  const Function& function = Function::Handle(cls.LookupStaticFunction(
+      String::Handle(String::New(function_name))));
+  EXPECT(!function.IsNull());
+  return function.raw();
+}
+
+
+// Looks up a top-level function of the test script.
+static RawFunction* GetFunction(const char* function_name) {
+  const Function& function = Function::Handle(
+      Library::Handle(TestLibrary()).LookupLocalFunction(
+          String::Handle(Symbols::New(function_name))));
+  EXPECT(!function.IsNull());
+  return function.raw();
+}
+
+
+TEST_CASE(DeferredOptimization) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static foo(x) { return x; }\n"
+      "  static bar(x) { return x; }\n"
+      "}\n"
+      "callFoo(n) {\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < n; i++) s = A.foo(s);\n"
+      "  return s;\n"
+      "}\n"
+      "callBar(n) {\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < n; i++) s = A.bar(s);\n"
+      "  return s;\n"
+      "}\n";
+  // A.foo and A.bar make no instance calls, which would also be counted as
+  // uses of them.
+  // The loops must not replace callFoo and callBar by optimized code, in
+  // which A.foo and A.bar would be inlined.
+  const intptr_t kThreshold = 10;
+  OptimizationFlagsScope flags(kThreshold);
+  FLAG_deferred_optimization = true;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  const Function& foo = Function::Handle(GetStaticFunction("A", "foo"));
+  const Function& bar = Function::Handle(GetStaticFunction("A", "bar"));
+
+  // The optimization of a function which got hot is queued.
+  Dart_Handle args[1] = { Dart_NewInteger(kThreshold) };
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("callFoo"), 1, args));
+  EXPECT(!foo.HasOptimizedCode());
+  EXPECT(Compiler::CompilePendingOptimizations() == Error::null());
+  EXPECT(foo.HasOptimizedCode());
+  EXPECT(Isolate::Current()->pending_optimizations() ==
+         GrowableObjectArray::null());
+
+  // A queued function which gets hot again is optimized right away.
+  args[0] = Dart_NewInteger(2 * kThreshold);
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("callBar"), 1, args));
+  EXPECT(bar.HasOptimizedCode());
+  EXPECT(Compiler::CompilePendingOptimizations() == Error::null());
+}
+
+
+TEST_CASE(OnStackReplacement) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static sum(n) {\n"
+      "    var s = 0;\n"
+      "    for (var i = 0; i < n; i++) {\n"
+      "      s += i;\n"
+      "    }\n"
+      "    return s;\n"
+      "  }\n"
+      "  static halves(n) {\n"
+      "    var s = 0;\n"
+      "    var step = 1;\n"
+      "    var i = 0;\n"
+      "    while (i < n) {\n"
+      "      s = s + step;\n"
+      "      if (i == (n ~/ 2)) step = 0.5;\n"
+      "      i++;\n"
+      "    }\n"
+      "    return s;\n"
+      "  }\n"
+      "}\n"
+      "callSum(n) => A.sum(n);\n"
+      "callHalves(n) => A.halves(n);\n";
+  const intptr_t kThreshold = 100;
+  OptimizationFlagsScope flags(kThreshold);
+  FLAG_use_osr = true;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  const Function& sum = Function::Handle(GetStaticFunction("A", "sum"));
+
+  // A single invocation with a hot loop continues in optimized code, which
+  // does not count the return.
+  Dart_Handle args[1] = { Dart_NewInteger(10 * kThreshold) };
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("callSum"), 1, args);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(499500, value);
+  EXPECT(sum.HasOptimizedCode());
+  EXPECT_EQ(0, sum.usage_counter());
+
+  // The optimized code entered in the loop deoptimizes back into the
+  // unoptimized frame when step becomes a double.
+  result = Dart_Invoke(lib, Dart_NewString("callHalves"), 1, args);
+  EXPECT_VALID(result);
+  double double_value = 0.0;
+  EXPECT_VALID(Dart_DoubleValue(result, &double_value));
+  EXPECT_EQ(750.5, double_value);
+}
+
+
+static intptr_t NumberOfChecksAtCalls(const Function& function) {
+  const Code& code = Code::Handle(function.unoptimized_code());
+  const Array& feedback = Array::Handle(code.ExtractTypeFeedbackArray());
+  ICData& ic_data = ICData::Handle();
+  intptr_t num_checks = 0;
+  for (intptr_t i = 0; i < feedback.Length(); i++) {
+    ic_data ^= feedback.At(i);
+    if (!ic_data.IsNull()) {
+      num_checks += ic_data.NumberOfChecks();
+    }
+  }
+  return num_checks;
+}
+
+
+TEST_CASE(Reoptimization) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  foo() => 1;\n"
+      "  static callFoo(a) => a.foo();\n"
+      "  static loop(n) {\n"
+      "    var a = new A();\n"
+      "    var s = 0;\n"
+      "    for (var i = 0; i < n; i++) s += callFoo(a);\n"
+      "    return s;\n"
+      "  }\n"
+      "}\n"
+      "run(n) => A.loop(n);\n";
+  const intptr_t kThreshold = 10;
+  const intptr_t kBackoff = 2;
+  OptimizationFlagsScope flags(kThreshold);
+  FLAG_reoptimization_backoff = kBackoff;
+  FLAG_reoptimization_limit = 1;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  // Keep callFoo from being inlined into an optimized loop.
+  Function::Handle(GetStaticFunction("A", "loop")).set_is_optimizable(false);
+  Dart_Handle args[1] = { Dart_NewInteger(1) };
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("run"), 1, args));
+  const Function& call_foo =
+      Function::Handle(GetStaticFunction("A", "callFoo"));
+  EXPECT(call_foo.HasCode());
+  EXPECT_EQ(1, NumberOfChecksAtCalls(call_foo));
+
+  // A function that deoptimized too often drops its type feedback and backs
+  // off before it is optimized again. Both the instance call and the return
+  // increment the usage counter.
+  const intptr_t deopt_threshold = FLAG_deoptimization_counter_threshold;
+  call_foo.set_deoptimization_counter(deopt_threshold);
+  call_foo.set_usage_counter(kThreshold - 2);
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("run"), 1, args));
+  EXPECT(!call_foo.HasOptimizedCode());
+  EXPECT_EQ(1, call_foo.reoptimization_counter());
+  EXPECT_EQ(deopt_threshold / 2, call_foo.deoptimization_counter());
+  EXPECT_EQ(-kBackoff * kThreshold, call_foo.usage_counter());
+  EXPECT_EQ(0, NumberOfChecksAtCalls(call_foo));
+
+  args[0] = Dart_NewInteger((kBackoff + 1) * kThreshold);
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("run"), 1, args));
+  EXPECT(call_foo.HasOptimizedCode());
+  if (!call_foo.HasOptimizedCode()) {
+    return;  // The rest of the test switches away from the optimized code.
+  }
+  EXPECT_EQ(1, NumberOfChecksAtCalls(call_foo));
+
+  // Once the limit is reached the function is not optimized again.
+  call_foo.SwitchToUnoptimizedCode();
+  call_foo.set_deoptimization_counter(deopt_threshold);
+  call_foo.set_usage_counter(kThreshold - 2);
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("run"), 1, args));
+  EXPECT(!call_foo.HasOptimizedCode());
+  EXPECT_EQ(1, call_foo.reoptimization_counter());
+  EXPECT(call_foo.usage_counter() < -kBackoff * kThreshold);
+}
+
+
+TEST_CASE(MegamorphicCall) {
+  const char* kScriptChars =
+      "class A0 { foo() => 0; }\n"
+      "class A1 { foo() => 1; }\n"
+      "class A2 { foo() => 2; }\n"
+      "class A3 { foo() => 3; }\n"
+      "class A4 { foo() => 4; }\n"
+      "class N { noSuchMethod(name, args) => 100; }\n"
+      "class C {\n"
+      "  static callFoo(a) => a.foo();\n"
+      "  static loop(n) {\n"
+      "    var l = [new A0(), new A1(), new A2(), new A3(), new A4(), 5];\n"
+      "    var s = 0;\n"
+      "    for (var i = 0; i < n; i++) {\n"
+      "      var a = l[i % 6];\n"
+      "      s += (a is int) ? callFoo(new N()) : callFoo(a);\n"
+      "    }\n"
+      "    return s;\n"
+      "  }\n"
+      "}\n"
+      "run(n) => C.loop(n);\n";
+  const intptr_t kThreshold = 10;
+  OptimizationFlagsScope flags(kThreshold);
+  FLAG_max_polymorphic_checks = 2;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  // Keep callFoo from being inlined into an optimized loop.
+  Function::Handle(GetStaticFunction("C", "loop")).set_is_optimizable(false);
+
+  // The call in callFoo sees more receiver classes than are checked inline
+  // before callFoo is optimized. Each round over the six receivers calls
+  // callFoo six times, so it gets hot within the first kThreshold rounds.
+  const intptr_t kRounds = kThreshold;
+  Dart_Handle args[1] = { Dart_NewInteger(6 * kRounds) };
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("run"), 1, args);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(kRounds * (0 + 1 + 2 + 3 + 4 + 100), value);
+  const Function& call_foo =
+      Function::Handle(GetStaticFunction("C", "callFoo"));
+  EXPECT(call_foo.HasOptimizedCode());
+  if (!call_foo.HasOptimizedCode()) {
+    return;  // Only the optimized call fills the cache.
+  }
+
+  // The optimized call filled the cache of the selector, except for the
+  // receiver that does not implement foo.
+  const MegamorphicCache& cache = MegamorphicCache::Handle(
+      MegamorphicCache::ForSelector(
+          String::Handle(Symbols::New("foo")),
+          DartEntry::ArgumentsDescriptor(1, Array::Handle())));
+  EXPECT_EQ(5, cache.filled_entry_count());
+}
+
+
+// A loop phi that only gets Doubles along its back edge stays unboxed even
+// though its entry value is a parameter; the entry value is checked before
+// the loop instead.
+TEST_CASE(UnboxedLoopPhi) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static compound(principal, rate, years) {\n"
+      "    var v = principal;\n"
+      "    for (var i = 0; i < years; i++) {\n"
+      "      v = v * (1.0 + rate);\n"
+      "    }\n"
+      "    return v;\n"
+      "  }\n"
+      "}\n"
+      "run(n) {\n"
+      "  var s = 0.0;\n"
+      "  for (var i = 0; i < n; i++) s += A.compound(100.0, 0.5, 2);\n"
+      "  return s;\n"
+      "}\n"
+      "callCompound(principal, years) => A.compound(principal, 0.5, years);\n";
+  const intptr_t kThreshold = 10;
+  OptimizationFlagsScope flags(kThreshold);
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  // Calling compound kCalls times makes it hot well before the last call.
+  const intptr_t kCalls = 10 * kThreshold;
+  Dart_Handle args[2] = { Dart_NewInteger(kCalls), Dart_NewInteger(0) };
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("run"), 1, args);
+  EXPECT_VALID(result);
+  double double_value = 0.0;
+  EXPECT_VALID(Dart_DoubleValue(result, &double_value));
+  EXPECT_EQ(kCalls * 225.0, double_value);
+  const Function& compound =
+      Function::Handle(GetStaticFunction("A", "compound"));
+  EXPECT(compound.HasOptimizedCode());
+  if (!compound.HasOptimizedCode()) {
+    return;  // The rest of the test deoptimizes the optimized code.
+  }
+  EXPECT_EQ(0, compound.deoptimization_counter());
+
+  // A Smi principal deoptimizes before entering the loop and is not
+  // converted to a double when the loop does not run.
+  args[0] = Dart_NewInteger(100);
+  args[1] = Dart_NewInteger(0);
+  result = Dart_Invoke(lib, Dart_NewString("callCompound"), 2, args);
+  EXPECT_VALID(result);
+  EXPECT(Dart_IsInteger(result));
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(100, value);
+  EXPECT_EQ(1, compound.deoptimization_counter());
+
+  args[1] = Dart_NewInteger(2);
+  result = Dart_Invoke(lib, Dart_NewString("callCompound"), 2, args);
+  EXPECT_VALID(result);
+  EXPECT_VALID(Dart_DoubleValue(result, &double_value));
+  EXPECT_EQ(225.0, double_value);
+}
+
+
+// The allocation of a point that does not escape is removed from optimized
+// code. Deoptimization recreates the point once, even though both the
+// receiver and the argument of the inlined operator refer to it.
+TEST_CASE(SunkAllocation) {
+  const char* kScriptChars =
+      "class Point {\n"
+      "  var x;\n"
+      "  var y;\n"
+      "  Point(this.x, this.y);\n"
+      "  Point operator+(other) {\n"
+      "    var sum_x = x + other.x;\n"
+      "    x = 0;\n"
+      "    return new Point(sum_x, y + other.y + other.x);\n"
+      "  }\n"
+      "}\n"
+      "class A {\n"
+      "  static twice(a, b) {\n"
+      "    var p = new Point(a, b);\n"
+      "    var q = p + p;\n"
+      "    return q.x + q.y;\n"
+      "  }\n"
+      "}\n"
+      "run(n) {\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < n; i++) s += A.twice(i, 2);\n"
+      "  return s;\n"
+      "}\n"
+      "callTwice(a, b) => A.twice(a, b);\n";
+  OptimizationFlagsScope flags(10);
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle args[2] = { Dart_NewInteger(100), Dart_NewInteger(2) };
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("run"), 1, args);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(100 * 99 + 100 * 4, value);
+  const Function& twice = Function::Handle(GetStaticFunction("A", "twice"));
+  EXPECT(twice.HasOptimizedCode());
+  EXPECT_EQ(0, twice.deoptimization_counter());
+
+  // A double deoptimizes in the inlined operator. The operator continues
+  // in unoptimized code and sees its store into the receiver when reading
+  // the argument.
+  args[0] = Dart_NewDouble(1.5);
+  result = Dart_Invoke(lib, Dart_NewString("callTwice"), 2, args);
+  EXPECT_VALID(result);
+  double double_value = 0.0;
+  EXPECT_VALID(Dart_DoubleValue(result, &double_value));
+  EXPECT_EQ(3.0 + 4.0, double_value);
+  EXPECT_EQ(1, twice.deoptimization_counter());
+}
+
+
+TEST_CASE(BoundsCheckElimination) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static sum(a) {\n"
+      "    var s = 0;\n"
+      "    for (var i = 0; i < a.length; i++) s += a[i];\n"
+      "    return s;\n"
+      "  }\n"
+      "  static sumGrowable(a) {\n"
+      "    var s = 0;\n"
+      "    for (var i = 0; i < a.length; i++) s += a[i];\n"
+      "    return s;\n"
+      "  }\n"
+      "  static sumTo(a, last) {\n"
+      "    var s = 0;\n"
+      "    for (var i = 0; i <= last; i++) s += a[i];\n"
+      "    return s;\n"
+      "  }\n"
+      "}\n"
+      "run(n) {\n"
+      "  var a = new List(10);\n"
+      "  for (var i = 0; i < 10; i++) a[i] = i;\n"
+      "  var g = [1, 2, 3];\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < n; i++) {\n"
+      "    s += A.sum(a) + A.sumGrowable(g) + A.sumTo(a, 9);\n"
+      "  }\n"
+      "  return s;\n"
+      "}\n"
+      "runPastEnd() {\n"
+      "  try {\n"
+      "    return A.sumTo([1, 2, 3], 3);\n"
+      "  } catch (e) {\n"
+      "    return -1;\n"
+      "  }\n"
+      "}\n";
+  OptimizationFlagsScope flags(100);
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle args[1] = { Dart_NewInteger(3000) };
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("run"), 1, args);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(3000 * (45 + 6 + 45), value);
+  const Function& sum_to = Function::Handle(GetStaticFunction("A", "sumTo"));
+  EXPECT(sum_to.HasOptimizedCode());
+
+  // The index is only bounded by the argument, so the check is kept and
+  // an access past the end still throws.
+  result = Dart_Invoke(lib, Dart_NewString("runPastEnd"), 0, NULL);
+  EXPECT_VALID(result);
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(-1, value);
+}
+
+
+TEST_CASE(PolymorphicInlining) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  var v;\n"
+      "  A(this.v);\n"
+      "  f(x) => v + x;\n"
+      "  operator *(other) => v * other;\n"
+      "}\n"
+      "class B {\n"
+      "  f(x) => x * 2;\n"
+      "  operator *(other) => 7;\n"
+      "}\n"
+      "class C {\n"
+      "  f(x) => x + 10;\n"
+      "  operator *(other) => 1;\n"
+      "}\n"
+      "sum(list) {\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < list.length; i++) s += list[i].f(i);\n"
+      "  return s;\n"
+      "}\n"
+      "twice(list) {\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < list.length; i++) s += list[i] * 2;\n"
+      "  return s;\n"
+      "}\n"
+      "run(n) {\n"
+      "  var objects = [new A(1), new B()];\n"
+      "  var mixed = [new A(1), 3, new B()];\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < n; i++) s += sum(objects) + twice(mixed);\n"
+      "  return s;\n"
+      "}\n"
+      "runOther() => sum([new C()]) + twice([new C()]);\n";
+  OptimizationFlagsScope flags(100);
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle args[1] = { Dart_NewInteger(3000) };
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("run"), 1, args);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(3000 * ((1 + 2) + (2 + 6 + 7)), value);
+  const Function& sum = Function::Handle(GetFunction("sum"));
+  EXPECT(sum.HasOptimizedCode());
+  EXPECT_EQ(0, sum.deoptimization_counter());
+
+  // A receiver of a class that was not seen deoptimizes.
+  result = Dart_Invoke(lib, Dart_NewString("runOther"), 0, NULL);
+  EXPECT_VALID(result);
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(10 + 1, value);
+  EXPECT_EQ(1, sum.deoptimization_counter());
+}
+
+
+// A polymorphic call is left alone when none of its targets is inlined.
+TEST_CASE(PolymorphicInliningWithoutTargets) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  f(x) => x + 1;\n"
+      "}\n"
+      "class B {\n"
+      "  f(x) => x * 2;\n"
+      "}\n"
+      "sum(list) {\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < list.length; i++) s += list[i].f(i);\n"
+      "  return s;\n"
+      "}\n"
+      "run(n) {\n"
+      "  var objects = [new A(), new B()];\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < n; i++) s += sum(objects);\n"
+      "  return s;\n"
+      "}\n";
+  OptimizationFlagsScope flags(100);
+  FLAG_max_polymorphic_inlining_targets = 0;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle args[1] = { Dart_NewInteger(3000) };
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("run"), 1, args);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(3000 * (1 + 2), value);
+  const Function& sum = Function::Handle(GetFunction("sum"));
+  EXPECT(sum.HasOptimizedCode());
+  EXPECT_EQ(0, sum.deoptimization_counter());
+}
+
+
+TEST_CASE(LoadElimination) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  var x;\n"
+      "  var y;\n"
+      "  A(this.x, this.y);\n"
+      "}\n"
+      "class L {\n"
+      "  static sum(a, n) {\n"
+      "    var s = 0;\n"
+      "    for (var i = 0; i < n; i++) {\n"
+      "      s += a.x;\n"
+      "      a.y = i;\n"
+      "    }\n"
+      "    return s + a.y;\n"
+      "  }\n"
+      "  static aliased(a, b) {\n"
+      "    var s = a.x;\n"
+      "    b.x = 5;\n"
+      "    return s + a.x;\n"
+      "  }\n"
+      "  static called(a) {\n"
+      "    var s = a.x;\n"
+      "    bump(a);\n"
+      "    return s + a.x;\n"
+      "  }\n"
+      "}\n"
+      "bump(a) { a.x = a.x + 1; }\n"
+      "run(n) {\n"
+      "  var a = new A(1, 0);\n"
+      "  var b = new A(2, 0);\n"
+      "  var s = 0;\n"
+      "  for (var i = 0; i < n; i++) {\n"
+      "    a.x = 1;\n"
+      "    b.x = 2;\n"
+      "    s += L.sum(a, 10) + L.aliased(a, b) + L.called(b);\n"
+      "  }\n"
+      "  return s;\n"
+      "}\n"
+      "runAliased() {\n"
+      "  var a = new A(1, 0);\n"
+      "  return L.aliased(a, a);\n"
+      "}\n";
+  OptimizationFlagsScope flags(100);
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle args[1] = { Dart_NewInteger(3000) };
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("run"), 1, args);
+  EXPECT_VALID(result);
+  int64_t value = 0;
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(3000 * ((10 + 9) + (1 + 1) + (5 + 6)), value);
+  const Function& aliased =
+      Function::Handle(GetStaticFunction("L", "aliased"));
+  EXPECT(aliased.HasOptimizedCode());
+
+  // A store through another reference to the same object is seen by the
+  // following load.
+  result = Dart_Invoke(lib, Dart_NewString("runAliased"), 0, NULL);
+  EXPECT_VALID(result);
+  EXPECT_VALID(Dart_IntegerToInt64(result, &value));
+  EXPECT_EQ(1 + 5, value);
+}
+
 #endif  // TARGET_ARCH_IA32 || TARGET_ARCH_X64
 
 }  // namespace dart
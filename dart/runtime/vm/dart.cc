@@ -61,6 +61,7 @@ bool Dart::InitOnce(Dart_IsolateCreateCallback create,
   PortMap::InitOnce();
   FreeListElement::InitOnce();
   Api::InitOnce();
+  ThreadPool::InitOnce();
   // Create the VM isolate and finish the VM initialization.
   ASSERT(thread_pool_ == NULL);
   thread_pool_ = new ThreadPool();
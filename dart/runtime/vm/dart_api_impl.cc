@@ -728,6 +728,66 @@ DART_EXPORT Dart_Handle Dart_HeapProfile(Dart_HeapProfileWriteCallback callback,
   return Api::Success(isolate);
 }
 
+// --- Garbage Collection Events ---
+
+static Heap::Space GcSpaceToHeapSpace(Dart_GcSpace space) {
+  return (space == kGcNewSpace) ? Heap::kNew : Heap::kOld;
+}
+
+
+DART_EXPORT Dart_Handle Dart_GetGcEvents(Dart_GcEvent* events,
+                                         intptr_t* count) {
+  Isolate* isolate = Isolate::Current();
+  CHECK_ISOLATE(isolate);
+  if (events == NULL) {
+    RETURN_NULL_ERROR(events);
+  }
+  if (count == NULL) {
+    RETURN_NULL_ERROR(count);
+  }
+  CHECK_LENGTH(*count, kMaxInt32);
+  const GCEventLog* log = isolate->heap()->gc_events();
+  intptr_t length = log->Length();
+  intptr_t first = (length > *count) ? (length - *count) : 0;
+  for (intptr_t i = first; i < length; i++) {
+    const GCEvent& event = log->At(i);
+    Dart_GcEvent* result = &events[i - first];
+    result->space = (event.space == Heap::kNew) ? kGcNewSpace : kGcOldSpace;
+    result->reason = event.reason;
+    result->start = event.start;
+    result->end = event.end;
+    result->used_before = event.used_before;
+    result->used_after = event.used_after;
+    result->promoted = event.promoted;
+  }
+  *count = length - first;
+  return Api::Success(isolate);
+}
+
+
+DART_EXPORT Dart_Handle Dart_GetGcPauseHistogram(
+    Dart_GcSpace space,
+    Dart_GcPauseHistogram* histogram) {
+  Isolate* isolate = Isolate::Current();
+  CHECK_ISOLATE(isolate);
+  if (histogram == NULL) {
+    RETURN_NULL_ERROR(histogram);
+  }
+  if ((space != kGcNewSpace) && (space != kGcOldSpace)) {
+    return Api::NewError("%s expects argument 'space' to be a Dart_GcSpace.",
+                         CURRENT_FUNC);
+  }
+  const GCEventLog* log = isolate->heap()->gc_events();
+  Heap::Space heap_space = GcSpaceToHeapSpace(space);
+  histogram->count = log->PauseCount(heap_space);
+  histogram->p50 = log->PausePercentile(heap_space, 50);
+  histogram->p90 = log->PausePercentile(heap_space, 90);
+  histogram->p99 = log->PausePercentile(heap_space, 99);
+  histogram->max = log->PausePercentile(heap_space, 100);
+  return Api::Success(isolate);
+}
+
+
 // --- Initialization and Globals ---
 
 DART_EXPORT const char* Dart_VersionString() {
@@ -1037,8 +1097,10 @@ DART_EXPORT bool Dart_Post(Dart_Port port_id, Dart_Handle handle) {
   MessageWriter writer(&data, &allocator);
   writer.WriteMessage(object);
   intptr_t len = writer.BytesWritten();
-  return PortMap::PostMessage(new Message(
-      port_id, Message::kIllegalPort, data, len, Message::kNormalPriority));
+  Message* message = new Message(
+      port_id, Message::kIllegalPort, data, len, Message::kNormalPriority);
+  message->set_transferred_peers(writer.TakeTransferredPeers());
+  return PortMap::PostMessage(message);
 }
 
 
@@ -2183,6 +2245,24 @@ DART_EXPORT Dart_Handle Dart_NewExternalByteArray(uint8_t* data,
 }
 
 
+DART_EXPORT Dart_Handle Dart_NewTransferableExternalByteArray(
+    uint8_t* data,
+    intptr_t length,
+    void* peer,
+    Dart_PeerFinalizer callback) {
+  Isolate* isolate = Isolate::Current();
+  DARTSCOPE(isolate);
+  if (data == NULL && length != 0) {
+    RETURN_NULL_ERROR(data);
+  }
+  CHECK_LENGTH(length, ExternalUint8Array::kMaxElements);
+  const ExternalUint8Array& array = ExternalUint8Array::Handle(
+      isolate, ExternalUint8Array::New(data, length, peer, callback));
+  array.SetTransferable();
+  return Api::NewHandle(isolate, array.raw());
+}
+
+
 DART_EXPORT Dart_Handle Dart_ExternalByteArrayGetPeer(Dart_Handle object,
                                                       void** peer) {
   Isolate* isolate = Isolate::Current();
@@ -2177,6 +2177,38 @@ TEST_CASE(MultipleGarbageCollectionCallbacks) {
   EXPECT_EQ(7, global_epilogue_callback_status);
 }
 
+
+TEST_CASE(GetGcEvents) {
+  Heap* heap = Isolate::Current()->heap();
+  heap->CollectGarbage(Heap::kNew);
+  heap->CollectGarbage(Heap::kOld);
+
+  Dart_GcEvent events[2];
+  intptr_t count = 2;
+  EXPECT_VALID(Dart_GetGcEvents(events, &count));
+  EXPECT_EQ(2, count);
+  EXPECT_EQ(kGcNewSpace, events[0].space);
+  EXPECT_STREQ(Heap::GCReasonToString(Heap::kNewSpace), events[0].reason);
+  EXPECT_EQ(kGcOldSpace, events[1].space);
+  EXPECT_STREQ(Heap::GCReasonToString(Heap::kOldSpace), events[1].reason);
+  for (intptr_t i = 0; i < count; i++) {
+    EXPECT(events[i].start <= events[i].end);
+    EXPECT(events[i].used_before >= 0);
+    EXPECT(events[i].used_after >= 0);
+    EXPECT(events[i].promoted >= 0);
+  }
+  EXPECT(events[0].end <= events[1].start);
+
+  Dart_GcPauseHistogram histogram;
+  EXPECT_VALID(Dart_GetGcPauseHistogram(kGcOldSpace, &histogram));
+  EXPECT(histogram.count >= 1);
+  EXPECT(histogram.p50 <= histogram.p90);
+  EXPECT(histogram.p90 <= histogram.p99);
+  EXPECT(histogram.p99 <= histogram.max);
+  EXPECT(Dart_IsError(Dart_GetGcEvents(NULL, &count)));
+  EXPECT(Dart_IsError(Dart_GetGcPauseHistogram(kGcNewSpace, NULL)));
+}
+
 #endif
 
 
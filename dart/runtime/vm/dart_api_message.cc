@@ -373,6 +373,22 @@ Dart_CObject* ApiMessageReader::ReadInternalVMObject(intptr_t class_id,
       }
       return object;
     }
+    case kExternalUint8ArrayCid: {
+      // A transferred external byte array. The receiver of the message now
+      // owns the data and is responsible for calling the callback.
+      Dart_CObject* object =
+          AllocateDartCObject(Dart_CObject::kExternalUint8Array);
+      AddBackRef(object_id, object, kIsDeserialized);
+      object->value.as_external_byte_array.length = ReadSmiValue();
+      object->value.as_external_byte_array.data =
+          reinterpret_cast<uint8_t*>(ReadIntptrValue());
+      object->value.as_external_byte_array.peer =
+          reinterpret_cast<void*>(ReadIntptrValue());
+      object->value.as_external_byte_array.callback =
+          reinterpret_cast<Dart_PeerFinalizer>(ReadIntptrValue());
+      ReadIntptrValue();  // Transferable, not used.
+      return object;
+    }
     case kGrowableObjectArrayCid: {
       // A GrowableObjectArray is serialized as its length followed by
       // its backing store. The backing store is an array with a
@@ -786,6 +802,7 @@ void ApiMessageWriter::WriteCObjectInlined(Dart_CObject* object,
       WriteIntptrValue(reinterpret_cast<intptr_t>(data));
       WriteIntptrValue(reinterpret_cast<intptr_t>(peer));
       WriteIntptrValue(reinterpret_cast<intptr_t>(callback));
+      WriteIntptrValue(0);  // Not transferable.
       break;
     }
     default:
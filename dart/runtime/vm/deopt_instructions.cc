@@ -71,11 +71,10 @@ class DeoptStackSlotInstr : public DeoptInstr {
     return chars;
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     intptr_t from_index =
        deopt_context->from_frame_size() - stack_slot_index_ - 1;
     intptr_t* from_addr = deopt_context->GetFromFrameAddressAt(from_index);
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *to_addr = *from_addr;
   }
 
@@ -104,12 +103,11 @@ class DeoptDoubleStackSlotInstr : public DeoptInstr {
     return chars;
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     intptr_t from_index =
        deopt_context->from_frame_size() - stack_slot_index_ - 1;
     double* from_addr = reinterpret_cast<double*>(
         deopt_context->GetFromFrameAddressAt(from_index));
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *reinterpret_cast<RawSmi**>(to_addr) = Smi::New(0);
     Isolate::Current()->DeferDoubleMaterialization(
         *from_addr, reinterpret_cast<RawDouble**>(to_addr));
@@ -140,12 +138,11 @@ class DeoptInt64StackSlotInstr : public DeoptInstr {
     return chars;
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     intptr_t from_index =
        deopt_context->from_frame_size() - stack_slot_index_ - 1;
     int64_t* from_addr = reinterpret_cast<int64_t*>(
         deopt_context->GetFromFrameAddressAt(from_index));
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *reinterpret_cast<RawSmi**>(to_addr) = Smi::New(0);
     if (Smi::IsValid64(*from_addr)) {
       *to_addr = reinterpret_cast<intptr_t>(
@@ -193,13 +190,12 @@ class DeoptRetAddrAfterInstr : public DeoptInstr {
     return chars;
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     Function& function = Function::Handle(deopt_context->isolate());
     function ^= deopt_context->ObjectAt(object_table_index_);
     const Code& code =
         Code::Handle(deopt_context->isolate(), function.unoptimized_code());
     uword continue_at_pc = code.GetDeoptAfterPcAtDeoptId(deopt_id_);
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *to_addr = continue_at_pc;
   }
 
@@ -245,13 +241,12 @@ class DeoptRetAddrBeforeInstr : public DeoptInstr {
     return chars;
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     Function& function = Function::Handle(deopt_context->isolate());
     function ^= deopt_context->ObjectAt(object_table_index_);
     const Code& code =
         Code::Handle(deopt_context->isolate(), function.unoptimized_code());
     uword continue_at_pc = code.GetDeoptBeforePcAtDeoptId(deopt_id_);
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *to_addr = continue_at_pc;
   }
 
@@ -286,12 +281,10 @@ class DeoptConstantInstr : public DeoptInstr {
     return chars;
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     const Object& obj = Object::Handle(
         deopt_context->isolate(), deopt_context->ObjectAt(object_table_index_));
-    RawObject** to_addr = reinterpret_cast<RawObject**>(
-        deopt_context->GetToFrameAddressAt(to_index));
-    *to_addr = obj.raw();
+    *reinterpret_cast<RawObject**>(to_addr) = obj.raw();
   }
 
  private:
@@ -314,9 +307,8 @@ class DeoptRegisterInstr: public DeoptInstr {
     return Assembler::RegisterName(reg_);
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     intptr_t value = deopt_context->RegisterValue(reg_);
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *to_addr = value;
   }
 
@@ -340,9 +332,8 @@ class DeoptXmmRegisterInstr: public DeoptInstr {
     return Assembler::XmmRegisterName(reg_);
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     double value = deopt_context->XmmRegisterValue(reg_);
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *reinterpret_cast<RawSmi**>(to_addr) = Smi::New(0);
     Isolate::Current()->DeferDoubleMaterialization(
         value, reinterpret_cast<RawDouble**>(to_addr));
@@ -372,9 +363,8 @@ class DeoptInt64XmmRegisterInstr: public DeoptInstr {
     return chars;
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     int64_t value = deopt_context->XmmRegisterValueAsInt64(reg_);
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *reinterpret_cast<RawSmi**>(to_addr) = Smi::New(0);
     if (Smi::IsValid64(value)) {
       *to_addr = reinterpret_cast<intptr_t>(
@@ -412,14 +402,13 @@ class DeoptPcMarkerInstr : public DeoptInstr {
     return chars;
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     Function& function = Function::Handle(deopt_context->isolate());
     function ^= deopt_context->ObjectAt(object_table_index_);
     const Code& code =
         Code::Handle(deopt_context->isolate(), function.unoptimized_code());
     intptr_t pc_marker = code.EntryPoint() +
                          AssemblerMacros::kOffsetOfSavedPCfromEntrypoint;
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *to_addr = pc_marker;
     // Increment the deoptimization counter. This effectively increments each
     // function occurring in the optimized frame.
@@ -449,9 +438,8 @@ class DeoptCallerFpInstr : public DeoptInstr {
     return "callerfp";
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     intptr_t from = deopt_context->GetCallerFp();
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *to_addr = from;
     deopt_context->SetCallerFp(reinterpret_cast<intptr_t>(to_addr));
   }
@@ -474,9 +462,8 @@ class DeoptCallerPcInstr : public DeoptInstr {
     return "callerpc";
   }
 
-  void Execute(DeoptimizationContext* deopt_context, intptr_t to_index) {
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
     intptr_t from = deopt_context->GetFromPc();
-    intptr_t* to_addr = deopt_context->GetToFrameAddressAt(to_index);
     *to_addr = from;
   }
 
@@ -485,6 +472,71 @@ class DeoptCallerPcInstr : public DeoptInstr {
 };
 
 
+// Deoptimization instruction recreating an object whose allocation was sunk
+// by the optimizing compiler. The descriptor at 'object_table_index' holds
+// the class and the deoptimization instructions copying the field values.
+class DeoptMaterializeObjectInstr : public DeoptInstr {
+ public:
+  explicit DeoptMaterializeObjectInstr(intptr_t object_table_index)
+      : object_table_index_(object_table_index) {
+    ASSERT(object_table_index >= 0);
+  }
+
+  virtual intptr_t from_index() const { return object_table_index_; }
+  virtual DeoptInstr::Kind kind() const { return kMaterializeObject; }
+
+  virtual const char* ToCString() const {
+    const char* format = "mat oti:%"Pd"";
+    intptr_t len = OS::SNPrint(NULL, 0, format, object_table_index_);
+    char* chars = Isolate::Current()->current_zone()->Alloc<char>(len + 1);
+    OS::SNPrint(chars, len + 1, format, object_table_index_);
+    return chars;
+  }
+
+  void Execute(DeoptimizationContext* deopt_context, intptr_t* to_addr) {
+    Isolate* isolate = deopt_context->isolate();
+    Array& descriptor = Array::Handle(isolate);
+    descriptor ^= deopt_context->ObjectAt(object_table_index_);
+    *reinterpret_cast<RawSmi**>(to_addr) = Smi::New(0);
+    // An object referred to from several slots is materialized only once.
+    for (DeferredObject* other = isolate->deferred_objects();
+         other != NULL;
+         other = other->next()) {
+      if (!other->IsAlias() && (other->descriptor() == descriptor.raw())) {
+        isolate->set_deferred_objects(
+            new DeferredObject(other,
+                               reinterpret_cast<RawInstance**>(to_addr),
+                               isolate->deferred_objects()));
+        return;
+      }
+    }
+    const intptr_t field_count = DeferredObject::FieldCount(descriptor);
+    DeferredObject* object =
+        new DeferredObject(descriptor.raw(),
+                           reinterpret_cast<RawInstance**>(to_addr),
+                           field_count,
+                           isolate->deferred_objects());
+    Smi& kind = Smi::Handle(isolate);
+    Smi& from_index = Smi::Handle(isolate);
+    for (intptr_t i = 0; i < field_count; i++) {
+      const intptr_t entry = DeferredObject::kFirstFieldIndex +
+          i * DeferredObject::kFieldEntryLength;
+      kind ^= descriptor.At(entry + 1);
+      from_index ^= descriptor.At(entry + 2);
+      DeoptInstr* copy = DeoptInstr::Create(kind.Value(), from_index.Value());
+      copy->Execute(deopt_context,
+                    reinterpret_cast<intptr_t*>(object->ValueAddressAt(i)));
+    }
+    isolate->set_deferred_objects(object);
+  }
+
+ private:
+  const intptr_t object_table_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeoptMaterializeObjectInstr);
+};
+
+
 DeoptInstr* DeoptInstr::Create(intptr_t kind_as_int, intptr_t from_index) {
   Kind kind = static_cast<Kind>(kind_as_int);
   switch (kind) {
@@ -501,6 +553,8 @@ DeoptInstr* DeoptInstr::Create(intptr_t kind_as_int, intptr_t from_index) {
     case kSetPcMarker:   return new DeoptPcMarkerInstr(from_index);
     case kSetCallerFp:   return new DeoptCallerFpInstr();
     case kSetCallerPc:   return new DeoptCallerPcInstr();
+    case kMaterializeObject:
+        return new DeoptMaterializeObjectInstr(from_index);
   }
   UNREACHABLE();
   return NULL;
@@ -547,41 +601,84 @@ void DeoptInfoBuilder::AddPcMarker(const Function& function,
 }
 
 
-void DeoptInfoBuilder::AddCopy(const Location& from_loc,
-                               const Value& from_value,
-                               const intptr_t to_index) {
-  DeoptInstr* deopt_instr = NULL;
+DeoptInstr* DeoptInfoBuilder::CreateCopyInstr(const Location& from_loc) const {
   if (from_loc.IsConstant()) {
     intptr_t object_table_index = FindOrAddObjectInTable(from_loc.constant());
-    deopt_instr = new DeoptConstantInstr(object_table_index);
+    return new DeoptConstantInstr(object_table_index);
   } else if (from_loc.IsRegister()) {
-    deopt_instr = new DeoptRegisterInstr(from_loc.reg());
+    return new DeoptRegisterInstr(from_loc.reg());
   } else if (from_loc.IsXmmRegister()) {
     if (from_loc.representation() == Location::kDouble) {
-      deopt_instr = new DeoptXmmRegisterInstr(from_loc.xmm_reg());
+      return new DeoptXmmRegisterInstr(from_loc.xmm_reg());
     } else {
       ASSERT(from_loc.representation() == Location::kMint);
-      deopt_instr = new DeoptInt64XmmRegisterInstr(from_loc.xmm_reg());
+      return new DeoptInt64XmmRegisterInstr(from_loc.xmm_reg());
     }
   } else if (from_loc.IsStackSlot()) {
     intptr_t from_index = (from_loc.stack_index() < 0) ?
         from_loc.stack_index() + num_args_ :
         from_loc.stack_index() + num_args_ -
             ParsedFunction::kFirstLocalSlotIndex + 1;
-    deopt_instr = new DeoptStackSlotInstr(from_index);
+    return new DeoptStackSlotInstr(from_index);
   } else if (from_loc.IsDoubleStackSlot()) {
     intptr_t from_index = (from_loc.stack_index() < 0) ?
         from_loc.stack_index() + num_args_ :
         from_loc.stack_index() + num_args_ -
             ParsedFunction::kFirstLocalSlotIndex + 1;
     if (from_loc.representation() == Location::kDouble) {
-      deopt_instr = new DeoptDoubleStackSlotInstr(from_index);
+      return new DeoptDoubleStackSlotInstr(from_index);
     } else {
       ASSERT(from_loc.representation() == Location::kMint);
-      deopt_instr = new DeoptInt64StackSlotInstr(from_index);
+      return new DeoptInt64StackSlotInstr(from_index);
     }
+  }
+  UNREACHABLE();
+  return NULL;
+}
+
+
+intptr_t DeoptInfoBuilder::AddMaterializationDescriptor(
+    const MaterializeObjectInstr& materialization) {
+  for (intptr_t i = 0; i < materializations_.length(); i++) {
+    if (materializations_[i] == &materialization) {
+      return descriptor_indices_[i];
+    }
+  }
+  const intptr_t field_count = materialization.InputCount();
+  const Array& descriptor = Array::Handle(Array::New(
+      DeferredObject::kFirstFieldIndex +
+          field_count * DeferredObject::kFieldEntryLength,
+      Heap::kOld));
+  descriptor.SetAt(DeferredObject::kClassIndex, materialization.cls());
+  Smi& smi = Smi::Handle();
+  for (intptr_t i = 0; i < field_count; i++) {
+    DeoptInstr* copy = CreateCopyInstr(materialization.LocationAt(i));
+    const intptr_t entry = DeferredObject::kFirstFieldIndex +
+        i * DeferredObject::kFieldEntryLength;
+    descriptor.SetAt(entry, materialization.FieldAt(i));
+    smi = Smi::New(copy->kind());
+    descriptor.SetAt(entry + 1, smi);
+    smi = Smi::New(copy->from_index());
+    descriptor.SetAt(entry + 2, smi);
+  }
+  const intptr_t object_table_index = FindOrAddObjectInTable(descriptor);
+  materializations_.Add(&materialization);
+  descriptor_indices_.Add(object_table_index);
+  return object_table_index;
+}
+
+
+void DeoptInfoBuilder::AddCopy(const Location& from_loc,
+                               const Value& from_value,
+                               const intptr_t to_index) {
+  DeoptInstr* deopt_instr = NULL;
+  MaterializeObjectInstr* materialization =
+      from_value.definition()->AsMaterializeObject();
+  if (materialization != NULL) {
+    deopt_instr = new DeoptMaterializeObjectInstr(
+        AddMaterializationDescriptor(*materialization));
   } else {
-    UNREACHABLE();
+    deopt_instr = CreateCopyInstr(from_loc);
   }
   ASSERT(to_index == instructions_.length());
   instructions_.Add(deopt_instr);
@@ -611,6 +708,63 @@ RawDeoptInfo* DeoptInfoBuilder::CreateDeoptInfo() const {
 }
 
 
+DeferredObject::DeferredObject(RawArray* descriptor,
+                               RawInstance** slot,
+                               intptr_t field_count,
+                               DeferredObject* next)
+    : descriptor_(descriptor),
+      slot_(slot),
+      field_count_(field_count),
+      values_(new RawObject*[field_count]),
+      original_(NULL),
+      next_(next) {
+  for (intptr_t i = 0; i < field_count_; i++) {
+    values_[i] = Smi::New(0);
+  }
+}
+
+
+DeferredObject::DeferredObject(DeferredObject* original,
+                               RawInstance** slot,
+                               DeferredObject* next)
+    : descriptor_(original->descriptor()),
+      slot_(slot),
+      field_count_(0),
+      values_(NULL),
+      original_(original),
+      next_(next) {
+}
+
+
+void DeferredObject::Materialize() {
+  if (IsAlias()) {
+    ASSERT(!original_->IsAlias());
+    *slot_ = *original_->slot_;
+    return;
+  }
+  Class& cls = Class::Handle();
+  const Array& descriptor = Array::Handle(descriptor_);
+  cls ^= descriptor.At(kClassIndex);
+  const Instance& object = Instance::Handle(Instance::New(cls));
+  Field& field = Field::Handle();
+  Object& value = Object::Handle();
+  for (intptr_t i = 0; i < field_count_; i++) {
+    field ^= descriptor.At(kFirstFieldIndex + i * kFieldEntryLength);
+    value = values_[i];
+    object.SetField(field, value);
+  }
+  *slot_ = object.raw();
+}
+
+
+void DeferredObject::VisitObjectPointers(ObjectPointerVisitor* visitor) {
+  visitor->VisitPointer(reinterpret_cast<RawObject**>(&descriptor_));
+  if (field_count_ > 0) {
+    visitor->VisitPointers(values_, field_count_);
+  }
+}
+
+
 intptr_t DeoptTable::SizeFor(intptr_t length) {
   return length * kEntrySize;
 }
@@ -9,10 +9,12 @@
 #include "vm/assembler.h"
 #include "vm/growable_array.h"
 #include "vm/object.h"
+#include "vm/visitor.h"
 
 namespace dart {
 
 class Location;
+class MaterializeObjectInstr;
 class Value;
 
 // Holds all data relevant for execution of deoptimization instructions.
@@ -91,8 +93,9 @@ class DeoptInstr : public ZoneAllocated {
 
   virtual const char* ToCString() const = 0;
 
+  // Writes the value for the unoptimized frame to 'to_addr'.
   virtual void Execute(DeoptimizationContext* deopt_context,
-                       intptr_t to_index) = 0;
+                       intptr_t* to_addr) = 0;
 
  protected:
   enum Kind {
@@ -108,6 +111,7 @@ class DeoptInstr : public ZoneAllocated {
     kSetPcMarker,
     kSetCallerFp,
     kSetCallerPc,
+    kMaterializeObject,
   };
 
   virtual DeoptInstr::Kind kind() const = 0;
@@ -131,7 +135,9 @@ class DeoptInfoBuilder : public ValueObject {
                    const intptr_t num_args)
       : instructions_(),
         object_table_(object_table),
-        num_args_(num_args) {}
+        num_args_(num_args),
+        materializations_(),
+        descriptor_indices_() {}
 
   // Return address before instruction.
   void AddReturnAddressBefore(const Function& function,
@@ -156,14 +162,85 @@ class DeoptInfoBuilder : public ValueObject {
  private:
   intptr_t FindOrAddObjectInTable(const Object& obj) const;
 
+  DeoptInstr* CreateCopyInstr(const Location& from_loc) const;
+
+  // Returns the object table index of the descriptor of the object. All
+  // uses of the same materialization share the descriptor, so that they
+  // deoptimize to the same object.
+  intptr_t AddMaterializationDescriptor(
+      const MaterializeObjectInstr& materialization);
+
   GrowableArray<DeoptInstr*> instructions_;
   const GrowableObjectArray& object_table_;
   const intptr_t num_args_;
 
+  GrowableArray<const MaterializeObjectInstr*> materializations_;
+  GrowableArray<intptr_t> descriptor_indices_;
+
   DISALLOW_COPY_AND_ASSIGN(DeoptInfoBuilder);
 };
 
 
+// An object whose allocation was sunk by the optimizing compiler and that is
+// recreated when its frame is deoptimized. The field values are collected
+// while the unoptimized frame is filled; the object itself is allocated in
+// the last step of deoptimization, when GC is safe. Until then the isolate
+// visits the values.
+class DeferredObject {
+ public:
+  // The descriptor in the object table of the optimized code holds the class
+  // followed by a (field, deopt instruction kind, from index) triple for each
+  // field value.
+  enum {
+    kClassIndex = 0,
+    kFirstFieldIndex = 1,
+    kFieldEntryLength = 3,
+  };
+
+  static intptr_t FieldCount(const Array& descriptor) {
+    return (descriptor.Length() - kFirstFieldIndex) / kFieldEntryLength;
+  }
+
+  DeferredObject(RawArray* descriptor,
+                 RawInstance** slot,
+                 intptr_t field_count,
+                 DeferredObject* next);
+
+  // Another slot holding the same object as 'original'.
+  DeferredObject(DeferredObject* original,
+                 RawInstance** slot,
+                 DeferredObject* next);
+  ~DeferredObject() { delete[] values_; }
+
+  RawObject** ValueAddressAt(intptr_t i) const {
+    ASSERT((0 <= i) && (i < field_count_));
+    return &values_[i];
+  }
+
+  RawArray* descriptor() const { return descriptor_; }
+  DeferredObject* next() const { return next_; }
+
+  bool IsAlias() const { return original_ != NULL; }
+
+  // Allocates the object, initializes its fields and stores it into the
+  // slot. May cause GC. Aliases copy the object of their original, which
+  // must have been materialized before.
+  void Materialize();
+
+  void VisitObjectPointers(ObjectPointerVisitor* visitor);
+
+ private:
+  RawArray* descriptor_;
+  RawInstance** const slot_;
+  const intptr_t field_count_;
+  RawObject** values_;
+  DeferredObject* const original_;
+  DeferredObject* const next_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeferredObject);
+};
+
+
 // Utilities for managing the deopt table and its entries.  The table is
 // stored in an Array in the heap.  It consists of triples of (PC offset,
 // info, reason).  Elements of each entry are stored consecutively in the
@@ -484,8 +484,12 @@ void FlowGraph::Rename(GrowableArray<PhiInstr*>* live_phis) {
   graph_entry_->initial_definitions()->Add(constant_null);
 
   // Add incoming parameters to the initial definitions and the renaming
-  // environment.
-  for (intptr_t i = 0; i < parameter_count(); ++i) {
+  // environment. A graph compiled for on-stack replacement is entered with
+  // all locals already in their frame slots, so they are incoming as well.
+  const intptr_t incoming_count = graph_entry_->IsCompiledForOsr()
+      ? variable_count()
+      : parameter_count();
+  for (intptr_t i = 0; i < incoming_count; ++i) {
     ParameterInstr* param = new ParameterInstr(i, graph_entry_);
     param->set_ssa_temp_index(alloc_ssa_temp_index());  // New SSA temp.
     graph_entry_->initial_definitions()->Add(param);
@@ -493,7 +497,7 @@ void FlowGraph::Rename(GrowableArray<PhiInstr*>* live_phis) {
   }
 
   // Initialize all locals with #null in the renaming environment.
-  for (intptr_t i = parameter_count(); i < variable_count(); ++i) {
+  for (intptr_t i = incoming_count; i < variable_count(); ++i) {
     env.Add(constant_null);
   }
 
@@ -900,6 +904,147 @@ void FlowGraph::InlineCall(Definition* call, FlowGraph* callee_graph) {
 }
 
 
+static bool ContainsClassId(const GrowableArray<intptr_t>& class_ids,
+                            intptr_t cid) {
+  for (intptr_t i = 0; i < class_ids.length(); ++i) {
+    if (class_ids[i] == cid) return true;
+  }
+  return false;
+}
+
+
+void FlowGraph::SplitPolymorphicCall(
+    PolymorphicInstanceCallInstr* call,
+    const GrowableArray<intptr_t>& class_ids,
+    GrowableArray<StaticCallInstr*>* direct_calls) {
+  ASSERT(call->with_checks());
+  ASSERT(!class_ids.is_empty());
+  InstanceCallInstr* instance_call = call->instance_call();
+  const ICData& ic_data = call->ic_data();
+  const intptr_t argument_count = call->ArgumentCount();
+  BlockEntryInstr* caller_entry = call->GetBlock();
+  const intptr_t try_index = caller_entry->try_index();
+
+  // Receivers of other classes are checked by a new polymorphic call.
+  const ICData& remaining_checks = ICData::ZoneHandle(
+      ICData::New(Function::Handle(ic_data.function()),
+                  String::Handle(ic_data.target_name()),
+                  ic_data.deopt_id(),
+                  ic_data.num_args_tested()));
+  Function& target = Function::Handle();
+  for (intptr_t i = 0; i < ic_data.NumberOfChecks(); ++i) {
+    const intptr_t cid = ic_data.GetReceiverClassIdAt(i);
+    if (!ContainsClassId(class_ids, cid)) {
+      target = ic_data.GetTargetAt(i);
+      remaining_checks.AddReceiverCheck(cid, target);
+    }
+  }
+  const bool with_checks = true;
+  PolymorphicInstanceCallInstr* fallback_call =
+      new PolymorphicInstanceCallInstr(instance_call,
+                                       remaining_checks,
+                                       with_checks);
+  fallback_call->set_ssa_temp_index(alloc_ssa_temp_index());
+  fallback_call->set_env(call->env());
+
+  // The arguments are pushed in each of the branches, so detach the pushes
+  // from the caller block. They are reused by the fallback call. As when
+  // inlining, environments refer to the pushed values instead.
+  for (intptr_t i = 0; i < argument_count; ++i) {
+    PushArgumentInstr* push = call->ArgumentAt(i);
+    push->ReplaceUsesWith(push->value()->definition());
+    push->RemoveFromGraph();
+  }
+  Instruction* current = call->previous();
+  Definition* receiver = call->ArgumentAt(0)->value()->definition();
+  LoadClassIdInstr* load_cid = new LoadClassIdInstr(new Value(receiver));
+  load_cid->set_ssa_temp_index(alloc_ssa_temp_index());
+  current->LinkTo(load_cid);
+  current = load_cid;
+
+  JoinEntryInstr* join = new JoinEntryInstr(++max_block_id_, try_index);
+  GrowableArray<Definition*> results(class_ids.length() + 1);
+  for (intptr_t i = 0; i < class_ids.length(); ++i) {
+    ConstantInstr* cid =
+        new ConstantInstr(Smi::ZoneHandle(Smi::New(class_ids[i])));
+    cid->set_ssa_temp_index(alloc_ssa_temp_index());
+    current->LinkTo(cid);
+    StrictCompareInstr* compare =
+        new StrictCompareInstr(Token::kEQ_STRICT,
+                               new Value(load_cid),
+                               new Value(cid));
+    BranchInstr* branch = new BranchInstr(compare);
+    cid->LinkTo(branch);
+    TargetEntryInstr* if_true = new TargetEntryInstr(++max_block_id_,
+                                                     try_index);
+    TargetEntryInstr* if_false = new TargetEntryInstr(++max_block_id_,
+                                                      try_index);
+    *branch->true_successor_address() = if_true;
+    *branch->false_successor_address() = if_false;
+
+    // Push a copy of the arguments and call the target directly.
+    ZoneGrowableArray<PushArgumentInstr*>* arguments =
+        new ZoneGrowableArray<PushArgumentInstr*>(argument_count);
+    Instruction* last = if_true;
+    for (intptr_t j = 0; j < argument_count; ++j) {
+      PushArgumentInstr* push = new PushArgumentInstr(
+          new Value(call->ArgumentAt(j)->value()->definition()));
+      arguments->Add(push);
+      last->LinkTo(push);
+      last = push;
+    }
+    const Function& direct_target = Function::ZoneHandle(
+        ic_data.GetTargetForReceiverClassId(class_ids[i]));
+    ASSERT(!direct_target.IsNull());
+    StaticCallInstr* direct_call =
+        new StaticCallInstr(instance_call->token_pos(),
+                            direct_target,
+                            instance_call->argument_names(),
+                            arguments,
+                            instance_call->deopt_id());
+    direct_call->set_ssa_temp_index(alloc_ssa_temp_index());
+    call->env()->DeepCopyTo(direct_call);
+    last->LinkTo(direct_call);
+    direct_call->Goto(join);
+    join->predecessors_.Add(if_true);
+    results.Add(direct_call);
+    direct_calls->Add(direct_call);
+    current = if_false;
+  }
+  for (intptr_t i = 0; i < argument_count; ++i) {
+    current->LinkTo(call->ArgumentAt(i));
+    current = call->ArgumentAt(i);
+  }
+  current->LinkTo(fallback_call);
+  fallback_call->Goto(join);
+  join->predecessors_.Add(current->GetBlock());
+  results.Add(fallback_call);
+
+  // If the call has uses, create a phi of the results.
+  if ((call->input_use_list() != NULL) || (call->env_use_list() != NULL)) {
+    intptr_t env_count = call->env()->Length() - argument_count;
+    join->InsertPhi(env_count, env_count + 1);
+    PhiInstr* phi = join->phis()->Last();
+    phi->set_ssa_temp_index(alloc_ssa_temp_index());
+    phi->mark_alive();
+    for (intptr_t i = 0; i < results.length(); ++i) {
+      phi->SetInputAt(i, new Value(results[i]));
+    }
+    call->ReplaceUsesWith(phi);
+  }
+  join->LinkTo(call->next());
+  call->set_previous(NULL);
+  call->set_next(NULL);
+
+  // The caller block is split and its tail moves to the join.
+  ReorderPhis(caller_entry);
+  DiscoverBlocks();
+  GrowableArray<BitVector*> dominance_frontier;
+  ComputeDominators(&dominance_frontier);
+  ComputeUseLists();
+}
+
+
 intptr_t FlowGraph::InstructionCount() const {
   intptr_t size = 0;
   // Iterate each block, skipping the graph entry.
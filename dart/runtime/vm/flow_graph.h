@@ -15,7 +15,9 @@ class Definition;
 class FlowGraphBuilder;
 class GraphEntryInstr;
 class PhiInstr;
+class PolymorphicInstanceCallInstr;
 class ReturnInstr;
+class StaticCallInstr;
 
 class BlockIterator : public ValueObject {
  public:
@@ -114,6 +116,14 @@ class FlowGraph : public ZoneAllocated {
 
   void InlineCall(Definition* call, FlowGraph* callee_graph);
 
+  // Replaces a polymorphic instance call by tests of the receiver class id
+  // against each of the given class ids followed by a direct call of the
+  // matching target. Other receivers go through a polymorphic call with the
+  // remaining checks. The direct calls are added to 'direct_calls'.
+  void SplitPolymorphicCall(PolymorphicInstanceCallInstr* call,
+                            const GrowableArray<intptr_t>& class_ids,
+                            GrowableArray<StaticCallInstr*>* direct_calls);
+
   // TODO(zerny): Once the SSA is feature complete this should be removed.
   void Bailout(const char* reason) const;
 
@@ -159,8 +159,17 @@ void FlowGraphAllocator::ComputeInitialSets() {
              !env_it.Done();
              env_it.Advance()) {
           Value* value = env_it.CurrentValue();
-          if (!value->definition()->IsPushArgument() &&
-              !value->BindsToConstant()) {
+          MaterializeObjectInstr* mat =
+              value->definition()->AsMaterializeObject();
+          if (mat != NULL) {
+            // The field values of a materialized object are used instead.
+            for (intptr_t k = 0; k < mat->InputCount(); k++) {
+              if (!mat->InputAt(k)->BindsToConstant()) {
+                live_in->Add(mat->InputAt(k)->definition()->ssa_temp_index());
+              }
+            }
+          } else if (!value->definition()->IsPushArgument() &&
+                     !value->BindsToConstant()) {
             live_in->Add(value->definition()->ssa_temp_index());
           }
         }
@@ -534,6 +543,9 @@ void FlowGraphAllocator::BuildLiveRanges() {
     LiveRange* range = GetLiveRange(defn->ssa_temp_index());
     range->AddUseInterval(graph_entry->start_pos(), graph_entry->end_pos());
     range->DefineAt(graph_entry->start_pos());
+    // Copied parameters and, when entering through on-stack replacement,
+    // locals live in the spill area of the frame.
+    bool is_spilled_parameter = false;
     if (defn->IsParameter()) {
       ParameterInstr* param = defn->AsParameter();
       // Assert that copied and non-copied parameters are mutually exclusive.
@@ -547,9 +559,10 @@ void FlowGraphAllocator::BuildLiveRanges() {
 
       range->set_assigned_location(Location::StackSlot(slot_index));
       range->set_spill_slot(Location::StackSlot(slot_index));
-      if (flow_graph_.num_copied_params() > 0) {
+      if (slot_index >= 0) {
         ASSERT(spill_slots_.length() == slot_index);
         spill_slots_.Add(range->End());
+        is_spilled_parameter = true;
       }
       AssignSafepoints(range);
     } else {
@@ -569,7 +582,7 @@ void FlowGraphAllocator::BuildLiveRanges() {
     }
     ConvertAllUses(range);
 
-    if (defn->IsParameter() && flow_graph_.num_copied_params() > 0) {
+    if (is_spilled_parameter) {
       MarkAsObjectAtSafepoints(range);
     }
   }
@@ -772,6 +785,18 @@ void FlowGraphAllocator::ProcessEnvironmentUses(BlockEntryInstr* block,
         continue;
       }
 
+      MaterializeObjectInstr* mat = def->AsMaterializeObject();
+      if (mat != NULL) {
+        // Deoptimization allocates the object from the locations of its
+        // field values. Uses of a materialization are all in the environment
+        // of one instruction.
+        locations[i] = Location::NoLocation();
+        if (mat->locations() == NULL) {
+          ProcessMaterializationUses(block_start_pos, use_pos, mat);
+        }
+        continue;
+      }
+
       const intptr_t vreg = def->ssa_temp_index();
       LiveRange* range = GetLiveRange(vreg);
       range->AddUseInterval(block_start_pos, use_pos);
@@ -784,6 +809,35 @@ void FlowGraphAllocator::ProcessEnvironmentUses(BlockEntryInstr* block,
 }
 
 
+void FlowGraphAllocator::ProcessMaterializationUses(
+    const intptr_t block_start_pos,
+    const intptr_t use_pos,
+    MaterializeObjectInstr* mat) {
+  // Field values are used like values in the environment: they survive
+  // until the end of the instruction but do not need to be in registers.
+  Location* locations =
+      Isolate::Current()->current_zone()->Alloc<Location>(mat->InputCount());
+
+  for (intptr_t i = 0; i < mat->InputCount(); ++i) {
+    Definition* def = mat->InputAt(i)->definition();
+    locations[i] = Location::Any();
+
+    ConstantInstr* constant = def->AsConstant();
+    if (constant != NULL) {
+      locations[i] = Location::Constant(constant->value());
+      continue;
+    }
+
+    const intptr_t vreg = def->ssa_temp_index();
+    LiveRange* range = GetLiveRange(vreg);
+    range->AddUseInterval(block_start_pos, use_pos);
+    range->AddUse(use_pos, &locations[i]);
+  }
+
+  mat->set_locations(locations);
+}
+
+
 // Create and update live ranges corresponding to instruction's inputs,
 // temporaries and output.
 void FlowGraphAllocator::ProcessOneInstruction(BlockEntryInstr* block,
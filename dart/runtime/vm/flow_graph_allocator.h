@@ -96,6 +96,9 @@ class FlowGraphAllocator : public ValueObject {
   void BuildLiveRanges();
   Instruction* ConnectOutgoingPhiMoves(BlockEntryInstr* block);
   void ProcessEnvironmentUses(BlockEntryInstr* block, Instruction* current);
+  void ProcessMaterializationUses(const intptr_t block_start_pos,
+                                  const intptr_t use_pos,
+                                  MaterializeObjectInstr* mat);
   void ProcessOneInstruction(BlockEntryInstr* block, Instruction* instr);
   void ConnectIncomingPhiMoves(BlockEntryInstr* block);
   void BlockLocation(Location loc, intptr_t from, intptr_t to);
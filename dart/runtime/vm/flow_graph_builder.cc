@@ -5,6 +5,7 @@
 #include "vm/flow_graph_builder.h"
 
 #include "vm/ast_printer.h"
+#include "vm/bit_vector.h"
 #include "vm/code_descriptors.h"
 #include "vm/dart_entry.h"
 #include "vm/flags.h"
@@ -1196,7 +1197,7 @@ void EffectGraphVisitor::VisitWhileNode(WhileNode* node) {
 
   EffectGraphVisitor for_body(owner(), temp_index());
   for_body.AddInstruction(
-      new CheckStackOverflowInstr(node->token_pos()));
+      new CheckStackOverflowInstr(node->token_pos(), true));
   node->body()->Visit(&for_body);
 
   // Labels are set after body traversal.
@@ -1228,7 +1229,7 @@ void EffectGraphVisitor::VisitDoWhileNode(DoWhileNode* node) {
   // Traverse body first in order to generate continue and break labels.
   EffectGraphVisitor for_body(owner(), temp_index());
   for_body.AddInstruction(
-      new CheckStackOverflowInstr(node->token_pos()));
+      new CheckStackOverflowInstr(node->token_pos(), true));
   node->body()->Visit(&for_body);
 
   TestGraphVisitor for_test(owner(),
@@ -1287,7 +1288,7 @@ void EffectGraphVisitor::VisitForNode(ForNode* node) {
   // Compose body to set any jump labels.
   EffectGraphVisitor for_body(owner(), temp_index());
   for_body.AddInstruction(
-      new CheckStackOverflowInstr(node->token_pos()));
+      new CheckStackOverflowInstr(node->token_pos(), true));
   node->body()->Visit(&for_body);
 
   // Join loop body, increment and compute their end instruction.
@@ -2636,7 +2637,8 @@ void EffectGraphVisitor::VisitInlinedFinallyNode(InlinedFinallyNode* node) {
 }
 
 
-FlowGraph* FlowGraphBuilder::BuildGraph(InliningContext context) {
+FlowGraph* FlowGraphBuilder::BuildGraph(InliningContext context,
+                                        intptr_t osr_id) {
   if (FLAG_print_ast) {
     // Print the function ast before IL generation.
     AstPrinter::PrintFunctionNodes(parsed_function());
@@ -2657,7 +2659,8 @@ FlowGraph* FlowGraphBuilder::BuildGraph(InliningContext context) {
   }
   // TODO(kmillikin): We can eliminate stack checks in some cases (e.g., the
   // stack check on entry for leaf routines).
-  Instruction* check = new CheckStackOverflowInstr(function.token_pos());
+  Instruction* check =
+      new CheckStackOverflowInstr(function.token_pos(), false);
   // If we are inlining don't actually attach the stack check. We must still
   // create the stack check inorder to allocate a deopt id.
   if (!InInliningContext()) for_effect.AddInstruction(check);
@@ -2665,12 +2668,73 @@ FlowGraph* FlowGraphBuilder::BuildGraph(InliningContext context) {
   AppendFragment(normal_entry, for_effect);
   // Check that the graph is properly terminated.
   ASSERT(!for_effect.is_open());
+  if (osr_id != Isolate::kNoDeoptId) {
+    ASSERT(!InInliningContext());
+    BuildOsrEntry(osr_id);
+  }
   FlowGraph* graph = new FlowGraph(*this, graph_entry_, last_used_block_id_);
   if (InInliningContext()) graph->set_exits(exits_);
   return graph;
 }
 
 
+// Replace the normal entry of the graph by an entry that jumps directly to
+// the loop stack check with deopt id osr_id, splitting its block if needed.
+// The code before the loop becomes unreachable and is dropped when blocks
+// are discovered. The values of all variables are incoming in their frame
+// slots, see FlowGraph::Rename.
+void FlowGraphBuilder::BuildOsrEntry(intptr_t osr_id) {
+  BitVector* visited = new BitVector(last_used_block_id_ + 1);
+  GrowableArray<BlockEntryInstr*> worklist;
+  worklist.Add(graph_entry_->normal_entry());
+  visited->Add(graph_entry_->normal_entry()->block_id());
+  CheckStackOverflowInstr* check = NULL;
+  BlockEntryInstr* check_block = NULL;
+  while ((check == NULL) && !worklist.is_empty()) {
+    BlockEntryInstr* block = worklist.Last();
+    worklist.RemoveLast();
+    for (Instruction* current = block->next();
+         current != NULL;
+         current = current->next()) {
+      CheckStackOverflowInstr* candidate = current->AsCheckStackOverflow();
+      if ((candidate != NULL) &&
+          candidate->in_loop() &&
+          (candidate->osr_id() == osr_id)) {
+        check = candidate;
+        check_block = block;
+        break;
+      }
+      for (intptr_t i = 0; i < current->SuccessorCount(); ++i) {
+        BlockEntryInstr* successor = current->SuccessorAt(i);
+        if (!visited->Contains(successor->block_id())) {
+          visited->Add(successor->block_id());
+          worklist.Add(successor);
+        }
+      }
+    }
+  }
+  if (check == NULL) {
+    Bailout("On-stack replacement entry not found");
+  }
+  if (check_block->try_index() != CatchClauseNode::kInvalidTryIndex) {
+    Bailout("On-stack replacement inside try");
+  }
+
+  JoinEntryInstr* loop_entry = check->previous()->AsJoinEntry();
+  if (loop_entry == NULL) {
+    loop_entry = new JoinEntryInstr(AllocateBlockId(),
+                                    CatchClauseNode::kInvalidTryIndex);
+    check->previous()->LinkTo(new GotoInstr(loop_entry));
+    loop_entry->LinkTo(check);
+  }
+  TargetEntryInstr* osr_entry =
+      new TargetEntryInstr(AllocateBlockId(),
+                           CatchClauseNode::kInvalidTryIndex);
+  osr_entry->LinkTo(new GotoInstr(loop_entry));
+  graph_entry_->SetOsrEntry(osr_entry, osr_id);
+}
+
+
 void FlowGraphBuilder::Bailout(const char* reason) {
   const char* kFormat = "FlowGraphBuilder Bailout: %s %s";
   const char* function_name = parsed_function_.function().ToCString();
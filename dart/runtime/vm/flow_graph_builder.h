@@ -28,7 +28,9 @@ class FlowGraphBuilder: public ValueObject {
     kTestContext
   };
 
-  FlowGraph* BuildGraph(InliningContext context);
+  // If osr_id is a deopt id, the graph is entered directly at the loop stack
+  // check with that deopt id (on-stack replacement).
+  FlowGraph* BuildGraph(InliningContext context, intptr_t osr_id);
 
   const ParsedFunction& parsed_function() const { return parsed_function_; }
 
@@ -75,6 +77,8 @@ class FlowGraphBuilder: public ValueObject {
     return parameter_count() + num_stack_locals_;
   }
 
+  void BuildOsrEntry(intptr_t osr_id);
+
   const ParsedFunction& parsed_function_;
 
   const intptr_t num_copied_params_;
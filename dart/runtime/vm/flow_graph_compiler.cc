@@ -54,7 +54,8 @@ void CompilerDeoptInfo::AllocateIncomingParametersRecursive(
   if (env == NULL) return;
   AllocateIncomingParametersRecursive(env->outer(), stack_height);
   for (Environment::ShallowIterator it(env); !it.Done(); it.Advance()) {
-    if (it.CurrentLocation().IsInvalid()) {
+    if (it.CurrentLocation().IsInvalid() &&
+        !it.CurrentValue()->definition()->IsMaterializeObject()) {
       ASSERT(it.CurrentValue()->definition()->IsPushArgument());
       it.SetCurrentLocation(Location::StackSlot((*stack_height)++));
     }
@@ -231,6 +232,12 @@ void FlowGraphCompiler::Bailout(const char* reason) {
 }
 
 
+bool FlowGraphCompiler::IsCompilingForOsr() const {
+  return is_optimizing_ &&
+      block_order_[0]->AsGraphEntry()->IsCompiledForOsr();
+}
+
+
 intptr_t FlowGraphCompiler::StackSize() const {
   if (is_optimizing_) {
     return block_order_[0]->AsGraphEntry()->spill_slot_count();
@@ -502,6 +509,29 @@ const ICData& FlowGraphCompiler::GenerateInstanceCall(
 }
 
 
+void FlowGraphCompiler::GenerateMegamorphicInstanceCall(
+    intptr_t deopt_id,
+    intptr_t token_pos,
+    const String& function_name,
+    intptr_t argument_count,
+    const Array& argument_names,
+    LocationSummary* locs) {
+  // The ic-data is only used to resolve the call when the cache misses.
+  const intptr_t kNumArgsChecked = 1;
+  const ICData& ic_data =
+      ICData::ZoneHandle(ICData::New(parsed_function().function(),
+                                     function_name,
+                                     deopt_id,
+                                     kNumArgsChecked));
+  const Array& arguments_descriptor =
+      DartEntry::ArgumentsDescriptor(argument_count, argument_names);
+  const MegamorphicCache& cache = MegamorphicCache::ZoneHandle(
+      MegamorphicCache::ForSelector(function_name, arguments_descriptor));
+  EmitMegamorphicInstanceCall(ic_data, cache, arguments_descriptor,
+                              argument_count, deopt_id, token_pos, locs);
+}
+
+
 void FlowGraphCompiler::GenerateStaticCall(intptr_t deopt_id,
                                            intptr_t token_pos,
                                            const Function& function,
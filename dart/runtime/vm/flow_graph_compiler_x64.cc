@@ -906,17 +906,7 @@ void FlowGraphCompiler::GenerateInlinedSetter(intptr_t offset) {
 }
 
 
-void FlowGraphCompiler::CompileGraph() {
-  InitCompiler();
-  if (TryIntrinsify()) {
-    // Although this intrinsified code will never be patched, it must satisfy
-    // CodePatcher::CodeIsPatchable, which verifies that this code has a minimum
-    // code size, and nop(2) increases the minimum code size appropriately.
-    __ nop(2);
-    __ int3();
-    __ jmp(&StubCode::FixCallersTargetLabel());
-    return;
-  }
+void FlowGraphCompiler::EmitFrameEntry() {
   // Specialized version of entry code from CodeGenerator::GenerateEntryCode.
   const Function& function = parsed_function().function();
 
@@ -996,6 +986,31 @@ void FlowGraphCompiler::CompileGraph() {
       __ movq(Address(RBP, (slot_base - i) * kWordSize), RAX);
     }
   }
+}
+
+
+void FlowGraphCompiler::CompileGraph() {
+  InitCompiler();
+  if (IsCompilingForOsr()) {
+    // The frame of the unoptimized code being replaced is reused: the
+    // parameters and locals stay in their slots and only the spill area
+    // is resized.
+    __ Comment("Enter frame for on-stack replacement");
+    // + 1 for PC marker.
+    __ leaq(RSP, Address(RBP, -(StackSize() + 1) * kWordSize));
+  } else {
+    if (TryIntrinsify()) {
+      // Although this intrinsified code will never be patched, it must
+      // satisfy CodePatcher::CodeIsPatchable, which verifies that this code
+      // has a minimum code size, and nop(2) increases the minimum code size
+      // appropriately.
+      __ nop(2);
+      __ int3();
+      __ jmp(&StubCode::FixCallersTargetLabel());
+      return;
+    }
+    EmitFrameEntry();
+  }
 
   if (FLAG_print_scopes) {
     // Print the function scope (again) after generating the prologue in order
@@ -1084,6 +1099,22 @@ void FlowGraphCompiler::EmitInstanceCall(ExternalLabel* target_label,
 }
 
 
+void FlowGraphCompiler::EmitMegamorphicInstanceCall(
+    const ICData& ic_data,
+    const MegamorphicCache& cache,
+    const Array& arguments_descriptor,
+    intptr_t argument_count,
+    intptr_t deopt_id,
+    intptr_t token_pos,
+    LocationSummary* locs) {
+  __ LoadObject(RDI, cache);
+  ExternalLabel target_label("MegamorphicLookup",
+                             StubCode::MegamorphicLookupEntryPoint());
+  EmitInstanceCall(&target_label, ic_data, arguments_descriptor,
+                   argument_count, deopt_id, token_pos, locs);
+}
+
+
 void FlowGraphCompiler::EmitStaticCall(const Function& function,
                                        const Array& arguments_descriptor,
                                        intptr_t argument_count,
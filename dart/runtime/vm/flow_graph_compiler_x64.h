@@ -52,6 +52,10 @@ class FlowGraphCompiler : public ValueObject {
   static bool CanOptimize();
   bool is_optimizing() const { return is_optimizing_; }
 
+  // Returns true if the code is entered from a running activation of the
+  // unoptimized code (on-stack replacement).
+  bool IsCompilingForOsr() const;
+
   const GrowableArray<BlockInfo*>& block_info() const { return block_info_; }
   ParallelMoveResolver* parallel_move_resolver() {
     return &parallel_move_resolver_;
@@ -111,6 +115,15 @@ class FlowGraphCompiler : public ValueObject {
                                      intptr_t checked_argument_count,
                                      LocationSummary* locs);
 
+  // Calls through the megamorphic cache of the selector instead of an inline
+  // cache.
+  void GenerateMegamorphicInstanceCall(intptr_t deopt_id,
+                                       intptr_t token_pos,
+                                       const String& function_name,
+                                       intptr_t argument_count,
+                                       const Array& argument_names,
+                                       LocationSummary* locs);
+
   void GenerateStaticCall(intptr_t deopt_id,
                           intptr_t token_pos,
                           const Function& function,
@@ -138,6 +151,14 @@ class FlowGraphCompiler : public ValueObject {
                         intptr_t token_pos,
                         LocationSummary* locs);
 
+  void EmitMegamorphicInstanceCall(const ICData& ic_data,
+                                   const MegamorphicCache& cache,
+                                   const Array& arguments_descriptor,
+                                   intptr_t argument_count,
+                                   intptr_t deopt_id,
+                                   intptr_t token_pos,
+                                   LocationSummary* locs);
+
   void EmitTestAndCall(const ICData& ic_data,
                        Register class_id_reg,
                        intptr_t arg_count,
@@ -275,6 +296,7 @@ class FlowGraphCompiler : public ValueObject {
 
   void GenerateBoolToJump(Register bool_reg, Label* is_true, Label* is_false);
 
+  void EmitFrameEntry();
   void CopyParameters();
 
   void GenerateInlinedGetter(intptr_t offset);
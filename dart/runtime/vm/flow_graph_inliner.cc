@@ -4,6 +4,7 @@
 
 #include "vm/flow_graph_inliner.h"
 
+#include "vm/bit_vector.h"
 #include "vm/compiler.h"
 #include "vm/flags.h"
 #include "vm/flow_graph.h"
@@ -23,6 +24,18 @@ DEFINE_FLAG(int, inlining_size_threshold, 250,
     "Inline only functions with up to threshold instructions (default 250)");
 DEFINE_FLAG(int, inlining_depth_threshold, 1,
     "Inline recursively up to threshold depth (default 1)");
+DEFINE_FLAG(int, inlining_leaf_size_threshold, 25,
+    "Inline leaf functions with up to threshold instructions called from a "
+    "loop beyond the depth threshold (default 25)");
+DEFINE_FLAG(int, inlining_leaf_depth_threshold, 3,
+    "Inline small leaf functions recursively up to threshold depth "
+    "(default 3)");
+DEFINE_FLAG(int, inlining_growth_factor, 4,
+    "Stop inlining when the inlined instructions exceed threshold times the "
+    "caller size or the size threshold, whichever is larger (default 4)");
+DEFINE_FLAG(int, max_polymorphic_inlining_targets, 4,
+    "Inline up to threshold receiver classes of a polymorphic call "
+    "(default 4)");
 DEFINE_FLAG(bool, inline_control_flow, true,
     "Inline functions with control flow.");
 DECLARE_FLAG(bool, print_flow_graph);
@@ -46,6 +59,67 @@ static bool IsCallRecursive(const Function& function, Definition* call) {
 }
 
 
+// Test if a graph contains calls to other Dart functions.
+static bool IsLeafGraph(FlowGraph* graph) {
+  for (BlockIterator block_it = graph->postorder_iterator();
+       !block_it.Done();
+       block_it.Advance()) {
+    for (ForwardInstructionIterator it(block_it.Current());
+         !it.Done();
+         it.Advance()) {
+      Instruction* current = it.Current();
+      if (current->IsStaticCall() ||
+          current->IsInstanceCall() ||
+          current->IsPolymorphicInstanceCall() ||
+          current->IsClosureCall()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+// A call site with an estimate of its execution frequency. ICData does not
+// record call counts, so the estimate is the loop nesting depth of the call
+// site and the usage counter of the function containing it.
+struct CallSiteInfo {
+  Definition* call;
+  intptr_t loop_depth;
+  intptr_t usage_counter;
+};
+
+
+static int HighestFrequencyFirst(const CallSiteInfo* a,
+                                 const CallSiteInfo* b) {
+  if (a->loop_depth != b->loop_depth) {
+    return (a->loop_depth > b->loop_depth) ? -1 : 1;
+  }
+  if (a->usage_counter != b->usage_counter) {
+    return (a->usage_counter > b->usage_counter) ? -1 : 1;
+  }
+  return 0;
+}
+
+
+// A receiver class of a polymorphic call and the usage counter of its
+// target.
+struct ReceiverTarget {
+  intptr_t class_id;
+  intptr_t check_index;
+  intptr_t usage_counter;
+};
+
+
+static int MostUsedTargetFirst(const ReceiverTarget* a,
+                               const ReceiverTarget* b) {
+  if (a->usage_counter != b->usage_counter) {
+    return (a->usage_counter > b->usage_counter) ? -1 : 1;
+  }
+  return 0;
+}
+
+
 // A collection of call sites to consider for inlining.
 class CallSites : public FlowGraphVisitor {
  public:
@@ -120,7 +194,11 @@ class CallSiteInliner : public ValueObject {
         inlined_(false),
         initial_size_(flow_graph->InstructionCount()),
         inlined_size_(0),
+        growth_budget_(Utils::Maximum<intptr_t>(initial_size_,
+                                                FLAG_inlining_size_threshold) *
+                       FLAG_inlining_growth_factor),
         inlining_depth_(1),
+        current_loop_depth_(0),
         collected_call_sites_(NULL),
         inlining_call_sites_(NULL) { }
 
@@ -142,10 +220,20 @@ class CallSiteInliner : public ValueObject {
       collected_call_sites_ = inlining_call_sites_;
       inlining_call_sites_ = call_sites_temp;
       collected_call_sites_->Clear();
-      // Inline call sites at the current depth.
-      InlineStaticCalls();
-      InlineClosureCalls();
-      InlineInstanceCalls();
+      // Inline call sites at the current depth, most frequent first.
+      GrowableArray<CallSiteInfo> sites;
+      RankCallSites(&sites);
+      for (intptr_t i = 0; i < sites.length(); ++i) {
+        current_loop_depth_ = sites[i].loop_depth;
+        Definition* call = sites[i].call;
+        if (call->IsStaticCall()) {
+          InlineStaticCall(call->AsStaticCall());
+        } else if (call->IsClosureCall()) {
+          InlineClosureCall(call->AsClosureCall());
+        } else {
+          InlineInstanceCall(call->AsPolymorphicInstanceCall());
+        }
+      }
       // Increment the inlining depth. Checked before recursive inlining.
       ++inlining_depth_;
     }
@@ -161,9 +249,69 @@ class CallSiteInliner : public ValueObject {
   }
 
  private:
+  intptr_t MaxInliningDepth() const {
+    return Utils::Maximum(FLAG_inlining_depth_threshold,
+                          FLAG_inlining_leaf_depth_threshold);
+  }
+
+  // Collects the call sites to inline at the current depth and sorts them
+  // by their estimated frequency.
+  void RankCallSites(GrowableArray<CallSiteInfo>* sites) {
+    GrowableArray<Definition*> calls;
+    const GrowableArray<StaticCallInstr*>& static_calls =
+        *inlining_call_sites_->static_calls();
+    for (intptr_t i = 0; i < static_calls.length(); ++i) {
+      calls.Add(static_calls[i]);
+    }
+    const GrowableArray<ClosureCallInstr*>& closure_calls =
+        *inlining_call_sites_->closure_calls();
+    for (intptr_t i = 0; i < closure_calls.length(); ++i) {
+      calls.Add(closure_calls[i]);
+    }
+    const GrowableArray<PolymorphicInstanceCallInstr*>& instance_calls =
+        *inlining_call_sites_->instance_calls();
+    for (intptr_t i = 0; i < instance_calls.length(); ++i) {
+      calls.Add(instance_calls[i]);
+    }
+    TRACE_INLINING(OS::Print("  Call sites (%d)\n", calls.length()));
+
+    GrowableArray<BlockEntryInstr*> loop_headers;
+    caller_graph_->ComputeLoops(&loop_headers);
+    for (intptr_t i = 0; i < calls.length(); ++i) {
+      Definition* call = calls[i];
+      const intptr_t block_index = call->GetBlock()->preorder_number();
+      CallSiteInfo info;
+      info.call = call;
+      info.loop_depth = 0;
+      for (intptr_t j = 0; j < loop_headers.length(); ++j) {
+        // A header with several back edges is listed once per edge.
+        if ((j > 0) && (loop_headers[j] == loop_headers[j - 1])) continue;
+        if (loop_headers[j]->loop_info()->Contains(block_index)) {
+          ++info.loop_depth;
+        }
+      }
+      info.usage_counter = (call->env() == NULL)
+          ? 0
+          : call->env()->function().usage_counter();
+      sites->Add(info);
+    }
+    sites->Sort(HighestFrequencyFirst);
+  }
+
   bool TryInlining(const Function& function,
                    GrowableArray<Value*>* arguments,
                    Definition* call) {
+    return TryInlining(function, arguments, call, NULL);
+  }
+
+  // If checked_size is not NULL, only checks whether the call could be
+  // inlined without changing the caller graph. The size of the callee graph
+  // is then added to *checked_size, which counts against the growth budget
+  // of the caller in addition to what has been inlined.
+  bool TryInlining(const Function& function,
+                   GrowableArray<Value*>* arguments,
+                   Definition* call,
+                   intptr_t* checked_size) {
     TRACE_INLINING(OS::Print("  => %s (deopt count %d)\n",
                              function.ToCString(),
                              function.deoptimization_counter()));
@@ -174,6 +322,15 @@ class CallSiteInliner : public ValueObject {
       return false;
     }
 
+    // Beyond the depth threshold only calls from loops are inlined.
+    const bool beyond_depth_threshold =
+        (inlining_depth_ > FLAG_inlining_depth_threshold);
+    if (beyond_depth_threshold && (current_loop_depth_ == 0)) {
+      TRACE_INLINING(OS::Print("     Bailout: cold call beyond depth %"Pd"\n",
+                               inlining_depth_));
+      return false;
+    }
+
     // Abort if the callee has optional parameters.
     if (function.HasOptionalParameters()) {
       TRACE_INLINING(OS::Print("     Bailout: optional parameters\n"));
@@ -233,13 +390,15 @@ class CallSiteInliner : public ValueObject {
       FlowGraphBuilder builder(parsed_function);
       builder.SetInitialBlockId(caller_graph_->max_block_id());
       FlowGraph* callee_graph =
-          builder.BuildGraph(FlowGraphBuilder::kValueContext);
+          builder.BuildGraph(FlowGraphBuilder::kValueContext,
+                             Isolate::kNoDeoptId);
 
       // Abort if the callee graph contains control flow.
       if (!FLAG_inline_control_flow &&
           (callee_graph->preorder().length() != 2)) {
         function.set_is_inlinable(false);
         isolate->set_long_jump_base(base);
+        isolate->set_deopt_id(prev_deopt_id);
         isolate->set_ic_data_array(prev_ic_data.raw());
         TRACE_INLINING(OS::Print("     Bailout: control flow\n"));
         return false;
@@ -273,8 +432,40 @@ class CallSiteInliner : public ValueObject {
         return false;
       }
 
-      // If depth is less or equal to threshold recursively add call sites.
-      if (inlining_depth_ < FLAG_inlining_depth_threshold) {
+      // Beyond the depth threshold only small leaf functions are inlined.
+      if (beyond_depth_threshold &&
+          ((size > FLAG_inlining_leaf_size_threshold) ||
+           !IsLeafGraph(callee_graph))) {
+        isolate->set_long_jump_base(base);
+        isolate->set_deopt_id(prev_deopt_id);
+        isolate->set_ic_data_array(prev_ic_data.raw());
+        TRACE_INLINING(OS::Print("     Bailout: not a small leaf at depth "
+                                 "%"Pd"\n", inlining_depth_));
+        return false;
+      }
+
+      // Abort if the callee does not fit in the growth budget of the caller.
+      const intptr_t pending_size = (checked_size == NULL) ? 0 : *checked_size;
+      if ((inlined_size_ + pending_size + size) > growth_budget_) {
+        isolate->set_long_jump_base(base);
+        isolate->set_deopt_id(prev_deopt_id);
+        isolate->set_ic_data_array(prev_ic_data.raw());
+        TRACE_INLINING(OS::Print("     Bailout: growth budget %"Pd"\n",
+                                 growth_budget_));
+        return false;
+      }
+
+      if (checked_size != NULL) {
+        *checked_size += size;
+        isolate->set_long_jump_base(base);
+        isolate->set_deopt_id(prev_deopt_id);
+        isolate->set_ic_data_array(prev_ic_data.raw());
+        TRACE_INLINING(OS::Print("     Inlinable\n"));
+        return true;
+      }
+
+      // If depth is less than the maximum depth recursively add call sites.
+      if (inlining_depth_ < MaxInliningDepth()) {
         collected_call_sites_->FindCallSites(callee_graph);
       }
 
@@ -329,62 +520,98 @@ class CallSiteInliner : public ValueObject {
     }
   }
 
-  void InlineStaticCalls() {
-    const GrowableArray<StaticCallInstr*>& calls =
-        *inlining_call_sites_->static_calls();
-    TRACE_INLINING(OS::Print("  Static Calls (%d)\n", calls.length()));
-    for (intptr_t i = 0; i < calls.length(); ++i) {
-      StaticCallInstr* call = calls[i];
-      GrowableArray<Value*> arguments(call->ArgumentCount());
-      for (int i = 0; i < call->ArgumentCount(); ++i) {
-        arguments.Add(call->ArgumentAt(i)->value());
-      }
-      TryInlining(call->function(), &arguments, call);
+  void InlineStaticCall(StaticCallInstr* call) {
+    GrowableArray<Value*> arguments(call->ArgumentCount());
+    for (int i = 0; i < call->ArgumentCount(); ++i) {
+      arguments.Add(call->ArgumentAt(i)->value());
     }
+    TryInlining(call->function(), &arguments, call);
   }
 
-  void InlineClosureCalls() {
-    const GrowableArray<ClosureCallInstr*>& calls =
-        *inlining_call_sites_->closure_calls();
-    TRACE_INLINING(OS::Print("  Closure Calls (%d)\n", calls.length()));
-    for (intptr_t i = 0; i < calls.length(); ++i) {
-      ClosureCallInstr* call = calls[i];
-      // Find the closure of the callee.
-      ASSERT(call->ArgumentCount() > 0);
-      const CreateClosureInstr* closure =
-          call->ArgumentAt(0)->value()->definition()->AsCreateClosure();
-      if (closure == NULL) {
-        TRACE_INLINING(OS::Print("     Bailout: non-closure operator\n"));
-        continue;
-      }
-      GrowableArray<Value*> arguments(call->ArgumentCount() - 1);
-      for (int i = 1; i < call->ArgumentCount(); ++i) {
-        arguments.Add(call->ArgumentAt(i)->value());
-      }
-      TryInlining(closure->function(), &arguments, call);
+  void InlineClosureCall(ClosureCallInstr* call) {
+    // Find the closure of the callee.
+    ASSERT(call->ArgumentCount() > 0);
+    const CreateClosureInstr* closure =
+        call->ArgumentAt(0)->value()->definition()->AsCreateClosure();
+    if (closure == NULL) {
+      TRACE_INLINING(OS::Print("     Bailout: non-closure operator\n"));
+      return;
+    }
+    GrowableArray<Value*> arguments(call->ArgumentCount() - 1);
+    for (int i = 1; i < call->ArgumentCount(); ++i) {
+      arguments.Add(call->ArgumentAt(i)->value());
     }
+    TryInlining(closure->function(), &arguments, call);
   }
 
-  void InlineInstanceCalls() {
-    const GrowableArray<PolymorphicInstanceCallInstr*>& calls =
-        *inlining_call_sites_->instance_calls();
-    TRACE_INLINING(OS::Print("  Polymorphic Instance Calls (%d)\n",
-                             calls.length()));
-    for (intptr_t i = 0; i < calls.length(); ++i) {
-      PolymorphicInstanceCallInstr* instr = calls[i];
-      const ICData& ic_data = instr->ic_data();
-      const Function& target = Function::ZoneHandle(ic_data.GetTargetAt(0));
-      if (instr->with_checks()) {
-        TRACE_INLINING(OS::Print("     Bailout: %"Pd" checks target '%s'\n",
-                                 ic_data.NumberOfChecks(),
-                                 target.ToCString()));
-        continue;
-      }
-      GrowableArray<Value*> arguments(instr->ArgumentCount());
-      for (int i = 0; i < instr->ArgumentCount(); ++i) {
-        arguments.Add(instr->ArgumentAt(i)->value());
+  void InlineInstanceCall(PolymorphicInstanceCallInstr* instr) {
+    if (instr->with_checks()) {
+      InlinePolymorphicCall(instr);
+      return;
+    }
+    const ICData& ic_data = instr->ic_data();
+    const Function& target = Function::ZoneHandle(ic_data.GetTargetAt(0));
+    GrowableArray<Value*> arguments(instr->ArgumentCount());
+    for (int i = 0; i < instr->ArgumentCount(); ++i) {
+      arguments.Add(instr->ArgumentAt(i)->value());
+    }
+    TryInlining(target, &arguments, instr);
+  }
+
+  // Test if a function could be inlined, without building its graph.
+  static bool MayInline(const Function& function) {
+    return function.is_inlinable() &&
+        !function.HasOptionalParameters() &&
+        (function.deoptimization_counter() <
+            FLAG_deoptimization_counter_threshold) &&
+        !Intrinsifier::CanIntrinsify(function);
+  }
+
+  // Dispatches on the receiver class to direct calls of the most used
+  // targets that can be inlined and inlines them.
+  void InlinePolymorphicCall(PolymorphicInstanceCallInstr* instr) {
+    const ICData& ic_data = instr->ic_data();
+    TRACE_INLINING(OS::Print("  => polymorphic call with %"Pd" checks\n",
+                             ic_data.NumberOfChecks()));
+    // Order the receiver classes by the usage counter of their targets.
+    GrowableArray<ReceiverTarget> candidates;
+    Function& target = Function::Handle();
+    for (intptr_t i = 0; i < ic_data.NumberOfChecks(); ++i) {
+      target = ic_data.GetTargetAt(i);
+      if (!MayInline(target)) continue;
+      ReceiverTarget candidate;
+      candidate.class_id = ic_data.GetReceiverClassIdAt(i);
+      candidate.check_index = i;
+      candidate.usage_counter = target.usage_counter();
+      candidates.Add(candidate);
+    }
+    candidates.Sort(MostUsedTargetFirst);
+    // Only dispatch to the targets which pass all checks for inlining, so
+    // that the caller graph is left unchanged if none of them does.
+    GrowableArray<Value*> arguments(instr->ArgumentCount());
+    for (int i = 0; i < instr->ArgumentCount(); ++i) {
+      arguments.Add(instr->ArgumentAt(i)->value());
+    }
+    GrowableArray<intptr_t> class_ids;
+    intptr_t checked_size = 0;
+    for (intptr_t i = 0;
+         (i < candidates.length()) &&
+             (class_ids.length() < FLAG_max_polymorphic_inlining_targets);
+         ++i) {
+      target = ic_data.GetTargetAt(candidates[i].check_index);
+      if (TryInlining(target, &arguments, instr, &checked_size)) {
+        class_ids.Add(candidates[i].class_id);
       }
-      TryInlining(target, &arguments, instr);
+    }
+    if (class_ids.is_empty()) {
+      TRACE_INLINING(OS::Print("     Bailout: no inlinable targets\n"));
+      return;
+    }
+    GrowableArray<StaticCallInstr*> direct_calls;
+    caller_graph_->SplitPolymorphicCall(instr, class_ids, &direct_calls);
+    next_ssa_temp_index_ = caller_graph_->max_virtual_register_number();
+    for (intptr_t i = 0; i < direct_calls.length(); ++i) {
+      InlineStaticCall(direct_calls[i]);
     }
   }
 
@@ -393,7 +620,9 @@ class CallSiteInliner : public ValueObject {
   bool inlined_;
   intptr_t initial_size_;
   intptr_t inlined_size_;
+  const intptr_t growth_budget_;
   intptr_t inlining_depth_;
+  intptr_t current_loop_depth_;
   CallSites* collected_call_sites_;
   CallSites* inlining_call_sites_;
 
@@ -23,6 +23,9 @@ DECLARE_FLAG(bool, enable_type_checks);
 DEFINE_FLAG(bool, trace_optimization, false, "Print optimization details.");
 DECLARE_FLAG(bool, trace_type_check_elimination);
 DEFINE_FLAG(bool, use_cha, true, "Use class hierarchy analysis.");
+DEFINE_FLAG(int, max_polymorphic_checks, 4,
+    "Maximum number of receiver classes checked inline at a call, calls "
+    "with more use a megamorphic cache");
 DEFINE_FLAG(bool, load_cse, true, "Use redundant load elimination.");
 DEFINE_FLAG(bool, trace_range_analysis, false, "Trace range analysis progress");
 DEFINE_FLAG(bool, trace_constant_propagation, false,
@@ -147,18 +150,145 @@ void FlowGraphOptimizer::InsertConversionsFor(Definition* def) {
 }
 
 
+static bool HasUnboxedDoubleInput(PhiInstr* phi) {
+  for (intptr_t i = 0; i < phi->InputCount(); ++i) {
+    if (phi->InputAt(i)->definition()->representation() == kUnboxedDouble) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+static bool HasUnboxedDoubleUse(Definition* def) {
+  for (Value* use = def->input_use_list();
+       use != NULL;
+       use = use->next_use()) {
+    Instruction* instr = use->instruction();
+    if (instr->IsPhi() && !instr->AsPhi()->is_alive()) continue;
+    if (instr->RequiredInputRepresentation(use->use_index()) ==
+        kUnboxedDouble) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+static BlockEntryInstr* FindPreHeader(BlockEntryInstr* header) {
+  for (intptr_t j = 0; j < header->PredecessorCount(); ++j) {
+    BlockEntryInstr* candidate = header->PredecessorAt(j);
+    if (header->dominator() == candidate) {
+      return candidate;
+    }
+  }
+  return NULL;
+}
+
+
+// A loop phi whose back edge inputs are all Doubles stays boxed when the value
+// it has on loop entry is not known to be a Double (e.g., a parameter), so
+// every iteration allocates a Double. If the phi has uses that want an unboxed
+// double, check the entry value's class in the loop pre-header instead and
+// let SelectRepresentations keep the phi unboxed across the loop.
+void FlowGraphOptimizer::UnboxLoopPhis() {
+  GrowableArray<BlockEntryInstr*> loop_headers;
+  flow_graph_->ComputeLoops(&loop_headers);
+
+  const Function& function = flow_graph_->parsed_function().function();
+  for (intptr_t i = 0; i < loop_headers.length(); ++i) {
+    JoinEntryInstr* header = loop_headers[i]->AsJoinEntry();
+    if ((header == NULL) || (header->phis() == NULL)) continue;
+    BlockEntryInstr* pre_header = FindPreHeader(header);
+    if (pre_header == NULL) continue;
+    GotoInstr* last = pre_header->last_instruction()->AsGoto();
+    ASSERT((last != NULL) && (last->env() != NULL));
+
+    for (intptr_t j = 0; j < header->phis()->length(); ++j) {
+      PhiInstr* phi = (*header->phis())[j];
+      if ((phi == NULL) ||
+          !phi->is_alive() ||
+          (phi->GetPropagatedCid() != kDynamicCid) ||
+          !HasUnboxedDoubleUse(phi)) {
+        continue;
+      }
+
+      const intptr_t kNotFound = -1;
+      intptr_t entry_input = kNotFound;
+      bool back_edges_are_double = true;
+      for (intptr_t k = 0; k < phi->InputCount(); ++k) {
+        Value* input = phi->InputAt(k);
+        if (header->PredecessorAt(k) == pre_header) {
+          entry_input = k;
+        } else if ((input->definition() != phi) &&
+                   (input->ResultCid() != kDoubleCid)) {
+          back_edges_are_double = false;
+          break;
+        }
+      }
+      if (!back_edges_are_double ||
+          (entry_input == kNotFound) ||
+          (phi->InputAt(entry_input)->ResultCid() != kDynamicCid)) {
+        continue;
+      }
+
+      if (FLAG_trace_optimization) {
+        OS::Print("Unboxing loop phi v%"Pd" in B%"Pd"\n",
+                  phi->ssa_temp_index(),
+                  header->block_id());
+      }
+      // Deoptimize to the pre-header goto if the entry value is not a
+      // Double, like instructions hoisted by LICM do. The class check keeps
+      // the unboxing from converting a Smi entry value to a double.
+      Value* entry_value = phi->InputAt(entry_input);
+      const ICData& double_check = ICData::ZoneHandle(
+          ICData::New(function,
+                      String::Handle(function.name()),
+                      last->GetDeoptId(),
+                      1));  // Number of arguments checked.
+      double_check.AddReceiverCheck(kDoubleCid, function);
+      InsertBefore(last,
+                   new CheckClassInstr(entry_value->Copy(),
+                                       last->GetDeoptId(),
+                                       double_check),
+                   last->env(),
+                   Definition::kEffect);
+      UnboxDoubleInstr* unbox =
+          new UnboxDoubleInstr(entry_value->Copy(), last->GetDeoptId());
+      InsertBefore(last, unbox, last->env(), Definition::kValue);
+
+      // Replace the entry value with the unboxed one. Maintain use lists.
+      entry_value->RemoveFromInputUseList();
+      entry_value->set_definition(unbox);
+      entry_value->AddToInputUseList();
+      phi->SetPropagatedCid(kDoubleCid);
+    }
+  }
+}
+
+
 void FlowGraphOptimizer::SelectRepresentations() {
-  // Convervatively unbox all phis that were proven to be of type Double.
-  for (intptr_t i = 0; i < block_order_.length(); ++i) {
-    JoinEntryInstr* join_entry = block_order_[i]->AsJoinEntry();
-    if (join_entry == NULL) continue;
+  // Unbox phis that were proven to be of type Double when that saves
+  // conversions: some input is already unboxed or some use needs an unboxed
+  // value. Unboxing one phi can make its neighbours profitable, so iterate
+  // until nothing changes.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (intptr_t i = 0; i < block_order_.length(); ++i) {
+      JoinEntryInstr* join_entry = block_order_[i]->AsJoinEntry();
+      if ((join_entry == NULL) || (join_entry->phis() == NULL)) continue;
 
-    if (join_entry->phis() != NULL) {
       for (intptr_t i = 0; i < join_entry->phis()->length(); ++i) {
         PhiInstr* phi = (*join_entry->phis())[i];
-        if (phi == NULL) continue;
-        if (phi->GetPropagatedCid() == kDoubleCid) {
+        if ((phi == NULL) ||
+            (phi->representation() == kUnboxedDouble) ||
+            (phi->GetPropagatedCid() != kDoubleCid)) {
+          continue;
+        }
+        if (HasUnboxedDoubleInput(phi) || HasUnboxedDoubleUse(phi)) {
           phi->set_representation(kUnboxedDouble);
+          changed = true;
         }
       }
     }
@@ -991,8 +1121,7 @@ void FlowGraphOptimizer::VisitInstanceCall(InstanceCallInstr* instr) {
       instr->ReplaceWith(call, current_iterator());
       return;
     }
-    const intptr_t kMaxChecks = 4;
-    if (instr->ic_data()->NumberOfChecks() <= kMaxChecks) {
+    if (instr->ic_data()->NumberOfChecks() <= FLAG_max_polymorphic_checks) {
       bool call_with_checks;
       // TODO(srdjan): Add check class instr for mixed smi/non-smi.
       if (unary_checks.HasOneTarget() &&
@@ -1461,6 +1590,10 @@ class RangeAnalysis : public ValueObject {
   // Propagate range information until fix-point is reached.
   void InferRanges();
 
+  // Remove array bound checks whose index is proven to be in range, either
+  // by its inferred range or by a constraint against the array length.
+  void EliminateRedundantBoundsChecks();
+
   void ProcessWorklist(Definition::RangeOperator op);
 
   // Walk the dominator tree, initialize ranges for smi values and place them
@@ -1500,6 +1633,9 @@ class RangeAnalysis : public ValueObject {
   GrowableArray<Definition*> smi_values_;  // Value that are known to be smi.
   GrowableArray<CheckSmiInstr*> smi_checks_;  // All CheckSmi instructions.
 
+  // All CheckArrayBound instructions.
+  GrowableArray<CheckArrayBoundInstr*> bounds_checks_;
+
   // All Constraints inserted during InsertConstraints phase. They are treated
   // as smi values.
   GrowableArray<ConstraintInstr*> constraints_;
@@ -1519,6 +1655,7 @@ void RangeAnalysis::Analyze() {
   CollectSmiValues();
   InsertConstraints();
   InferRanges();
+  EliminateRedundantBoundsChecks();
   RemoveConstraints();
 }
 
@@ -1540,6 +1677,8 @@ void RangeAnalysis::CollectSmiValues() {
         }
       } else if (current->IsCheckSmi()) {
         smi_checks_.Add(current->AsCheckSmi());
+      } else if (current->IsCheckArrayBound()) {
+        bounds_checks_.Add(current->AsCheckArrayBound());
       }
     }
 
@@ -1893,6 +2032,105 @@ void RangeAnalysis::InferRanges() {
 }
 
 
+static Definition* UnwrapConstraints(Definition* defn) {
+  while (defn->IsConstraint()) {
+    defn = defn->AsConstraint()->value()->definition();
+  }
+  return defn;
+}
+
+
+// Returns true if no instruction between 'from' and 'to' has side effects.
+// Only follows blocks with a single predecessor back from 'to'.
+static bool NoSideEffectsBetween(Instruction* from, Instruction* to) {
+  Instruction* current = to->previous();
+  while (current != from) {
+    BlockEntryInstr* block = current->AsBlockEntry();
+    if (block != NULL) {
+      if (block->PredecessorCount() != 1) return false;
+      current = block->PredecessorAt(0)->last_instruction();
+    } else {
+      if (current->HasSideEffect()) return false;
+      current = current->previous();
+    }
+  }
+  return true;
+}
+
+
+// Returns true if 'length' is the length of 'check''s array when the check
+// is executed.
+static bool IsLengthAtCheck(Definition* length, CheckArrayBoundInstr* check) {
+  LoadFieldInstr* load = UnwrapConstraints(length)->AsLoadField();
+  if ((load == NULL) ||
+      (load->value()->definition() != check->array()->definition())) {
+    return false;
+  }
+  switch (check->array_type()) {
+    case kArrayCid:
+    case kImmutableArrayCid:
+      return load->offset_in_bytes() == Array::length_offset();
+    case kGrowableObjectArrayCid:
+      // The length of a growable array may change in between.
+      return (load->offset_in_bytes() ==
+              GrowableObjectArray::length_offset()) &&
+          NoSideEffectsBetween(load, check);
+    default:
+      return false;
+  }
+}
+
+
+static bool IsRedundantBoundsCheck(CheckArrayBoundInstr* check) {
+  Definition* index = check->index()->definition();
+  Range* index_range = index->range();
+  if ((index_range == NULL) ||
+      (Range::ConstantMin(index_range).value() < 0)) {
+    return false;
+  }
+
+  // Constant upper bound of the index and constant array.
+  if (check->array()->BindsToConstant()) {
+    const Object& array = check->array()->BoundConstant();
+    if (array.IsArray() &&
+        (Range::ConstantMax(index_range).value() <
+         Array::Cast(array).Length())) {
+      return true;
+    }
+  }
+
+  // Symbolic upper bound below the array length, e.g. for an index
+  // compared against the array length by the loop condition.
+  for (Definition* defn = index;
+       defn->IsConstraint();
+       defn = defn->AsConstraint()->value()->definition()) {
+    const RangeBoundary& max = defn->AsConstraint()->constraint()->max();
+    if (max.IsSymbol() &&
+        (max.offset() < 0) &&
+        IsLengthAtCheck(max.symbol(), check)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void RangeAnalysis::EliminateRedundantBoundsChecks() {
+  for (intptr_t i = 0; i < bounds_checks_.length(); i++) {
+    CheckArrayBoundInstr* check = bounds_checks_[i];
+    if (IsRedundantBoundsCheck(check)) {
+      if (FLAG_trace_range_analysis) {
+        OS::Print("removing redundant bounds check %"Pd"\n",
+                  check->deopt_id());
+      }
+      check->array()->RemoveFromInputUseList();
+      check->index()->RemoveFromInputUseList();
+      check->RemoveFromGraph();
+    }
+  }
+}
+
+
 void RangeAnalysis::RemoveConstraints() {
   for (intptr_t i = 0; i < constraints_.length(); i++) {
     Definition* def = constraints_[i]->value()->definition();
@@ -2164,17 +2402,6 @@ void FlowGraphTypePropagator::PropagateTypes() {
 }
 
 
-static BlockEntryInstr* FindPreHeader(BlockEntryInstr* header) {
-  for (intptr_t j = 0; j < header->PredecessorCount(); ++j) {
-    BlockEntryInstr* candidate = header->PredecessorAt(j);
-    if (header->dominator() == candidate) {
-      return candidate;
-    }
-  }
-  return NULL;
-}
-
-
 void LICM::Hoist(ForwardInstructionIterator* it,
                  BlockEntryInstr* pre_header,
                  Instruction* current) {
@@ -2183,7 +2410,7 @@ void LICM::Hoist(ForwardInstructionIterator* it,
   if (FLAG_trace_optimization) {
     OS::Print("Hoisting instruction %s:%"Pd" from B%"Pd" to B%"Pd"\n",
               current->DebugName(),
-              current->deopt_id(),
+              current->GetDeoptId(),
               current->GetBlock()->block_id(),
               pre_header->block_id());
   }
@@ -2248,9 +2475,56 @@ void LICM::TryHoistCheckSmiThroughPhi(ForwardInstructionIterator* it,
 }
 
 
+// Returns the numbers of the loads that an instruction in the loop of
+// 'header' may change.
+static BitVector* ComputeLoopKills(FlowGraph* flow_graph,
+                                   BlockEntryInstr* header,
+                                   const LoadAliasing& aliasing) {
+  BitVector* kills = new BitVector(aliasing.num_loads());
+  for (BitVector::Iterator loop_it(header->loop_info());
+       !loop_it.Done();
+       loop_it.Advance()) {
+    BlockEntryInstr* block = flow_graph->preorder()[loop_it.Current()];
+    for (ForwardInstructionIterator it(block); !it.Done(); it.Advance()) {
+      if (!it.Current()->HasSideEffect()) continue;
+      for (intptr_t i = 0; i < aliasing.num_loads(); i++) {
+        if (!kills->Contains(i) && aliasing.MayKill(it.Current(), i)) {
+          kills->Add(i);
+        }
+      }
+    }
+  }
+  return kills;
+}
+
+
+// Returns true if 'current' is a field load that nothing in the loop of
+// 'header' may change and that is executed on every iteration, so that it
+// is no more speculative than hoisting its class check. Indexed loads are
+// not hoisted because their bounds check may not be invariant.
+static bool IsInvariantLoad(Instruction* current,
+                            BlockEntryInstr* header,
+                            BitVector* loop_kills) {
+  if (!LoadAliasing::IsLoad(current) || current->IsLoadIndexed()) {
+    return false;
+  }
+  if (loop_kills->Contains(current->AsDefinition()->expr_id())) return false;
+  BlockEntryInstr* block = current->GetBlock();
+  for (intptr_t i = 0; i < header->PredecessorCount(); i++) {
+    BlockEntryInstr* pred = header->PredecessorAt(i);
+    if (header->loop_info()->Contains(pred->preorder_number()) &&
+        !block->Dominates(pred)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
 void LICM::Optimize(FlowGraph* flow_graph) {
   GrowableArray<BlockEntryInstr*> loop_headers;
   flow_graph->ComputeLoops(&loop_headers);
+  LoadAliasing aliasing(flow_graph);
 
   for (intptr_t i = 0; i < loop_headers.length(); ++i) {
     BlockEntryInstr* header = loop_headers[i];
@@ -2258,6 +2532,10 @@ void LICM::Optimize(FlowGraph* flow_graph) {
     BlockEntryInstr* pre_header = FindPreHeader(header);
     if (pre_header == NULL) continue;
 
+    BitVector* loop_kills = (aliasing.num_loads() > 0)
+        ? ComputeLoopKills(flow_graph, header, aliasing)
+        : NULL;
+
     for (BitVector::Iterator loop_it(header->loop_info());
          !loop_it.Done();
          loop_it.Advance()) {
@@ -2266,7 +2544,10 @@ void LICM::Optimize(FlowGraph* flow_graph) {
            !it.Done();
            it.Advance()) {
         Instruction* current = it.Current();
-        if (!current->IsPushArgument() && !current->AffectedBySideEffect()) {
+        if (!current->IsPushArgument() &&
+            (!current->AffectedBySideEffect() ||
+             ((loop_kills != NULL) &&
+              IsInvariantLoad(current, header, loop_kills)))) {
           bool inputs_loop_invariant = true;
           for (int i = 0; i < current->InputCount(); ++i) {
             Definition* input_def = current->InputAt(i)->definition();
@@ -2289,114 +2570,477 @@ void LICM::Optimize(FlowGraph* flow_graph) {
 }
 
 
-static intptr_t NumberLoadExpressions(FlowGraph* graph) {
+// Returns the instruction following 'instr' in the straight-line region
+// starting at a sink candidate: the region continues through gotos to joins
+// that have no other predecessor and no phis, and ends at any other control
+// instruction.
+static Instruction* NextInRegion(Instruction* instr) {
+  if (instr->next() != NULL) return instr->next();
+  GotoInstr* goto_instr = instr->AsGoto();
+  if (goto_instr == NULL) return NULL;
+  JoinEntryInstr* join = goto_instr->successor();
+  if ((join->PredecessorCount() != 1) || (join->phis() != NULL)) return NULL;
+  return join->next();
+}
+
+
+// Returns the call to the constructor of class Object that 'instr' is, if it
+// is passed 'alloc' and nothing uses its result. Such a call does nothing.
+static StaticCallInstr* AsObjectConstructorCall(Instruction* instr,
+                                                AllocateObjectInstr* alloc) {
+  StaticCallInstr* call = instr->AsStaticCall();
+  if ((call == NULL) ||
+      (call->ArgumentCount() == 0) ||
+      (call->ArgumentAt(0)->value()->definition() != alloc) ||
+      (call->input_use_list() != NULL) ||
+      (call->env_use_list() != NULL) ||
+      !call->function().IsConstructor() ||
+      !Class::Handle(call->function().Owner()).IsObjectClass()) {
+    return NULL;
+  }
+  return call;
+}
+
+
+bool AllocationSinking::IsSinkCandidate(AllocateObjectInstr* alloc) {
+  // Objects with type arguments are not handled.
+  if (alloc->ArgumentCount() != 0) return false;
+
+  // The object must only be the instance of field loads and stores, and be
+  // passed to nothing but the constructor of class Object.
+  intptr_t stores = 0;
+  intptr_t pushes = 0;
+  for (Value* use = alloc->input_use_list();
+       use != NULL;
+       use = use->next_use()) {
+    Instruction* instr = use->instruction();
+    if (instr->IsLoadField()) {
+      continue;
+    } else if (instr->IsStoreInstanceField() && (use->use_index() == 0)) {
+      stores++;
+    } else if (instr->IsPushArgument()) {
+      pushes++;
+    } else {
+      return false;
+    }
+  }
+
+  // Stores and constructor calls must be in the region following the
+  // allocation, so that the field values are known at every use.
+  for (Instruction* instr = NextInRegion(alloc);
+       instr != NULL;
+       instr = NextInRegion(instr)) {
+    StoreInstanceFieldInstr* store = instr->AsStoreInstanceField();
+    if ((store != NULL) && (store->instance()->definition() == alloc)) {
+      stores--;
+    }
+    if (AsObjectConstructorCall(instr, alloc) != NULL) {
+      pushes--;
+    }
+  }
+  return (stores == 0) && (pushes == 0);
+}
+
+
+// Field values of a sunk object.
+class FieldValues : public ValueObject {
+ public:
+  FieldValues() : fields_(new ZoneGrowableArray<const Field*>()), values_() { }
+
+  void Store(const Field& field, Definition* value) {
+    for (intptr_t i = 0; i < fields_->length(); i++) {
+      if ((*fields_)[i]->raw() == field.raw()) {
+        values_[i] = value;
+        return;
+      }
+    }
+    fields_->Add(&field);
+    values_.Add(value);
+  }
+
+  // Returns NULL for a field not stored yet.
+  Definition* Load(intptr_t offset_in_bytes) const {
+    for (intptr_t i = 0; i < fields_->length(); i++) {
+      if ((*fields_)[i]->Offset() == offset_in_bytes) return values_[i];
+    }
+    return NULL;
+  }
+
+  MaterializeObjectInstr* CreateMaterialization(const Class& cls) const {
+    ZoneGrowableArray<const Field*>* fields =
+        new ZoneGrowableArray<const Field*>(fields_->length());
+    ZoneGrowableArray<Value*>* values =
+        new ZoneGrowableArray<Value*>(fields_->length());
+    for (intptr_t i = 0; i < fields_->length(); i++) {
+      fields->Add((*fields_)[i]);
+      values->Add(new Value(values_[i]));
+    }
+    MaterializeObjectInstr* mat =
+        new MaterializeObjectInstr(cls, *fields, values);
+    for (intptr_t i = 0; i < values->length(); i++) {
+      Value* value = (*values)[i];
+      value->set_instruction(mat);
+      value->set_use_index(i);
+      value->AddToInputUseList();
+    }
+    return mat;
+  }
+
+ private:
+  ZoneGrowableArray<const Field*>* fields_;
+  GrowableArray<Definition*> values_;
+};
+
+
+static void ReplaceEnvironmentUses(const GrowableArray<Value*>& env_uses,
+                                   MaterializeObjectInstr* mat) {
+  for (intptr_t i = 0; i < env_uses.length(); i++) {
+    Value* use = env_uses[i];
+    use->set_definition(mat);
+    use->AddToEnvUseList();
+  }
+}
+
+
+void AllocationSinking::Sink(FlowGraph* flow_graph,
+                             AllocateObjectInstr* alloc) {
+  if (FLAG_trace_optimization) {
+    OS::Print("Sinking allocation v%"Pd"\n", alloc->ssa_temp_index());
+  }
+  const Class& cls = Class::ZoneHandle(
+      Class::Handle(alloc->constructor().Owner()).raw());
+  Definition* null_value = flow_graph->graph_entry()->constant_null();
+
+  // Remove the calls to the constructor of class Object. Environment uses of
+  // their arguments become uses of the allocation.
+  for (Instruction* instr = NextInRegion(alloc);
+       instr != NULL;
+       instr = NextInRegion(instr)) {
+    StaticCallInstr* call = AsObjectConstructorCall(instr, alloc);
+    if (call != NULL) {
+      RemovePushArguments(call);
+      instr = call->RemoveFromGraph();
+    }
+  }
+
+  // Collect the uses before changing the graph further.
+  GrowableArray<LoadFieldInstr*> loads;
+  for (Value* use = alloc->input_use_list();
+       use != NULL;
+       use = use->next_use()) {
+    if (use->instruction()->IsLoadField()) {
+      loads.Add(use->instruction()->AsLoadField());
+    }
+  }
+  GrowableArray<Value*> env_uses;
+  for (Value* use = alloc->env_use_list();
+       use != NULL;
+       use = use->next_use()) {
+    env_uses.Add(use);
+  }
+  alloc->set_input_use_list(NULL);
+  alloc->set_env_use_list(NULL);
+
+  // Forward stored values to loads and describe the object in environments
+  // along the region following the allocation.
+  FieldValues field_values;
+  Instruction* instr = NextInRegion(alloc);
+  while (instr != NULL) {
+    Instruction* next = NextInRegion(instr);
+    if (instr->env() != NULL) {
+      GrowableArray<Value*> uses;
+      for (Environment::DeepIterator it(instr->env());
+           !it.Done();
+           it.Advance()) {
+        if (it.CurrentValue()->definition() == alloc) {
+          uses.Add(it.CurrentValue());
+        }
+      }
+      if (!uses.is_empty()) {
+        ReplaceEnvironmentUses(uses, field_values.CreateMaterialization(cls));
+      }
+    }
+    StoreInstanceFieldInstr* store = instr->AsStoreInstanceField();
+    if ((store != NULL) && (store->instance()->definition() == alloc)) {
+      field_values.Store(store->field(), store->value()->definition());
+      store->value()->RemoveFromInputUseList();
+      ASSERT(store->input_use_list() == NULL);
+      store->RemoveFromGraph();
+    }
+    LoadFieldInstr* load = instr->AsLoadField();
+    if ((load != NULL) && (load->value()->definition() == alloc)) {
+      Definition* value = field_values.Load(load->offset_in_bytes());
+      load->ReplaceUsesWith((value != NULL) ? value : null_value);
+      load->RemoveFromGraph();
+    }
+    instr = next;
+  }
+
+  // All remaining uses are dominated by the end of the region.
+  for (intptr_t i = 0; i < loads.length(); i++) {
+    LoadFieldInstr* load = loads[i];
+    if (load->previous() == NULL) continue;  // Removed above.
+    Definition* value = field_values.Load(load->offset_in_bytes());
+    load->ReplaceUsesWith((value != NULL) ? value : null_value);
+    load->RemoveFromGraph();
+  }
+  // The register allocator assigns the locations of field values per
+  // instruction, so each environment gets its own materialization.
+  for (intptr_t i = 0; i < env_uses.length(); i++) {
+    if (env_uses[i]->definition() != alloc) continue;
+    Instruction* instr = env_uses[i]->instruction();
+    GrowableArray<Value*> uses;
+    for (intptr_t j = i; j < env_uses.length(); j++) {
+      if ((env_uses[j]->definition() == alloc) &&
+          (env_uses[j]->instruction() == instr)) {
+        uses.Add(env_uses[j]);
+      }
+    }
+    ReplaceEnvironmentUses(uses, field_values.CreateMaterialization(cls));
+  }
+
+  alloc->RemoveFromGraph();
+}
+
+
+void AllocationSinking::Optimize(FlowGraph* flow_graph) {
+  GrowableArray<AllocateObjectInstr*> candidates;
+  for (BlockIterator block_it = flow_graph->reverse_postorder_iterator();
+       !block_it.Done();
+       block_it.Advance()) {
+    for (ForwardInstructionIterator it(block_it.Current());
+         !it.Done();
+         it.Advance()) {
+      AllocateObjectInstr* alloc = it.Current()->AsAllocateObject();
+      if ((alloc != NULL) && IsSinkCandidate(alloc)) {
+        candidates.Add(alloc);
+      }
+    }
+  }
+  for (intptr_t i = 0; i < candidates.length(); i++) {
+    Sink(flow_graph, candidates[i]);
+  }
+}
+
+
+// Returns true if 'defn' is an allocation whose result is only used as the
+// instance of field loads and stores, and possibly passed to the constructor
+// of class Object. No other value can refer to such an object, and no call
+// can change its fields.
+static bool IsNonEscapingAllocation(Definition* defn) {
+  AllocateObjectInstr* alloc = defn->AsAllocateObject();
+  if (alloc == NULL) return false;
+  for (Value* use = alloc->input_use_list();
+       use != NULL;
+       use = use->next_use()) {
+    Instruction* instr = use->instruction();
+    if (instr->IsLoadField() ||
+        (instr->IsStoreInstanceField() && (use->use_index() == 0))) {
+      continue;
+    }
+    if (!instr->IsPushArgument()) return false;
+    // The pushed arguments are followed by the call they are passed to.
+    Instruction* call = instr->next();
+    while ((call != NULL) && call->IsPushArgument()) call = call->next();
+    if ((call == NULL) || (AsObjectConstructorCall(call, alloc) == NULL)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// Returns true if the instances 'a' and 'b' may be the same object.
+static bool MayBeSameInstance(Definition* a, Definition* b) {
+  if (a == b) return true;
+  return !IsNonEscapingAllocation(a) && !IsNonEscapingAllocation(b);
+}
+
+
+// Returns true if 'store' may write the array element read by 'load'.
+static bool MayBeSameElement(StoreIndexedInstr* store, LoadIndexedInstr* load) {
+  if (store->index()->BindsToConstant() &&
+      load->index()->BindsToConstant() &&
+      store->index()->BoundConstant().IsSmi() &&
+      load->index()->BoundConstant().IsSmi() &&
+      (store->index()->BoundConstant().raw() !=
+          load->index()->BoundConstant().raw())) {
+    return false;
+  }
+  // Arrays of different classes, e.g. an immutable array and the backing
+  // store of a growable array, are different objects.
+  const intptr_t store_cid = store->array()->ResultCid();
+  const intptr_t load_cid = load->array()->ResultCid();
+  return (store_cid == kDynamicCid) ||
+         (load_cid == kDynamicCid) ||
+         (store_cid == load_cid);
+}
+
+
+LoadAliasing::LoadAliasing(FlowGraph* graph) : loads_() {
   DirectChainedHashMap<Definition*> map;
-  intptr_t expr_id = 0;
   for (BlockIterator it = graph->reverse_postorder_iterator();
        !it.Done();
        it.Advance()) {
-    BlockEntryInstr* block = it.Current();
-    for (ForwardInstructionIterator instr_it(block);
+    for (ForwardInstructionIterator instr_it(it.Current());
          !instr_it.Done();
          instr_it.Advance()) {
+      if (!IsLoad(instr_it.Current())) continue;
       Definition* defn = instr_it.Current()->AsDefinition();
-      if ((defn == NULL) ||
-          !defn->IsLoadField() ||
-          !defn->AffectedBySideEffect()) {
-        // TODO(fschneider): Extend to other load instructions.
-        continue;
-      }
       Definition* result = map.Lookup(defn);
       if (result == NULL) {
         map.Insert(defn);
-        defn->set_expr_id(expr_id++);
+        defn->set_expr_id(loads_.length());
+        loads_.Add(defn);
       } else {
         defn->set_expr_id(result->expr_id());
       }
     }
   }
-  return expr_id;
 }
 
 
-static void ComputeAvailableLoads(
-    FlowGraph* graph,
-    intptr_t max_expr_id,
-    const GrowableArray<BitVector*>& avail_in) {
-  // Initialize gen-, kill-, out-sets.
-  intptr_t num_blocks = graph->preorder().length();
-  GrowableArray<BitVector*> avail_out(num_blocks);
-  GrowableArray<BitVector*> avail_gen(num_blocks);
-  GrowableArray<BitVector*> avail_kill(num_blocks);
-  for (intptr_t i = 0; i < num_blocks; i++) {
-    avail_out.Add(new BitVector(max_expr_id));
-    avail_gen.Add(new BitVector(max_expr_id));
-    avail_kill.Add(new BitVector(max_expr_id));
+bool LoadAliasing::IsLoad(Instruction* instr) {
+  return (instr->IsLoadField() ||
+          instr->IsLoadStaticField() ||
+          instr->IsLoadIndexed()) &&
+         instr->AffectedBySideEffect();
+}
+
+
+bool LoadAliasing::MayKill(Instruction* instr, intptr_t load_id) const {
+  if (!instr->HasSideEffect()) return false;
+  Definition* load = loads_[load_id];
+
+  StoreInstanceFieldInstr* store_field = instr->AsStoreInstanceField();
+  if (store_field != NULL) {
+    LoadFieldInstr* load_field = load->AsLoadField();
+    return (load_field != NULL) &&
+           (load_field->offset_in_bytes() == store_field->field().Offset()) &&
+           MayBeSameInstance(load_field->value()->definition(),
+                             store_field->instance()->definition());
+  }
+  StoreVMFieldInstr* store_vm_field = instr->AsStoreVMField();
+  if (store_vm_field != NULL) {
+    LoadFieldInstr* load_field = load->AsLoadField();
+    return (load_field != NULL) &&
+           (load_field->offset_in_bytes() ==
+               store_vm_field->offset_in_bytes()) &&
+           MayBeSameInstance(load_field->value()->definition(),
+                             store_vm_field->dest()->definition());
+  }
+  StoreStaticFieldInstr* store_static = instr->AsStoreStaticField();
+  if (store_static != NULL) {
+    LoadStaticFieldInstr* load_static = load->AsLoadStaticField();
+    return (load_static != NULL) &&
+           (load_static->field().raw() == store_static->field().raw());
+  }
+  StoreIndexedInstr* store_indexed = instr->AsStoreIndexed();
+  if (store_indexed != NULL) {
+    LoadIndexedInstr* load_indexed = load->AsLoadIndexed();
+    return (load_indexed != NULL) &&
+           MayBeSameElement(store_indexed, load_indexed);
   }
 
-  for (BlockIterator block_it = graph->reverse_postorder_iterator();
-       !block_it.Done();
-       block_it.Advance()) {
-    BlockEntryInstr* block = block_it.Current();
-    intptr_t preorder_number = block->preorder_number();
-    for (BackwardInstructionIterator instr_it(block);
-         !instr_it.Done();
-         instr_it.Advance()) {
-      Instruction* instr = instr_it.Current();
-      if (instr->HasSideEffect()) {
-        avail_kill[preorder_number]->SetAll();
-        break;
+  // Any other side effect, e.g. a call, may change everything that can be
+  // reached from outside of this code.
+  LoadFieldInstr* load_field = load->AsLoadField();
+  return (load_field == NULL) ||
+         !IsNonEscapingAllocation(load_field->value()->definition());
+}
+
+
+// Updates 'available', which holds for each load number the load whose
+// value is current or NULL, to the state after 'instr'. Returns the
+// available load if 'instr' is a load with the same value, NULL otherwise.
+static Definition* TransferAvailableLoads(
+    const LoadAliasing& aliasing,
+    Instruction* instr,
+    GrowableArray<Definition*>* available) {
+  if (LoadAliasing::IsLoad(instr)) {
+    Definition* load = instr->AsDefinition();
+    Definition* result = (*available)[load->expr_id()];
+    if (result == NULL) {
+      (*available)[load->expr_id()] = load;
+    }
+    return result;
+  }
+  if (instr->HasSideEffect()) {
+    for (intptr_t i = 0; i < available->length(); i++) {
+      if (((*available)[i] != NULL) && aliasing.MayKill(instr, i)) {
+        (*available)[i] = NULL;
       }
-      Definition* defn = instr_it.Current()->AsDefinition();
-      if ((defn == NULL) ||
-          !defn->IsLoadField() ||
-          !defn->AffectedBySideEffect()) {
-        // TODO(fschneider): Extend to other load instructions.
-        continue;
+    }
+  }
+  return NULL;
+}
+
+
+// Computes the loads available at the entry of 'block': a load is available
+// if it is the available load at the end of every predecessor. Predecessors
+// not yet visited (back edges) are optimistically ignored.
+static void ComputeAvailableIn(
+    BlockEntryInstr* block,
+    const GrowableArray<ZoneGrowableArray<Definition*>*>& avail_out,
+    GrowableArray<Definition*>* available) {
+  bool first = true;
+  for (intptr_t i = 0; i < block->PredecessorCount(); i++) {
+    ZoneGrowableArray<Definition*>* pred_out =
+        avail_out[block->PredecessorAt(i)->preorder_number()];
+    if (pred_out == NULL) continue;
+    for (intptr_t j = 0; j < available->length(); j++) {
+      if (first) {
+        (*available)[j] = (*pred_out)[j];
+      } else if ((*available)[j] != (*pred_out)[j]) {
+        (*available)[j] = NULL;
       }
-      avail_gen[preorder_number]->Add(defn->expr_id());
     }
-    avail_out[preorder_number]->CopyFrom(avail_gen[preorder_number]);
+    first = false;
+  }
+  if (first) {
+    for (intptr_t j = 0; j < available->length(); j++) {
+      (*available)[j] = NULL;
+    }
   }
+}
 
-  BitVector* temp = new BitVector(avail_in[0]->length());
 
+static void ComputeAvailableLoads(
+    FlowGraph* graph,
+    const LoadAliasing& aliasing,
+    GrowableArray<ZoneGrowableArray<Definition*>*>* avail_out) {
+  const intptr_t num_loads = aliasing.num_loads();
+  GrowableArray<Definition*> available(num_loads);
+  for (intptr_t i = 0; i < num_loads; i++) available.Add(NULL);
+
+  // The available load at the entry of a block only goes from unknown to a
+  // single load to none, so the iteration terminates.
   bool changed = true;
   while (changed) {
     changed = false;
-
     for (BlockIterator block_it = graph->reverse_postorder_iterator();
          !block_it.Done();
          block_it.Advance()) {
       BlockEntryInstr* block = block_it.Current();
-      BitVector* block_in = avail_in[block->preorder_number()];
-      BitVector* block_out = avail_out[block->preorder_number()];
-      BitVector* block_kill = avail_kill[block->preorder_number()];
-      BitVector* block_gen = avail_gen[block->preorder_number()];
-
-      if (FLAG_trace_optimization) {
-        OS::Print("B%"Pd"", block->block_id());
-        block_in->Print();
-        block_out->Print();
-        OS::Print("\n");
+      ComputeAvailableIn(block, *avail_out, &available);
+      for (ForwardInstructionIterator it(block); !it.Done(); it.Advance()) {
+        TransferAvailableLoads(aliasing, it.Current(), &available);
       }
 
-      // Compute block_in as the intersection of all out(p) where p
-      // is a predecessor of the current block.
-      if (block->IsGraphEntry()) {
-        temp->Clear();
-      } else {
-        temp->SetAll();
-        ASSERT(block->PredecessorCount() > 0);
-        for (intptr_t i = 0; i < block->PredecessorCount(); i++) {
-          BlockEntryInstr* pred = block->PredecessorAt(i);
-          BitVector* pred_out = avail_out[pred->preorder_number()];
-          temp->Intersect(*pred_out);
-        }
+      ZoneGrowableArray<Definition*>* block_out =
+          (*avail_out)[block->preorder_number()];
+      if (block_out == NULL) {
+        block_out = new ZoneGrowableArray<Definition*>(num_loads);
+        for (intptr_t i = 0; i < num_loads; i++) block_out->Add(available[i]);
+        (*avail_out)[block->preorder_number()] = block_out;
+        changed = true;
+        continue;
       }
-      if (!temp->Equals(*block_in)) {
-        block_in->CopyFrom(temp);
-        if (block_out->KillAndAdd(block_kill, block_gen)) changed = true;
+      for (intptr_t i = 0; i < num_loads; i++) {
+        if ((*block_out)[i] != available[i]) {
+          (*block_out)[i] = available[i];
+          changed = true;
+        }
       }
     }
   }
@@ -2404,63 +3048,32 @@ static void ComputeAvailableLoads(
 
 
 static void OptimizeLoads(
-    BlockEntryInstr* block,
-    GrowableArray<Definition*>* definitions,
-    const GrowableArray<BitVector*>& avail_in) {
-  // TODO(fschneider): Factor out code shared with the existing CSE pass.
-
-  // Delete loads that are killed (not available) at the entry.
-  intptr_t pre_num = block->preorder_number();
-  ASSERT(avail_in[pre_num]->length() == definitions->length());
-  for (intptr_t i = 0; i < avail_in[pre_num]->length(); i++) {
-    if (!avail_in[pre_num]->Contains(i)) {
-      (*definitions)[i] = NULL;
-    }
-  }
+    FlowGraph* graph,
+    const LoadAliasing& aliasing,
+    const GrowableArray<ZoneGrowableArray<Definition*>*>& avail_out) {
+  GrowableArray<Definition*> available(aliasing.num_loads());
+  for (intptr_t i = 0; i < aliasing.num_loads(); i++) available.Add(NULL);
 
-  for (ForwardInstructionIterator it(block); !it.Done(); it.Advance()) {
-    Instruction* instr = it.Current();
-    if (instr->HasSideEffect()) {
-      // Handle local side effects by clearing current definitions.
-      for (intptr_t i = 0; i < definitions->length(); i++) {
-        (*definitions)[i] = NULL;
+  for (BlockIterator block_it = graph->reverse_postorder_iterator();
+       !block_it.Done();
+       block_it.Advance()) {
+    BlockEntryInstr* block = block_it.Current();
+    ComputeAvailableIn(block, avail_out, &available);
+    for (ForwardInstructionIterator it(block); !it.Done(); it.Advance()) {
+      Instruction* instr = it.Current();
+      Definition* result =
+          TransferAvailableLoads(aliasing, instr, &available);
+      if (result == NULL) continue;
+
+      // Replace current with the available load.
+      Definition* defn = instr->AsDefinition();
+      defn->ReplaceUsesWith(result);
+      it.RemoveCurrentFromGraph();
+      if (FLAG_trace_optimization) {
+        OS::Print("Replacing load v%"Pd" with v%"Pd"\n",
+                  defn->ssa_temp_index(),
+                  result->ssa_temp_index());
       }
-      continue;
-    }
-    Definition* defn = instr->AsDefinition();
-    if ((defn == NULL) ||
-        !defn->IsLoadField() ||
-        !defn->AffectedBySideEffect()) {
-      // Immutable loads are handled in normal CSE.
-      // TODO(fschneider): Extend to other load instructions.
-      continue;
-    }
-    Definition* result = (*definitions)[defn->expr_id()];
-    if (result == NULL) {
-      (*definitions)[defn->expr_id()] = defn;
-      continue;
-    }
-
-    // Replace current with lookup result.
-    defn->ReplaceUsesWith(result);
-    it.RemoveCurrentFromGraph();
-    if (FLAG_trace_optimization) {
-      OS::Print("Replacing load v%"Pd" with v%"Pd"\n",
-                defn->ssa_temp_index(),
-                result->ssa_temp_index());
-    }
-  }
-
-  // Process children in the dominator tree recursively.
-  intptr_t num_children = block->dominated_blocks().length();
-  for (intptr_t i = 0; i < num_children; ++i) {
-    BlockEntryInstr* child = block->dominated_blocks()[i];
-    if (i  < num_children - 1) {
-      GrowableArray<Definition*> child_defs(definitions->length());
-      child_defs.AddArray(*definitions);
-      OptimizeLoads(child, &child_defs, avail_in);
-    } else {
-      OptimizeLoads(child, definitions, avail_in);
     }
   }
 }
@@ -2468,22 +3081,16 @@ static void OptimizeLoads(
 
 void DominatorBasedCSE::Optimize(FlowGraph* graph) {
   if (FLAG_load_cse) {
-    intptr_t max_expr_id = NumberLoadExpressions(graph);
-    if (max_expr_id > 0) {
+    LoadAliasing aliasing(graph);
+    if (aliasing.num_loads() > 0) {
       intptr_t num_blocks = graph->preorder().length();
-      GrowableArray<BitVector*> avail_in(num_blocks);
+      GrowableArray<ZoneGrowableArray<Definition*>*> avail_out(num_blocks);
       for (intptr_t i = 0; i < num_blocks; i++) {
-        avail_in.Add(new BitVector(max_expr_id));
-      }
-
-      ComputeAvailableLoads(graph, max_expr_id, avail_in);
-
-      GrowableArray<Definition*> definitions(max_expr_id);
-      for (intptr_t j = 0; j < max_expr_id ; j++) {
-        definitions.Add(NULL);
+        avail_out.Add(NULL);
       }
 
-      OptimizeLoads(graph->graph_entry(), &definitions, avail_in);
+      ComputeAvailableLoads(graph, aliasing, &avail_out);
+      OptimizeLoads(graph, aliasing, avail_out);
     }
   }
 
@@ -2918,11 +3525,28 @@ void ConstantPropagator::VisitAllocateObjectWithBoundsCheck(
 }
 
 
+void ConstantPropagator::VisitMaterializeObject(MaterializeObjectInstr* instr) {
+  // Should not be used outside of allocation sinking.
+  UNREACHABLE();
+}
+
+
 void ConstantPropagator::VisitLoadField(LoadFieldInstr* instr) {
   SetValue(instr, non_constant_);
 }
 
 
+void ConstantPropagator::VisitLoadClassId(LoadClassIdInstr* instr) {
+  const Object& object = instr->object()->definition()->constant_value();
+  if (IsNonConstant(object)) {
+    SetValue(instr, non_constant_);
+  } else if (IsConstant(object)) {
+    const Class& cls = Class::Handle(object.clazz());
+    SetValue(instr, Smi::ZoneHandle(Smi::New(cls.id())));
+  }
+}
+
+
 void ConstantPropagator::VisitStoreVMField(StoreVMFieldInstr* instr) {
   SetValue(instr, instr->value()->definition()->constant_value());
 }
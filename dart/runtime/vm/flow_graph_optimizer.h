@@ -26,6 +26,10 @@ class FlowGraphOptimizer : public FlowGraphVisitor {
 
   void EliminateDeadPhis();
 
+  // Speculatively makes loop phis of type Double when only their value on
+  // loop entry is unknown. Requires valid use lists and invalidates them.
+  void UnboxLoopPhis();
+
   void SelectRepresentations();
 
   void PropagateSminess();
@@ -121,6 +125,32 @@ class FlowGraphTypePropagator : public FlowGraphVisitor {
 };
 
 
+// Numbers the loads that are affected by side effects (LoadField,
+// LoadStaticField and LoadIndexed) so that equal loads get the same number,
+// and tells which of them an instruction may change. A store only changes
+// loads of the same field offset, static field or array element class.
+// Other instructions with side effects change all loads except loads from
+// allocations that do not escape the optimized code.
+class LoadAliasing : public ValueObject {
+ public:
+  explicit LoadAliasing(FlowGraph* graph);
+
+  static bool IsLoad(Instruction* instr);
+
+  intptr_t num_loads() const { return loads_.length(); }
+
+  // Returns true if 'instr' may change the value of the loads numbered
+  // 'load_id'. Expects use lists to be computed.
+  bool MayKill(Instruction* instr, intptr_t load_id) const;
+
+ private:
+  // A representative load for each number.
+  GrowableArray<Definition*> loads_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadAliasing);
+};
+
+
 // Loop invariant code motion.
 class LICM : public AllStatic {
  public:
@@ -138,8 +168,26 @@ class LICM : public AllStatic {
 };
 
 
+// Removes allocations of objects that do not escape the optimized code.
+// The fields of such an object live in SSA values; loads of a field are
+// replaced by the value last stored into it. Environments referring to the
+// object get a MaterializeObject description used to recreate the object
+// when deoptimizing. Expects use lists to be computed, must run right before
+// register allocation.
+class AllocationSinking : public AllStatic {
+ public:
+  static void Optimize(FlowGraph* flow_graph);
+
+ private:
+  static bool IsSinkCandidate(AllocateObjectInstr* alloc);
+  static void Sink(FlowGraph* flow_graph, AllocateObjectInstr* alloc);
+};
+
+
 // A simple common subexpression elimination based
-// on the dominator tree.
+// on the dominator tree. With --load_cse loads that are affected by side
+// effects are also eliminated when an equal load is available on all paths
+// and nothing on the way may have changed its value.
 class DominatorBasedCSE : public AllStatic {
  public:
   static void Optimize(FlowGraph* graph);
@@ -50,38 +50,30 @@ FreeList::~FreeList() {
 
 uword FreeList::TryAllocate(intptr_t size) {
   int index = IndexForSize(size);
-  if ((index != kNumLists) && free_map_.Test(index)) {
-    return reinterpret_cast<uword>(DequeueElement(index));
+  if (index < kNumLists) {
+    if (free_map_.Test(index)) {
+      return reinterpret_cast<uword>(DequeueElement(index));
+    }
+  } else if (free_map_.Test(index)) {
+    // Only some of the elements in the size class of the requested size may
+    // be large enough.
+    FreeListElement* element = DequeueFittingElement(index, size);
+    if (element != NULL) {
+      SplitElementAfterAndEnqueue(element, size);
+      return reinterpret_cast<uword>(element);
+    }
   }
 
-  if ((index + 1) < kNumLists) {
+  if ((index + 1) < kNumIndices) {
     intptr_t next_index = free_map_.Next(index + 1);
     if (next_index != -1) {
-      // Dequeue an element from the list, split and enqueue the remainder in
-      // the appropriate list.
+      // Any element of a larger size is large enough. Dequeue an element from
+      // the list, split and enqueue the remainder in the appropriate list.
       FreeListElement* element = DequeueElement(next_index);
       SplitElementAfterAndEnqueue(element, size);
       return reinterpret_cast<uword>(element);
     }
   }
-
-  FreeListElement* previous = NULL;
-  FreeListElement* current = free_lists_[kNumLists];
-  while (current != NULL) {
-    if (current->Size() >= size) {
-      // Found an element large enough to hold the requested size. Dequeue,
-      // split and enqueue the remainder.
-      if (previous == NULL) {
-        free_lists_[kNumLists] = current->next();
-      } else {
-        previous->set_next(current->next());
-      }
-      SplitElementAfterAndEnqueue(current, size);
-      return reinterpret_cast<uword>(current);
-    }
-    previous = current;
-    current = current->next();
-  }
   return 0;
 }
 
@@ -95,27 +87,53 @@ void FreeList::Free(uword addr, intptr_t size) {
 
 void FreeList::Reset() {
   free_map_.Reset();
-  for (int i = 0; i < (kNumLists + 1); i++) {
+  for (int i = 0; i < kNumIndices; i++) {
     free_lists_[i] = NULL;
   }
 }
 
 
+void FreeList::Merge(FreeList* other) {
+  for (int i = 0; i < kNumIndices; i++) {
+    FreeListElement* head = other->free_lists_[i];
+    if (head == NULL) {
+      continue;
+    }
+    FreeListElement* tail = head;
+    while (tail->next() != NULL) {
+      tail = tail->next();
+    }
+    if (free_lists_[i] == NULL) {
+      free_map_.Set(i, true);
+    }
+    tail->set_next(free_lists_[i]);
+    free_lists_[i] = head;
+  }
+  other->Reset();
+}
+
+
 intptr_t FreeList::IndexForSize(intptr_t size) {
   ASSERT(size >= kObjectAlignment);
   ASSERT(Utils::IsAligned(size, kObjectAlignment));
 
   intptr_t index = size / kObjectAlignment;
-  if (index >= kNumLists) {
-    index = kNumLists;
+  if (index < kNumLists) {
+    return index;
   }
-  return index;
+  // Size class i holds the sizes from (kNumLists << i) up to
+  // (kNumLists << (i + 1)) units of the object alignment.
+  intptr_t size_class = Utils::HighestBit(index / kNumLists);
+  if (size_class >= kNumSizeClasses) {
+    size_class = kNumSizeClasses - 1;
+  }
+  return kNumLists + size_class;
 }
 
 
 void FreeList::EnqueueElement(FreeListElement* element, intptr_t index) {
   FreeListElement* next = free_lists_[index];
-  if (next == NULL && index != kNumLists) {
+  if (next == NULL) {
     free_map_.Set(index, true);
   }
   element->set_next(next);
@@ -126,7 +144,7 @@ void FreeList::EnqueueElement(FreeListElement* element, intptr_t index) {
 FreeListElement* FreeList::DequeueElement(intptr_t index) {
   FreeListElement* result = free_lists_[index];
   FreeListElement* next = result->next();
-  if (next == NULL && index != kNumLists) {
+  if (next == NULL) {
     free_map_.Set(index, false);
   }
   free_lists_[index] = next;
@@ -134,6 +152,27 @@ FreeListElement* FreeList::DequeueElement(intptr_t index) {
 }
 
 
+FreeListElement* FreeList::DequeueFittingElement(intptr_t index,
+                                                 intptr_t size) {
+  ASSERT(index >= kNumLists);
+  FreeListElement* previous = NULL;
+  FreeListElement* current = free_lists_[index];
+  while (current != NULL) {
+    if (current->Size() >= size) {
+      if (previous == NULL) {
+        DequeueElement(index);
+      } else {
+        previous->set_next(current->next());
+      }
+      return current;
+    }
+    previous = current;
+    current = current->next();
+  }
+  return NULL;
+}
+
+
 intptr_t FreeList::Length(int index) const {
   ASSERT(index >= 0);
   ASSERT(index < kNumLists);
@@ -167,6 +206,29 @@ void FreeList::Print() const {
   }
   OS::Print("--------------------------------\n");
   OS::Print("%*d %*d %*d\n", 10, total_index, 10, total_length, 10, total_size);
+  PrintSizeClasses();
+}
+
+
+void FreeList::PrintSizeClasses() const {
+  OS::Print("%*s %*s %*s\n", 10, "Min size", 10, "Length", 10, "Size");
+  OS::Print("--------------------------------\n");
+  for (int i = kNumLists; i < kNumIndices; ++i) {
+    intptr_t length = 0;
+    intptr_t size = 0;
+    FreeListElement* element = free_lists_[i];
+    while (element != NULL) {
+      ++length;
+      size += element->Size();
+      element = element->next();
+    }
+    if (length == 0) {
+      continue;
+    }
+    intptr_t min_size = (kNumLists << (i - kNumLists)) * kObjectAlignment;
+    OS::Print("%*"Pd" %*"Pd" %*"Pd"\n", 10, min_size, 10, length, 10, size);
+  }
+  OS::Print("--------------------------------\n");
 }
 
 
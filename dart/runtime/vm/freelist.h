@@ -79,23 +79,38 @@ class FreeList {
 
   void Reset();
 
+  // Moves all elements of the other freelist into this freelist.
+  void Merge(FreeList* other);
+
   intptr_t Length(int index) const;
 
   void Print() const;
 
  private:
+  // Elements smaller than kNumLists * kObjectAlignment are kept in lists of
+  // exactly one size. Larger elements are kept in size classes, each covering
+  // the sizes from a power of two up to the next one. The last size class
+  // holds all remaining sizes.
   static const int kNumLists = 128;
+  static const int kNumSizeClasses = 16;
+  static const int kNumIndices = kNumLists + kNumSizeClasses;
 
   static intptr_t IndexForSize(intptr_t size);
 
   void EnqueueElement(FreeListElement* element, intptr_t index);
   FreeListElement* DequeueElement(intptr_t index);
 
+  // Unlinks the first element of at least the given size from the list of a
+  // size class. Returns NULL if there is none.
+  FreeListElement* DequeueFittingElement(intptr_t index, intptr_t size);
+
   void SplitElementAfterAndEnqueue(FreeListElement* element, intptr_t size);
 
-  BitSet<kNumLists> free_map_;
+  void PrintSizeClasses() const;
+
+  BitSet<kNumIndices> free_map_;
 
-  FreeListElement* free_lists_[kNumLists + 1];
+  FreeListElement* free_lists_[kNumIndices];
 
   DISALLOW_COPY_AND_ASSIGN(FreeList);
 };
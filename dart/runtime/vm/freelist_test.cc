@@ -50,4 +50,58 @@ TEST_CASE(FreeList) {
   delete free_list;
 }
 
+
+TEST_CASE(FreeListMerge) {
+  FreeList* free_list = new FreeList();
+  FreeList* other = new FreeList();
+  intptr_t kBlobSize = 64 * KB;
+  intptr_t kSmallObjectSize = 4 * kWordSize;
+  intptr_t kLargeObjectSize = 8 * KB;
+  uword blob = reinterpret_cast<uword>(malloc(kBlobSize));
+  free_list->Free(blob, kSmallObjectSize);
+  other->Free(blob + kSmallObjectSize, kSmallObjectSize);
+  other->Free(blob + 2 * kSmallObjectSize, kSmallObjectSize);
+  other->Free(blob + KB, kLargeObjectSize);
+  free_list->Merge(other);
+  // All elements of the other freelist are moved over.
+  EXPECT_EQ(0, other->TryAllocate(kSmallObjectSize));
+  EXPECT_EQ(3, free_list->Length(kSmallObjectSize / kObjectAlignment));
+  uword large_object = free_list->TryAllocate(kLargeObjectSize);
+  EXPECT_EQ(blob + KB, large_object);
+  for (intptr_t i = 0; i < 3; i++) {
+    EXPECT(free_list->TryAllocate(kSmallObjectSize) != 0);
+  }
+  EXPECT_EQ(0, free_list->TryAllocate(kSmallObjectSize));
+  free(reinterpret_cast<void*>(blob));
+  delete other;
+  delete free_list;
+}
+
+
+TEST_CASE(FreeListSizeClasses) {
+  FreeList* free_list = new FreeList();
+  // Elements of at least kClassSize are kept in power of two size classes.
+  const intptr_t kClassSize = 128 * kObjectAlignment;
+  intptr_t kBlobSize = 32 * kClassSize;
+  uword blob = reinterpret_cast<uword>(malloc(kBlobSize));
+  uword small_element = blob;
+  uword medium_element = blob + 2 * kClassSize;
+  uword large_element = blob + 8 * kClassSize;
+  free_list->Free(small_element, kClassSize * 3 / 2);
+  free_list->Free(medium_element, kClassSize * 5 / 2);
+  free_list->Free(large_element, 10 * kClassSize);
+  // The element in the size class of the requested size fits.
+  EXPECT_EQ(medium_element, free_list->TryAllocate(kClassSize * 9 / 4));
+  // The element in the size class of the requested size is too small, the
+  // next larger size class is used.
+  EXPECT_EQ(large_element, free_list->TryAllocate(kClassSize * 7 / 4));
+  EXPECT_EQ(small_element, free_list->TryAllocate(kClassSize * 3 / 2));
+  // The remainder of the large element is too small.
+  EXPECT_EQ(0, free_list->TryAllocate(9 * kClassSize));
+  EXPECT_EQ(large_element + kClassSize * 7 / 4,
+            free_list->TryAllocate(kClassSize * 33 / 4));
+  free(reinterpret_cast<void*>(blob));
+  delete free_list;
+}
+
 }  // namespace dart
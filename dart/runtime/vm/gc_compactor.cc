@@ -0,0 +1,400 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/gc_compactor.h"
+
+#include <string.h>
+
+#include "platform/utils.h"
+#include "vm/class_table.h"
+#include "vm/dart_api_state.h"
+#include "vm/heap.h"
+#include "vm/isolate.h"
+#include "vm/pages.h"
+#include "vm/raw_object.h"
+#include "vm/stack_frame.h"
+#include "vm/store_buffer.h"
+#include "vm/visitor.h"
+
+namespace dart {
+
+// The forwarding information of a page being compacted. The page is divided
+// into blocks of kBitsPerBlock object alignment units. For each block the new
+// address of the first live object starting in the block is kept together
+// with a bitmap of the units covered by live objects starting in the block.
+// The new address of a live object is then found by counting the live units
+// preceding it in its block.
+class ForwardingPage {
+ public:
+  explicit ForwardingPage(HeapPage* page)
+      : page_(page), old_top_(page->top()) {
+    memset(blocks_, 0, sizeof(blocks_));
+  }
+
+  HeapPage* page() const { return page_; }
+  uword old_top() const { return old_top_; }
+
+  // Records the units covered by the live object in its starting block and
+  // accounts for its size in the live size of the block.
+  void RecordLive(uword addr, intptr_t size) {
+    intptr_t unit = UnitFor(addr);
+    intptr_t block_index = unit / kBitsPerBlock;
+    intptr_t first_bit = unit % kBitsPerBlock;
+    intptr_t num_bits = Utils::Minimum(size / kObjectAlignment,
+                                       kBitsPerBlock - first_bit);
+    Block* block = &blocks_[block_index];
+    for (intptr_t i = 0; i < num_bits; i++) {
+      block->live_bitmap |= (static_cast<uint32_t>(1) << (first_bit + i));
+    }
+    // Until the moves are planned, the new address holds the live size.
+    block->new_address += size;
+  }
+
+  // Assigns consecutive addresses to the live objects of each block, moving
+  // to the next destination page whenever the objects of a block do not fit.
+  void PlanBlocks(HeapPage** dest_page, uword* dest) {
+    for (intptr_t i = 0; i < kBlocksPerPage; i++) {
+      Block* block = &blocks_[i];
+      intptr_t live_size = block->new_address;
+      if (live_size == 0) {
+        continue;
+      }
+      if ((*dest + live_size) > (*dest_page)->end()) {
+        *dest_page = (*dest_page)->next();
+        ASSERT(*dest_page != NULL);
+        *dest = (*dest_page)->first_object_start();
+      }
+      block->new_address = *dest;
+      *dest += live_size;
+    }
+  }
+
+  uword Lookup(uword addr) const {
+    intptr_t unit = UnitFor(addr);
+    const Block& block = blocks_[unit / kBitsPerBlock];
+    uint32_t unit_bit = static_cast<uint32_t>(1) << (unit % kBitsPerBlock);
+    ASSERT((block.live_bitmap & unit_bit) != 0);
+    uint32_t preceding_mask = unit_bit - 1;
+    intptr_t preceding_units =
+        Utils::CountOneBits(block.live_bitmap & preceding_mask);
+    return block.new_address + (preceding_units * kObjectAlignment);
+  }
+
+ private:
+  static const intptr_t kBitsPerBlock = 32;
+  static const intptr_t kBlockSize = kBitsPerBlock * kObjectAlignment;
+  static const intptr_t kBlocksPerPage = PageSpace::kPageSize / kBlockSize;
+
+  struct Block {
+    uword new_address;
+    uint32_t live_bitmap;
+  };
+
+  intptr_t UnitFor(uword addr) const {
+    ASSERT(page_->Contains(addr));
+    return (addr - page_->start()) / kObjectAlignment;
+  }
+
+  HeapPage* page_;
+  uword old_top_;
+  Block blocks_[kBlocksPerPage];
+
+  DISALLOW_COPY_AND_ASSIGN(ForwardingPage);
+};
+
+
+// Replaces the pointers to moved objects by their new addresses. When
+// visiting the pointers of an old object the store buffer is rebuilt using
+// the address the visited object will be moved to.
+class CompactingVisitor : public ObjectPointerVisitor {
+ public:
+  CompactingVisitor(Isolate* isolate, GCCompactor* compactor)
+      : ObjectPointerVisitor(isolate),
+        compactor_(compactor),
+        update_store_buffers_(false),
+        delta_(0),
+        card_page_(NULL) {}
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      RawObject* raw_obj = *current;
+      if (!raw_obj->IsHeapObject()) {
+        continue;
+      }
+      if (raw_obj->IsNewObject()) {
+        if (update_store_buffers_) {
+          uword slot = reinterpret_cast<uword>(current) + delta_;
+          if (card_page_ != NULL) {
+            card_page_->MarkCard(slot);
+          } else {
+            isolate()->store_buffer()->AddPointer(slot);
+          }
+        }
+        continue;
+      }
+      *current = compactor_->Forward(raw_obj);
+    }
+  }
+
+  // Sets up the visiting of the pointers of an old object which is moved by
+  // the given number of bytes.
+  void set_object_delta(intptr_t delta) {
+    update_store_buffers_ = true;
+    delta_ = delta;
+    card_page_ = NULL;
+  }
+
+  // Sets up the visiting of the pointers of an object on a card marked page,
+  // which stays in place.
+  void set_card_page(HeapPage* page) {
+    set_object_delta(0);
+    card_page_ = page->is_card_marked() ? page : NULL;
+  }
+
+ private:
+  GCCompactor* compactor_;
+  bool update_store_buffers_;
+  intptr_t delta_;
+  HeapPage* card_page_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactingVisitor);
+};
+
+
+class CompactingWeakVisitor : public HandleVisitor {
+ public:
+  explicit CompactingWeakVisitor(GCCompactor* compactor)
+      : compactor_(compactor) {}
+
+  void VisitHandle(uword addr) {
+    FinalizablePersistentHandle* handle =
+        reinterpret_cast<FinalizablePersistentHandle*>(addr);
+    RawObject** p = handle->raw_addr();
+    if ((*p)->IsHeapObject() && (*p)->IsOldObject()) {
+      *p = compactor_->Forward(*p);
+    }
+  }
+
+ private:
+  GCCompactor* compactor_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactingWeakVisitor);
+};
+
+
+GCCompactor::GCCompactor(Heap* heap)
+    : heap_(heap),
+      forwarding_pages_(NULL),
+      num_forwarding_pages_(0),
+      page_table_(NULL),
+      page_table_mask_(0) {
+}
+
+
+GCCompactor::~GCCompactor() {
+  for (intptr_t i = 0; i < num_forwarding_pages_; i++) {
+    delete forwarding_pages_[i];
+  }
+  delete[] forwarding_pages_;
+  delete[] page_table_;
+}
+
+
+intptr_t GCCompactor::CompactPages(Isolate* isolate,
+                                   PageSpace* page_space,
+                                   HeapPage* pages) {
+  if (pages == NULL) {
+    return 0;
+  }
+  PlanMoves(pages);
+  UpdatePointers(isolate, page_space);
+  return MoveObjects(isolate);
+}
+
+
+RawObject* GCCompactor::Forward(RawObject* raw_obj) const {
+  ASSERT(raw_obj->IsHeapObject() && raw_obj->IsOldObject());
+  uword addr = RawObject::ToAddr(raw_obj);
+  ForwardingPage* forwarding_page = ForwardingPageFor(addr);
+  if ((forwarding_page == NULL) || !raw_obj->IsMarked()) {
+    return raw_obj;
+  }
+  return RawObject::FromAddr(forwarding_page->Lookup(addr));
+}
+
+
+void GCCompactor::PlanMoves(HeapPage* pages) {
+  intptr_t num_pages = 0;
+  for (HeapPage* page = pages; page != NULL; page = page->next()) {
+    num_pages++;
+  }
+  forwarding_pages_ = new ForwardingPage*[num_pages];
+  intptr_t page_table_size = Utils::RoundUpToPowerOfTwo(2 * num_pages);
+  page_table_ = new ForwardingPage*[page_table_size];
+  for (intptr_t i = 0; i < page_table_size; i++) {
+    page_table_[i] = NULL;
+  }
+  page_table_mask_ = page_table_size - 1;
+
+  // Record the live objects and assign the new addresses in page list order.
+  // Objects never move to a page later in the list nor to a higher address
+  // within their page, which allows moving them in a single pass.
+  HeapPage* dest_page = pages;
+  uword dest = dest_page->first_object_start();
+  for (HeapPage* page = pages; page != NULL; page = page->next()) {
+    ForwardingPage* forwarding_page = new ForwardingPage(page);
+    uword current = page->first_object_start();
+    uword top = page->top();
+    while (current < top) {
+      RawObject* raw_obj = RawObject::FromAddr(current);
+      intptr_t obj_size = raw_obj->Size();
+      if (raw_obj->IsMarked()) {
+        forwarding_page->RecordLive(current, obj_size);
+      }
+      current += obj_size;
+    }
+    forwarding_page->PlanBlocks(&dest_page, &dest);
+    AddForwardingPage(forwarding_page);
+  }
+}
+
+
+void GCCompactor::UpdatePointers(Isolate* isolate, PageSpace* page_space) {
+  // The store buffers are rebuilt while visiting the old objects.
+  isolate->store_buffer()->Reset();
+  isolate->store_buffer_block()->Reset();
+
+  // The class table is needed to determine object sizes until the classes
+  // are actually moved. Keep the old entries, they are updated as the
+  // classes move.
+  ClassTable* class_table = isolate->class_table();
+  intptr_t num_cids = class_table->NumCids();
+  RawClass** saved_classes = new RawClass*[num_cids];
+  for (intptr_t i = 1; i < num_cids; i++) {
+    saved_classes[i] = class_table->At(i);
+  }
+
+  CompactingVisitor visitor(isolate, this);
+  isolate->VisitObjectPointers(&visitor,
+                               false,
+                               StackFrameIterator::kDontValidateFrames);
+  for (intptr_t i = 1; i < num_cids; i++) {
+    class_table->SetAt(i, saved_classes[i]);
+  }
+  delete[] saved_classes;
+
+  // The prologue weak persistent handles are visited here, every pointer has
+  // to be forwarded exactly once.
+  CompactingWeakVisitor weak_visitor(this);
+  isolate->VisitWeakPersistentHandles(&weak_visitor, true);
+
+  heap_->IterateNewPointers(&visitor);
+  visitor.set_object_delta(0);
+  heap_->IterateCodePointers(&visitor);
+
+  // Visit the live objects of the compacted pages, the objects are not moved
+  // yet.
+  for (intptr_t i = 0; i < num_forwarding_pages_; i++) {
+    ForwardingPage* forwarding_page = forwarding_pages_[i];
+    uword current = forwarding_page->page()->first_object_start();
+    uword top = forwarding_page->old_top();
+    while (current < top) {
+      RawObject* raw_obj = RawObject::FromAddr(current);
+      intptr_t obj_size = raw_obj->Size();
+      if (raw_obj->IsMarked()) {
+        visitor.set_object_delta(forwarding_page->Lookup(current) - current);
+        raw_obj->VisitPointers(&visitor);
+      }
+      current += obj_size;
+    }
+  }
+
+  // Visit the live large objects, which stay in place.
+  for (HeapPage* page = page_space->large_pages_;
+       page != NULL;
+       page = page->next()) {
+    RawObject* raw_obj = RawObject::FromAddr(page->first_object_start());
+    if (raw_obj->IsMarked()) {
+      visitor.set_card_page(page);
+      raw_obj->VisitPointers(&visitor);
+    }
+  }
+
+  // The peers are keyed by the object addresses.
+  PageSpace::PeerTable forwarded_peers;
+  PageSpace::PeerTable* peer_table = page_space->GetPeerTable();
+  for (PageSpace::PeerTable::iterator it = peer_table->begin();
+       it != peer_table->end();
+       ++it) {
+    forwarded_peers[Forward(it->first)] = it->second;
+  }
+  peer_table->swap(forwarded_peers);
+}
+
+
+intptr_t GCCompactor::MoveObjects(Isolate* isolate) {
+  for (intptr_t i = 0; i < num_forwarding_pages_; i++) {
+    HeapPage* page = forwarding_pages_[i]->page();
+    page->set_top(page->first_object_start());
+    page->set_used(0);
+  }
+
+  ClassTable* class_table = isolate->class_table();
+  intptr_t in_use = 0;
+  for (intptr_t i = 0; i < num_forwarding_pages_; i++) {
+    ForwardingPage* forwarding_page = forwarding_pages_[i];
+    uword current = forwarding_page->page()->first_object_start();
+    uword top = forwarding_page->old_top();
+    while (current < top) {
+      RawObject* raw_obj = RawObject::FromAddr(current);
+      // The size has to be read before the object is overwritten.
+      intptr_t obj_size = raw_obj->Size();
+      if (raw_obj->IsMarked()) {
+        uword new_addr = forwarding_page->Lookup(current);
+        if (new_addr != current) {
+          memmove(reinterpret_cast<void*>(new_addr),
+                  reinterpret_cast<void*>(current),
+                  obj_size);
+        }
+        RawObject* new_obj = RawObject::FromAddr(new_addr);
+        new_obj->ClearMarkBit();
+        if (new_obj->GetClassId() == kClassCid) {
+          RawClass* raw_class = reinterpret_cast<RawClass*>(new_obj);
+          class_table->SetAt(raw_class->ptr()->id_, raw_class);
+        }
+        PageSpace::PageFor(new_obj)->set_top(new_addr + obj_size);
+        in_use += obj_size;
+      }
+      current += obj_size;
+    }
+  }
+  return in_use;
+}
+
+
+void GCCompactor::AddForwardingPage(ForwardingPage* forwarding_page) {
+  forwarding_pages_[num_forwarding_pages_++] = forwarding_page;
+  intptr_t index =
+      (forwarding_page->page()->start() / PageSpace::kPageSize) &
+      page_table_mask_;
+  while (page_table_[index] != NULL) {
+    index = (index + 1) & page_table_mask_;
+  }
+  page_table_[index] = forwarding_page;
+}
+
+
+ForwardingPage* GCCompactor::ForwardingPageFor(uword addr) const {
+  uword page_start = addr & ~(PageSpace::kPageSize - 1);
+  intptr_t index = (page_start / PageSpace::kPageSize) & page_table_mask_;
+  while (page_table_[index] != NULL) {
+    if (page_table_[index]->page()->start() == page_start) {
+      return page_table_[index];
+    }
+    index = (index + 1) & page_table_mask_;
+  }
+  return NULL;
+}
+
+}  // namespace dart
@@ -0,0 +1,68 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_GC_COMPACTOR_H_
+#define VM_GC_COMPACTOR_H_
+
+#include "vm/allocation.h"
+#include "vm/globals.h"
+
+namespace dart {
+
+// Forward declarations.
+class ForwardingPage;
+class HeapPage;
+class Heap;
+class Isolate;
+class PageSpace;
+class RawObject;
+
+// The class GCCompactor is used after marking to slide the live objects of
+// the regular old generation pages towards the start of the page list,
+// instead of sweeping these pages. Large pages are not compacted.
+//
+// The compaction happens in three passes over the pages: the new addresses
+// of the marked objects are planned and kept in forwarding pages, all
+// pointers to marked objects are updated and finally the objects are moved.
+class GCCompactor : public ValueObject {
+ public:
+  explicit GCCompactor(Heap* heap);
+  ~GCCompactor();
+
+  // Compacts the pages while clearing the mark bits. The tops of the pages
+  // are updated, pages which end up empty are left for the caller to free.
+  // Returns the size of memory used by the marked objects.
+  intptr_t CompactPages(Isolate* isolate,
+                        PageSpace* page_space,
+                        HeapPage* pages);
+
+  // Returns the new address of the marked object if it is being moved.
+  RawObject* Forward(RawObject* raw_obj) const;
+
+ private:
+  void PlanMoves(HeapPage* pages);
+  void UpdatePointers(Isolate* isolate, PageSpace* page_space);
+  intptr_t MoveObjects(Isolate* isolate);
+
+  void AddForwardingPage(ForwardingPage* forwarding_page);
+  ForwardingPage* ForwardingPageFor(uword addr) const;
+
+  Heap* heap_;
+
+  // The forwarding pages in page list order.
+  ForwardingPage** forwarding_pages_;
+  intptr_t num_forwarding_pages_;
+
+  // Open addressing hash table mapping page starts to forwarding pages. The
+  // pointers being updated are not dereferenced to find their page, as
+  // unreachable new objects may hold pointers into released pages.
+  ForwardingPage** page_table_;
+  intptr_t page_table_mask_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(GCCompactor);
+};
+
+}  // namespace dart
+
+#endif  // VM_GC_COMPACTOR_H_
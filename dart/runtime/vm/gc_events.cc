@@ -0,0 +1,52 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/gc_events.h"
+
+#include <algorithm>
+
+namespace dart {
+
+void GCEventLog::Add(const GCEvent& event) {
+  events_[count_ % kCapacity] = event;
+  count_++;
+}
+
+
+intptr_t GCEventLog::PauseCount(intptr_t space) const {
+  intptr_t result = 0;
+  for (intptr_t i = 0; i < Length(); i++) {
+    if (At(i).space == space) {
+      result++;
+    }
+  }
+  return result;
+}
+
+
+int64_t GCEventLog::PausePercentile(intptr_t space,
+                                    intptr_t percentile) const {
+  ASSERT((percentile >= 0) && (percentile <= 100));
+  int64_t pauses[kCapacity];
+  intptr_t num_pauses = 0;
+  for (intptr_t i = 0; i < Length(); i++) {
+    const GCEvent& event = At(i);
+    if (event.space == space) {
+      pauses[num_pauses++] = event.end - event.start;
+    }
+  }
+  if (num_pauses == 0) {
+    return 0;
+  }
+  std::sort(pauses, pauses + num_pauses);
+  // Nearest rank: the smallest pause not exceeded by percentile percent of
+  // the pauses.
+  intptr_t rank = (percentile * num_pauses + 99) / 100;
+  if (rank == 0) {
+    rank = 1;
+  }
+  return pauses[rank - 1];
+}
+
+}  // namespace dart
@@ -0,0 +1,64 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_GC_EVENTS_H_
+#define VM_GC_EVENTS_H_
+
+#include "platform/assert.h"
+#include "vm/globals.h"
+
+namespace dart {
+
+// A garbage collection of one space of the heap. Times are in microseconds
+// and sizes in bytes.
+struct GCEvent {
+  intptr_t space;  // The collected Heap::Space.
+  const char* reason;
+  int64_t start;
+  int64_t end;
+  intptr_t used_before;
+  intptr_t used_after;
+  intptr_t promoted;
+};
+
+
+// Keeps the most recent garbage collections of a heap in a ring buffer.
+class GCEventLog {
+ public:
+  static const intptr_t kCapacity = 256;
+
+  GCEventLog() : count_(0) {}
+  ~GCEventLog() {}
+
+  void Add(const GCEvent& event);
+
+  // Returns the number of recorded events.
+  intptr_t Length() const {
+    return (count_ < kCapacity) ? count_ : kCapacity;
+  }
+
+  // Returns the recorded events, the oldest first.
+  const GCEvent& At(intptr_t index) const {
+    ASSERT((index >= 0) && (index < Length()));
+    return events_[(count_ - Length() + index) % kCapacity];
+  }
+
+  // Returns the number of recorded collections of the space.
+  intptr_t PauseCount(intptr_t space) const;
+
+  // Returns the percentile of the pause times of the recorded collections of
+  // the space, or 0 if there are none.
+  int64_t PausePercentile(intptr_t space, intptr_t percentile) const;
+
+ private:
+  GCEvent events_[kCapacity];
+  // The number of events recorded since the heap was created.
+  intptr_t count_;
+
+  DISALLOW_COPY_AND_ASSIGN(GCEventLog);
+};
+
+}  // namespace dart
+
+#endif  // VM_GC_EVENTS_H_
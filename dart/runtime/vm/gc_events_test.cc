@@ -0,0 +1,55 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "platform/assert.h"
+#include "vm/gc_events.h"
+#include "vm/heap.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+static GCEvent MakeGCEvent(intptr_t space, int64_t start, int64_t pause) {
+  GCEvent event;
+  event.space = space;
+  event.reason = "test";
+  event.start = start;
+  event.end = start + pause;
+  event.used_before = 0;
+  event.used_after = 0;
+  event.promoted = 0;
+  return event;
+}
+
+
+TEST_CASE(GCEventLog) {
+  GCEventLog* log = new GCEventLog();
+  EXPECT_EQ(0, log->Length());
+  EXPECT_EQ(0, log->PausePercentile(Heap::kNew, 50));
+  // Pauses of 1 to 100 microseconds for the new space, 1000 for the old.
+  for (intptr_t i = 1; i <= 100; i++) {
+    log->Add(MakeGCEvent(Heap::kNew, i * 1000, i));
+  }
+  log->Add(MakeGCEvent(Heap::kOld, 0, 1000));
+  EXPECT_EQ(101, log->Length());
+  EXPECT_EQ(100, log->PauseCount(Heap::kNew));
+  EXPECT_EQ(1, log->PauseCount(Heap::kOld));
+  EXPECT_EQ(50, log->PausePercentile(Heap::kNew, 50));
+  EXPECT_EQ(90, log->PausePercentile(Heap::kNew, 90));
+  EXPECT_EQ(100, log->PausePercentile(Heap::kNew, 100));
+  EXPECT_EQ(1, log->PausePercentile(Heap::kNew, 0));
+  EXPECT_EQ(1000, log->PausePercentile(Heap::kOld, 50));
+  // The oldest events are dropped once the log is full.
+  const intptr_t kCapacity = GCEventLog::kCapacity;
+  for (intptr_t i = 0; i < kCapacity; i++) {
+    log->Add(MakeGCEvent(Heap::kOld, i, 10));
+  }
+  EXPECT_EQ(kCapacity, log->Length());
+  EXPECT_EQ(0, log->PauseCount(Heap::kNew));
+  EXPECT_EQ(0, log->At(0).start);
+  EXPECT_EQ(kCapacity - 1, log->At(kCapacity - 1).start);
+  EXPECT_EQ(10, log->PausePercentile(Heap::kOld, 99));
+  delete log;
+}
+
+}  // namespace dart
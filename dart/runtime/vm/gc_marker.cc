@@ -4,21 +4,26 @@
 
 #include "vm/gc_marker.h"
 
+#include <algorithm>
 #include <map>
 #include <utility>
 
 #include "vm/allocation.h"
+#include "vm/dart.h"
 #include "vm/dart_api_state.h"
+#include "vm/heap.h"
 #include "vm/isolate.h"
+#include "vm/os.h"
 #include "vm/pages.h"
 #include "vm/raw_object.h"
 #include "vm/stack_frame.h"
+#include "vm/thread_pool.h"
 #include "vm/visitor.h"
 
 namespace dart {
 
 // A simple chunked marking stack.
-class MarkingStack : public ValueObject {
+class MarkingStack {
  public:
   MarkingStack()
       : head_(new MarkingStackChunk()),
@@ -117,6 +122,95 @@ class MarkingStack : public ValueObject {
 };
 
 
+// A chunked list of object addresses or pointers recorded for the concurrent
+// marker.
+class MarkingAddressList {
+ public:
+  MarkingAddressList() : head_(NULL) {}
+
+  ~MarkingAddressList() {
+    Clear();
+  }
+
+  bool IsEmpty() const { return head_ == NULL; }
+
+  void Add(uword addr) {
+    if ((head_ == NULL) || head_->IsFull()) {
+      head_ = new Chunk(head_);
+    }
+    head_->Add(addr);
+  }
+
+  void AddAll(const uword* addrs, intptr_t count) {
+    for (intptr_t i = 0; i < count; i++) {
+      Add(addrs[i]);
+    }
+  }
+
+  // Moves all addresses of this list to the empty list 'other'.
+  void TransferTo(MarkingAddressList* other) {
+    ASSERT(other->IsEmpty());
+    other->head_ = head_;
+    head_ = NULL;
+  }
+
+  // Calls visitor->VisitAddress for every address in the list, skipping
+  // duplicate addresses within a chunk, and empties the list.
+  template<typename Visitor>
+  void VisitAndClear(Visitor* visitor) {
+    while (head_ != NULL) {
+      Chunk* chunk = head_;
+      head_ = chunk->next();
+      uword* first = chunk->addresses();
+      uword* last = first + chunk->top();
+      std::sort(first, last);
+      last = std::unique(first, last);
+      for (uword* current = first; current < last; current++) {
+        visitor->VisitAddress(*current);
+      }
+      delete chunk;
+    }
+  }
+
+  void Clear() {
+    while (head_ != NULL) {
+      Chunk* next = head_->next();
+      delete head_;
+      head_ = next;
+    }
+  }
+
+ private:
+  class Chunk {
+   public:
+    explicit Chunk(Chunk* next) : next_(next), top_(0) {}
+
+    Chunk* next() const { return next_; }
+    intptr_t top() const { return top_; }
+    uword* addresses() { return &addresses_[0]; }
+
+    bool IsFull() const { return top_ == kSize; }
+    void Add(uword addr) {
+      ASSERT(!IsFull());
+      addresses_[top_++] = addr;
+    }
+
+    static const intptr_t kSize = 1022;
+
+   private:
+    Chunk* next_;
+    intptr_t top_;
+    uword addresses_[kSize];
+
+    DISALLOW_COPY_AND_ASSIGN(Chunk);
+  };
+
+  Chunk* head_;
+
+  DISALLOW_COPY_AND_ASSIGN(MarkingAddressList);
+};
+
+
 class MarkingVisitor : public ObjectPointerVisitor {
  public:
   MarkingVisitor(Isolate* isolate,
@@ -128,7 +222,10 @@ class MarkingVisitor : public ObjectPointerVisitor {
         vm_heap_(Dart::vm_isolate()->heap()),
         page_space_(page_space),
         marking_stack_(marking_stack),
-        update_store_buffers_(false) {
+        update_store_buffers_(false),
+        concurrent_(false),
+        visited_new_pointer_(false),
+        visited_object_(NULL) {
     ASSERT(heap_ != vm_heap_);
   }
 
@@ -140,6 +237,45 @@ class MarkingVisitor : public ObjectPointerVisitor {
     }
   }
 
+  // Visits the pointers of a marked object. While marking concurrently the
+  // store buffers cannot be updated, instead the objects with pointers into
+  // new space are remembered and revisited when marking is finished.
+  void VisitObject(RawObject* raw_obj) {
+    if (!concurrent_) {
+      RawObject* saved_visited_object = visited_object_;
+      visited_object_ = raw_obj;
+      raw_obj->VisitPointers(this);
+      visited_object_ = saved_visited_object;
+      return;
+    }
+    bool saved_visited_new_pointer = visited_new_pointer_;
+    visited_new_pointer_ = false;
+    raw_obj->VisitPointers(this);
+    if (visited_new_pointer_) {
+      remembered_objects_.Add(reinterpret_cast<uword>(raw_obj));
+    }
+    visited_new_pointer_ = saved_visited_new_pointer;
+  }
+
+  // Pushes an already marked object to be visited again.
+  void Revisit(RawObject* raw_obj) {
+    ASSERT(raw_obj->IsMarked());
+    marking_stack_->Push(raw_obj);
+  }
+
+  // Objects allocated during concurrent marking are considered live.
+  void MarkAllocatedObject(RawObject* raw_obj) {
+    if (raw_obj->GetClassId() == kFreeListElement) {
+      // The parallel scavenger gives up copies that lost a race this way.
+      return;
+    }
+    if (raw_obj->IsMarked()) {
+      Revisit(raw_obj);
+    } else {
+      MarkAndPush(raw_obj);
+    }
+  }
+
   void DelayWeakProperty(RawWeakProperty* raw_weak) {
     RawObject* raw_key = raw_weak->ptr()->key_;
     DelaySet::iterator it = delay_set_.find(raw_key);
@@ -155,12 +291,23 @@ class MarkingVisitor : public ObjectPointerVisitor {
   void Finalize() {
     DelaySet::iterator it = delay_set_.begin();
     for (; it != delay_set_.end(); ++it) {
-      WeakProperty::Clear(it->second);
+      // The key of a weak property may have been replaced during concurrent
+      // marking, in which case the weak property has been visited again.
+      RawObject* raw_key = it->second->ptr()->key_;
+      if (raw_key->IsHeapObject() &&
+          raw_key->IsOldObject() &&
+          !raw_key->IsMarked()) {
+        WeakProperty::Clear(it->second);
+      }
     }
   }
 
   void set_update_store_buffers(bool val) { update_store_buffers_ = val; }
 
+  void set_concurrent(bool val) { concurrent_ = val; }
+
+  MarkingAddressList* remembered_objects() { return &remembered_objects_; }
+
  private:
   void MarkAndPush(RawObject* raw_obj) {
     ASSERT(raw_obj->IsHeapObject());
@@ -169,15 +316,22 @@ class MarkingVisitor : public ObjectPointerVisitor {
            true);
 
     // Mark the object and push it on the marking stack.
-    ASSERT(!raw_obj->IsMarked());
     RawClass* raw_class = isolate()->class_table()->At(raw_obj->GetClassId());
-    raw_obj->SetMarkBit();
+    if (concurrent_) {
+      // The isolate may concurrently update other bits of the tags.
+      if (!raw_obj->TryAcquireMarkBit()) {
+        return;
+      }
+    } else {
+      ASSERT(!raw_obj->IsMarked());
+      raw_obj->SetMarkBit();
+    }
     if (raw_obj->IsWatched()) {
       std::pair<DelaySet::iterator, DelaySet::iterator> ret;
       // Visit all elements with a key equal to raw_obj.
       ret = delay_set_.equal_range(raw_obj);
       for (DelaySet::iterator it = ret.first; it != ret.second; ++it) {
-        it->second->VisitPointers(this);
+        VisitObject(it->second);
       }
       delay_set_.erase(ret.first, ret.second);
       raw_obj->ClearWatchedBit();
@@ -196,19 +350,27 @@ class MarkingVisitor : public ObjectPointerVisitor {
     // Fast exit if the raw object is a Smi.
     if (!raw_obj->IsHeapObject()) return;
 
-    // Fast exit if the raw object is marked.
-    if (raw_obj->IsMarked()) return;
-
-    // Skip over new objects, but verify consistency of heap while at it.
+    // Skip over new objects, but verify consistency of heap while at it. New
+    // objects are checked first as their headers may be concurrently
+    // overwritten by the scavenger while marking concurrently.
     if (raw_obj->IsNewObject()) {
       // TODO(iposva): Add consistency check.
       if (update_store_buffers_) {
         ASSERT(p != NULL);
-        isolate()->store_buffer()->AddPointer(reinterpret_cast<uword>(p));
+        if (concurrent_) {
+          visited_new_pointer_ = true;
+        } else {
+          ASSERT(visited_object_ != NULL);
+          isolate()->store_buffer()->AddObjectPointer(
+              visited_object_, reinterpret_cast<uword>(p));
+        }
       }
       return;
     }
 
+    // Fast exit if the raw object is marked.
+    if (raw_obj->IsMarked()) return;
+
     // TODO(iposva): merge old and code spaces.
     MarkAndPush(raw_obj);
   }
@@ -220,6 +382,13 @@ class MarkingVisitor : public ObjectPointerVisitor {
   typedef std::multimap<RawObject*, RawWeakProperty*> DelaySet;
   DelaySet delay_set_;
   bool update_store_buffers_;
+  bool concurrent_;
+  bool visited_new_pointer_;
+  // The object whose pointers are being visited when not marking
+  // concurrently.
+  RawObject* visited_object_;
+  // Objects visited concurrently which had pointers into new space.
+  MarkingAddressList remembered_objects_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(MarkingVisitor);
 };
@@ -354,7 +523,7 @@ void GCMarker::DrainMarkingStack(Isolate* isolate,
   while (!visitor->marking_stack()->IsEmpty()) {
     RawObject* raw_obj = visitor->marking_stack()->Pop();
     if (raw_obj->GetClassId() != kWeakPropertyCid) {
-      raw_obj->VisitPointers(visitor);
+      visitor->VisitObject(raw_obj);
     } else {
       RawWeakProperty* raw_weak = reinterpret_cast<RawWeakProperty*>(raw_obj);
       ProcessWeakProperty(raw_weak, visitor);
@@ -375,7 +544,7 @@ void GCMarker::ProcessWeakProperty(RawWeakProperty* raw_weak,
     visitor->DelayWeakProperty(raw_weak);
   } else {
     // Key is gray or black.  Make the weak property black.
-    raw_weak->VisitPointers(visitor);
+    visitor->VisitObject(raw_weak);
   }
 }
 
@@ -411,6 +580,274 @@ void GCMarker::MarkObjects(Isolate* isolate,
   mark.Finalize();
   ProcessPeerReferents(page_space);
   Epilogue(isolate, invoke_api_callbacks);
+  isolate->class_table()->FreeOldTables();
+}
+
+
+
+class ConcurrentMarkerTask : public ThreadPool::Task {
+ public:
+  explicit ConcurrentMarkerTask(ConcurrentMarker* marker) : marker_(marker) {}
+
+  virtual void Run() {
+    marker_->Run();
+  }
+
+ private:
+  ConcurrentMarker* marker_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentMarkerTask);
+};
+
+
+// Pushes the recorded objects that have already been marked to be visited
+// again. Unmarked objects will be visited once they are marked.
+class BarrierObjectVisitor : public ValueObject {
+ public:
+  explicit BarrierObjectVisitor(MarkingVisitor* visitor) : visitor_(visitor) {}
+
+  void VisitAddress(uword addr) {
+    RawObject* raw_obj = reinterpret_cast<RawObject*>(addr);
+    if (raw_obj->IsMarked()) {
+      visitor_->Revisit(raw_obj);
+    }
+  }
+
+ private:
+  MarkingVisitor* visitor_;
+
+  DISALLOW_COPY_AND_ASSIGN(BarrierObjectVisitor);
+};
+
+
+// Marks the objects allocated during marking and pushes them to be visited.
+class AllocatedObjectVisitor : public ValueObject {
+ public:
+  explicit AllocatedObjectVisitor(MarkingVisitor* visitor)
+      : visitor_(visitor) {}
+
+  void VisitAddress(uword addr) {
+    visitor_->MarkAllocatedObject(RawObject::FromAddr(addr));
+  }
+
+ private:
+  MarkingVisitor* visitor_;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocatedObjectVisitor);
+};
+
+
+ConcurrentMarker::ConcurrentMarker(Heap* heap, PageSpace* page_space)
+    : heap_(heap),
+      page_space_(page_space),
+      isolate_(NULL),
+      marker_(heap),
+      marking_stack_(new MarkingStack()),
+      visitor_(NULL),
+      incremental_(false),
+      allocated_objects_(new MarkingAddressList()),
+      barrier_objects_(new MarkingAddressList()),
+      running_(false),
+      stop_requested_(false),
+      done_(false) {
+}
+
+
+ConcurrentMarker::~ConcurrentMarker() {
+  if (isolate_ != NULL) {
+    // Marking was abandoned, e.g. because the isolate is shutting down.
+    StopHelper();
+    DeactivateBarrier();
+    while (!marking_stack_->IsEmpty()) {
+      marking_stack_->Pop();
+    }
+  }
+  delete visitor_;
+  delete marking_stack_;
+  delete allocated_objects_;
+  delete barrier_objects_;
+}
+
+
+void ConcurrentMarker::MarkRoots(Isolate* isolate) {
+  ASSERT(isolate_ == NULL);
+  isolate_ = isolate;
+  visitor_ = new MarkingVisitor(isolate, heap_, page_space_, marking_stack_);
+  MarkingBarrierBlock* barrier_block = isolate->marking_barrier_block();
+  barrier_block->Reset();
+  barrier_block->set_is_active(true);
+  // Prologue weak persistent handles are treated as strong references, the
+  // API callbacks are only invoked when marking is finished.
+  marker_.IterateRoots(isolate, visitor_, true);
+  visitor_->set_concurrent(true);
+}
+
+
+void ConcurrentMarker::Start(Isolate* isolate) {
+  ASSERT(Dart::thread_pool() != NULL);
+  MarkRoots(isolate);
+  // The marker thread visits objects of this isolate on its behalf.
+  isolate->IncrementGCHelpers();
+  running_ = true;
+  Dart::thread_pool()->RunHelper(new ConcurrentMarkerTask(this));
+}
+
+
+void ConcurrentMarker::StartIncremental(Isolate* isolate) {
+  incremental_ = true;
+  MarkRoots(isolate);
+}
+
+
+void ConcurrentMarker::VisitBatch() {
+  for (intptr_t i = 0;
+       (i < kMarkingBatchSize) && !marking_stack_->IsEmpty();
+       i++) {
+    RawObject* raw_obj = marking_stack_->Pop();
+    if (raw_obj->GetClassId() != kWeakPropertyCid) {
+      visitor_->VisitObject(raw_obj);
+    } else {
+      RawWeakProperty* raw_weak = reinterpret_cast<RawWeakProperty*>(raw_obj);
+      marker_.ProcessWeakProperty(raw_weak, visitor_);
+    }
+  }
+}
+
+
+void ConcurrentMarker::Run() {
+  // Object sizes and class ids are looked up through the current isolate.
+  Isolate::SetCurrent(isolate_);
+  visitor_->set_update_store_buffers(true);
+  bool stop = false;
+  while (!stop) {
+    VisitBatch();
+    MarkingAddressList objects;
+    monitor_.Enter();
+    stop = stop_requested_;
+    if (marking_stack_->IsEmpty()) {
+      barrier_objects_->TransferTo(&objects);
+    }
+    monitor_.Exit();
+    VisitBarrierObjects(&objects);
+    if (marking_stack_->IsEmpty()) {
+      break;
+    }
+  }
+  visitor_->set_update_store_buffers(false);
+  Isolate::SetCurrent(NULL);
+
+  monitor_.Enter();
+  if (!stop_requested_) {
+    // Ask the isolate to finish marking at its next interrupt check.
+    done_ = true;
+    isolate_->ScheduleInterrupts(Isolate::kMarkingInterrupt);
+  }
+  running_ = false;
+  monitor_.NotifyAll();
+  monitor_.Exit();
+}
+
+
+bool ConcurrentMarker::Step(int64_t budget_micros) {
+  ASSERT(incremental_);
+  ASSERT(isolate_ == Isolate::Current());
+  if (done_) {
+    return true;
+  }
+  int64_t deadline = OS::GetCurrentTimeMicros() + budget_micros;
+  visitor_->set_update_store_buffers(true);
+  do {
+    VisitBatch();
+    if (marking_stack_->IsEmpty()) {
+      // Revisit the objects stored into since they were last visited.
+      isolate_->marking_barrier_block()->ProcessBuffer(isolate_);
+      MarkingAddressList objects;
+      barrier_objects_->TransferTo(&objects);
+      VisitBarrierObjects(&objects);
+      if (marking_stack_->IsEmpty()) {
+        done_ = true;
+        break;
+      }
+    }
+  } while (OS::GetCurrentTimeMicros() < deadline);
+  visitor_->set_update_store_buffers(false);
+  return done_;
+}
+
+
+void ConcurrentMarker::StopHelper() {
+  monitor_.Enter();
+  stop_requested_ = true;
+  while (running_) {
+    monitor_.Wait(Monitor::kNoTimeout);
+  }
+  monitor_.Exit();
+}
+
+
+void ConcurrentMarker::DeactivateBarrier() {
+  if (!incremental_) {
+    isolate_->DecrementGCHelpers();
+  }
+  MarkingBarrierBlock* barrier_block = isolate_->marking_barrier_block();
+  barrier_block->set_is_active(false);
+  for (intptr_t i = 0; i < barrier_block->Count(); i++) {
+    barrier_objects_->Add(barrier_block->At(i));
+  }
+  barrier_block->Reset();
+}
+
+
+void ConcurrentMarker::VisitBarrierObjects(MarkingAddressList* objects) {
+  BarrierObjectVisitor barrier_visitor(visitor_);
+  objects->VisitAndClear(&barrier_visitor);
+}
+
+
+bool ConcurrentMarker::IsDone() {
+  monitor_.Enter();
+  bool result = done_;
+  monitor_.Exit();
+  return result;
+}
+
+
+void ConcurrentMarker::AddBarrierObjects(const uword* objects,
+                                         intptr_t count) {
+  monitor_.Enter();
+  barrier_objects_->AddAll(objects, count);
+  monitor_.Exit();
+}
+
+
+void ConcurrentMarker::RecordAllocation(uword addr) {
+  allocated_objects_->Add(addr);
+}
+
+
+void ConcurrentMarker::Finish(bool invoke_api_callbacks) {
+  ASSERT(isolate_ != NULL);
+  Isolate* isolate = isolate_;
+  StopHelper();
+  DeactivateBarrier();
+  isolate_ = NULL;
+  visitor_->set_concurrent(false);
+  // Rebuilds the store buffers from the visited objects below.
+  marker_.Prologue(isolate, invoke_api_callbacks);
+  VisitBarrierObjects(visitor_->remembered_objects());
+  VisitBarrierObjects(barrier_objects_);
+  AllocatedObjectVisitor allocated_visitor(visitor_);
+  allocated_objects_->VisitAndClear(&allocated_visitor);
+  marker_.IterateRoots(isolate, visitor_, !invoke_api_callbacks);
+  marker_.DrainMarkingStack(isolate, visitor_);
+  marker_.IterateWeakReferences(isolate, visitor_);
+  MarkingWeakVisitor mark_weak;
+  marker_.IterateWeakRoots(isolate, &mark_weak, invoke_api_callbacks);
+  visitor_->Finalize();
+  marker_.ProcessPeerReferents(page_space_);
+  marker_.Epilogue(isolate, invoke_api_callbacks);
+  // No other thread reads the class table anymore.
+  isolate->class_table()->FreeOldTables();
 }
 
 }  // namespace dart
@@ -5,6 +5,7 @@
 #ifndef VM_GC_MARKER_H_
 #define VM_GC_MARKER_H_
 
+#include "platform/thread.h"
 #include "vm/allocation.h"
 
 namespace dart {
@@ -13,6 +14,8 @@ namespace dart {
 class HandleVisitor;
 class Heap;
 class Isolate;
+class MarkingAddressList;
+class MarkingStack;
 class MarkingVisitor;
 class ObjectPointerVisitor;
 class PageSpace;
@@ -45,9 +48,81 @@ class GCMarker : public ValueObject {
 
   Heap* heap_;
 
+  friend class ConcurrentMarker;
   DISALLOW_IMPLICIT_CONSTRUCTORS(GCMarker);
 };
 
+
+// The class ConcurrentMarker marks reachable old generation objects on a
+// helper thread while the isolate keeps running. While marking is active the
+// write barrier records the old objects being stored into, and the marker
+// revisits the recorded objects it has already visited. The marking is
+// finished in a pause which revisits the roots, the recorded objects and the
+// objects allocated during marking before processing the weak references.
+// In incremental mode there is no marker thread, instead the isolate marks
+// in time-bounded steps taken on its allocation slow paths.
+class ConcurrentMarker {
+ public:
+  ConcurrentMarker(Heap* heap, PageSpace* page_space);
+  ~ConcurrentMarker();
+
+  // Marks the roots of the isolate and starts the marker thread.
+  void Start(Isolate* isolate);
+
+  // Marks the roots of the isolate, leaving the remaining marking to Step.
+  void StartIncremental(Isolate* isolate);
+
+  // Marks for at most about 'budget_micros' in the calling isolate. Returns
+  // true once there is nothing left to mark before finishing.
+  bool Step(int64_t budget_micros);
+
+  bool is_incremental() const { return incremental_; }
+
+  // Stops the marker thread and finishes marking in the calling thread.
+  void Finish(bool invoke_api_callbacks);
+
+  // Returns true once the marker thread has run out of work.
+  bool IsDone();
+
+  // Hands over the objects recorded by the write barrier of the isolate.
+  void AddBarrierObjects(const uword* objects, intptr_t count);
+
+  // Records an object allocated in the old generation during marking. These
+  // objects are treated as live by this marking.
+  void RecordAllocation(uword addr);
+
+ private:
+  static const intptr_t kMarkingBatchSize = 1024;
+
+  void MarkRoots(Isolate* isolate);
+  void VisitBatch();
+  void Run();
+  void StopHelper();
+  void DeactivateBarrier();
+  void VisitBarrierObjects(MarkingAddressList* objects);
+
+  Heap* heap_;
+  PageSpace* page_space_;
+  Isolate* isolate_;
+  GCMarker marker_;
+  MarkingStack* marking_stack_;
+  MarkingVisitor* visitor_;
+  bool incremental_;
+
+  // Objects allocated during marking, only accessed by the isolate.
+  MarkingAddressList* allocated_objects_;
+
+  // Protects the fields below, which are shared with the marker thread.
+  Monitor monitor_;
+  MarkingAddressList* barrier_objects_;
+  bool running_;
+  bool stop_requested_;
+  bool done_;
+
+  friend class ConcurrentMarkerTask;
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ConcurrentMarker);
+};
+
 }  // namespace dart
 
 #endif  // VM_GC_MARKER_H_
@@ -4,9 +4,12 @@
 
 #include "vm/gc_sweeper.h"
 
+#include "vm/dart.h"
 #include "vm/freelist.h"
 #include "vm/globals.h"
+#include "vm/isolate.h"
 #include "vm/pages.h"
+#include "vm/thread_pool.h"
 
 namespace dart {
 
@@ -70,4 +73,86 @@ intptr_t GCSweeper::SweepLargePage(HeapPage* page) {
   return raw_obj->Size();
 }
 
+
+class ConcurrentSweeperTask : public ThreadPool::Task {
+ public:
+  explicit ConcurrentSweeperTask(ConcurrentSweeper* sweeper)
+      : sweeper_(sweeper) {}
+
+  virtual void Run() {
+    sweeper_->Run();
+  }
+
+ private:
+  ConcurrentSweeper* sweeper_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentSweeperTask);
+};
+
+
+ConcurrentSweeper::ConcurrentSweeper(Heap* heap, PageSpace* page_space)
+    : heap_(heap),
+      page_space_(page_space),
+      isolate_(NULL),
+      freelist_(),
+      running_(false) {
+}
+
+
+ConcurrentSweeper::~ConcurrentSweeper() {
+  ASSERT(!running_);
+}
+
+
+void ConcurrentSweeper::Start(Isolate* isolate) {
+  ASSERT(isolate_ == NULL);
+  ASSERT(Dart::thread_pool() != NULL);
+  isolate_ = isolate;
+  // The helper looks up the sizes of objects on behalf of the isolate.
+  isolate->IncrementGCHelpers();
+  running_ = true;
+  Dart::thread_pool()->RunHelper(new ConcurrentSweeperTask(this));
+}
+
+
+void ConcurrentSweeper::Run() {
+  // Object sizes are looked up through the class table of the current isolate.
+  Isolate::SetCurrent(isolate_);
+  GCSweeper sweeper(heap_);
+  FreeList page_freelist;
+  HeapPage* page = page_space_->TakeUnsweptPage();
+  while (page != NULL) {
+    sweeper.SweepPage(page, &page_freelist);
+    monitor_.Enter();
+    freelist_.Merge(&page_freelist);
+    monitor_.Exit();
+    page = page_space_->TakeUnsweptPage();
+  }
+  Isolate::SetCurrent(NULL);
+  monitor_.Enter();
+  running_ = false;
+  monitor_.NotifyAll();
+  monitor_.Exit();
+}
+
+
+void ConcurrentSweeper::TakeFreeList(FreeList* freelist) {
+  monitor_.Enter();
+  freelist->Merge(&freelist_);
+  monitor_.Exit();
+}
+
+
+void ConcurrentSweeper::Finish(FreeList* freelist) {
+  ASSERT(isolate_ != NULL);
+  monitor_.Enter();
+  while (running_) {
+    monitor_.Wait(Monitor::kNoTimeout);
+  }
+  freelist->Merge(&freelist_);
+  monitor_.Exit();
+  isolate_->DecrementGCHelpers();
+  isolate_ = NULL;
+}
+
 }  // namespace dart
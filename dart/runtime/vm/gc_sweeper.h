@@ -5,14 +5,17 @@
 #ifndef VM_GC_SWEEPER_H_
 #define VM_GC_SWEEPER_H_
 
+#include "platform/thread.h"
+#include "vm/freelist.h"
 #include "vm/globals.h"
 
 namespace dart {
 
 // Forward declarations.
-class FreeList;
 class Heap;
 class HeapPage;
+class Isolate;
+class PageSpace;
 
 // The class GCSweeper is used to visit the heap after marking to reclaim unused
 // memory.
@@ -34,6 +37,42 @@ class GCSweeper {
   DISALLOW_IMPLICIT_CONSTRUCTORS(GCSweeper);
 };
 
+
+// The class ConcurrentSweeper sweeps the pages left unswept by a mark-sweep on
+// a helper thread while the isolate keeps running. The helper and the isolate
+// take the pages to sweep from the page space, the memory freed by the helper
+// is collected in a separate freelist which the isolate takes over.
+class ConcurrentSweeper {
+ public:
+  ConcurrentSweeper(Heap* heap, PageSpace* page_space);
+  ~ConcurrentSweeper();
+
+  // Starts the helper thread sweeping on behalf of the isolate.
+  void Start(Isolate* isolate);
+
+  // Moves the memory freed by the helper so far into the freelist.
+  void TakeFreeList(FreeList* freelist);
+
+  // Waits for the helper to run out of pages and moves the memory it freed
+  // into the freelist.
+  void Finish(FreeList* freelist);
+
+ private:
+  void Run();
+
+  Heap* heap_;
+  PageSpace* page_space_;
+  Isolate* isolate_;
+
+  // Protects the fields below, which are shared with the helper thread.
+  Monitor monitor_;
+  FreeList freelist_;
+  bool running_;
+
+  friend class ConcurrentSweeperTask;
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ConcurrentSweeper);
+};
+
 }  // namespace dart
 
 #endif  // VM_GC_SWEEPER_H_
@@ -99,18 +99,33 @@ HandleScope::~HandleScope() {
 
 
 #if defined(DEBUG)
-NoHandleScope::NoHandleScope(BaseIsolate* isolate) : StackResource(isolate) {
-  isolate->IncrementNoHandleScopeDepth();
+// While GC helper threads are active the scope is not registered with the
+// isolate, see BaseIsolate::gc_helpers_active.
+static BaseIsolate* NoHandleScopeIsolate(BaseIsolate* isolate) {
+  return isolate->gc_helpers_active() ? NULL : isolate;
 }
 
 
-NoHandleScope::NoHandleScope() : StackResource(Isolate::Current()) {
-  isolate()->IncrementNoHandleScopeDepth();
+NoHandleScope::NoHandleScope(BaseIsolate* isolate)
+    : StackResource(NoHandleScopeIsolate(isolate)) {
+  if (this->isolate() != NULL) {
+    this->isolate()->IncrementNoHandleScopeDepth();
+  }
+}
+
+
+NoHandleScope::NoHandleScope()
+    : StackResource(NoHandleScopeIsolate(Isolate::Current())) {
+  if (isolate() != NULL) {
+    isolate()->IncrementNoHandleScopeDepth();
+  }
 }
 
 
 NoHandleScope::~NoHandleScope() {
-  isolate()->DecrementNoHandleScopeDepth();
+  if (isolate() != NULL) {
+    isolate()->DecrementNoHandleScopeDepth();
+  }
 }
 #endif  // defined(DEBUG)
 
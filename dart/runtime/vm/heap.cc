@@ -59,6 +59,7 @@ uword Heap::AllocateNew(intptr_t size) {
     return addr;
   }
   CollectGarbage(kNew);
+  StepIncrementalMarking();
   addr = new_space_->TryAllocate(size);
   if (addr != 0) {
     return addr;
@@ -69,6 +70,7 @@ uword Heap::AllocateNew(intptr_t size) {
 
 uword Heap::AllocateOld(intptr_t size) {
   ASSERT(Isolate::Current()->no_gc_scope_depth() == 0);
+  StepIncrementalMarking();
   uword addr = old_space_->TryAllocate(size);
   if (addr == 0) {
     CollectAllGarbage();
@@ -120,6 +122,7 @@ bool Heap::CodeContains(uword addr) const {
 
 
 void Heap::IterateObjects(ObjectVisitor* visitor) {
+  old_space_->FinishSweeping();
   new_space_->VisitObjects(visitor);
   old_space_->VisitObjects(visitor);
   code_space_->VisitObjects(visitor);
@@ -127,6 +130,7 @@ void Heap::IterateObjects(ObjectVisitor* visitor) {
 
 
 void Heap::IteratePointers(ObjectPointerVisitor* visitor) {
+  old_space_->FinishSweeping();
   new_space_->VisitObjectPointers(visitor);
   old_space_->VisitObjectPointers(visitor);
   code_space_->VisitObjectPointers(visitor);
@@ -139,6 +143,7 @@ void Heap::IterateNewPointers(ObjectPointerVisitor* visitor) {
 
 
 void Heap::IterateOldPointers(ObjectPointerVisitor* visitor) {
+  old_space_->FinishSweeping();
   old_space_->VisitObjectPointers(visitor);
   code_space_->VisitObjectPointers(visitor);
 }
@@ -149,12 +154,18 @@ void Heap::IterateCodePointers(ObjectPointerVisitor* visitor) {
 }
 
 
+intptr_t Heap::IterateDirtyCards(ObjectPointerVisitor* visitor) {
+  return old_space_->VisitDirtyCards(visitor);
+}
+
+
 void Heap::IterateNewObjects(ObjectVisitor* visitor) {
   new_space_->VisitObjects(visitor);
 }
 
 
 void Heap::IterateOldObjects(ObjectVisitor* visitor) {
+  old_space_->FinishSweeping();
   old_space_->VisitObjects(visitor);
   code_space_->VisitObjects(visitor);
 }
@@ -232,8 +243,41 @@ void Heap::EnableGrowthControl() {
 }
 
 
+void Heap::UpdateConcurrentMarking() {
+  old_space_->UpdateConcurrentMarking();
+}
+
+
+void Heap::StartConcurrentMarking() {
+  if (old_space_->concurrent_marker() == NULL) {
+    old_space_->StartConcurrentMarking();
+  }
+}
+
+
+void Heap::FinishConcurrentMarking() {
+  if (old_space_->concurrent_marker() != NULL) {
+    CollectGarbage(kOld);
+  }
+}
+
+
+void Heap::StepIncrementalMarking() {
+  if (old_space_->StepIncrementalMarking()) {
+    CollectGarbage(kOld);
+  }
+}
+
+
+void Heap::FinishSweeping() {
+  FinishConcurrentMarking();
+  old_space_->FinishSweeping();
+}
+
+
 void Heap::WriteProtect(bool read_only) {
   read_only_ = read_only;
+  old_space_->FinishSweeping();
   new_space_->WriteProtect(read_only);
   old_space_->WriteProtect(read_only);
   // TODO(iposva): Merge old and code space.
@@ -386,6 +430,11 @@ int64_t Heap::PeerCount() const {
 }
 
 
+intptr_t Heap::NewSemiSpaceSize() const {
+  return new_space_->semi_space_size();
+}
+
+
 #if defined(DEBUG)
 NoGCScope::NoGCScope() : StackResource(Isolate::Current()) {
   isolate()->IncrementNoGCScopeDepth();
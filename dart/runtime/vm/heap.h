@@ -8,6 +8,7 @@
 #include "platform/assert.h"
 #include "vm/allocation.h"
 #include "vm/flags.h"
+#include "vm/gc_events.h"
 #include "vm/globals.h"
 #include "vm/pages.h"
 #include "vm/scavenger.h"
@@ -74,14 +75,21 @@ class Heap {
   }
 
   uword TryAllocate(intptr_t size, Space space) {
+    return TryAllocate(size, space, PageSpace::kControlGrowth);
+  }
+
+  // The growth policy is ignored for allocations in the new space.
+  uword TryAllocate(intptr_t size,
+                    Space space,
+                    PageSpace::GrowthPolicy growth_policy) {
     ASSERT(!read_only_);
     switch (space) {
       case kNew:
         return new_space_->TryAllocate(size);
       case kOld:
-        return old_space_->TryAllocate(size);
+        return old_space_->TryAllocate(size, growth_policy);
       case kCode:
-        return code_space_->TryAllocate(size);
+        return code_space_->TryAllocate(size, growth_policy);
       default:
         UNREACHABLE();
     }
@@ -103,6 +111,10 @@ class Heap {
   void IterateOldPointers(ObjectPointerVisitor* visitor);
   void IterateCodePointers(ObjectPointerVisitor* visitor);
 
+  // Visit the old generation pointers covered by dirty cards. Returns the
+  // number of dirty cards.
+  intptr_t IterateDirtyCards(ObjectPointerVisitor* visitor);
+
   // Visit all objects.
   void IterateObjects(ObjectVisitor* visitor);
 
@@ -129,6 +141,32 @@ class Heap {
   // called before any user code is executed.
   void EnableGrowthControl();
 
+  // Starts or finishes the concurrent marking of the old generation. Called
+  // when the isolate handles a marking interrupt.
+  void UpdateConcurrentMarking();
+
+  // Starts the concurrent marking of the old generation unless it is already
+  // in progress.
+  void StartConcurrentMarking();
+
+  // Finishes the concurrent marking in progress, if any, with a full
+  // mark-sweep of the old generation.
+  void FinishConcurrentMarking();
+
+  // Takes a time-bounded step of the incremental marking in progress, if
+  // any, and finishes it once there is nothing left to mark. Called on the
+  // allocation slow paths.
+  void StepIncrementalMarking();
+
+  // Finishes the collection of the old generation in progress, if any, i.e.
+  // the concurrent marking and the lazy sweeping. Afterwards no old object
+  // is marked.
+  void FinishSweeping();
+
+  ConcurrentMarker* concurrent_marker() const {
+    return old_space_->concurrent_marker();
+  }
+
   // Protect access to the heap.
   void WriteProtect(bool read_only);
 
@@ -167,6 +205,15 @@ class Heap {
   // Returns the number of objects with a peer.
   int64_t PeerCount() const;
 
+  // Returns the size of the new gen semi space used for allocation.
+  intptr_t NewSemiSpaceSize() const;
+
+  // Records a garbage collection of one of the spaces.
+  void RecordGCEvent(const GCEvent& event) { gc_events_.Add(event); }
+
+  // The most recent garbage collections of this heap.
+  const GCEventLog* gc_events() const { return &gc_events_; }
+
  private:
   Heap();
 
@@ -182,6 +229,8 @@ class Heap {
   // This heap is in read-only mode: No allocation is allowed.
   bool read_only_;
 
+  GCEventLog gc_events_;
+
   friend class GCTestHelper;
   DISALLOW_COPY_AND_ASSIGN(Heap);
 };
@@ -3,12 +3,16 @@
 // BSD-style license that can be found in the LICENSE file.
 
 #include "platform/assert.h"
+#include "vm/dart_api_impl.h"
+#include "vm/gc_marker.h"
 #include "vm/globals.h"
 #include "vm/heap.h"
 #include "vm/unit_test.h"
 
 namespace dart {
 
+DECLARE_FLAG(int, incremental_mark_budget);
+
 // Only ia32 and x64 can run execution tests.
 #if defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64)
 TEST_CASE(OldGC) {
@@ -53,5 +57,367 @@ TEST_CASE(LargeSweep) {
   heap->CollectGarbage(Heap::kOld);
 }
 
+
+TEST_CASE(ParallelScavenge) {
+  const char* kScriptChars =
+  "var data;\n"
+  "build() {\n"
+  "  data = new List(1000);\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    data[i] = [i, 'x$i', new List(i)];\n"
+  "  }\n"
+  "}\n"
+  "check() {\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    if (data[i][0] != i) return false;\n"
+  "    if (data[i][1] != 'x$i') return false;\n"
+  "    if (data[i][2].length != i) return false;\n"
+  "  }\n"
+  "  return true;\n"
+  "}\n";
+  intptr_t saved_tasks = FLAG_scavenger_tasks;
+  FLAG_scavenger_tasks = 4;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("build"), 0, NULL);
+  EXPECT_VALID(result);
+  Heap* heap = Isolate::Current()->heap();
+  // The second scavenge promotes the survivors of the first one.
+  for (intptr_t i = 0; i < 3; i++) {
+    heap->CollectGarbage(Heap::kNew);
+    EXPECT(heap->Verify());
+  }
+  result = Dart_Invoke(lib, Dart_NewString("check"), 0, NULL);
+  EXPECT_VALID(result);
+  bool value = false;
+  EXPECT_VALID(Dart_BooleanValue(result, &value));
+  EXPECT(value);
+  FLAG_scavenger_tasks = saved_tasks;
+}
+
+
+static void TestMarking(bool incremental) {
+  const char* kScriptChars =
+  "var data;\n"
+  "build() {\n"
+  "  data = new List(1000);\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    data[i] = [i, 'x$i', new List(i % 10)];\n"
+  "  }\n"
+  "}\n"
+  "mutate() {\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    var entry = data[(i * 7) % data.length];\n"
+  "    data[(i * 7) % data.length] = data[i];\n"
+  "    data[i] = [entry[0], entry[1], entry[2]];\n"
+  "    entry[2] = null;\n"
+  "  }\n"
+  "}\n"
+  "check() {\n"
+  "  var seen = new List(data.length);\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    var entry = data[i];\n"
+  "    if (seen[entry[0]] != null) return false;\n"
+  "    seen[entry[0]] = true;\n"
+  "    if (entry[1] != 'x${entry[0]}') return false;\n"
+  "    if ((entry[2] != null) && (entry[2].length != entry[0] % 10)) {\n"
+  "      return false;\n"
+  "    }\n"
+  "  }\n"
+  "  return true;\n"
+  "}\n";
+  bool saved_concurrent_mark = FLAG_concurrent_mark;
+  bool saved_incremental_mark = FLAG_incremental_mark;
+  int saved_incremental_mark_budget = FLAG_incremental_mark_budget;
+  FLAG_concurrent_mark = !incremental;
+  FLAG_incremental_mark = incremental;
+  // Take the smallest steps to keep marking while the objects are mutated.
+  FLAG_incremental_mark_budget = 0;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("build"), 0, NULL);
+  EXPECT_VALID(result);
+  Heap* heap = Isolate::Current()->heap();
+  // Compile the functions before marking, the incremental marking is also
+  // advanced by the old generation allocations of the compiler.
+  result = Dart_Invoke(lib, Dart_NewString("mutate"), 0, NULL);
+  EXPECT_VALID(result);
+  heap->CollectGarbage(Heap::kOld);
+  for (intptr_t i = 0; i < 3; i++) {
+    heap->StartConcurrentMarking();
+    EXPECT(heap->concurrent_marker() != NULL);
+    EXPECT_EQ(incremental, heap->concurrent_marker()->is_incremental());
+    // Store into the old objects while they are being marked. The scavenge
+    // promotes the new entries into the old generation during marking.
+    result = Dart_Invoke(lib, Dart_NewString("mutate"), 0, NULL);
+    EXPECT_VALID(result);
+    heap->CollectGarbage(Heap::kNew);
+    heap->CollectGarbage(Heap::kNew);
+    result = Dart_Invoke(lib, Dart_NewString("mutate"), 0, NULL);
+    EXPECT_VALID(result);
+    if (incremental) {
+      // The steps finish the marking once everything has been marked.
+      while (heap->concurrent_marker() != NULL) {
+        heap->StepIncrementalMarking();
+      }
+    } else {
+      heap->CollectGarbage(Heap::kOld);
+    }
+    EXPECT(heap->concurrent_marker() == NULL);
+    EXPECT(heap->Verify());
+  }
+  result = Dart_Invoke(lib, Dart_NewString("check"), 0, NULL);
+  EXPECT_VALID(result);
+  bool value = false;
+  EXPECT_VALID(Dart_BooleanValue(result, &value));
+  EXPECT(value);
+  FLAG_concurrent_mark = saved_concurrent_mark;
+  FLAG_incremental_mark = saved_incremental_mark;
+  FLAG_incremental_mark_budget = saved_incremental_mark_budget;
+}
+
+
+TEST_CASE(ConcurrentMark) {
+  TestMarking(false);
+}
+
+
+TEST_CASE(IncrementalMark) {
+  TestMarking(true);
+}
+
+
+static void TestSweeping(bool concurrent_sweep) {
+  const char* kScriptChars =
+  "var data;\n"
+  "build() {\n"
+  "  data = new List(2000);\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    data[i] = [i, 'x$i', new List(i % 10)];\n"
+  "  }\n"
+  "}\n"
+  "drop() {\n"
+  "  for (int i = 0; i < data.length; i += 2) {\n"
+  "    data[i] = null;\n"
+  "  }\n"
+  "}\n"
+  "refill() {\n"
+  "  for (int i = 0; i < data.length; i += 2) {\n"
+  "    data[i] = [i, 'x$i', new List(i % 10)];\n"
+  "  }\n"
+  "}\n"
+  "check() {\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    if (data[i][0] != i) return false;\n"
+  "    if (data[i][1] != 'x$i') return false;\n"
+  "    if (data[i][2].length != i % 10) return false;\n"
+  "  }\n"
+  "  return true;\n"
+  "}\n";
+  bool saved_lazy_sweep = FLAG_lazy_sweep;
+  bool saved_concurrent_sweep = FLAG_concurrent_sweep;
+  FLAG_lazy_sweep = true;
+  FLAG_concurrent_sweep = concurrent_sweep;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Heap* heap = Isolate::Current()->heap();
+  for (intptr_t i = 0; i < 3; i++) {
+    EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("build"), 0, NULL));
+    heap->CollectGarbage(Heap::kOld);
+    EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("drop"), 0, NULL));
+    heap->CollectGarbage(Heap::kOld);
+    // Promote the new entries into the partly swept old generation.
+    EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("refill"), 0, NULL));
+    heap->CollectGarbage(Heap::kNew);
+    heap->CollectGarbage(Heap::kNew);
+    Dart_Handle result = Dart_Invoke(lib, Dart_NewString("check"), 0, NULL);
+    EXPECT_VALID(result);
+    bool value = false;
+    EXPECT_VALID(Dart_BooleanValue(result, &value));
+    EXPECT(value);
+  }
+  heap->FinishSweeping();
+  EXPECT(heap->Verify());
+  FLAG_lazy_sweep = saved_lazy_sweep;
+  FLAG_concurrent_sweep = saved_concurrent_sweep;
+}
+
+
+TEST_CASE(LazySweep) {
+  TestSweeping(false);
+}
+
+
+TEST_CASE(ConcurrentSweep) {
+  TestSweeping(true);
+}
+
+
+TEST_CASE(AdaptiveNewGen) {
+  const char* kScriptChars =
+  "var data;\n"
+  "build() {\n"
+  "  data = new List(20000);\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    data[i] = [i, 'x$i'];\n"
+  "  }\n"
+  "}\n"
+  "check() {\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    if (data[i][0] != i) return false;\n"
+  "    if (data[i][1] != 'x$i') return false;\n"
+  "  }\n"
+  "  return true;\n"
+  "}\n";
+  bool saved_adaptive_new_gen = FLAG_adaptive_new_gen;
+  int saved_pause_target = FLAG_new_gen_pause_target;
+  FLAG_adaptive_new_gen = true;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Heap* heap = Isolate::Current()->heap();
+  // Missing the pause target shrinks the semi space.
+  FLAG_new_gen_pause_target = -1;
+  intptr_t size = heap->NewSemiSpaceSize();
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT(heap->NewSemiSpaceSize() < size);
+  heap->CollectGarbage(Heap::kNew);
+  // Most of the new objects survive, which grows the semi space.
+  FLAG_new_gen_pause_target = kMaxInt32;
+  size = heap->NewSemiSpaceSize();
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("build"), 0, NULL));
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT(heap->NewSemiSpaceSize() > size);
+  EXPECT(heap->Verify());
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("check"), 0, NULL);
+  EXPECT_VALID(result);
+  bool value = false;
+  EXPECT_VALID(Dart_BooleanValue(result, &value));
+  EXPECT(value);
+  FLAG_adaptive_new_gen = saved_adaptive_new_gen;
+  FLAG_new_gen_pause_target = saved_pause_target;
+}
+
+
+TEST_CASE(CompactOldGen) {
+  const char* kScriptChars =
+  "var data;\n"
+  "build() {\n"
+  "  data = new List(20000);\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    data[i] = [i, 'x$i', new List(i % 10)];\n"
+  "  }\n"
+  "}\n"
+  "drop() {\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    if (i % 4 != 0) data[i] = null;\n"
+  "  }\n"
+  "}\n"
+  "last() {\n"
+  "  return data[data.length - 4];\n"
+  "}\n"
+  "check() {\n"
+  "  for (int i = 0; i < data.length; i += 4) {\n"
+  "    if (data[i][0] != i) return false;\n"
+  "    if (data[i][1] != 'x$i') return false;\n"
+  "    if (data[i][2].length != i % 10) return false;\n"
+  "  }\n"
+  "  return true;\n"
+  "}\n";
+  bool saved_compact_old_gen = FLAG_compact_old_gen;
+  FLAG_compact_old_gen = true;
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Heap* heap = Isolate::Current()->heap();
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("build"), 0, NULL));
+  // Promote the data into the old generation.
+  heap->CollectGarbage(Heap::kNew);
+  heap->CollectGarbage(Heap::kNew);
+  heap->CollectGarbage(Heap::kOld);
+  Dart_Handle last = Dart_Invoke(lib, Dart_NewString("last"), 0, NULL);
+  EXPECT_VALID(last);
+  Dart_Handle weak = Dart_NewWeakPersistentHandle(last, NULL, NULL);
+  EXPECT_VALID(weak);
+  int peer = 42;
+  EXPECT_VALID(Dart_SetPeer(last, &peer));
+  RawObject* raw_before = Api::UnwrapHandle(weak);
+  EXPECT(raw_before->IsOldObject());
+
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("drop"), 0, NULL));
+  heap->CollectGarbage(Heap::kOld);
+  EXPECT(heap->Verify());
+  // The surviving objects have been slid together.
+  EXPECT(Api::UnwrapHandle(weak) != raw_before);
+  EXPECT(Dart_IdentityEquals(last, weak));
+  void* out = NULL;
+  EXPECT_VALID(Dart_GetPeer(weak, &out));
+  EXPECT(out == &peer);
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("check"), 0, NULL);
+  EXPECT_VALID(result);
+  bool value = false;
+  EXPECT_VALID(Dart_BooleanValue(result, &value));
+  EXPECT(value);
+  FLAG_compact_old_gen = saved_compact_old_gen;
+}
+
+
+
+TEST_CASE(CardMarking) {
+  const char* kScriptChars =
+  "var data;\n"
+  "build() {\n"
+  "  data = new List(100000);\n"
+  "}\n"
+  "fill() {\n"
+  "  for (int i = 0; i < data.length; i += 7) {\n"
+  "    data[i] = 'x$i';\n"
+  "  }\n"
+  "}\n"
+  "check() {\n"
+  "  for (int i = 0; i < data.length; i++) {\n"
+  "    if (data[i] != ((i % 7 == 0) ? 'x$i' : null)) return false;\n"
+  "  }\n"
+  "  return true;\n"
+  "}\n";
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Heap* heap = Isolate::Current()->heap();
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("build"), 0, NULL));
+  // Promote the list, it is too large for a regular page.
+  heap->CollectGarbage(Heap::kNew);
+  heap->CollectGarbage(Heap::kNew);
+  Dart_Handle data = Dart_GetField(lib, Dart_NewString("data"));
+  EXPECT_VALID(data);
+  RawObject* raw_data = Api::UnwrapHandle(data);
+  EXPECT(raw_data->IsOldObject());
+  EXPECT(PageSpace::PageFor(raw_data)->is_card_marked());
+
+  // Stores from generated code dirty the cards.
+  EXPECT_VALID(Dart_Invoke(lib, Dart_NewString("fill"), 0, NULL));
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT(heap->Verify());
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT(heap->Verify());
+  Dart_Handle result = Dart_Invoke(lib, Dart_NewString("check"), 0, NULL);
+  EXPECT_VALID(result);
+  bool value = false;
+  EXPECT_VALID(Dart_BooleanValue(result, &value));
+  EXPECT(value);
+
+  // Stores from the runtime dirty the cards as well.
+  {
+    DARTSCOPE_NOCHECKS(Isolate::Current());
+    const Array& array = Array::Handle(Array::New(100000, Heap::kOld));
+    EXPECT(PageSpace::PageFor(array.raw())->is_card_marked());
+    for (intptr_t i = 0; i < array.Length(); i += 1000) {
+      array.SetAt(i, Smi::Handle(Smi::New(i)));
+      array.SetAt(i + 1, String::Handle(String::New("card")));
+    }
+    heap->CollectGarbage(Heap::kNew);
+    heap->CollectGarbage(Heap::kOld);
+    heap->CollectGarbage(Heap::kNew);
+    EXPECT(heap->Verify());
+    String& str = String::Handle();
+    for (intptr_t i = 0; i < array.Length(); i += 1000) {
+      EXPECT(array.At(i) == Smi::New(i));
+      str ^= array.At(i + 1);
+      EXPECT(str.Equals("card"));
+    }
+  }
+}
+
 #endif  // defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64).
 }
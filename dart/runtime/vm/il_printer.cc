@@ -412,6 +412,15 @@ void AllocateObjectWithBoundsCheckInstr::PrintOperandsTo(
 }
 
 
+void MaterializeObjectInstr::PrintOperandsTo(BufferFormatter* f) const {
+  f->Print("%s", cls().ToCString());
+  for (intptr_t i = 0; i < InputCount(); i++) {
+    f->Print(", %s: ", String::Handle(FieldAt(i).name()).ToCString());
+    InputAt(i)->PrintTo(f);
+  }
+}
+
+
 void CreateArrayInstr::PrintOperandsTo(BufferFormatter* f) const {
   for (int i = 0; i < ArgumentCount(); ++i) {
     if (i != 0) f->Print(", ");
@@ -646,6 +655,10 @@ void Environment::PrintTo(BufferFormatter* f) const {
     if (i > 0) f->Print(", ");
     if (values_[i]->definition()->IsPushArgument()) {
       f->Print("a%d", arg_count++);
+    } else if (values_[i]->definition()->IsMaterializeObject()) {
+      f->Print("MaterializeObject(");
+      values_[i]->definition()->PrintOperandsTo(f);
+      f->Print(")");
     } else {
       values_[i]->PrintTo(f);
     }
@@ -21,6 +21,8 @@
 namespace dart {
 
 DECLARE_FLAG(bool, enable_type_checks);
+DECLARE_FLAG(int, max_polymorphic_checks);
+DECLARE_FLAG(bool, use_osr);
 
 
 Definition::Definition()
@@ -116,9 +118,11 @@ bool LoadFieldInstr::AttributesEqual(Instruction* other) const {
 bool LoadStaticFieldInstr::AttributesEqual(Instruction* other) const {
   LoadStaticFieldInstr* other_load = other->AsLoadStaticField();
   ASSERT(other_load != NULL);
-  // Assert that the field is initialized.
-  ASSERT(field().value() != Object::sentinel());
-  ASSERT(field().value() != Object::transition_sentinel());
+  // Assert that a final field is initialized. Loads of other fields are only
+  // compared when nothing may have changed the field in between.
+  ASSERT(!field().is_final() || (field().value() != Object::sentinel()));
+  ASSERT(!field().is_final() ||
+         (field().value() != Object::transition_sentinel()));
   return field().raw() == other_load->field().raw();
 }
 
@@ -156,7 +160,8 @@ GraphEntryInstr::GraphEntryInstr(TargetEntryInstr* normal_entry)
       normal_entry_(normal_entry),
       catch_entries_(),
       initial_definitions_(),
-      spill_slot_count_(0) {
+      spill_slot_count_(0),
+      osr_id_(Isolate::kNoDeoptId) {
 }
 
 
@@ -1117,12 +1122,22 @@ RawAbstractType* AllocateObjectInstr::CompileType() const {
 }
 
 
+intptr_t AllocateObjectInstr::ResultCid() const {
+  return Class::Handle(constructor().Owner()).id();
+}
+
+
 RawAbstractType* AllocateObjectWithBoundsCheckInstr::CompileType() const {
   // TODO(regis): Be more specific.
   return Type::DynamicType();
 }
 
 
+RawAbstractType* MaterializeObjectInstr::CompileType() const {
+  return Type::DynamicType();
+}
+
+
 RawAbstractType* LoadFieldInstr::CompileType() const {
   // Type may be null if the field is a VM field, e.g. context parent.
   // Keep it as null for debug purposes and do not return dynamic in production
@@ -1137,6 +1152,11 @@ RawAbstractType* LoadFieldInstr::CompileType() const {
 }
 
 
+RawAbstractType* LoadClassIdInstr::CompileType() const {
+  return Type::SmiType();
+}
+
+
 RawAbstractType* StoreVMFieldInstr::CompileType() const {
   return value()->CompileType();
 }
@@ -1182,6 +1202,15 @@ RawAbstractType* CheckStackOverflowInstr::CompileType() const {
 }
 
 
+bool CheckStackOverflowInstr::CountsForOsr(FlowGraphCompiler* compiler) const {
+  return FLAG_use_osr &&
+      in_loop() &&
+      !compiler->is_optimizing() &&
+      FlowGraphCompiler::CanOptimize() &&
+      compiler->parsed_function().function().is_optimizable();
+}
+
+
 RawAbstractType* BinarySmiOpInstr::CompileType() const {
   return (op_kind() == Token::kSHL) ? Type::IntType() : Type::SmiType();
 }
@@ -1485,6 +1514,18 @@ void ConstraintInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
   UNREACHABLE();
 }
 
+
+LocationSummary* MaterializeObjectInstr::MakeLocationSummary() const {
+  UNREACHABLE();
+  return NULL;
+}
+
+
+void MaterializeObjectInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
+  UNREACHABLE();
+}
+
+
 LocationSummary* ThrowInstr::MakeLocationSummary() const {
   return new LocationSummary(0, 0, LocationSummary::kCall);
 }
@@ -1712,6 +1753,19 @@ void InstanceCallInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
                                    deopt_id(),
                                    token_pos());
   }
+  if (compiler->is_optimizing() &&
+      HasICData() &&
+      (ic_data()->NumberOfChecks() > FLAG_max_polymorphic_checks)) {
+    // Too many receiver classes to check inline or to scan in an inline
+    // cache.
+    compiler->GenerateMegamorphicInstanceCall(deopt_id(),
+                                              token_pos(),
+                                              function_name(),
+                                              ArgumentCount(),
+                                              argument_names(),
+                                              locs());
+    return;
+  }
   compiler->GenerateInstanceCall(deopt_id(),
                                  token_pos(),
                                  function_name(),
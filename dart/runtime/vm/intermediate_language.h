@@ -236,7 +236,9 @@ class EmbeddedArray<T, 0> {
   M(CreateClosure)                                                             \
   M(AllocateObject)                                                            \
   M(AllocateObjectWithBoundsCheck)                                             \
+  M(MaterializeObject)                                                         \
   M(LoadField)                                                                 \
+  M(LoadClassId)                                                               \
   M(StoreVMField)                                                              \
   M(InstantiateTypeArguments)                                                  \
   M(ExtractConstructorTypeArguments)                                           \
@@ -522,11 +524,13 @@ FOR_EACH_INSTRUCTION(INSTRUCTION_TYPE_CHECK)
   friend class ShiftMintOpInstr;
   friend class UnaryMintOpInstr;
   friend class MathSqrtInstr;
+  friend class StaticCallInstr;
   friend class CheckClassInstr;
   friend class CheckSmiInstr;
   friend class CheckArrayBoundInstr;
   friend class CheckEitherNonSmiInstr;
   friend class LICM;
+  friend class FlowGraphOptimizer;  // Needed for UnboxLoopPhis.
 
   intptr_t deopt_id_;
   intptr_t lifetime_position_;  // Position used by register allocator.
@@ -882,6 +886,16 @@ class GraphEntryInstr : public BlockEntryInstr {
 
   TargetEntryInstr* normal_entry() const { return normal_entry_; }
 
+  // A graph compiled for on-stack replacement is entered from a running
+  // unoptimized frame at the loop stack check with deopt id osr_id. Its
+  // normal entry jumps directly into the loop.
+  intptr_t osr_id() const { return osr_id_; }
+  bool IsCompiledForOsr() const { return osr_id_ != Isolate::kNoDeoptId; }
+  void SetOsrEntry(TargetEntryInstr* osr_entry, intptr_t osr_id) {
+    normal_entry_ = osr_entry;
+    osr_id_ = osr_id;
+  }
+
   virtual void PrintTo(BufferFormatter* f) const;
 
  private:
@@ -892,6 +906,7 @@ class GraphEntryInstr : public BlockEntryInstr {
   GrowableArray<TargetEntryInstr*> catch_entries_;
   GrowableArray<Definition*> initial_definitions_;
   intptr_t spill_slot_count_;
+  intptr_t osr_id_;
 
   DISALLOW_COPY_AND_ASSIGN(GraphEntryInstr);
 };
@@ -1649,6 +1664,11 @@ class RangeBoundary : public ValueObject {
     return reinterpret_cast<Definition*>(value_);
   }
 
+  intptr_t offset() const {
+    ASSERT(IsSymbol());
+    return offset_;
+  }
+
   RangeBoundary LowerBound() const;
   RangeBoundary UpperBound() const;
 
@@ -2412,6 +2432,24 @@ class StaticCallInstr : public TemplateDefinition<0> {
     ASSERT(argument_names.IsZoneHandle());
   }
 
+  // Used when the call replaces another call, e.g., one target of an
+  // instance call. Deoptimization continues at the original call.
+  StaticCallInstr(intptr_t token_pos,
+                  const Function& function,
+                  const Array& argument_names,
+                  ZoneGrowableArray<PushArgumentInstr*>* arguments,
+                  intptr_t original_deopt_id)
+      : token_pos_(token_pos),
+        function_(function),
+        argument_names_(argument_names),
+        arguments_(arguments),
+        result_cid_(kDynamicCid) {
+    ASSERT(function.IsZoneHandle());
+    ASSERT(argument_names.IsZoneHandle());
+    ASSERT(original_deopt_id != Isolate::kNoDeoptId);
+    deopt_id_ = original_deopt_id;
+  }
+
   DECLARE_INSTRUCTION(StaticCall)
   virtual RawAbstractType* CompileType() const;
 
@@ -2677,6 +2715,8 @@ class LoadIndexedInstr : public TemplateDefinition<2> {
 
   virtual intptr_t ResultCid() const { return kDynamicCid; }
 
+  virtual bool AttributesEqual(Instruction* other) const { return true; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(LoadIndexedInstr);
 };
@@ -2822,7 +2862,7 @@ class AllocateObjectInstr : public TemplateDefinition<0> {
 
   virtual bool HasSideEffect() const { return true; }
 
-  virtual intptr_t ResultCid() const { return kDynamicCid; }
+  virtual intptr_t ResultCid() const;
 
  private:
   const ConstructorCallNode& ast_node_;
@@ -2865,6 +2905,58 @@ class AllocateObjectWithBoundsCheckInstr : public TemplateDefinition<2> {
 };
 
 
+// Stands for an object whose allocation was removed by AllocationSinking.
+// It is only referenced from deoptimization environments and is never part
+// of the instruction stream: deoptimization allocates an instance of the
+// class and stores the input values into the given fields.
+class MaterializeObjectInstr : public Definition {
+ public:
+  MaterializeObjectInstr(const Class& cls,
+                         const ZoneGrowableArray<const Field*>& fields,
+                         ZoneGrowableArray<Value*>* values)
+      : cls_(cls), fields_(fields), values_(values), locations_(NULL) {
+    ASSERT(fields_.length() == values_->length());
+  }
+
+  DECLARE_INSTRUCTION(MaterializeObject)
+  virtual RawAbstractType* CompileType() const;
+
+  const Class& cls() const { return cls_; }
+  const Field& FieldAt(intptr_t i) const { return *fields_[i]; }
+
+  virtual intptr_t InputCount() const { return values_->length(); }
+  virtual Value* InputAt(intptr_t i) const { return (*values_)[i]; }
+  virtual void SetInputAt(intptr_t i, Value* value) { (*values_)[i] = value; }
+
+  // Locations of the input values, set by the register allocator.
+  Location LocationAt(intptr_t i) const {
+    ASSERT(locations_ != NULL);
+    return locations_[i];
+  }
+  Location* locations() const { return locations_; }
+  void set_locations(Location* locations) {
+    ASSERT(locations_ == NULL);
+    locations_ = locations;
+  }
+
+  virtual void PrintOperandsTo(BufferFormatter* f) const;
+
+  virtual bool CanDeoptimize() const { return false; }
+
+  virtual bool HasSideEffect() const { return false; }
+
+  virtual intptr_t ResultCid() const { return cls_.id(); }
+
+ private:
+  const Class& cls_;
+  const ZoneGrowableArray<const Field*>& fields_;
+  ZoneGrowableArray<Value*>* const values_;
+  Location* locations_;
+
+  DISALLOW_COPY_AND_ASSIGN(MaterializeObjectInstr);
+};
+
+
 class CreateArrayInstr : public TemplateDefinition<1> {
  public:
   CreateArrayInstr(intptr_t token_pos,
@@ -2992,6 +3084,35 @@ class LoadFieldInstr : public TemplateDefinition<1> {
 };
 
 
+// Loads the class id of an object as a Smi. Smis have class id kSmiCid.
+class LoadClassIdInstr : public TemplateDefinition<1> {
+ public:
+  explicit LoadClassIdInstr(Value* object) {
+    ASSERT(object != NULL);
+    inputs_[0] = object;
+  }
+
+  DECLARE_INSTRUCTION(LoadClassId)
+  virtual RawAbstractType* CompileType() const;
+
+  Value* object() const { return inputs_[0]; }
+
+  virtual bool CanDeoptimize() const { return false; }
+
+  virtual bool HasSideEffect() const { return false; }
+
+  virtual intptr_t ResultCid() const { return kSmiCid; }
+
+  virtual bool AttributesEqual(Instruction* other) const { return true; }
+
+  // The class id of an object never changes.
+  virtual bool AffectedBySideEffect() const { return false; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LoadClassIdInstr);
+};
+
+
 class StoreVMFieldInstr : public TemplateDefinition<2> {
  public:
   StoreVMFieldInstr(Value* dest,
@@ -3786,11 +3907,22 @@ class UnarySmiOpInstr : public TemplateDefinition<1> {
 
 class CheckStackOverflowInstr : public TemplateInstruction<0> {
  public:
-  explicit CheckStackOverflowInstr(intptr_t token_pos)
-      : token_pos_(token_pos) {}
+  CheckStackOverflowInstr(intptr_t token_pos, bool in_loop)
+      : token_pos_(token_pos), in_loop_(in_loop) {}
 
   intptr_t token_pos() const { return token_pos_; }
 
+  // Stack checks at the head of a loop body are points where unoptimized
+  // code can be replaced by optimized code on the stack. They are
+  // identified by their deopt id.
+  bool in_loop() const { return in_loop_; }
+  intptr_t osr_id() const { return GetDeoptId(); }
+
+  // Returns true if the unoptimized code of the check counts loop iterations
+  // in the usage counter of the function and enters the runtime to attempt
+  // on-stack replacement once the function is hot.
+  bool CountsForOsr(FlowGraphCompiler* compiler) const;
+
   DECLARE_INSTRUCTION(CheckStackOverflow)
   virtual RawAbstractType* CompileType() const;
 
@@ -3802,6 +3934,7 @@ class CheckStackOverflowInstr : public TemplateInstruction<0> {
 
  private:
   const intptr_t token_pos_;
+  const bool in_loop_;
 
   DISALLOW_COPY_AND_ASSIGN(CheckStackOverflowInstr);
 };
@@ -1186,6 +1186,28 @@ void LoadFieldInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
 }
 
 
+LocationSummary* LoadClassIdInstr::MakeLocationSummary() const {
+  return LocationSummary::Make(1,
+                               Location::RequiresRegister(),
+                               LocationSummary::kNoCall);
+}
+
+
+void LoadClassIdInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
+  Register object = locs()->in(0).reg();
+  Register result = locs()->out().reg();
+  Label load, done;
+  __ testl(object, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &load, Assembler::kNearJump);
+  __ movl(result, Immediate(Smi::RawValue(kSmiCid)));
+  __ jmp(&done, Assembler::kNearJump);
+  __ Bind(&load);
+  __ LoadClassId(result, object);
+  __ SmiTag(result);
+  __ Bind(&done);
+}
+
+
 LocationSummary* InstantiateTypeArgumentsInstr::MakeLocationSummary() const {
   const intptr_t kNumInputs = 1;
   const intptr_t kNumTemps = 1;
@@ -1451,11 +1473,12 @@ void CatchEntryInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
 
 LocationSummary* CheckStackOverflowInstr::MakeLocationSummary() const {
   const intptr_t kNumInputs = 0;
-  const intptr_t kNumTemps = 0;
+  const intptr_t kNumTemps = 1;
   LocationSummary* summary =
       new LocationSummary(kNumInputs,
                           kNumTemps,
                           LocationSummary::kCallOnSlowPath);
+  summary->set_temp(0, Location::RequiresRegister());
   return summary;
 }
 
@@ -1468,9 +1491,19 @@ class CheckStackOverflowSlowPath : public SlowPathCode {
   virtual void EmitNativeCode(FlowGraphCompiler* compiler) {
     __ Bind(entry_label());
     compiler->SaveLiveRegisters(instruction_->locs());
-    compiler->GenerateCallRuntime(instruction_->token_pos(),
-                                  kStackOverflowRuntimeEntry,
-                                  instruction_->locs());
+    if (instruction_->CountsForOsr(compiler)) {
+      // The runtime may return to the entry of optimized code for the loop
+      // instead, see PcDescriptors::kOsrEntry.
+      __ CallRuntime(kStackOverflowRuntimeEntry);
+      compiler->AddCurrentDescriptor(PcDescriptors::kOsrEntry,
+                                     instruction_->osr_id(),
+                                     instruction_->token_pos());
+      compiler->RecordSafepoint(instruction_->locs());
+    } else {
+      compiler->GenerateCallRuntime(instruction_->token_pos(),
+                                    kStackOverflowRuntimeEntry,
+                                    instruction_->locs());
+    }
     compiler->RestoreLiveRegisters(instruction_->locs());
     __ jmp(exit_label());
   }
@@ -1487,6 +1520,16 @@ void CheckStackOverflowInstr::EmitNativeCode(FlowGraphCompiler* compiler) {
   __ cmpl(ESP,
           Address::Absolute(Isolate::Current()->stack_limit_address()));
   __ j(BELOW_EQUAL, slow_path->entry_label());
+  if (CountsForOsr(compiler)) {
+    Register temp = locs()->temp(0).reg();
+    const Function& function =
+        Function::ZoneHandle(compiler->parsed_function().function().raw());
+    __ LoadObject(temp, function);
+    __ incl(FieldAddress(temp, Function::usage_counter_offset()));
+    __ cmpl(FieldAddress(temp, Function::usage_counter_offset()),
+            Immediate(FLAG_optimization_counter_threshold));
+    __ j(GREATER_EQUAL, slow_path->entry_label());
+  }
   __ Bind(slow_path->exit_label());
 }
 
@@ -7,11 +7,13 @@
 #include "include/dart_api.h"
 #include "platform/assert.h"
 #include "lib/mirrors.h"
+#include "vm/compiler.h"
 #include "vm/compiler_stats.h"
 #include "vm/dart_api_state.h"
 #include "vm/dart_entry.h"
 #include "vm/debugger.h"
 #include "vm/debuginfo.h"
+#include "vm/deopt_instructions.h"
 #include "vm/heap.h"
 #include "vm/message_handler.h"
 #include "vm/object_store.h"
@@ -90,6 +92,7 @@ bool IsolateMessageHandler::HandleMessage(Message* message) {
   SnapshotReader reader(message->data(), message->len(),
                         Snapshot::kMessage, Isolate::Current());
   const Object& msg_obj = Object::Handle(reader.ReadObject());
+  message->MarkDelivered();
   if (!msg_obj.IsNull() && !msg_obj.IsInstance()) {
     // TODO(turnidge): We need to decide what an isolate does with
     // malformed messages.  If they (eventually) come from a remote
@@ -116,6 +119,14 @@ bool IsolateMessageHandler::HandleMessage(Message* message) {
       return false;
     }
     ASSERT(result.IsNull());
+    // The optimizations requested while handling the message are compiled
+    // once it has been handled.
+    const Error& error =
+        Error::Handle(Compiler::CompilePendingOptimizations());
+    if (!error.IsNull()) {
+      isolate_->object_store()->set_sticky_error(error);
+      return false;
+    }
   }
   return true;
 }
@@ -161,6 +172,8 @@ Isolate::Isolate()
       timer_list_(),
       deopt_id_(0),
       ic_data_array_(Array::null()),
+      pending_optimizations_(GrowableObjectArray::null()),
+      megamorphic_caches_(GrowableObjectArray::null()),
       mutex_(new Mutex()),
       stack_limit_(0),
       saved_stack_limit_(0),
@@ -173,7 +186,8 @@ Isolate::Isolate()
       deopt_frame_copy_(NULL),
       deopt_frame_copy_size_(0),
       deferred_doubles_(NULL),
-      deferred_mints_(NULL) {
+      deferred_mints_(NULL),
+      deferred_objects_(NULL) {
 }
 
 
@@ -487,6 +501,21 @@ void Isolate::VisitObjectPointers(ObjectPointerVisitor* visitor,
   // Visit the currently active IC data array.
   visitor->VisitPointer(reinterpret_cast<RawObject**>(&ic_data_array_));
 
+  // Visit the functions waiting to be optimized.
+  visitor->VisitPointer(
+      reinterpret_cast<RawObject**>(&pending_optimizations_));
+
+  // Visit the caches of megamorphic calls.
+  visitor->VisitPointer(reinterpret_cast<RawObject**>(&megamorphic_caches_));
+
+  // Visit the field values of objects waiting to be materialized by
+  // deoptimization.
+  for (DeferredObject* object = deferred_objects_;
+       object != NULL;
+       object = object->next()) {
+    object->VisitObjectPointers(visitor);
+  }
+
   // Visit objects in the debugger.
   debugger()->VisitObjectPointers(visitor);
 }
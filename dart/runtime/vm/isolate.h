@@ -20,6 +20,7 @@ namespace dart {
 class ApiState;
 class CodeIndexTable;
 class Debugger;
+class DeferredObject;
 class HandleScope;
 class HandleVisitor;
 class Heap;
@@ -35,6 +36,7 @@ class RawDouble;
 class RawMint;
 class RawInteger;
 class RawError;
+class RawGrowableObjectArray;
 class StackResource;
 class StackZone;
 class StubCode;
@@ -109,6 +111,13 @@ class Isolate : public BaseIsolate {
 
   StoreBuffer* store_buffer() { return &store_buffer_; }
 
+  MarkingBarrierBlock* marking_barrier_block() {
+    return &marking_barrier_block_;
+  }
+  static intptr_t marking_barrier_block_offset() {
+    return OFFSET_OF(Isolate, marking_barrier_block_);
+  }
+
   ClassTable* class_table() { return &class_table_; }
   static intptr_t class_table_offset() {
     return OFFSET_OF(Isolate, class_table_);
@@ -201,11 +210,13 @@ class Isolate : public BaseIsolate {
     kApiInterrupt = 0x1,      // An interrupt from Dart_InterruptIsolate.
     kMessageInterrupt = 0x2,  // An interrupt to process an out of band message.
     kStoreBufferInterrupt = 0x4,  // An interrupt to process the store buffer.
+    kMarkingInterrupt = 0x8,  // An interrupt to start or finish marking.
 
     kInterruptsMask =
         kApiInterrupt |
         kMessageInterrupt |
-        kStoreBufferInterrupt,
+        kStoreBufferInterrupt |
+        kMarkingInterrupt,
   };
 
   void ScheduleInterrupts(uword interrupt_bits);
@@ -232,6 +243,23 @@ class Isolate : public BaseIsolate {
   void set_ic_data_array(RawArray* value) { ic_data_array_ = value; }
   ICData* GetICDataForDeoptId(intptr_t deopt_id) const;
 
+  // Functions waiting to be optimized at the end of the current message, see
+  // Compiler::QueueOptimization.
+  RawGrowableObjectArray* pending_optimizations() const {
+    return pending_optimizations_;
+  }
+  void set_pending_optimizations(RawGrowableObjectArray* value) {
+    pending_optimizations_ = value;
+  }
+
+  // Caches of megamorphic instance calls, see MegamorphicCache::ForSelector.
+  RawGrowableObjectArray* megamorphic_caches() const {
+    return megamorphic_caches_;
+  }
+  void set_megamorphic_caches(RawGrowableObjectArray* value) {
+    megamorphic_caches_ = value;
+  }
+
   Debugger* debugger() const { return debugger_; }
 
   GcPrologueCallbacks& gc_prologue_callbacks() {
@@ -306,6 +334,11 @@ class Isolate : public BaseIsolate {
     return list;
   }
 
+  DeferredObject* deferred_objects() const { return deferred_objects_; }
+  void set_deferred_objects(DeferredObject* value) {
+    deferred_objects_ = value;
+  }
+
  private:
   Isolate();
 
@@ -319,6 +352,7 @@ class Isolate : public BaseIsolate {
   static ThreadLocalKey isolate_key;
   StoreBufferBlock store_buffer_block_;
   StoreBuffer store_buffer_;
+  MarkingBarrierBlock marking_barrier_block_;
   ClassTable class_table_;
   Dart_MessageNotifyCallback message_notify_callback_;
   char* name_;
@@ -337,6 +371,8 @@ class Isolate : public BaseIsolate {
   TimerList timer_list_;
   intptr_t deopt_id_;
   RawArray* ic_data_array_;
+  RawGrowableObjectArray* pending_optimizations_;
+  RawGrowableObjectArray* megamorphic_caches_;
   Mutex* mutex_;  // protects stack_limit_ and saved_stack_limit_.
   uword stack_limit_;
   uword saved_stack_limit_;
@@ -351,6 +387,7 @@ class Isolate : public BaseIsolate {
   intptr_t deopt_frame_copy_size_;
   DeferredDouble* deferred_doubles_;
   DeferredMint* deferred_mints_;
+  DeferredObject* deferred_objects_;
 
   static Dart_IsolateCreateCallback create_callback_;
   static Dart_IsolateInterruptCallback interrupt_callback_;
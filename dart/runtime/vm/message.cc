@@ -4,13 +4,30 @@
 
 #include "vm/message.h"
 
+#include "vm/atomic.h"
+
 namespace dart {
 
 DECLARE_FLAG(bool, trace_isolates);
 
+void Message::TransferredPeer::DeleteList(TransferredPeer* list,
+                                          bool finalize) {
+  while (list != NULL) {
+    TransferredPeer* next = list->next_;
+    if (finalize && (list->callback_ != NULL)) {
+      (*list->callback_)(list->peer_);
+    }
+    delete list;
+    list = next;
+  }
+}
+
+
+
 MessageQueue::MessageQueue() {
   head_ = NULL;
   tail_ = NULL;
+  incoming_ = 0;
 }
 
 
@@ -18,28 +35,61 @@ MessageQueue::~MessageQueue() {
   // Ensure that all pending messages have been released.
 #if defined(DEBUG)
   ASSERT(head_ == NULL);
+  ASSERT(incoming_ == 0);
 #endif
 }
 
 
-void MessageQueue::Enqueue(Message* msg) {
+bool MessageQueue::Enqueue(Message* msg) {
   // Make sure messages are not reused.
   ASSERT(msg->next_ == NULL);
+  uword new_incoming = reinterpret_cast<uword>(msg);
+  uword old_incoming;
+  do {
+    old_incoming = incoming_;
+    msg->next_ = reinterpret_cast<Message*>(old_incoming);
+  } while (AtomicOperations::CompareAndSwapWord(
+      &incoming_, old_incoming, new_incoming) != old_incoming);
+  return old_incoming == 0;
+}
+
+
+void MessageQueue::TakeIncoming() {
+  uword incoming;
+  do {
+    incoming = incoming_;
+    if (incoming == 0) return;
+  } while (AtomicOperations::CompareAndSwapWord(
+      &incoming_, incoming, 0) != incoming);
+
+  // Reverse the stack to get the messages in the order they were enqueued.
+  Message* first = NULL;
+  Message* last = reinterpret_cast<Message*>(incoming);
+  Message* cur = last;
+  while (cur != NULL) {
+    Message* next = cur->next_;
+    cur->next_ = first;
+    first = cur;
+    cur = next;
+  }
+
   if (head_ == NULL) {
-    // Only element in the queue.
+    // Only elements in the queue.
     ASSERT(tail_ == NULL);
-    head_ = msg;
-    tail_ = msg;
+    head_ = first;
   } else {
     ASSERT(tail_ != NULL);
     // Append at the tail.
-    tail_->next_ = msg;
-    tail_ = msg;
+    tail_->next_ = first;
   }
+  tail_ = last;
 }
 
 
 Message* MessageQueue::Dequeue() {
+  if (head_ == NULL) {
+    TakeIncoming();
+  }
   Message* result = head_;
   if (result != NULL) {
     head_ = result->next_;
@@ -57,6 +107,7 @@ Message* MessageQueue::Dequeue() {
 
 
 void MessageQueue::Flush(Dart_Port port) {
+  TakeIncoming();
   Message* cur = head_;
   Message* prev = NULL;
   while (cur != NULL) {
@@ -81,6 +132,7 @@ void MessageQueue::Flush(Dart_Port port) {
 
 
 void MessageQueue::FlushAll() {
+  TakeIncoming();
   Message* cur = head_;
   head_ = NULL;
   tail_ = NULL;
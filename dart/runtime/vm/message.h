@@ -9,6 +9,7 @@
 
 // Duplicated from dart_api.h to avoid including the whole header.
 typedef int64_t Dart_Port;
+typedef void (*Dart_PeerFinalizer)(void* peer);
 
 namespace dart {
 
@@ -26,6 +27,32 @@ class Message {
   // A port number which is never used.
   static const Dart_Port kIllegalPort = 0;
 
+  // External data whose ownership is handed over with a message. The
+  // entries form a list which is owned by the writer of the message, then
+  // by the message, until the receiver takes over the data.
+  class TransferredPeer {
+   public:
+    TransferredPeer(void* peer,
+                    Dart_PeerFinalizer callback,
+                    TransferredPeer* next)
+        : peer_(peer), callback_(callback), next_(next) {}
+
+    void* peer() const { return peer_; }
+    Dart_PeerFinalizer callback() const { return callback_; }
+    TransferredPeer* next() const { return next_; }
+
+    // Deletes all entries of the list, calling the finalization callbacks
+    // of the peers if the data has not been taken over by a receiver.
+    static void DeleteList(TransferredPeer* list, bool finalize);
+
+   private:
+    void* peer_;
+    Dart_PeerFinalizer callback_;
+    TransferredPeer* next_;
+
+    DISALLOW_COPY_AND_ASSIGN(TransferredPeer);
+  };
+
   // A new message to be sent between two isolates. The data handed to this
   // message will be disposed by calling free() once the message object is
   // being destructed (after delivery or when the receiving port is closed).
@@ -38,9 +65,13 @@ class Message {
         reply_port_(reply_port),
         data_(data),
         len_(len),
-        priority_(priority) {}
+        priority_(priority),
+        transferred_peers_(NULL) {}
   ~Message() {
     free(data_);
+    // The external data transferred by a message which is never delivered,
+    // e.g. because the receiving port is closed, must not be leaked.
+    TransferredPeer::DeleteList(transferred_peers_, true);
   }
 
   Dart_Port dest_port() const { return dest_port_; }
@@ -51,6 +82,19 @@ class Message {
 
   bool IsOOB() const { return priority_ == Message::kOOBPriority; }
 
+  // Takes ownership of the external data transferred by this message.
+  void set_transferred_peers(TransferredPeer* list) {
+    ASSERT(transferred_peers_ == NULL);
+    transferred_peers_ = list;
+  }
+
+  // Called once the receiver has taken over the transferred data, which is
+  // then no longer finalized when the message is destructed.
+  void MarkDelivered() {
+    TransferredPeer::DeleteList(transferred_peers_, false);
+    transferred_peers_ = NULL;
+  }
+
  private:
   friend class MessageQueue;
 
@@ -60,17 +104,26 @@ class Message {
   uint8_t* data_;
   intptr_t len_;
   Priority priority_;
+  TransferredPeer* transferred_peers_;
 
   DISALLOW_COPY_AND_ASSIGN(Message);
 };
 
 // There is a message queue per isolate.
+//
+// Messages can be enqueued from any number of threads at once without
+// locking: they are pushed onto a stack of incoming messages with an atomic
+// compare and swap. All other operations must only be used by one thread at
+// a time, the consumer. The consumer takes all incoming messages in one
+// operation and keeps them in order in a list of its own.
 class MessageQueue {
  public:
   MessageQueue();
   ~MessageQueue();
 
-  void Enqueue(Message* msg);
+  // Returns true if no other incoming message was pending, i.e. the
+  // consumer may have to be woken up.
+  bool Enqueue(Message* msg);
 
   // Gets the next message from the message queue or NULL if no
   // message is available.  This function will not block.
@@ -82,9 +135,16 @@ class MessageQueue {
  private:
   friend class MessageQueueTestPeer;
 
+  // Moves all incoming messages to the end of the consumer's list.
+  void TakeIncoming();
+
+  // The consumer's list.
   Message* head_;
   Message* tail_;
 
+  // Stack of incoming messages, most recent first. Updated atomically.
+  uword incoming_;
+
   DISALLOW_COPY_AND_ASSIGN(MessageQueue);
 };
 
@@ -86,7 +86,6 @@ void MessageHandler::Run(ThreadPool* pool,
 
 
 void MessageHandler::PostMessage(Message* message) {
-  MonitorLocker ml(&monitor_);
   if (FLAG_trace_isolates) {
     const char* source_name = "<native code>";
     Isolate* source_isolate = Isolate::Current();
@@ -102,16 +101,23 @@ void MessageHandler::PostMessage(Message* message) {
   }
 
   Message::Priority saved_priority = message->priority();
+  bool first_pending;
   if (message->IsOOB()) {
-    oob_queue_->Enqueue(message);
+    first_pending = oob_queue_->Enqueue(message);
   } else {
-    queue_->Enqueue(message);
+    first_pending = queue_->Enqueue(message);
   }
   message = NULL;  // Do not access message.  May have been deleted.
 
-  if (pool_ != NULL && task_ == NULL) {
-    task_ = new MessageHandlerTask(this);
-    pool_->Run(task_);
+  // Only the first of the pending messages of a queue may have to start a
+  // task: the handler takes all pending messages at once, and it only stops
+  // after finding both queues empty with the monitor held.
+  if (first_pending) {
+    MonitorLocker ml(&monitor_);
+    if (pool_ != NULL && task_ == NULL) {
+      task_ = new MessageHandlerTask(this);
+      pool_->Run(task_);
+    }
   }
 
   // Invoke any custom message notification.
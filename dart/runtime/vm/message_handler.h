@@ -94,6 +94,9 @@ class MessageHandler {
   // ------------ END PortMap API ------------
 
   // Custom message notification.  Optionally provided by subclass.
+  //
+  // Called without holding the monitor, possibly from several posting
+  // threads at once.
   virtual void MessageNotify(Message::Priority priority);
 
   // Handles a single message.  Provided by subclass.
@@ -117,7 +120,9 @@ class MessageHandler {
   bool HandleMessages(bool allow_normal_messages,
                       bool allow_multiple_normal_messages);
 
-  Monitor monitor_;  // Protects all fields in MessageHandler.
+  // Protects all fields in MessageHandler. Messages are enqueued without
+  // holding it, all other queue operations hold it.
+  Monitor monitor_;
   MessageQueue* queue_;
   MessageQueue* oob_queue_;
   intptr_t live_ports_;
@@ -4,6 +4,7 @@
 
 #include "platform/assert.h"
 #include "vm/message.h"
+#include "vm/os.h"
 #include "vm/unit_test.h"
 
 namespace dart {
@@ -17,7 +18,7 @@ class MessageQueueTestPeer {
   bool HasMessage() const {
     // We don't really need to grab the monitor during the unit test,
     // but it doesn't hurt.
-    bool result = (queue_->head_ != NULL);
+    bool result = (queue_->head_ != NULL) || (queue_->incoming_ != 0);
     return result;
   }
 
@@ -173,4 +174,99 @@ TEST_CASE(MessageQueue_Flush_EmptyQueue) {
   EXPECT(!queue_peer.HasMessage());
 }
 
+
+static void TransferredPeerFinalizer(void* peer) {
+  *reinterpret_cast<int*>(peer) += 1;
+}
+
+
+TEST_CASE(MessageQueue_Flush_TransferredPeers) {
+  MessageQueue queue;
+  Dart_Port port1 = 1;
+  Dart_Port port2 = 2;
+  int peer1 = 0;
+  int peer2 = 0;
+
+  // Add two messages which transfer external data.
+  Message* msg1 = new Message(port1, 0, NULL, 0, Message::kNormalPriority);
+  msg1->set_transferred_peers(
+      new Message::TransferredPeer(&peer1, TransferredPeerFinalizer, NULL));
+  queue.Enqueue(msg1);
+  Message* msg2 = new Message(port2, 0, NULL, 0, Message::kNormalPriority);
+  msg2->set_transferred_peers(
+      new Message::TransferredPeer(&peer2, TransferredPeerFinalizer, NULL));
+  queue.Enqueue(msg2);
+
+  // The data of a message which is dropped is finalized.
+  queue.Flush(port1);
+  EXPECT_EQ(1, peer1);
+  EXPECT_EQ(0, peer2);
+
+  // The data of a delivered message is owned by the receiver.
+  Message* msg = queue.Dequeue();
+  EXPECT(msg == msg2);
+  msg->MarkDelivered();
+  delete msg;
+  EXPECT_EQ(1, peer1);
+  EXPECT_EQ(0, peer2);
+}
+
+
+static const intptr_t kNumProducedMessages = 1000;
+
+
+// Enqueues numbered messages to a port of its own from a separate thread.
+class MessageProducer {
+ public:
+  MessageProducer(MessageQueue* queue, Dart_Port port)
+      : queue_(queue), port_(port) {}
+
+  static void Run(uword parameter) {
+    MessageProducer* producer = reinterpret_cast<MessageProducer*>(parameter);
+    for (intptr_t i = 0; i < kNumProducedMessages; i++) {
+      // The length carries the sequence number.
+      producer->queue_->Enqueue(new Message(
+          producer->port_, 0, NULL, i, Message::kNormalPriority));
+    }
+  }
+
+ private:
+  MessageQueue* queue_;
+  Dart_Port port_;
+};
+
+
+TEST_CASE(MessageQueue_ConcurrentEnqueue) {
+  const intptr_t kNumProducers = 4;
+  MessageQueue queue;
+  MessageProducer* producers[kNumProducers];
+  intptr_t next_expected[kNumProducers];
+  for (intptr_t i = 0; i < kNumProducers; i++) {
+    producers[i] = new MessageProducer(&queue, i + 1);
+    next_expected[i] = 0;
+    Thread::Start(MessageProducer::Run, reinterpret_cast<uword>(producers[i]));
+  }
+
+  // Dequeue while the producers are running. The messages of each producer
+  // arrive in order.
+  intptr_t received = 0;
+  while (received < kNumProducers * kNumProducedMessages) {
+    Message* msg = queue.Dequeue();
+    if (msg == NULL) {
+      OS::Sleep(1);
+      continue;
+    }
+    intptr_t producer = msg->dest_port() - 1;
+    EXPECT_EQ(next_expected[producer], msg->len());
+    next_expected[producer] = msg->len() + 1;
+    delete msg;
+    received++;
+  }
+  EXPECT(queue.Dequeue() == NULL);
+  for (intptr_t i = 0; i < kNumProducers; i++) {
+    EXPECT_EQ(kNumProducedMessages, next_expected[i]);
+    delete producers[i];
+  }
+}
+
 }  // namespace dart
@@ -102,6 +102,8 @@ RawClass* Object::context_scope_class_ = reinterpret_cast<RawClass*>(RAW_NULL);
 RawClass* Object::icdata_class_ = reinterpret_cast<RawClass*>(RAW_NULL);
 RawClass* Object::subtypetestcache_class_ =
     reinterpret_cast<RawClass*>(RAW_NULL);
+RawClass* Object::megamorphic_cache_class_ =
+    reinterpret_cast<RawClass*>(RAW_NULL);
 RawClass* Object::api_error_class_ = reinterpret_cast<RawClass*>(RAW_NULL);
 RawClass* Object::language_error_class_ = reinterpret_cast<RawClass*>(RAW_NULL);
 RawClass* Object::unhandled_exception_class_ =
@@ -388,6 +390,9 @@ void Object::InitOnce() {
   cls = Class::New<SubtypeTestCache>();
   subtypetestcache_class_ = cls.raw();
 
+  cls = Class::New<MegamorphicCache>();
+  megamorphic_cache_class_ = cls.raw();
+
   cls = Class::New<ApiError>();
   api_error_class_ = cls.raw();
 
@@ -459,6 +464,7 @@ void Object::RegisterSingletonClassNames() {
   SET_CLASS_NAME(context_scope, ContextScope);
   SET_CLASS_NAME(icdata, ICData);
   SET_CLASS_NAME(subtypetestcache, SubtypeTestCache);
+  SET_CLASS_NAME(megamorphic_cache, MegamorphicCache);
   SET_CLASS_NAME(api_error, ApiError);
   SET_CLASS_NAME(language_error, LanguageError);
   SET_CLASS_NAME(unhandled_exception, UnhandledException);
@@ -1188,19 +1194,21 @@ RawObject* Object::Allocate(intptr_t cls_id,
 
 class StoreBufferObjectPointerVisitor : public ObjectPointerVisitor {
  public:
-  explicit StoreBufferObjectPointerVisitor(Isolate* isolate) :
-      ObjectPointerVisitor(isolate) {
+  StoreBufferObjectPointerVisitor(Isolate* isolate, RawObject* raw_obj) :
+      ObjectPointerVisitor(isolate), raw_obj_(raw_obj) {
   }
   void VisitPointers(RawObject** first, RawObject** last) {
     for (RawObject** curr = first; curr <= last; ++curr) {
       if ((*curr)->IsNewObject()) {
         uword ptr = reinterpret_cast<uword>(curr);
-        isolate()->store_buffer()->AddPointer(ptr);
+        isolate()->store_buffer()->AddObjectPointer(raw_obj_, ptr);
       }
     }
   }
 
  private:
+  RawObject* raw_obj_;
+
   DISALLOW_COPY_AND_ASSIGN(StoreBufferObjectPointerVisitor);
 };
 
@@ -1212,7 +1220,7 @@ RawObject* Object::Clone(const Object& src, Heap::Space space) {
   NoGCScope no_gc;
   memmove(raw_obj->ptr(), src.raw()->ptr(), size);
   if (space == Heap::kOld) {
-    StoreBufferObjectPointerVisitor visitor(Isolate::Current());
+    StoreBufferObjectPointerVisitor visitor(Isolate::Current(), raw_obj);
     raw_obj->VisitPointers(&visitor);
   }
   return raw_obj;
@@ -3876,6 +3884,7 @@ RawFunction* Function::New(const String& name,
   result.set_num_optional_parameters(0);
   result.set_usage_counter(0);
   result.set_deoptimization_counter(0);
+  result.set_reoptimization_counter(0);
   result.set_is_optimizable(true);
   result.set_has_finally(false);
   result.set_is_native(false);
@@ -4995,15 +5004,7 @@ RawString* TokenStream::Iterator::MakeLiteralToken(const Object& obj) const {
         Smi::Value(reinterpret_cast<RawSmi*>(obj.raw())));
     ASSERT(kind < Token::kNumTokens);
     if (Token::IsPseudoKeyword(kind) || Token::IsKeyword(kind)) {
-      Isolate* isolate = Isolate::Current();
-      ObjectStore* object_store = isolate->object_store();
-      String& str = String::Handle(isolate, String::null());
-      const Array& symbols = Array::Handle(isolate,
-                                           object_store->keyword_symbols());
-      ASSERT(!symbols.IsNull());
-      str ^= symbols.At(kind - Token::kFirstKeyword);
-      ASSERT(!str.IsNull());
-      return str.raw();
+      return Symbols::TokenSymbol(kind);
     }
     return Symbols::New(Token::Str(kind));
   } else {
@@ -6468,6 +6469,7 @@ const char* PcDescriptors::KindAsStr(intptr_t index) const {
     case PcDescriptors::kIcCall:        return "ic-call      ";
     case PcDescriptors::kFuncCall:      return "fn-call      ";
     case PcDescriptors::kReturn:        return "return       ";
+    case PcDescriptors::kOsrEntry:      return "osr-entry    ";
     case PcDescriptors::kOther:         return "other        ";
   }
   UNREACHABLE();
@@ -7132,6 +7134,19 @@ uword Code::GetDeoptAfterPcAtDeoptId(intptr_t deopt_id) const {
 }
 
 
+intptr_t Code::GetOsrIdAtPc(uword pc) const {
+  ASSERT(!is_optimized());
+  const PcDescriptors& descriptors = PcDescriptors::Handle(pc_descriptors());
+  for (intptr_t i = 0; i < descriptors.Length(); i++) {
+    if ((descriptors.PC(i) == pc) &&
+        (descriptors.DescriptorKind(i) == PcDescriptors::kOsrEntry)) {
+      return descriptors.DeoptId(i);
+    }
+  }
+  return Isolate::kNoDeoptId;
+}
+
+
 const char* Code::ToCString() const {
   const char* kFormat = "Code entry:0x%d";
   intptr_t len = OS::SNPrint(NULL, 0, kFormat, EntryPoint()) + 1;
@@ -7206,6 +7221,20 @@ RawArray* Code::ExtractTypeFeedbackArray() const {
 }
 
 
+void Code::ResetIcDataAtCalls() const {
+  ASSERT(!IsNull() && !is_optimized());
+  GrowableArray<intptr_t> deopt_ids;
+  const GrowableObjectArray& ic_data_objs =
+      GrowableObjectArray::Handle(GrowableObjectArray::New());
+  ExtractIcDataArraysAtCalls(&deopt_ids, ic_data_objs);
+  ICData& ic_data = ICData::Handle();
+  for (intptr_t i = 0; i < ic_data_objs.Length(); i++) {
+    ic_data ^= ic_data_objs.At(i);
+    ic_data.ResetChecks();
+  }
+}
+
+
 RawStackmap* Code::GetStackmap(uword pc, Array* maps, Stackmap* map) const {
   // This code is used during iterating frames during a GC and hence it
   // should not in turn start a GC.
@@ -7450,6 +7479,14 @@ void ICData::AddCheck(const GrowableArray<intptr_t>& class_ids,
 }
 
 
+void ICData::ResetChecks() const {
+  // IC data array must be null terminated (sentinel entry).
+  const Array& data = Array::Handle(Array::New(TestEntryLength(), Heap::kOld));
+  set_ic_data(data);
+  WriteSentinel();
+}
+
+
 void ICData::AddReceiverCheck(intptr_t receiver_class_id,
                               const Function& target) const {
 #if defined(DEBUG)
@@ -7737,6 +7774,181 @@ const char* SubtypeTestCache::ToCString() const {
 }
 
 
+RawMegamorphicCache* MegamorphicCache::New(const String& target_name,
+                                           const Array& arguments_descriptor) {
+  ASSERT(Object::megamorphic_cache_class() != Class::null());
+  ASSERT(target_name.IsSymbol());
+  MegamorphicCache& result = MegamorphicCache::Handle();
+  {
+    // MegamorphicCache objects are long living objects, allocate them in the
+    // old generation.
+    RawObject* raw = Object::Allocate(MegamorphicCache::kClassId,
+                                      MegamorphicCache::InstanceSize(),
+                                      Heap::kOld);
+    NoGCScope no_gc;
+    result ^= raw;
+  }
+  result.set_target_name(target_name);
+  result.set_arguments_descriptor(arguments_descriptor);
+  result.InitializeBuckets(kInitialCapacity);
+  return result.raw();
+}
+
+
+static bool ArgumentsDescriptorsEqual(const Array& a, const Array& b) {
+  if (a.Length() != b.Length()) {
+    return false;
+  }
+  // Descriptors only contain Smis and symbols.
+  for (intptr_t i = 0; i < a.Length(); i++) {
+    if (a.At(i) != b.At(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+RawMegamorphicCache* MegamorphicCache::ForSelector(
+    const String& target_name,
+    const Array& arguments_descriptor) {
+  Isolate* isolate = Isolate::Current();
+  GrowableObjectArray& caches = GrowableObjectArray::Handle(
+      isolate, isolate->megamorphic_caches());
+  if (caches.IsNull()) {
+    caches = GrowableObjectArray::New(Heap::kOld);
+    isolate->set_megamorphic_caches(caches.raw());
+  }
+  MegamorphicCache& cache = MegamorphicCache::Handle(isolate);
+  Array& descriptor = Array::Handle(isolate);
+  for (intptr_t i = 0; i < caches.Length(); i++) {
+    cache ^= caches.At(i);
+    if (cache.target_name() != target_name.raw()) {
+      continue;
+    }
+    descriptor = cache.arguments_descriptor();
+    if (ArgumentsDescriptorsEqual(descriptor, arguments_descriptor)) {
+      return cache.raw();
+    }
+  }
+  cache = MegamorphicCache::New(target_name, arguments_descriptor);
+  caches.Add(cache, Heap::kOld);
+  return cache.raw();
+}
+
+
+void MegamorphicCache::set_buckets(const Array& value) const {
+  StorePointer(&raw_ptr()->buckets_, value.raw());
+}
+
+
+void MegamorphicCache::set_mask(intptr_t value) const {
+  raw_ptr()->mask_ = Smi::New(value);
+}
+
+
+void MegamorphicCache::set_target_name(const String& value) const {
+  StorePointer(&raw_ptr()->target_name_, value.raw());
+}
+
+
+void MegamorphicCache::set_arguments_descriptor(const Array& value) const {
+  StorePointer(&raw_ptr()->arguments_descriptor_, value.raw());
+}
+
+
+void MegamorphicCache::set_filled_entry_count(intptr_t value) const {
+  raw_ptr()->filled_entry_count_ = value;
+}
+
+
+intptr_t MegamorphicCache::Capacity() const {
+  return Smi::Value(raw_ptr()->mask_) + 1;
+}
+
+
+void MegamorphicCache::InitializeBuckets(intptr_t capacity) const {
+  ASSERT(Utils::IsPowerOfTwo(capacity));
+  // The lookup stub stops probing at the first empty bucket, which holds the
+  // illegal class-id.
+  ASSERT(kIllegalCid == 0);
+  const Array& buckets =
+      Array::Handle(Array::New(capacity * kEntryLength, Heap::kOld));
+  const Smi& illegal_cid = Smi::Handle(Smi::New(kIllegalCid));
+  for (intptr_t i = 0; i < capacity; i++) {
+    buckets.SetAt(i * kEntryLength + kClassIdIndex, illegal_cid);
+  }
+  set_buckets(buckets);
+  set_mask(capacity - 1);
+  set_filled_entry_count(0);
+}
+
+
+RawFunction* MegamorphicCache::Lookup(intptr_t class_id) const {
+  ASSERT(class_id != kIllegalCid);
+  const Array& data = Array::Handle(buckets());
+  const intptr_t mask = Capacity() - 1;
+  intptr_t index = class_id & mask;
+  while (true) {
+    const intptr_t probe = Smi::Value(reinterpret_cast<RawSmi*>(
+        data.At(index * kEntryLength + kClassIdIndex)));
+    if (probe == class_id) {
+      return reinterpret_cast<RawFunction*>(
+          data.At(index * kEntryLength + kTargetFunctionIndex));
+    }
+    if (probe == kIllegalCid) {
+      return Function::null();
+    }
+    index = (index + 1) & mask;
+  }
+}
+
+
+void MegamorphicCache::Insert(intptr_t class_id,
+                              const Function& target) const {
+  ASSERT(Lookup(class_id) == Function::null());
+  // Keep the table at most three quarters full so that probing terminates
+  // quickly.
+  const intptr_t capacity = Capacity();
+  if (4 * (filled_entry_count() + 1) > 3 * capacity) {
+    const Array& old_buckets = Array::Handle(buckets());
+    InitializeBuckets(2 * capacity);
+    Function& old_target = Function::Handle();
+    for (intptr_t i = 0; i < capacity; i++) {
+      const intptr_t old_class_id = Smi::Value(reinterpret_cast<RawSmi*>(
+          old_buckets.At(i * kEntryLength + kClassIdIndex)));
+      if (old_class_id != kIllegalCid) {
+        old_target ^= old_buckets.At(i * kEntryLength + kTargetFunctionIndex);
+        InsertEntry(old_class_id, old_target);
+      }
+    }
+  }
+  InsertEntry(class_id, target);
+}
+
+
+void MegamorphicCache::InsertEntry(intptr_t class_id,
+                                   const Function& target) const {
+  ASSERT(class_id != kIllegalCid);
+  const Array& data = Array::Handle(buckets());
+  const intptr_t mask = Capacity() - 1;
+  intptr_t index = class_id & mask;
+  while (Smi::Value(reinterpret_cast<RawSmi*>(
+             data.At(index * kEntryLength + kClassIdIndex))) != kIllegalCid) {
+    index = (index + 1) & mask;
+  }
+  data.SetAt(index * kEntryLength + kClassIdIndex,
+             Smi::Handle(Smi::New(class_id)));
+  data.SetAt(index * kEntryLength + kTargetFunctionIndex, target);
+  set_filled_entry_count(filled_entry_count() + 1);
+}
+
+
+const char* MegamorphicCache::ToCString() const {
+  return "MegamorphicCache";
+}
+
+
 const char* Error::ToErrorCString() const {
   UNREACHABLE();
   return "Internal Error";
@@ -11089,9 +11301,8 @@ void Array::MakeImmutable() const {
       isolate, isolate->object_store()->immutable_array_class());
   {
     NoGCScope no_gc;
-    uword tags = raw_ptr()->tags_;
-    tags = RawObject::ClassIdTag::update(cls.id(), tags);
-    raw_ptr()->tags_ = tags;
+    raw()->UpdateTags(RawObject::ClassIdTag::mask_in_place(),
+                      RawObject::ClassIdTag::encode(cls.id()));
   }
 }
 
@@ -11130,20 +11341,11 @@ RawArray* Array::MakeArray(const GrowableObjectArray& growable_array) {
   intptr_t used_size = Array::InstanceSize(used_len);
   NoGCScope no_gc;
 
-  // Update the size in the header field and length of the array object.
-  uword tags = array.raw_ptr()->tags_;
-  ASSERT(kArrayCid == RawObject::ClassIdTag::decode(tags));
-  tags = RawObject::SizeTag::update(used_size, tags);
-  array.raw_ptr()->tags_ = tags;
-  array.SetLength(used_len);
-
-  // Null the GrowableObjectArray, we are removing it's backing array.
-  growable_array.SetLength(0);
-  growable_array.SetData(new_array);
-
   // If there is any left over space fill it with either an Array object or
   // just a plain object (depending on the amount of left over space) so
   // that it can be traversed over successfully during garbage collection.
+  // The filler is written before the array is shrunk as a concurrent sweeper
+  // may walk over the array at any time.
   if (capacity_size != used_size) {
     ASSERT(capacity_len > used_len);
     intptr_t leftover_size = capacity_size - used_size;
@@ -11154,7 +11356,7 @@ RawArray* Array::MakeArray(const GrowableObjectArray& growable_array) {
       // space as an Array object.
       RawArray* raw = reinterpret_cast<RawArray*>(RawObject::FromAddr(addr));
       const Class& cls = Class::Handle(isolate->object_store()->array_class());
-      tags = 0;
+      uword tags = 0;
       tags = RawObject::SizeTag::update(leftover_size, tags);
       tags = RawObject::ClassIdTag::update(cls.id(), tags);
       raw->ptr()->tags_ = tags;
@@ -11166,12 +11368,26 @@ RawArray* Array::MakeArray(const GrowableObjectArray& growable_array) {
       // Update the leftover space as a basic object.
       ASSERT(leftover_size == Object::InstanceSize());
       RawObject* raw = reinterpret_cast<RawObject*>(RawObject::FromAddr(addr));
-      tags = 0;
+      uword tags = 0;
       tags = RawObject::SizeTag::update(leftover_size, tags);
       tags = RawObject::ClassIdTag::update(kInstanceCid, tags);
       raw->ptr()->tags_ = tags;
     }
   }
+
+  // Update the size in the header field and length of the array object.
+  array.SetLength(used_len);
+  uword tags;
+  do {
+    tags = array.raw_ptr()->tags_;
+    ASSERT(kArrayCid == RawObject::ClassIdTag::decode(tags));
+  } while (!array.raw()->TryUpdateTags(
+      tags, RawObject::SizeTag::update(used_size, tags)));
+
+  // Null the GrowableObjectArray, we are removing it's backing array.
+  growable_array.SetLength(0);
+  growable_array.SetData(new_array);
+
   return array.raw();
 }
 
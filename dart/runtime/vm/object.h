@@ -292,6 +292,9 @@ CLASS_LIST_NO_OBJECT(DEFINE_CLASS_TESTER);
   static RawClass* unwind_error_class() { return unwind_error_class_; }
   static RawClass* icdata_class() { return icdata_class_; }
   static RawClass* subtypetestcache_class() { return subtypetestcache_class_; }
+  static RawClass* megamorphic_cache_class() {
+    return megamorphic_cache_class_;
+  }
 
   static RawError* Init(Isolate* isolate);
   static void InitFromSnapshot(Isolate* isolate);
@@ -349,9 +352,17 @@ CLASS_LIST_NO_OBJECT(DEFINE_CLASS_TESTER);
     *addr = value;
     // Filter stores based on source and target.
     if (!value->IsHeapObject()) return;
-    if (value->IsNewObject() && raw()->IsOldObject()) {
-      uword ptr = reinterpret_cast<uword>(addr);
-      Isolate::Current()->store_buffer()->AddPointer(ptr);
+    if (raw()->IsOldObject()) {
+      Isolate* isolate = Isolate::Current();
+      if (value->IsNewObject()) {
+        uword ptr = reinterpret_cast<uword>(addr);
+        isolate->store_buffer()->AddObjectPointer(raw(), ptr);
+      }
+      // Record the object for the concurrent marker, if it is running.
+      MarkingBarrierBlock* barrier_block = isolate->marking_barrier_block();
+      if (barrier_block->is_active()) {
+        barrier_block->AddObject(raw());
+      }
     }
   }
 
@@ -415,6 +426,7 @@ CLASS_LIST_NO_OBJECT(DEFINE_CLASS_TESTER);
   static RawClass* context_scope_class_;  // Class of ContextScope vm object.
   static RawClass* icdata_class_;  // Class of ICData.
   static RawClass* subtypetestcache_class_;  // Class of SubtypeTestCache.
+  static RawClass* megamorphic_cache_class_;  // Class of MegamorphicCache.
   static RawClass* api_error_class_;  // Class of ApiError.
   static RawClass* language_error_class_;  // Class of LanguageError.
   static RawClass* unhandled_exception_class_;  // Class of UnhandledException.
@@ -1254,6 +1266,14 @@ class Function : public Object {
     raw_ptr()->deoptimization_counter_ = value;
   }
 
+  // Number of times optimization backed off after too many deoptimizations.
+  int16_t reoptimization_counter() const {
+    return raw_ptr()->reoptimization_counter_;
+  }
+  void set_reoptimization_counter(int16_t value) const {
+    raw_ptr()->reoptimization_counter_ = value;
+  }
+
   bool is_optimizable() const;
   void set_is_optimizable(bool value) const;
 
@@ -2130,6 +2150,7 @@ class PcDescriptors : public Object {
     kIcCall,           // IC call.
     kFuncCall,         // Call to known target, e.g. static call, closure call.
     kReturn,           // Return from function.
+    kOsrEntry,         // On-stack replacement point at a loop stack check.
     kOther
   };
 
@@ -2517,6 +2538,10 @@ class Code : public Object {
   uword GetDeoptBeforePcAtDeoptId(intptr_t deopt_id) const;
   uword GetDeoptAfterPcAtDeoptId(intptr_t deopt_id) const;
 
+  // Returns the deopt id of the loop stack check returning to pc, or
+  // Isolate::kNoDeoptId if pc is not an on-stack replacement point.
+  intptr_t GetOsrIdAtPc(uword pc) const;
+
   // Returns true if there is an object in the code between 'start_offset'
   // (inclusive) and 'end_offset' (exclusive).
   bool ObjectExistsInArea(intptr_t start_offest, intptr_t end_offset) const;
@@ -2530,6 +2555,9 @@ class Code : public Object {
   // Returns an array indexed by deopt id, containing the extracted ICData.
   RawArray* ExtractTypeFeedbackArray() const;
 
+  // Clears the ICData at all instance calls of unoptimized code.
+  void ResetIcDataAtCalls() const;
+
  private:
   // An object finder visitor interface.
   class FindRawCodeVisitor : public FindObjectVisitor {
@@ -2761,6 +2789,9 @@ class ICData : public Object {
   void AddReceiverCheck(intptr_t receiver_class_id,
                         const Function& target) const;
 
+  // Removes all class tests so that new type feedback can be collected.
+  void ResetChecks() const;
+
   // Retrieving checks.
 
   void GetCheckAt(intptr_t index,
@@ -2860,6 +2891,76 @@ class SubtypeTestCache : public Object {
 };
 
 
+// Maps receiver class-ids to the targets of all instance calls with the same
+// name and arguments descriptor. Used by calls that have seen too many
+// receiver classes to be checked inline: the MegamorphicLookup stub probes
+// the open addressed buckets starting at the masked receiver class-id.
+class MegamorphicCache : public Object {
+ public:
+  enum Entries {
+    kClassIdIndex = 0,
+    kTargetFunctionIndex = 1,
+    kEntryLength = 2,
+  };
+
+  static const intptr_t kInitialCapacity = 16;
+
+  RawString* target_name() const {
+    return raw_ptr()->target_name_;
+  }
+  RawArray* arguments_descriptor() const {
+    return raw_ptr()->arguments_descriptor_;
+  }
+
+  // Number of buckets, always a power of two.
+  intptr_t Capacity() const;
+  intptr_t filled_entry_count() const {
+    return raw_ptr()->filled_entry_count_;
+  }
+
+  // Returns the target of class 'class_id' or null if it is not cached.
+  RawFunction* Lookup(intptr_t class_id) const;
+  void Insert(intptr_t class_id, const Function& target) const;
+
+  // Returns the cache shared by all megamorphic calls of 'target_name' with
+  // 'arguments_descriptor' in the current isolate, allocating it on first use.
+  static RawMegamorphicCache* ForSelector(const String& target_name,
+                                          const Array& arguments_descriptor);
+
+  static RawMegamorphicCache* New(const String& target_name,
+                                  const Array& arguments_descriptor);
+
+  static intptr_t InstanceSize() {
+    return RoundedAllocationSize(sizeof(RawMegamorphicCache));
+  }
+
+  static intptr_t buckets_offset() {
+    return OFFSET_OF(RawMegamorphicCache, buckets_);
+  }
+
+  static intptr_t mask_offset() {
+    return OFFSET_OF(RawMegamorphicCache, mask_);
+  }
+
+ private:
+  RawArray* buckets() const {
+    return raw_ptr()->buckets_;
+  }
+  void set_buckets(const Array& value) const;
+  void set_mask(intptr_t value) const;
+  void set_target_name(const String& value) const;
+  void set_arguments_descriptor(const Array& value) const;
+  void set_filled_entry_count(intptr_t value) const;
+
+  // Allocates empty buckets for 'capacity' entries.
+  void InitializeBuckets(intptr_t capacity) const;
+  void InsertEntry(intptr_t class_id, const Function& target) const;
+
+  HEAP_OBJECT_IMPLEMENTATION(MegamorphicCache, Object);
+  friend class Class;
+};
+
+
 class Error : public Object {
  public:
   virtual const char* ToErrorCString() const;
@@ -4985,6 +5086,16 @@ class ExternalUint8Array : public ByteArray {
     return raw_ptr()->external_data_->peer();
   }
 
+  // A transferable array is not copied when sent in a message. Its data is
+  // handed over to the receiving isolate and this array is left empty.
+  bool IsTransferable() const {
+    return raw_ptr()->external_data_->transferable();
+  }
+
+  void SetTransferable() const {
+    raw_ptr()->external_data_->set_transferable(true);
+  }
+
   static const intptr_t kBytesPerElement = 1;
 
   // Since external arrays may be serialized to non-external ones,
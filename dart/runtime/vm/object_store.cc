@@ -81,8 +81,7 @@ ObjectStore::ObjectStore()
     sticky_error_(Error::null()),
     empty_context_(Context::null()),
     stack_overflow_(Instance::null()),
-    out_of_memory_(Instance::null()),
-    keyword_symbols_(Array::null()) {
+    out_of_memory_(Instance::null()) {
 }
 
 
@@ -129,14 +128,4 @@ bool ObjectStore::PreallocateObjects() {
   return true;
 }
 
-
-void ObjectStore::InitKeywordTable() {
-  // Set up the keywords symbol array so that we can access it while scanning.
-  Array& keywords = Array::Handle(keyword_symbols());
-  ASSERT(keywords.IsNull());
-  keywords = Array::New(Token::numKeywords, Heap::kOld);
-  ASSERT(!keywords.IsError() && !keywords.IsNull());
-  set_keyword_symbols(keywords);
-}
-
 }  // namespace dart
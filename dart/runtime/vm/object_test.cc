@@ -5,6 +5,7 @@
 #include "platform/assert.h"
 #include "vm/assembler.h"
 #include "vm/bigint_operations.h"
+#include "vm/dart_entry.h"
 #include "vm/isolate.h"
 #include "vm/object.h"
 #include "vm/object_store.h"
@@ -1720,6 +1721,39 @@ TEST_CASE(Symbol) {
 }
 
 
+static bool IsInVMIsolateHeap(const Object& obj) {
+  return Dart::vm_isolate()->heap()->Contains(RawObject::ToAddr(obj.raw()));
+}
+
+
+TEST_CASE(SymbolsForTokens) {
+  // Keywords and operators are shared by all isolates.
+  String& symbol = String::Handle(Symbols::New("get"));
+  EXPECT(IsInVMIsolateHeap(symbol));
+  EXPECT_EQ(Symbols::TokenSymbol(Token::kGET), symbol.raw());
+  symbol = Symbols::New("==");
+  EXPECT(IsInVMIsolateHeap(symbol));
+  EXPECT_EQ(Symbols::TokenSymbol(Token::kEQ), symbol.raw());
+
+  // Tokens with the same string share the symbol, also with the other
+  // predefined symbols.
+  EXPECT_EQ(Symbols::TokenSymbol(Token::kADD),
+            Symbols::TokenSymbol(Token::kTIGHTADD));
+  EXPECT_EQ(Symbols::IndexToken(), Symbols::TokenSymbol(Token::kINDEX));
+  EXPECT_EQ(Symbols::This(), Symbols::TokenSymbol(Token::kTHIS));
+  EXPECT(Symbols::TokenSymbol(Token::kIDENT) == String::null());
+
+  // The scanner hands out the shared keyword symbols.
+  const String& source = String::Handle(String::New("class A { }"));
+  const String& private_key = String::Handle(String::New(""));
+  Scanner scanner(source, private_key);
+  const Scanner::GrowableTokenStream& ts = scanner.GetStream();
+  EXPECT_EQ(Token::kCLASS, ts[0].kind);
+  EXPECT_EQ(Symbols::TokenSymbol(Token::kCLASS), ts[0].literal->raw());
+  EXPECT(IsInVMIsolateHeap(*ts[0].literal));
+}
+
+
 TEST_CASE(Bool) {
   const Bool& true_value = Bool::Handle(Bool::True());
   EXPECT(true_value.value());
@@ -2678,6 +2712,44 @@ TEST_CASE(SubtypeTestCache) {
 }
 
 
+TEST_CASE(MegamorphicCache) {
+  const String& name = String::Handle(Symbols::New("foo"));
+  const Array& descriptor =
+      DartEntry::ArgumentsDescriptor(1, Array::Handle());
+  const MegamorphicCache& cache =
+      MegamorphicCache::Handle(MegamorphicCache::New(name, descriptor));
+  const intptr_t kInitialCapacity = MegamorphicCache::kInitialCapacity;
+  EXPECT_EQ(kInitialCapacity, cache.Capacity());
+  EXPECT_EQ(0, cache.filled_entry_count());
+  EXPECT_EQ(Function::null(), cache.Lookup(kSmiCid));
+
+  // Class-ids that collide in the initial buckets, enough of them to grow.
+  const intptr_t kNumEntries = 3 * kInitialCapacity;
+  const Function& target = Function::Handle(GetDummyTarget("foo"));
+  for (intptr_t i = 1; i <= kNumEntries; i++) {
+    cache.Insert(i * kInitialCapacity + 1, target);
+  }
+  EXPECT_EQ(kNumEntries, cache.filled_entry_count());
+  EXPECT(4 * cache.filled_entry_count() <= 3 * cache.Capacity());
+  for (intptr_t i = 1; i <= kNumEntries; i++) {
+    EXPECT_EQ(target.raw(), cache.Lookup(i * kInitialCapacity + 1));
+  }
+  EXPECT_EQ(Function::null(), cache.Lookup(1));
+
+  // Calls of the same selector share a cache.
+  const MegamorphicCache& shared = MegamorphicCache::Handle(
+      MegamorphicCache::ForSelector(name, descriptor));
+  const Array& same_descriptor =
+      DartEntry::ArgumentsDescriptor(1, Array::Handle());
+  EXPECT_EQ(shared.raw(),
+            MegamorphicCache::ForSelector(name, same_descriptor));
+  const Array& other_descriptor =
+      DartEntry::ArgumentsDescriptor(2, Array::Handle());
+  EXPECT(shared.raw() !=
+         MegamorphicCache::ForSelector(name, other_descriptor));
+}
+
+
 TEST_CASE(FieldTests) {
   const String& f = String::Handle(String::New("oneField"));
   const String& getter_f = String::Handle(Field::GetterName(f));
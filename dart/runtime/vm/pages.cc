@@ -5,6 +5,8 @@
 #include "vm/pages.h"
 
 #include "platform/assert.h"
+#include "vm/dart.h"
+#include "vm/gc_compactor.h"
 #include "vm/gc_marker.h"
 #include "vm/gc_sweeper.h"
 #include "vm/object.h"
@@ -22,6 +24,27 @@ DEFINE_FLAG(bool, print_free_list_before_gc, false,
             "Print free list statistics before a GC");
 DEFINE_FLAG(bool, print_free_list_after_gc, false,
             "Print free list statistics after a GC");
+DEFINE_FLAG(bool, concurrent_mark, false,
+            "Mark the old generation concurrently with the isolate");
+DEFINE_FLAG(bool, incremental_mark, false,
+            "Mark the old generation incrementally on allocation");
+DEFINE_FLAG(int, incremental_mark_budget, 2000,
+            "The maximum pause of an incremental marking step in "
+            "microseconds");
+DEFINE_FLAG(bool, lazy_sweep, false,
+            "Sweep the old generation lazily when allocating");
+DEFINE_FLAG(bool, concurrent_sweep, false,
+            "Sweep the old generation on a helper thread, implies lazy_sweep");
+DEFINE_FLAG(bool, compact_old_gen, false,
+            "Compact the old generation when it is fragmented");
+DEFINE_FLAG(int, heap_compaction_ratio, 25,
+            "The minimum percentage of old generation pages released by "
+            "compacting them");
+
+// Objects start right after the page header.
+COMPILE_ASSERT((sizeof(HeapPage) % kObjectAlignment) == 0,
+               heap_page_header_is_not_object_aligned);
+
 
 HeapPage* HeapPage::Initialize(VirtualMemory* memory, bool is_executable) {
   ASSERT(memory->size() > VirtualMemory::PageSize());
@@ -32,6 +55,8 @@ HeapPage* HeapPage::Initialize(VirtualMemory* memory, bool is_executable) {
   result->next_ = NULL;
   result->used_ = 0;
   result->top_ = result->first_object_start();
+  result->card_table_ = NULL;
+  ASSERT(Utils::IsAligned(result->first_object_start(), kObjectAlignment));
   return result;
 }
 
@@ -43,7 +68,16 @@ HeapPage* HeapPage::Allocate(intptr_t size, bool is_executable) {
 }
 
 
+void HeapPage::AllocateCardTable() {
+  ASSERT(card_table_ == NULL);
+  intptr_t num_cards = memory_->size() >> kCardBits;
+  card_table_ = new uint8_t[num_cards];
+  memset(card_table_, 0, num_cards);
+}
+
+
 void HeapPage::Deallocate() {
+  delete[] card_table_;
   // The memory for this object will become unavailable after the delete below.
   delete memory_;
 }
@@ -87,6 +121,64 @@ RawObject* HeapPage::FindObject(FindObjectVisitor* visitor) const {
 }
 
 
+// Hands the parts of the visited pointer ranges which are covered by dirty
+// cards to the wrapped visitor.
+class DirtyCardVisitor : public ObjectPointerVisitor {
+ public:
+  DirtyCardVisitor(HeapPage* page, ObjectPointerVisitor* visitor)
+      : ObjectPointerVisitor(visitor->isolate()),
+        page_(page),
+        visitor_(visitor),
+        dirty_cards_(0) {}
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    uword start = reinterpret_cast<uword>(first);
+    uword end = reinterpret_cast<uword>(last + 1);
+    intptr_t card = (start - page_->start()) >> HeapPage::kCardBits;
+    uword card_start = page_->start() + (card << HeapPage::kCardBits);
+    while (card_start < end) {
+      uword card_end = card_start + HeapPage::kCardSize;
+      if (page_->card_table_[card] != 0) {
+        page_->card_table_[card] = 0;
+        dirty_cards_++;
+        RawObject** from =
+            reinterpret_cast<RawObject**>(Utils::Maximum(start, card_start));
+        RawObject** to =
+            reinterpret_cast<RawObject**>(Utils::Minimum(end, card_end)) - 1;
+        visitor_->VisitPointers(from, to);
+        for (RawObject** current = from; current <= to; current++) {
+          if ((*current)->IsHeapObject() && (*current)->IsNewObject()) {
+            page_->card_table_[card] = 1;
+            break;
+          }
+        }
+      }
+      card++;
+      card_start = card_end;
+    }
+  }
+
+  intptr_t dirty_cards() const { return dirty_cards_; }
+
+ private:
+  HeapPage* page_;
+  ObjectPointerVisitor* visitor_;
+  intptr_t dirty_cards_;
+
+  DISALLOW_COPY_AND_ASSIGN(DirtyCardVisitor);
+};
+
+
+intptr_t HeapPage::VisitDirtyCards(ObjectPointerVisitor* visitor) {
+  ASSERT(is_card_marked());
+  // A large page holds a single object.
+  RawObject* raw_obj = RawObject::FromAddr(first_object_start());
+  DirtyCardVisitor card_visitor(this, visitor);
+  raw_obj->VisitPointers(&card_visitor);
+  return card_visitor.dirty_cards();
+}
+
+
 void HeapPage::WriteProtect(bool read_only) {
   memory_->Protect(
       read_only ? VirtualMemory::kReadOnly : VirtualMemory::kReadWrite);
@@ -100,19 +192,32 @@ PageSpace::PageSpace(Heap* heap, intptr_t max_capacity, bool is_executable)
       pages_tail_(NULL),
       large_pages_(NULL),
       bump_page_(NULL),
+      allocation_top_(0),
+      allocation_end_(0),
       max_capacity_(max_capacity),
       capacity_(0),
       in_use_(0),
       count_(0),
       is_executable_(is_executable),
       sweeping_(false),
+      marking_requested_(false),
+      concurrent_marker_(NULL),
+      has_unswept_pages_(false),
+      sweep_cursor_(NULL),
+      concurrent_sweeper_(NULL),
       page_space_controller_(FLAG_heap_growth_space_ratio,
                              FLAG_heap_growth_rate,
-                             FLAG_heap_growth_time_ratio) {
+                             FLAG_heap_growth_time_ratio,
+                             FLAG_heap_compaction_ratio) {
 }
 
 
 PageSpace::~PageSpace() {
+  delete concurrent_marker_;
+  if (concurrent_sweeper_ != NULL) {
+    concurrent_sweeper_->Finish(&freelist_);
+    delete concurrent_sweeper_;
+  }
   FreePages(pages_);
   FreePages(large_pages_);
 }
@@ -141,6 +246,9 @@ void PageSpace::AllocatePage() {
 HeapPage* PageSpace::AllocateLargePage(intptr_t size) {
   intptr_t page_size = LargePageSizeFor(size);
   HeapPage* page = HeapPage::Allocate(page_size, is_executable_);
+  if (!is_executable_) {
+    page->AllocateCardTable();
+  }
   page->set_next(large_pages_);
   large_pages_ = page;
   capacity_ += page_size;
@@ -176,6 +284,23 @@ void PageSpace::FreeLargePage(HeapPage* page, HeapPage* previous_page) {
 }
 
 
+void PageSpace::FreeEmptyPages() {
+  ASSERT(!has_unswept_pages_);
+  HeapPage* prev_page = NULL;
+  HeapPage* page = pages_;
+  while (page != NULL) {
+    HeapPage* next_page = page->next();
+    if (page->top() == page->first_object_start()) {
+      FreePage(page, prev_page);
+    } else {
+      prev_page = page;
+    }
+    page = next_page;
+  }
+  bump_page_ = NULL;
+}
+
+
 void PageSpace::FreePages(HeapPage* pages) {
   HeapPage* page = pages;
   while (page != NULL) {
@@ -220,14 +345,67 @@ uword PageSpace::TryAllocate(intptr_t size) {
 uword PageSpace::TryAllocate(intptr_t size, GrowthPolicy growth_policy) {
   ASSERT(size >= kObjectAlignment);
   ASSERT(Utils::IsAligned(size, kObjectAlignment));
+  if ((size <= kMaxBufferedObjectSize) && (concurrent_marker_ == NULL)) {
+    uword result = TryAllocateInBuffer(size, growth_policy);
+    if (result != 0) {
+      return result;
+    }
+  }
+  return TryAllocateUnbuffered(size, growth_policy);
+}
+
+
+uword PageSpace::TryAllocateInBuffer(intptr_t size,
+                                     GrowthPolicy growth_policy) {
+  uword result = allocation_top_;
+  if (static_cast<intptr_t>(allocation_end_ - result) < size) {
+    // Retire the buffer and carve out a new one. The buffer is accounted as
+    // in use as a whole until it is released.
+    ReleaseAllocationBuffer();
+    result = TryAllocateUnbuffered(kAllocationBufferSize, growth_policy);
+    if (result == 0) {
+      return 0;
+    }
+    allocation_end_ = result + kAllocationBufferSize;
+  }
+  allocation_top_ = result + size;
+  return result;
+}
+
+
+void PageSpace::ReleaseAllocationBuffer() {
+  intptr_t remaining = allocation_end_ - allocation_top_;
+  if (remaining > 0) {
+    freelist_.Free(allocation_top_, remaining);
+    in_use_ -= remaining;
+  }
+  allocation_top_ = 0;
+  allocation_end_ = 0;
+}
+
+
+void PageSpace::MakeAllocationBufferIterable() const {
+  intptr_t remaining = allocation_end_ - allocation_top_;
+  if (remaining > 0) {
+    FreeListElement::AsElement(allocation_top_, remaining);
+  }
+}
+
+
+uword PageSpace::TryAllocateUnbuffered(intptr_t size,
+                                       GrowthPolicy growth_policy) {
   uword result = 0;
   if (size < kAllocatablePageSize) {
     result = freelist_.TryAllocate(size);
+    if ((result == 0) && has_unswept_pages_) {
+      result = SweepAndTryAllocate(size);
+    }
     if (result == 0) {
       result = TryBumpAllocate(size);
       if ((result == 0) &&
           (page_space_controller_.CanGrowPageSpace(size) ||
-           growth_policy == kForceGrowth) &&
+           growth_policy == kForceGrowth ||
+           CanGrowForConcurrentMarking()) &&
           CanIncreaseCapacity(kPageSize)) {
         AllocatePage();
         result = TryBumpAllocate(size);
@@ -251,11 +429,128 @@ uword PageSpace::TryAllocate(intptr_t size, GrowthPolicy growth_policy) {
   }
   if (result != 0) {
     in_use_ += size;
+    if (concurrent_marker_ != NULL) {
+      concurrent_marker_->RecordAllocation(result);
+    }
   }
   return result;
 }
 
 
+// Instead of collecting garbage when the growth controller denies growing
+// the heap, concurrent or incremental marking is requested and the heap keeps
+// growing until the marking is finished.
+bool PageSpace::CanGrowForConcurrentMarking() {
+  if (!(FLAG_concurrent_mark || FLAG_incremental_mark) ||
+      is_executable_ ||
+      sweeping_) {
+    return false;
+  }
+  if (concurrent_marker_ != NULL) {
+    return true;
+  }
+  if (marking_requested_ ||
+      (!FLAG_incremental_mark && (Dart::thread_pool() == NULL))) {
+    // The isolate did not start the requested marking in time.
+    return false;
+  }
+  marking_requested_ = true;
+  Isolate::Current()->ScheduleInterrupts(Isolate::kMarkingInterrupt);
+  return true;
+}
+
+
+void PageSpace::UpdateConcurrentMarking() {
+  if (concurrent_marker_ == NULL) {
+    if (marking_requested_) {
+      StartConcurrentMarking();
+    }
+  } else if (concurrent_marker_->IsDone()) {
+    heap_->CollectGarbage(Heap::kOld);
+  }
+}
+
+
+void PageSpace::StartConcurrentMarking() {
+  ASSERT(concurrent_marker_ == NULL);
+  FinishSweeping();
+  marking_requested_ = false;
+  ReleaseAllocationBuffer();
+  concurrent_marker_ = new ConcurrentMarker(heap_, this);
+  if (FLAG_incremental_mark) {
+    concurrent_marker_->StartIncremental(Isolate::Current());
+  } else {
+    concurrent_marker_->Start(Isolate::Current());
+  }
+}
+
+
+bool PageSpace::StepIncrementalMarking() {
+  if ((concurrent_marker_ == NULL) || !concurrent_marker_->is_incremental()) {
+    return false;
+  }
+  return concurrent_marker_->Step(FLAG_incremental_mark_budget);
+}
+
+
+HeapPage* PageSpace::TakeUnsweptPage() {
+  sweep_mutex_.Lock();
+  HeapPage* page = sweep_cursor_;
+  if (page != NULL) {
+    sweep_cursor_ = page->next();
+  }
+  sweep_mutex_.Unlock();
+  return page;
+}
+
+
+uword PageSpace::SweepAndTryAllocate(intptr_t size) {
+  ASSERT(has_unswept_pages_);
+  GCSweeper sweeper(heap_);
+  while (true) {
+    if (concurrent_sweeper_ != NULL) {
+      concurrent_sweeper_->TakeFreeList(&freelist_);
+      uword result = freelist_.TryAllocate(size);
+      if (result != 0) {
+        return result;
+      }
+    }
+    HeapPage* page = TakeUnsweptPage();
+    if (page == NULL) {
+      break;
+    }
+    sweeper.SweepPage(page, &freelist_);
+    uword result = freelist_.TryAllocate(size);
+    if (result != 0) {
+      return result;
+    }
+  }
+  // All pages have been swept, bump allocation may be used from now on.
+  FinishSweeping();
+  return freelist_.TryAllocate(size);
+}
+
+
+void PageSpace::FinishSweeping() {
+  if (!has_unswept_pages_) {
+    return;
+  }
+  GCSweeper sweeper(heap_);
+  HeapPage* page = TakeUnsweptPage();
+  while (page != NULL) {
+    sweeper.SweepPage(page, &freelist_);
+    page = TakeUnsweptPage();
+  }
+  if (concurrent_sweeper_ != NULL) {
+    concurrent_sweeper_->Finish(&freelist_);
+    delete concurrent_sweeper_;
+    concurrent_sweeper_ = NULL;
+  }
+  has_unswept_pages_ = false;
+  FreeEmptyPages();
+}
+
+
 bool PageSpace::Contains(uword addr) const {
   HeapPage* page = pages_;
   while (page != NULL) {
@@ -294,6 +589,7 @@ void PageSpace::StartEndAddress(uword* start, uword* end) const {
 
 
 void PageSpace::VisitObjects(ObjectVisitor* visitor) const {
+  MakeAllocationBufferIterable();
   HeapPage* page = pages_;
   while (page != NULL) {
     page->VisitObjects(visitor);
@@ -329,6 +625,7 @@ int64_t PageSpace::PeerCount() const {
 
 
 void PageSpace::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
+  MakeAllocationBufferIterable();
   HeapPage* page = pages_;
   while (page != NULL) {
     page->VisitObjectPointers(visitor);
@@ -343,8 +640,22 @@ void PageSpace::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
 }
 
 
+intptr_t PageSpace::VisitDirtyCards(ObjectPointerVisitor* visitor) const {
+  intptr_t dirty_cards = 0;
+  HeapPage* page = large_pages_;
+  while (page != NULL) {
+    if (page->is_card_marked()) {
+      dirty_cards += page->VisitDirtyCards(visitor);
+    }
+    page = page->next();
+  }
+  return dirty_cards;
+}
+
+
 RawObject* PageSpace::FindObject(FindObjectVisitor* visitor) const {
   ASSERT(Isolate::Current()->no_gc_scope_depth() != 0);
+  MakeAllocationBufferIterable();
   HeapPage* page = pages_;
   while (page != NULL) {
     RawObject* obj = page->FindObject(visitor);
@@ -367,6 +678,10 @@ RawObject* PageSpace::FindObject(FindObjectVisitor* visitor) const {
 
 
 void PageSpace::WriteProtect(bool read_only) {
+  if (read_only) {
+    // No objects are allocated while the pages are protected.
+    ReleaseAllocationBuffer();
+  }
   HeapPage* page = pages_;
   while (page != NULL) {
     page->WriteProtect(read_only);
@@ -380,12 +695,39 @@ void PageSpace::WriteProtect(bool read_only) {
 }
 
 
+bool PageSpace::ShouldCompact() const {
+  if (!FLAG_compact_old_gen || is_executable_) {
+    return false;
+  }
+  // The marker has accounted for the live objects of each page.
+  intptr_t pages_in_use = 0;
+  intptr_t live_size = 0;
+  for (HeapPage* page = pages_; page != NULL; page = page->next()) {
+    if (page->used() > 0) {
+      pages_in_use++;
+      live_size += page->used();
+    }
+  }
+  intptr_t pages_after_compaction =
+      (live_size + kAllocatablePageSize - 1) / kAllocatablePageSize;
+  return page_space_controller_.NeedsCompaction(pages_in_use,
+                                                pages_after_compaction);
+}
+
+
 void PageSpace::MarkSweep(bool invoke_api_callbacks, const char* gc_reason) {
   // MarkSweep is not reentrant. Make sure that is the case.
   ASSERT(!sweeping_);
   sweeping_ = true;
   Isolate* isolate = Isolate::Current();
   NoHandleScope no_handles(isolate);
+  // The pause includes waiting for a concurrent sweep to finish.
+  int64_t pause_start = OS::GetCurrentTimeMicros();
+
+  // The marking relies on the mark bits left by the last sweep being clear.
+  FinishSweeping();
+  // The unused part of the allocation buffer is swept as free space.
+  ReleaseAllocationBuffer();
 
   if (FLAG_print_free_list_before_gc) {
     freelist_.Print();
@@ -405,8 +747,15 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks, const char* gc_reason) {
   int64_t start = OS::GetCurrentTimeMillis();
 
   // Mark all reachable old-gen objects.
-  GCMarker marker(heap_);
-  marker.MarkObjects(isolate, this, invoke_api_callbacks);
+  if (concurrent_marker_ != NULL) {
+    concurrent_marker_->Finish(invoke_api_callbacks);
+    delete concurrent_marker_;
+    concurrent_marker_ = NULL;
+  } else {
+    GCMarker marker(heap_);
+    marker.MarkObjects(isolate, this, invoke_api_callbacks);
+  }
+  marking_requested_ = false;
 
   // Reset the bump allocation page to unused.
   bump_page_ = NULL;
@@ -417,17 +766,38 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks, const char* gc_reason) {
 
   HeapPage* prev_page = NULL;
   HeapPage* page = pages_;
-  while (page != NULL) {
-    intptr_t page_in_use = sweeper.SweepPage(page, &freelist_);
-    HeapPage* next_page = page->next();
-    if (page_in_use == 0) {
-      FreePage(page, prev_page);
-    } else {
-      in_use += page_in_use;
-      prev_page = page;
+  if (ShouldCompact()) {
+    GCCompactor compactor(heap_);
+    in_use += compactor.CompactPages(isolate, this, pages_);
+    FreeEmptyPages();
+  } else if ((FLAG_lazy_sweep || FLAG_concurrent_sweep) && !is_executable_) {
+    // Leave the sweeping of the pages to allocation and the concurrent
+    // sweeper. The marker has already accounted for the live objects.
+    while (page != NULL) {
+      in_use += page->used();
+      page = page->next();
+    }
+    has_unswept_pages_ = (pages_ != NULL);
+    sweep_cursor_ = pages_;
+    if (has_unswept_pages_ &&
+        FLAG_concurrent_sweep &&
+        (Dart::thread_pool() != NULL)) {
+      concurrent_sweeper_ = new ConcurrentSweeper(heap_, this);
+      concurrent_sweeper_->Start(isolate);
+    }
+  } else {
+    while (page != NULL) {
+      intptr_t page_in_use = sweeper.SweepPage(page, &freelist_);
+      HeapPage* next_page = page->next();
+      if (page_in_use == 0) {
+        FreePage(page, prev_page);
+      } else {
+        in_use += page_in_use;
+        prev_page = page;
+      }
+      // Advance to the next page.
+      page = next_page;
     }
-    // Advance to the next page.
-    page = next_page;
   }
 
   prev_page = NULL;
@@ -456,6 +826,18 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks, const char* gc_reason) {
   page_space_controller_.EvaluateGarbageCollection(in_use_before, in_use,
                                                    start, end);
 
+  if (!is_executable_) {
+    GCEvent event;
+    event.space = Heap::kOld;
+    event.reason = gc_reason;
+    event.start = pause_start;
+    event.end = OS::GetCurrentTimeMicros();
+    event.used_before = in_use_before;
+    event.used_after = in_use;
+    event.promoted = 0;
+    heap_->RecordGCEvent(event);
+  }
+
   if (FLAG_verbose_gc) {
     const intptr_t KB2 = KB / 2;
     OS::PrintErr("Mark-Sweep[%d]: %"Pd64"us (%"Pd"K -> %"Pd"K, %"Pd"K)\n",
@@ -485,13 +867,15 @@ void PageSpace::MarkSweep(bool invoke_api_callbacks, const char* gc_reason) {
 
 PageSpaceController::PageSpaceController(int heap_growth_ratio,
                                          int heap_growth_rate,
-                                         int garbage_collection_time_ratio)
+                                         int garbage_collection_time_ratio,
+                                         int heap_compaction_ratio)
     : is_enabled_(false),
       grow_heap_(heap_growth_rate),
       heap_growth_ratio_(heap_growth_ratio),
       desired_utilization_((100.0 - heap_growth_ratio) / 100.0),
       heap_growth_rate_(heap_growth_rate),
-      garbage_collection_time_ratio_(garbage_collection_time_ratio) {
+      garbage_collection_time_ratio_(garbage_collection_time_ratio),
+      heap_compaction_ratio_(heap_compaction_ratio) {
 }
 
 
@@ -515,6 +899,22 @@ bool PageSpaceController::CanGrowPageSpace(intptr_t size_in_bytes) {
 }
 
 
+bool PageSpaceController::NeedsCompaction(
+    intptr_t pages_in_use, intptr_t pages_after_compaction) const {
+  if (pages_in_use == 0) {
+    return false;
+  }
+  ASSERT(pages_after_compaction <= pages_in_use);
+  intptr_t released_ratio =
+      (100 * (pages_in_use - pages_after_compaction)) / pages_in_use;
+  if (FLAG_verbose_gc) {
+    OS::PrintErr("PageSpaceController: compaction releases %"Pd"%% of "
+                 "%"Pd" pages\n", released_ratio, pages_in_use);
+  }
+  return released_ratio >= heap_compaction_ratio_;
+}
+
+
 void PageSpaceController::EvaluateGarbageCollection(
     intptr_t in_use_before, intptr_t in_use_after, int64_t start, int64_t end) {
   ASSERT(in_use_before >= in_use_after);
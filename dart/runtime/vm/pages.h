@@ -7,13 +7,23 @@
 
 #include <map>
 
+#include "platform/thread.h"
+#include "vm/flags.h"
 #include "vm/freelist.h"
 #include "vm/globals.h"
 #include "vm/virtual_memory.h"
 
 namespace dart {
 
+DECLARE_FLAG(bool, concurrent_mark);
+DECLARE_FLAG(bool, incremental_mark);
+DECLARE_FLAG(bool, lazy_sweep);
+DECLARE_FLAG(bool, concurrent_sweep);
+DECLARE_FLAG(bool, compact_old_gen);
+
 // Forward declarations.
+class ConcurrentMarker;
+class ConcurrentSweeper;
 class Heap;
 class ObjectPointerVisitor;
 
@@ -61,10 +71,35 @@ class HeapPage {
 
   void WriteProtect(bool read_only);
 
+  // Large pages holding old generation data objects are card marked: the
+  // write barrier dirties the card covering a slot which is made to refer to
+  // a new object instead of adding the slot to the store buffer.
+  static const intptr_t kCardBits = 9;
+  static const intptr_t kCardSize = 1 << kCardBits;
+
+  bool is_card_marked() const { return card_table_ != NULL; }
+
+  void MarkCard(uword addr) {
+    ASSERT(is_card_marked());
+    ASSERT(Contains(addr));
+    card_table_[(addr - start()) >> kCardBits] = 1;
+  }
+
+  static intptr_t card_table_offset() {
+    return OFFSET_OF(HeapPage, card_table_);
+  }
+
+  // Visits the pointers covered by dirty cards and cleans the cards. Cards
+  // which still refer to new objects after the visit are dirtied again.
+  // Returns the number of dirty cards.
+  intptr_t VisitDirtyCards(ObjectPointerVisitor* visitor);
+
  private:
   static HeapPage* Initialize(VirtualMemory* memory, bool is_executable);
   static HeapPage* Allocate(intptr_t size, bool is_executable);
 
+  void AllocateCardTable();
+
   // Deallocate the virtual memory backing this page. The page pointer to this
   // page becomes immediately inaccessible.
   void Deallocate();
@@ -73,7 +108,12 @@ class HeapPage {
   HeapPage* next_;
   uword used_;
   uword top_;
+  uint8_t* card_table_;
+  // Keeps the size of the header a multiple of the object alignment on 64-bit
+  // platforms, see the check in pages.cc.
+  uword padding_;
 
+  friend class DirtyCardVisitor;
   friend class PageSpace;
 
   DISALLOW_ALLOCATION();
@@ -111,7 +151,8 @@ class PageSpaceController {
  public:
   PageSpaceController(int heap_growth_ratio,
                       int heap_growth_rate,
-                      int garbage_collection_time_ratio);
+                      int garbage_collection_time_ratio,
+                      int heap_compaction_ratio);
   ~PageSpaceController();
 
   bool CanGrowPageSpace(intptr_t size_in_bytes);
@@ -123,6 +164,11 @@ class PageSpaceController {
   void EvaluateGarbageCollection(intptr_t in_use_before, intptr_t in_use_after,
                                  int64_t start, int64_t end);
 
+  // Compaction is considered worthwhile if sliding the live objects together
+  // releases at least heap_compaction_ratio % of the pages in use.
+  bool NeedsCompaction(intptr_t pages_in_use,
+                       intptr_t pages_after_compaction) const;
+
   void Enable() {
     is_enabled_ = true;
   }
@@ -148,6 +194,10 @@ class PageSpaceController {
   // garbage collection can be performed.
   int garbage_collection_time_ratio_;
 
+  // If compacting releases at least heap_compaction_ratio_ percent of the
+  // pages, the pages are compacted instead of swept.
+  int heap_compaction_ratio_;
+
   PageSpaceGarbageCollectionHistory history_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(PageSpaceController);
@@ -171,6 +221,16 @@ class PageSpace {
   uword TryAllocate(intptr_t size);
   uword TryAllocate(intptr_t size, GrowthPolicy growth_policy);
 
+  // Small objects are bump allocated from an allocation buffer carved out of
+  // the pages. The unused part of the buffer is returned to the freelist.
+  void ReleaseAllocationBuffer();
+
+  // Limits of the current allocation buffer. The buffer is kept empty while
+  // the old generation is marked concurrently, as the allocated objects have
+  // to be recorded with the marker.
+  uword allocation_top() const { return allocation_top_; }
+  uword allocation_end() const { return allocation_end_; }
+
   intptr_t in_use() const { return in_use_; }
   intptr_t capacity() const { return capacity_; }
 
@@ -185,11 +245,43 @@ class PageSpace {
   void VisitObjects(ObjectVisitor* visitor) const;
   void VisitObjectPointers(ObjectPointerVisitor* visitor) const;
 
+  // Visits the dirty cards of the card marked pages. Returns the number of
+  // dirty cards.
+  intptr_t VisitDirtyCards(ObjectPointerVisitor* visitor) const;
+
   RawObject* FindObject(FindObjectVisitor* visitor) const;
 
-  // Collect the garbage in the page space using mark-sweep.
+  // Collect the garbage in the page space using mark-sweep. Finishes the
+  // concurrent marking if it is in progress.
   void MarkSweep(bool invoke_api_callbacks, const char* gc_reason);
 
+  // Starts the requested concurrent marking, or finishes it with a mark-sweep
+  // once the marker has run out of work. Called when the isolate handles a
+  // marking interrupt.
+  void UpdateConcurrentMarking();
+
+  // Starts the concurrent marking without waiting for the heap to grow. The
+  // marking is incremental if requested by the incremental_mark flag.
+  void StartConcurrentMarking();
+
+  // Takes a step of the incremental marking in progress, if any, bounded by
+  // the incremental_mark_budget flag. Returns true once the marking is ready
+  // to be finished with a mark-sweep.
+  bool StepIncrementalMarking();
+
+  // The marker of the concurrent marking in progress or NULL.
+  ConcurrentMarker* concurrent_marker() const { return concurrent_marker_; }
+
+  // Sweeps the pages left unswept by the last mark-sweep. Has to be called
+  // before the objects of the page space are visited.
+  void FinishSweeping();
+
+  bool HasUnsweptPages() const { return has_unswept_pages_; }
+
+  // Returns the next page to be swept or NULL. Called by the isolate and the
+  // concurrent sweeper.
+  HeapPage* TakeUnsweptPage();
+
   static HeapPage* PageFor(RawObject* raw_obj) {
     return reinterpret_cast<HeapPage*>(
         RawObject::ToAddr(raw_obj) & ~(kPageSize -1));
@@ -215,12 +307,15 @@ class PageSpace {
 
  private:
   static const intptr_t kAllocatablePageSize = kPageSize - sizeof(HeapPage);
+  static const intptr_t kAllocationBufferSize = 8 * KB;
+  static const intptr_t kMaxBufferedObjectSize = kAllocationBufferSize / 4;
 
   void AllocatePage();
   void FreePage(HeapPage* page, HeapPage* previous_page);
   HeapPage* AllocateLargePage(intptr_t size);
   void FreeLargePage(HeapPage* page, HeapPage* previous_page);
   void FreePages(HeapPage* pages);
+  void FreeEmptyPages();
 
   static intptr_t LargePageSizeFor(intptr_t size);
 
@@ -231,6 +326,22 @@ class PageSpace {
 
   uword TryBumpAllocate(intptr_t size);
 
+  uword TryAllocateInBuffer(intptr_t size, GrowthPolicy growth_policy);
+  uword TryAllocateUnbuffered(intptr_t size, GrowthPolicy growth_policy);
+
+  // Formats the unused part of the allocation buffer as a free list element
+  // so that the pages can be iterated.
+  void MakeAllocationBufferIterable() const;
+
+  bool CanGrowForConcurrentMarking();
+
+  // Sweeps unswept pages until an object of the given size can be allocated
+  // from the freelist.
+  uword SweepAndTryAllocate(intptr_t size);
+
+  // Decides after marking whether the pages should be compacted.
+  bool ShouldCompact() const;
+
   FreeList freelist_;
 
   Heap* heap_;
@@ -248,6 +359,10 @@ class PageSpace {
   // tail page, we give up bump allocating.
   HeapPage* bump_page_;
 
+  // Current allocation buffer top and end.
+  uword allocation_top_;
+  uword allocation_end_;
+
   // Various sizes being tracked for this generation.
   intptr_t max_capacity_;
   intptr_t capacity_;
@@ -261,8 +376,23 @@ class PageSpace {
   // Keep track whether a MarkSweep is currently running.
   bool sweeping_;
 
+  // Concurrent or incremental marking has been requested but not yet
+  // started.
+  bool marking_requested_;
+  ConcurrentMarker* concurrent_marker_;
+
+  // After a mark-sweep with lazy sweeping the pages starting at the sweep
+  // cursor are left to be swept. Until all of them have been swept no pages
+  // are added or freed and bump allocation is not used.
+  bool has_unswept_pages_;
+  Mutex sweep_mutex_;
+  HeapPage* sweep_cursor_;
+  ConcurrentSweeper* concurrent_sweeper_;
+
   PageSpaceController page_space_controller_;
 
+  friend class GCCompactor;
+
   DISALLOW_IMPLICIT_CONSTRUCTORS(PageSpace);
 };
 
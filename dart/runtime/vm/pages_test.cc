@@ -31,4 +31,27 @@ TEST_CASE(Pages) {
   delete space;
 }
 
+
+TEST_CASE(PagesAllocationBuffer) {
+  PageSpace* space = new PageSpace(NULL, 4 * MB);
+  const intptr_t kSmallSize = 4 * kWordSize;
+  uword first = space->TryAllocate(kSmallSize);
+  EXPECT(first != 0);
+  // Small objects are bump allocated from the allocation buffer.
+  uword second = space->TryAllocate(kSmallSize);
+  EXPECT(second == (first + kSmallSize));
+  EXPECT(space->allocation_top() == (second + kSmallSize));
+  EXPECT(space->allocation_end() > space->allocation_top());
+  // Large objects bypass the buffer.
+  uword large = space->TryAllocate(64 * KB);
+  EXPECT(large != 0);
+  EXPECT(space->allocation_top() == (second + kSmallSize));
+  // Releasing the buffer only keeps the allocated objects in use.
+  space->ReleaseAllocationBuffer();
+  EXPECT(space->allocation_top() == 0);
+  EXPECT(space->allocation_end() == 0);
+  EXPECT(space->in_use() == (2 * kSmallSize + 64 * KB));
+  delete space;
+}
+
 }  // namespace dart
@@ -61,28 +61,40 @@ class PortMap: public AllStatic {
     bool live;
   } Entry;
 
-  // Allocate a new unique port.
-  static Dart_Port AllocatePort();
+  // The ports are spread over a fixed number of independently locked
+  // hashmaps, so that messages posted to ports in different shards do not
+  // contend for the same lock. The lock of a shard is held while posting a
+  // message, which keeps the handler of the port from being deleted.
+  typedef struct {
+    Mutex* mutex;
+    Entry* map;
+    intptr_t capacity;
+    intptr_t used;
+    intptr_t deleted;
+  } Shard;
+
+  static const intptr_t kNumShards = 16;
+
+  static Shard* ShardFor(Dart_Port port) {
+    return &shards_[static_cast<uintptr_t>(port) % kNumShards];
+  }
 
   static bool IsActivePort(Dart_Port id);
   static bool IsLivePort(Dart_Port id);
 
-  static intptr_t FindPort(Dart_Port port);
-  static void Rehash(intptr_t new_capacity);
+  // Returns the slot where the search for 'port' in a map starts.
+  static intptr_t StartIndex(Dart_Port port, intptr_t capacity);
 
-  static void MaintainInvariants();
+  static intptr_t FindPort(Shard* shard, Dart_Port port);
+  static void Rehash(Shard* shard, intptr_t new_capacity);
 
-  // Lock protecting access to the port map.
-  static Mutex* mutex_;
+  static void MaintainInvariants(Shard* shard);
 
-  // Hashmap of ports.
-  static Entry* map_;
+  static Shard shards_[kNumShards];
   static MessageHandler* deleted_entry_;
-  static intptr_t capacity_;
-  static intptr_t used_;
-  static intptr_t deleted_;
 
-  static Dart_Port next_port_;
+  // Next port id to try. Incremented atomically.
+  static uword next_port_;
 };
 
 }  // namespace dart
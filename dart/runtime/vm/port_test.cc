@@ -3,9 +3,11 @@
 // BSD-style license that can be found in the LICENSE file.
 
 #include "platform/assert.h"
+#include "vm/atomic.h"
 #include "vm/message_handler.h"
 #include "vm/os.h"
 #include "vm/port.h"
+#include "vm/thread.h"
 #include "vm/unit_test.h"
 
 namespace dart {
@@ -14,17 +16,19 @@ namespace dart {
 class PortMapTestPeer {
  public:
   static bool IsActivePort(Dart_Port port) {
-    MutexLocker ml(PortMap::mutex_);
-    return (PortMap::FindPort(port) >= 0);
+    PortMap::Shard* shard = PortMap::ShardFor(port);
+    MutexLocker ml(shard->mutex);
+    return (PortMap::FindPort(shard, port) >= 0);
   }
 
   static bool IsLivePort(Dart_Port port) {
-    MutexLocker ml(PortMap::mutex_);
-    intptr_t index = PortMap::FindPort(port);
+    PortMap::Shard* shard = PortMap::ShardFor(port);
+    MutexLocker ml(shard->mutex);
+    intptr_t index = PortMap::FindPort(shard, port);
     if (index < 0) {
       return false;
     }
-    return PortMap::map_[index].live;
+    return shard->map[index].live;
   }
 };
 
@@ -34,12 +38,14 @@ class PortTestMessageHandler : public MessageHandler {
   PortTestMessageHandler() : notify_count(0) {}
 
   void MessageNotify(Message::Priority priority) {
-    notify_count++;
+    // Messages may be posted from several threads at once.
+    AtomicOperations::FetchAndIncrement(
+        reinterpret_cast<uword*>(&notify_count));
   }
 
   bool HandleMessage(Message* message) { return true; }
 
-  int notify_count;
+  intptr_t notify_count;
 };
 
 
@@ -143,4 +149,65 @@ TEST_CASE(PortMap_PostMessageInvalidPort) {
       Message::kNormalPriority)));
 }
 
+
+// Posts messages to all ports from several threads at once.
+class PortPoster {
+ public:
+  static const int kNumThreads = 4;
+  static const int kNumPorts = 8;
+  static const int kNumMessages = 1000;
+
+  PortPoster(Dart_Port* ports, Monitor* monitor, int* running)
+      : ports_(ports), monitor_(monitor), running_(running) {}
+
+  static void Run(uword parameter) {
+    PortPoster* poster = reinterpret_cast<PortPoster*>(parameter);
+    for (int i = 0; i < kNumMessages; i++) {
+      for (int j = 0; j < kNumPorts; j++) {
+        uint8_t* data = reinterpret_cast<uint8_t*>(malloc(1));
+        data[0] = 0;
+        EXPECT(PortMap::PostMessage(new Message(
+            poster->ports_[j], 0, data, 1, Message::kNormalPriority)));
+      }
+    }
+    MonitorLocker ml(poster->monitor_);
+    (*poster->running_)--;
+    ml.Notify();
+  }
+
+ private:
+  Dart_Port* ports_;
+  Monitor* monitor_;
+  int* running_;
+};
+
+
+TEST_CASE(PortMap_PostMessageFromManyThreads) {
+  PortTestMessageHandler handlers[PortPoster::kNumPorts];
+  Dart_Port ports[PortPoster::kNumPorts];
+  for (int i = 0; i < PortPoster::kNumPorts; i++) {
+    ports[i] = PortMap::CreatePort(&handlers[i]);
+  }
+
+  Monitor monitor;
+  int running = PortPoster::kNumThreads;
+  PortPoster poster(ports, &monitor, &running);
+  for (int i = 0; i < PortPoster::kNumThreads; i++) {
+    Thread::Start(PortPoster::Run, reinterpret_cast<uword>(&poster));
+  }
+  {
+    MonitorLocker ml(&monitor);
+    while (running > 0) {
+      ml.Wait();
+    }
+  }
+
+  for (int i = 0; i < PortPoster::kNumPorts; i++) {
+    EXPECT_EQ(PortPoster::kNumThreads * PortPoster::kNumMessages,
+              handlers[i].notify_count);
+    PortMap::ClosePorts(&handlers[i]);
+    EXPECT(!PortMapTestPeer::IsActivePort(ports[i]));
+  }
+}
+
 }  // namespace dart
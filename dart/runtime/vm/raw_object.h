@@ -6,6 +6,7 @@
 #define VM_RAW_OBJECT_H_
 
 #include "platform/assert.h"
+#include "vm/atomic.h"
 #include "vm/globals.h"
 #include "vm/token.h"
 #include "vm/snapshot.h"
@@ -41,6 +42,7 @@ namespace dart {
   V(ContextScope)                                                              \
   V(ICData)                                                                    \
   V(SubtypeTestCache)                                                          \
+  V(MegamorphicCache)                                                          \
   V(Error)                                                                     \
     V(ApiError)                                                                \
     V(LanguageError)                                                           \
@@ -259,10 +261,22 @@ class RawObject {
     uword tags = ptr()->tags_;
     ptr()->tags_ = MarkBit::update(true, tags);
   }
+  // The sweeper may clear the mark bit while the isolate is running.
   void ClearMarkBit() {
     ASSERT(IsMarked());
-    uword tags = ptr()->tags_;
-    ptr()->tags_ = MarkBit::update(false, tags);
+    UpdateTags(MarkBit::mask_in_place(), 0);
+  }
+  // Atomically sets the mark bit. Returns false if the object was already
+  // marked, e.g. by another marking thread.
+  bool TryAcquireMarkBit() {
+    uword old_tags;
+    do {
+      old_tags = ptr()->tags_;
+      if (MarkBit::decode(old_tags)) {
+        return false;
+      }
+    } while (!TryUpdateTags(old_tags, MarkBit::update(true, old_tags)));
+    return true;
   }
 
   // Support for GC watched bit.
@@ -271,13 +285,11 @@ class RawObject {
   }
   void SetWatchedBit() {
     ASSERT(!IsWatched());
-    uword tags = ptr()->tags_;
-    ptr()->tags_ = WatchedBit::update(true, tags);
+    UpdateTags(WatchedBit::mask_in_place(), WatchedBit::encode(true));
   }
   void ClearWatchedBit() {
     ASSERT(IsWatched());
-    uword tags = ptr()->tags_;
-    ptr()->tags_ = WatchedBit::update(false, tags);
+    UpdateTags(WatchedBit::mask_in_place(), 0);
   }
 
   // Support for object tags.
@@ -285,15 +297,15 @@ class RawObject {
     return CanonicalObjectTag::decode(ptr()->tags_);
   }
   void SetCanonical() {
-    uword tags = ptr()->tags_;
-    ptr()->tags_ = CanonicalObjectTag::update(true, tags);
+    UpdateTags(CanonicalObjectTag::mask_in_place(),
+               CanonicalObjectTag::encode(true));
   }
   bool IsCreatedFromSnapshot() const {
     return CreatedFromSnapshotTag::decode(ptr()->tags_);
   }
   void SetCreatedFromSnapshot() {
-    uword tags = ptr()->tags_;
-    ptr()->tags_ = CreatedFromSnapshotTag::update(true, tags);
+    UpdateTags(CreatedFromSnapshotTag::mask_in_place(),
+               CreatedFromSnapshotTag::encode(true));
   }
 
   intptr_t Size() const {
@@ -372,15 +384,34 @@ class RawObject {
     return ClassIdTag::decode(tags);
   }
 
+  // The mark and watched bits may be updated by a concurrent marker or sweeper
+  // while the mutator updates other bits in the tags, therefore updates of the
+  // tags of an existing object have to be atomic.
+  bool TryUpdateTags(uword old_tags, uword new_tags) {
+    uword* tags_addr = reinterpret_cast<uword*>(&ptr()->tags_);
+    return AtomicOperations::CompareAndSwapWord(
+        tags_addr, old_tags, new_tags) == old_tags;
+  }
+  void UpdateTags(uword mask, uword bits) {
+    ASSERT((bits & ~mask) == 0);
+    uword old_tags;
+    do {
+      old_tags = ptr()->tags_;
+    } while (!TryUpdateTags(old_tags, (old_tags & ~mask) | bits));
+  }
+
   friend class Api;
   friend class Array;
+  friend class ConcurrentMarker;
   friend class FreeListElement;
+  friend class GCCompactor;
   friend class GCMarker;
   friend class Heap;
   friend class HeapProfiler;
   friend class HeapProfilerRootVisitor;
   friend class MarkingVisitor;
   friend class Object;
+  friend class ParallelScavengerVisitor;
   friend class RawInstructions;
   friend class RawInstance;
   friend class Scavenger;
@@ -432,6 +463,7 @@ class RawClass : public RawObject {
   intptr_t token_pos_;
   uint8_t state_bits_;  // state, is_const, is_interface.
 
+  friend class GCCompactor;
   friend class Instance;
   friend class Object;
   friend class RawInstance;
@@ -548,6 +580,7 @@ class RawFunction : public RawObject {
   int16_t num_fixed_parameters_;
   int16_t num_optional_parameters_;  // > 0: positional; < 0: named.
   uint16_t deoptimization_counter_;
+  uint16_t reoptimization_counter_;
   uint16_t kind_tag_;
 };
 
@@ -923,6 +956,23 @@ class RawSubtypeTestCache : public RawObject {
 };
 
 
+class RawMegamorphicCache : public RawObject {
+  RAW_HEAP_OBJECT_IMPLEMENTATION(MegamorphicCache);
+
+  RawObject** from() {
+    return reinterpret_cast<RawObject**>(&ptr()->buckets_);
+  }
+  RawArray* buckets_;  // Open addressed table of class-ids and targets.
+  RawSmi* mask_;  // Number of buckets minus one, used to reduce class-ids.
+  RawString* target_name_;  // Name of the called functions.
+  RawArray* arguments_descriptor_;  // Arguments of the calls.
+  RawObject** to() {
+    return reinterpret_cast<RawObject**>(&ptr()->arguments_descriptor_);
+  }
+  intptr_t filled_entry_count_;
+};
+
+
 
 class RawError : public RawObject {
   RAW_HEAP_OBJECT_IMPLEMENTATION(Error);
@@ -1334,7 +1384,7 @@ class ExternalByteArrayData {
   ExternalByteArrayData(T* data,
                         void* peer,
                         Dart_PeerFinalizer callback) :
-      data_(data), peer_(peer), callback_(callback) {
+      data_(data), peer_(peer), callback_(callback), transferable_(false) {
   }
   ~ExternalByteArrayData() {
     if (callback_ != NULL) (*callback_)(peer_);
@@ -1346,11 +1396,31 @@ class ExternalByteArrayData {
   void* peer() {
     return peer_;
   }
+  Dart_PeerFinalizer callback() {
+    return callback_;
+  }
+
+  // A transferable array hands its data over to the receiver when it is
+  // sent in a message instead of having it copied.
+  bool transferable() const {
+    return transferable_;
+  }
+  void set_transferable(bool value) {
+    transferable_ = value;
+  }
+
+  // Gives up ownership of the data without finalizing it.
+  void Detach() {
+    data_ = NULL;
+    peer_ = NULL;
+    callback_ = NULL;
+  }
 
  private:
   T* data_;
   void* peer_;
   Dart_PeerFinalizer callback_;
+  bool transferable_;
 };
 
 
@@ -1486,6 +1556,7 @@ class RawWeakProperty : public RawInstance {
 
   friend class GCMarker;
   friend class MarkingVisitor;
+  friend class ParallelScavengerVisitor;
   friend class Scavenger;
   friend class ScavengerVisitor;
 };
@@ -582,6 +582,7 @@ RawFunction* Function::ReadFrom(SnapshotReader* reader,
   func.set_num_fixed_parameters(reader->ReadIntptrValue());
   func.set_num_optional_parameters(reader->ReadIntptrValue());
   func.set_deoptimization_counter(reader->ReadIntptrValue());
+  func.set_reoptimization_counter(reader->ReadIntptrValue());
   func.set_kind_tag(reader->Read<uint16_t>());
 
   // Set all the object fields.
@@ -617,6 +618,7 @@ void RawFunction::WriteTo(SnapshotWriter* writer,
   writer->WriteIntptrValue(ptr()->num_fixed_parameters_);
   writer->WriteIntptrValue(ptr()->num_optional_parameters_);
   writer->WriteIntptrValue(ptr()->deoptimization_counter_);
+  writer->WriteIntptrValue(ptr()->reoptimization_counter_);
   writer->Write<uint16_t>(ptr()->kind_tag_);
 
   // Write out all the object pointer fields.
@@ -1291,6 +1293,22 @@ void RawSubtypeTestCache::WriteTo(SnapshotWriter* writer,
 }
 
 
+RawMegamorphicCache* MegamorphicCache::ReadFrom(SnapshotReader* reader,
+                                                intptr_t object_id,
+                                                intptr_t tags,
+                                                Snapshot::Kind kind) {
+  UNREACHABLE();
+  return NULL;
+}
+
+
+void RawMegamorphicCache::WriteTo(SnapshotWriter* writer,
+                                  intptr_t object_id,
+                                  Snapshot::Kind kind) {
+  UNREACHABLE();
+}
+
+
 RawError* Error::ReadFrom(SnapshotReader* reader,
                           intptr_t object_id,
                           intptr_t tags,
@@ -2102,10 +2120,16 @@ RawExternal##name##Array* External##name##Array::ReadFrom(                     \
   void* peer = reinterpret_cast<void*>(reader->ReadIntptrValue());             \
   Dart_PeerFinalizer callback =                                                \
       reinterpret_cast<Dart_PeerFinalizer>(reader->ReadIntptrValue());         \
+  bool transferable = (reader->ReadIntptrValue() != 0);                        \
   const Class& cls = Class::Handle(                                            \
       reader->isolate()->object_store()->external_##lname##_array_class());    \
-  return NewExternalImpl<External##name##Array, RawExternal##name##Array>(     \
-      cls, data, length, peer, callback, HEAP_SPACE(kind));                    \
+  External##name##Array& result = External##name##Array::ZoneHandle(          \
+      reader->isolate(),                                                       \
+      NewExternalImpl<External##name##Array, RawExternal##name##Array>(        \
+          cls, data, length, peer, callback, HEAP_SPACE(kind)));               \
+  reader->AddBackRef(object_id, &result, kIsDeserialized);                     \
+  result.raw_ptr()->external_data_->set_transferable(transferable);            \
+  return result.raw();                                                         \
 }                                                                              \
 
 
@@ -2165,10 +2189,56 @@ BYTEARRAY_TYPE_LIST(BYTEARRAY_WRITE_TO)
 #undef BYTEARRAY_WRITE_TO
 
 
+// Writes out the external data itself rather than a copy of its contents.
+// The ownership of the data passes to the message, which finalizes it if it
+// is never delivered, so the array is neutered: its length is set to zero
+// and it no longer finalizes the data.
+template<typename T>
+static void ExternalByteArrayTransferTo(SnapshotWriter* writer,
+                                        intptr_t object_id,
+                                        intptr_t external_byte_array_kind,
+                                        intptr_t tags,
+                                        RawSmi** length,
+                                        ExternalByteArrayData<T>* data) {
+  ASSERT(writer != NULL);
+  ASSERT(writer->kind() == Snapshot::kMessage);
+
+  // Write out the serialization header value for this object.
+  writer->WriteInlinedObjectHeader(object_id);
+
+  // Write out the class and tags information.
+  writer->WriteIndexedObject(external_byte_array_kind);
+  writer->WriteIntptrValue(tags);
+
+  // Write out the length field and the external data.
+  writer->Write<RawObject*>(*length);
+  writer->WriteIntptrValue(reinterpret_cast<intptr_t>(data->data()));
+  writer->WriteIntptrValue(reinterpret_cast<intptr_t>(data->peer()));
+  writer->WriteIntptrValue(reinterpret_cast<intptr_t>(data->callback()));
+  writer->WriteIntptrValue(1);  // The data stays transferable.
+
+  // Only message writers produce snapshots of kind kMessage.
+  static_cast<MessageWriter*>(writer)->AddTransferredPeer(data->peer(),
+                                                          data->callback());
+  *length = Smi::New(0);
+  data->Detach();
+}
+
+
 #define EXTERNALARRAY_WRITE_TO(name, lname, type)                              \
 void RawExternal##name##Array::WriteTo(SnapshotWriter* writer,                 \
                                        intptr_t object_id,                     \
                                        Snapshot::Kind kind) {                  \
+  if ((kind == Snapshot::kMessage) &&                                          \
+      ptr()->external_data_->transferable()) {                                 \
+    ExternalByteArrayTransferTo(writer,                                        \
+                                object_id,                                     \
+                                kExternal##name##ArrayCid,                     \
+                                writer->GetObjectTags(this),                   \
+                                &ptr()->length_,                               \
+                                ptr()->external_data_);                        \
+    return;                                                                    \
+  }                                                                            \
   ByteArrayWriteTo(writer,                                                     \
                    object_id,                                                  \
                    kind,                                                       \
@@ -216,7 +216,6 @@ class Scanner : ValueObject {
 
   SourcePosition c0_pos_;      // Source position of lookahead character c0_.
   KeywordTable keywords_[Token::numKeywords];
-  Array& keyword_symbol_table_;  // Access to keyword symbols in object store.
 };
 
 
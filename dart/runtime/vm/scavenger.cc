@@ -8,17 +8,32 @@
 #include <map>
 #include <utility>
 
+#include "vm/atomic.h"
 #include "vm/dart.h"
 #include "vm/dart_api_state.h"
+#include "vm/freelist.h"
 #include "vm/isolate.h"
 #include "vm/object.h"
 #include "vm/stack_frame.h"
 #include "vm/store_buffer.h"
+#include "vm/thread_pool.h"
 #include "vm/verifier.h"
 #include "vm/visitor.h"
 
 namespace dart {
 
+DEFINE_FLAG(int, scavenger_tasks, 1,
+            "Number of tasks copying objects during a scavenge. A single task "
+            "scavenges on the mutator thread only.");
+DEFINE_FLAG(bool, adaptive_new_gen, false,
+            "Grow and shrink the new gen semi spaces based on the survival "
+            "rate and the frequency of scavenges");
+DEFINE_FLAG(int, new_gen_min_semi_space, 256,
+            "Minimum size of an adaptively sized new gen semi space in KB");
+DEFINE_FLAG(int, new_gen_pause_target, 5000,
+            "The desired maximum scavenge pause in microseconds, used to "
+            "size the new gen semi spaces adaptively");
+
 // Scavenger uses RawObject::kFreeBit to distinguish forwaded and non-forwarded
 // objects because scavenger can never encounter free list element during
 // evacuation and thus all objects scavenger encounters have
@@ -50,6 +65,60 @@ static inline void ForwardTo(uword orignal, uword target) {
 }
 
 
+// Visits the slots recorded in a store buffer deduplication set which still
+// refer to objects in the from space. Returns the number of entries in the set.
+static intptr_t VisitStoreBufferSet(HashSet* set,
+                                    MemoryRegion* from,
+                                    ObjectPointerVisitor* visitor,
+                                    intptr_t* duplicates) {
+  intptr_t count = set->Count();
+  intptr_t size = set->Size();
+  intptr_t handled = 0;
+  for (intptr_t i = 0; i < size; i++) {
+    RawObject** pointer = reinterpret_cast<RawObject**>(set->At(i));
+    if (pointer != NULL) {
+      RawObject* value = *pointer;
+      // Skip entries that have been overwritten with Smis.
+      if (value->IsHeapObject()) {
+        if (from->Contains(RawObject::ToAddr(value))) {
+          visitor->VisitPointer(pointer);
+        } else {
+          (*duplicates)++;
+        }
+      }
+      handled++;
+      if (handled == count) {
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+
+// Visits the slots recorded in the store buffer block and resets it. Returns
+// the number of entries in the block.
+static intptr_t VisitStoreBufferBlock(StoreBufferBlock* block,
+                                      MemoryRegion* from,
+                                      ObjectPointerVisitor* visitor,
+                                      intptr_t* duplicates) {
+  intptr_t entries = block->Count();
+  for (intptr_t i = 0; i < entries; i++) {
+    RawObject** pointer = reinterpret_cast<RawObject**>(block->At(i));
+    RawObject* value = *pointer;
+    if (value->IsHeapObject()) {
+      if (from->Contains(RawObject::ToAddr(value))) {
+        visitor->VisitPointer(pointer);
+      } else {
+        (*duplicates)++;
+      }
+    }
+  }
+  block->Reset();
+  return entries;
+}
+
+
 class ScavengerVisitor : public ObjectPointerVisitor {
  public:
   explicit ScavengerVisitor(Isolate* isolate, Scavenger* scavenger)
@@ -160,6 +229,7 @@ class ScavengerVisitor : public ObjectPointerVisitor {
           // If promotion succeeded then we need to remember it so that it can
           // be traversed later.
           scavenger_->PushToPromotedStack(new_addr);
+          scavenger_->promoted_size_ += size;
         } else {
           // Promotion did not succeed. Copy into the to space instead.
           scavenger_->had_promotion_failure_ = true;
@@ -218,6 +288,512 @@ class ScavengerWeakVisitor : public HandleVisitor {
 };
 
 
+// A block of addresses used by the tasks of a parallel scavenge. The blocks
+// are malloced since zones can only be used from the mutator thread.
+class ScavengerWorkBlock {
+ public:
+  static const intptr_t kSize = 62;
+
+  ScavengerWorkBlock() : next_(NULL), top_(0) {}
+
+  ScavengerWorkBlock* next() const { return next_; }
+  void set_next(ScavengerWorkBlock* next) { next_ = next; }
+
+  bool IsEmpty() const { return top_ == 0; }
+  bool IsFull() const { return top_ == kSize; }
+
+  void Push(uword value) {
+    ASSERT(!IsFull());
+    data_[top_++] = value;
+  }
+
+  uword Pop() {
+    ASSERT(!IsEmpty());
+    return data_[--top_];
+  }
+
+  // Pushes value onto the first block of the chain, adding a new block to the
+  // chain if needed.
+  static void PushToChain(ScavengerWorkBlock** chain, uword value) {
+    if ((*chain == NULL) || (*chain)->IsFull()) {
+      ScavengerWorkBlock* block = new ScavengerWorkBlock();
+      block->set_next(*chain);
+      *chain = block;
+    }
+    (*chain)->Push(value);
+  }
+
+  static void DeleteChain(ScavengerWorkBlock* chain) {
+    while (chain != NULL) {
+      ScavengerWorkBlock* next = chain->next();
+      delete chain;
+      chain = next;
+    }
+  }
+
+ private:
+  ScavengerWorkBlock* next_;
+  intptr_t top_;
+  uword data_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(ScavengerWorkBlock);
+};
+
+
+// State shared by the tasks of a parallel scavenge. The locks are used
+// directly since MutexLocker and MonitorLocker register with the current
+// isolate which is shared by all tasks.
+class ParallelScavengerState {
+ public:
+  ParallelScavengerState(intptr_t num_tasks, StoreBuffer::DedupSet* sets)
+      : num_tasks_(num_tasks),
+        num_idle_(0),
+        num_helpers_running_(num_tasks - 1),
+        done_(false),
+        work_(NULL),
+        sets_(sets) {}
+
+  ~ParallelScavengerState() {
+    ASSERT(work_ == NULL);
+    ASSERT(sets_ == NULL);
+    ASSERT(num_helpers_running_ == 0);
+  }
+
+  // Returns the next unclaimed store buffer deduplication set or NULL.
+  StoreBuffer::DedupSet* TakeDedupSet() {
+    monitor_.Enter();
+    StoreBuffer::DedupSet* result = sets_;
+    if (result != NULL) {
+      sets_ = result->next();
+    }
+    monitor_.Exit();
+    return result;
+  }
+
+  // Makes a full block of work available to the other tasks.
+  void PublishWork(ScavengerWorkBlock* block) {
+    monitor_.Enter();
+    block->set_next(work_);
+    work_ = block;
+    if (num_idle_ > 0) {
+      monitor_.Notify();
+    }
+    monitor_.Exit();
+  }
+
+  // Returns a block of published work. Blocks while other tasks may still
+  // publish work and returns NULL once all tasks have run out of work.
+  ScavengerWorkBlock* TakeWork() {
+    monitor_.Enter();
+    while ((work_ == NULL) && !done_) {
+      num_idle_++;
+      if (num_idle_ == num_tasks_) {
+        done_ = true;
+        monitor_.NotifyAll();
+      } else {
+        monitor_.Wait(Monitor::kNoTimeout);
+      }
+      num_idle_--;
+    }
+    ScavengerWorkBlock* result = work_;
+    if (result != NULL) {
+      work_ = result->next();
+      result->set_next(NULL);
+    }
+    monitor_.Exit();
+    return result;
+  }
+
+  void HelperDone() {
+    monitor_.Enter();
+    num_helpers_running_--;
+    if (num_helpers_running_ == 0) {
+      monitor_.NotifyAll();
+    }
+    monitor_.Exit();
+  }
+
+  void WaitForHelpers() {
+    monitor_.Enter();
+    while (num_helpers_running_ > 0) {
+      monitor_.Wait(Monitor::kNoTimeout);
+    }
+    monitor_.Exit();
+  }
+
+  Mutex* promotion_mutex() { return &promotion_mutex_; }
+  Mutex* large_object_mutex() { return &large_object_mutex_; }
+
+ private:
+  Monitor monitor_;
+  const intptr_t num_tasks_;
+  intptr_t num_idle_;
+  intptr_t num_helpers_running_;
+  bool done_;
+  ScavengerWorkBlock* work_;
+  StoreBuffer::DedupSet* sets_;
+
+  // Serializes allocation in the old space.
+  Mutex promotion_mutex_;
+  // Objects too large to have their size encoded in the header are forwarded
+  // under this lock.
+  Mutex large_object_mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelScavengerState);
+};
+
+
+// Visitor used by each task of a parallel scavenge. Objects are claimed by
+// installing the forwarding pointer with a compare and swap of the header.
+// Copies into the to space are allocated from a task local allocation
+// buffer.
+class ParallelScavengerVisitor : public ObjectPointerVisitor {
+ public:
+  static const intptr_t kAllocationBufferSize = 4 * KB;
+  // Larger objects bypass the allocation buffer. This bounds the space
+  // wasted at the end of each buffer.
+  static const intptr_t kMaxBufferedSize = kAllocationBufferSize / 8;
+
+  ParallelScavengerVisitor(Isolate* isolate,
+                           Scavenger* scavenger,
+                           ParallelScavengerState* state)
+      : ObjectPointerVisitor(isolate),
+        scavenger_(scavenger),
+        heap_(scavenger->heap_),
+        state_(state),
+        work_(new ScavengerWorkBlock()),
+        store_buffer_pointers_(NULL),
+        delayed_weak_properties_(NULL),
+        top_(0),
+        end_(0),
+        visiting_old_pointers_(false),
+        had_promotion_failure_(false),
+        entries_(0),
+        duplicates_(0) {}
+
+  ~ParallelScavengerVisitor() {
+    ScavengerWorkBlock::DeleteChain(work_);
+    ScavengerWorkBlock::DeleteChain(store_buffer_pointers_);
+    ScavengerWorkBlock::DeleteChain(delayed_weak_properties_);
+  }
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      ScavengePointer(current);
+    }
+  }
+
+  void VisitStoreBufferBlock(StoreBufferBlock* block) {
+    visiting_old_pointers_ = true;
+    entries_ += dart::VisitStoreBufferBlock(block,
+                                            scavenger_->from_,
+                                            this,
+                                            &duplicates_);
+    visiting_old_pointers_ = false;
+  }
+
+  // Processes unclaimed store buffer sets and then copies objects until all
+  // tasks have run out of work.
+  void Run() {
+    visiting_old_pointers_ = true;
+    StoreBuffer::DedupSet* pending = state_->TakeDedupSet();
+    while (pending != NULL) {
+      entries_ += VisitStoreBufferSet(pending->set(),
+                                      scavenger_->from_,
+                                      this,
+                                      &duplicates_);
+      delete pending;
+      pending = state_->TakeDedupSet();
+    }
+    visiting_old_pointers_ = false;
+    while (true) {
+      while (!work_->IsEmpty()) {
+        ProcessObject(work_->Pop());
+      }
+      ScavengerWorkBlock* block = state_->TakeWork();
+      if (block == NULL) {
+        break;
+      }
+      delete work_;
+      work_ = block;
+    }
+  }
+
+  // Fills the unused part of the allocation buffer so that the to space can
+  // be walked and records the collected old to new pointers in the store
+  // buffer. Called on the mutator thread after all tasks are done.
+  void Finish() {
+    FillAllocationBuffer();
+    StoreBuffer* store_buffer = isolate()->store_buffer();
+    for (ScavengerWorkBlock* block = store_buffer_pointers_;
+         block != NULL;
+         block = block->next()) {
+      while (!block->IsEmpty()) {
+        store_buffer->AddPointer(block->Pop());
+      }
+    }
+  }
+
+  // Hands the weak properties whose keys were not known to be reachable to
+  // the serial visitor.
+  void ProcessDelayedWeakProperties(ScavengerVisitor* visitor) {
+    for (ScavengerWorkBlock* block = delayed_weak_properties_;
+         block != NULL;
+         block = block->next()) {
+      while (!block->IsEmpty()) {
+        RawWeakProperty* raw_weak =
+            reinterpret_cast<RawWeakProperty*>(RawObject::FromAddr(block->Pop()));
+        scavenger_->ProcessWeakProperty(raw_weak, visitor);
+      }
+    }
+  }
+
+  bool had_promotion_failure() const { return had_promotion_failure_; }
+  intptr_t entries() const { return entries_; }
+  intptr_t duplicates() const { return duplicates_; }
+
+ private:
+  void UpdateStoreBuffer(RawObject** p, RawObject* obj) {
+    uword ptr = reinterpret_cast<uword>(p);
+    ASSERT(obj->IsHeapObject());
+    ASSERT(!scavenger_->Contains(ptr));
+    ASSERT(!heap_->CodeContains(ptr));
+    ASSERT(heap_->Contains(ptr));
+    // If the newly written object is not a new object, drop it immediately.
+    if (!obj->IsNewObject()) return;
+    ScavengerWorkBlock::PushToChain(&store_buffer_pointers_, ptr);
+  }
+
+  void ScavengePointer(RawObject** p) {
+    RawObject* raw_obj = *p;
+
+    // Fast exit if the raw object is a Smi or an old object.
+    if (!raw_obj->IsHeapObject() || raw_obj->IsOldObject()) {
+      return;
+    }
+
+    uword raw_addr = RawObject::ToAddr(raw_obj);
+    // The scavenger is only interested in objects located in the from space.
+    if (!scavenger_->from_->Contains(raw_addr)) {
+      return;
+    }
+
+    uword header = *reinterpret_cast<uword*>(raw_addr);
+    uword new_addr = 0;
+    if (IsForwarding(header)) {
+      new_addr = ForwardedAddr(header);
+    } else {
+      ASSERT(!raw_obj->IsWatched());
+      new_addr = CopyObject(raw_addr, header);
+    }
+    // Update the reference.
+    RawObject* new_obj = RawObject::FromAddr(new_addr);
+    *p = new_obj;
+    // Update the store buffer as needed.
+    if (visiting_old_pointers_) {
+      UpdateStoreBuffer(p, new_obj);
+    }
+  }
+
+  // Copies the object at raw_addr unless another task forwards it first.
+  // Returns the address of the copy which wins.
+  uword CopyObject(uword raw_addr, uword header) {
+    // The size is taken from the header read by the caller, as the header
+    // of the original can be replaced by a forwarding pointer at any time.
+    intptr_t size = RawObject::SizeTag::decode(header);
+    if (size == 0) {
+      return CopyLargeObject(raw_addr);
+    }
+    uword new_addr = Allocate(raw_addr, size);
+    memmove(reinterpret_cast<void*>(new_addr),
+            reinterpret_cast<void*>(raw_addr),
+            size);
+    *reinterpret_cast<uword*>(new_addr) = header;
+    uword result = AtomicOperations::CompareAndSwapWord(
+        reinterpret_cast<uword*>(raw_addr), header, new_addr | kForwarded);
+    if (result != header) {
+      // Another task forwarded the object first. Give up this copy.
+      if (top_ == (new_addr + size)) {
+        top_ = new_addr;
+      } else {
+        // The space is reclaimed by the next collection of its space.
+        FreeListElement::AsElement(new_addr, size);
+      }
+      return ForwardedAddr(result);
+    }
+    PushWork(new_addr);
+    return new_addr;
+  }
+
+  uword CopyLargeObject(uword raw_addr) {
+    Mutex* mutex = state_->large_object_mutex();
+    mutex->Lock();
+    uword header = *reinterpret_cast<uword*>(raw_addr);
+    uword new_addr = 0;
+    if (IsForwarding(header)) {
+      new_addr = ForwardedAddr(header);
+    } else {
+      intptr_t size = RawObject::FromAddr(raw_addr)->Size();
+      new_addr = Allocate(raw_addr, size);
+      memmove(reinterpret_cast<void*>(new_addr),
+              reinterpret_cast<void*>(raw_addr),
+              size);
+      AtomicOperations::CompareAndSwapWord(
+          reinterpret_cast<uword*>(raw_addr), header, new_addr | kForwarded);
+      PushWork(new_addr);
+    }
+    mutex->Unlock();
+    return new_addr;
+  }
+
+  uword Allocate(uword raw_addr, intptr_t size) {
+    uword new_addr = 0;
+    if (scavenger_->survivor_end_ > raw_addr) {
+      // This object is a survivor of a previous scavenge. Attempt to promote
+      // the object.
+      new_addr = TryPromote(size, PageSpace::kControlGrowth);
+      if (new_addr == 0) {
+        had_promotion_failure_ = true;
+      }
+    }
+    if (new_addr == 0) {
+      new_addr = TryAllocateInToSpace(size);
+    }
+    if (new_addr == 0) {
+      // Unlike the serial scavenge, the tasks waste some of the to space at
+      // the end of their allocation buffers and in lost races. Promote the
+      // object if it no longer fits.
+      new_addr = TryPromote(size, PageSpace::kForceGrowth);
+      if (new_addr == 0) {
+        FATAL("Exhausted heap space during parallel scavenge.");
+      }
+    }
+    return new_addr;
+  }
+
+  uword TryPromote(intptr_t size, PageSpace::GrowthPolicy growth_policy) {
+    Mutex* mutex = state_->promotion_mutex();
+    mutex->Lock();
+    uword result = heap_->TryAllocate(size, Heap::kOld, growth_policy);
+    if (result != 0) {
+      scavenger_->promoted_size_ += size;
+    }
+    mutex->Unlock();
+    return result;
+  }
+
+  uword TryAllocateInToSpace(intptr_t size) {
+    if (static_cast<intptr_t>(end_ - top_) >= size) {
+      uword result = top_;
+      top_ += size;
+      return result;
+    }
+    if (size > kMaxBufferedSize) {
+      // Allocate larger objects directly to keep the allocation buffer.
+      return scavenger_->TryAllocateShared(size);
+    }
+    FillAllocationBuffer();
+    uword buffer = scavenger_->TryAllocateShared(kAllocationBufferSize);
+    intptr_t buffer_size = kAllocationBufferSize;
+    if (buffer == 0) {
+      buffer = scavenger_->TryAllocateShared(size);
+      buffer_size = size;
+    }
+    if (buffer == 0) {
+      return 0;
+    }
+    top_ = buffer + size;
+    end_ = buffer + buffer_size;
+    return buffer;
+  }
+
+  void FillAllocationBuffer() {
+    if (top_ < end_) {
+      FreeListElement::AsElement(top_, end_ - top_);
+    }
+    top_ = 0;
+    end_ = 0;
+  }
+
+  void PushWork(uword addr) {
+    if (work_->IsFull()) {
+      state_->PublishWork(work_);
+      work_ = new ScavengerWorkBlock();
+    }
+    work_->Push(addr);
+  }
+
+  void ProcessObject(uword addr) {
+    RawObject* raw_obj = RawObject::FromAddr(addr);
+    if (!scavenger_->to_->Contains(addr)) {
+      // Promoted objects may now contain old to new pointers.
+      visiting_old_pointers_ = true;
+      raw_obj->VisitPointers(this);
+      visiting_old_pointers_ = false;
+      return;
+    }
+    if (raw_obj->GetClassId() == kWeakPropertyCid) {
+      RawWeakProperty* raw_weak = reinterpret_cast<RawWeakProperty*>(raw_obj);
+      RawObject* raw_key = raw_weak->ptr()->key_;
+      if (raw_key->IsHeapObject() && raw_key->IsNewObject()) {
+        uword header = *reinterpret_cast<uword*>(RawObject::ToAddr(raw_key));
+        if (!IsForwarding(header)) {
+          // Key is not known to be reachable yet. Leave the weak property to
+          // the serial visitor.
+          ScavengerWorkBlock::PushToChain(&delayed_weak_properties_, addr);
+          return;
+        }
+      }
+    }
+    raw_obj->VisitPointers(this);
+  }
+
+  Scavenger* scavenger_;
+  Heap* heap_;
+  ParallelScavengerState* state_;
+
+  ScavengerWorkBlock* work_;
+  ScavengerWorkBlock* store_buffer_pointers_;
+  ScavengerWorkBlock* delayed_weak_properties_;
+
+  // Allocation buffer in the to space.
+  uword top_;
+  uword end_;
+
+  bool visiting_old_pointers_;
+  bool had_promotion_failure_;
+
+  intptr_t entries_;
+  intptr_t duplicates_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelScavengerVisitor);
+};
+
+
+class ParallelScavengerTask : public ThreadPool::Task {
+ public:
+  ParallelScavengerTask(Isolate* isolate,
+                        ParallelScavengerVisitor* visitor,
+                        ParallelScavengerState* state)
+      : isolate_(isolate), visitor_(visitor), state_(state) {}
+
+  virtual void Run() {
+    // Object sizes and class ids are looked up through the current isolate.
+    Isolate::SetCurrent(isolate_);
+    visitor_->Run();
+    Isolate::SetCurrent(NULL);
+    state_->HelperDone();
+  }
+
+ private:
+  Isolate* isolate_;
+  ParallelScavengerVisitor* visitor_;
+  ParallelScavengerState* state_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelScavengerTask);
+};
+
+
 // Visitor used to verify that all old->new references have been added to the
 // StoreBuffers.
 class VerifyStoreBufferPointerVisitor : public ObjectPointerVisitor {
@@ -244,8 +820,12 @@ class VerifyStoreBufferPointerVisitor : public ObjectPointerVisitor {
 Scavenger::Scavenger(Heap* heap, intptr_t max_capacity, uword object_alignment)
     : heap_(heap),
       object_alignment_(object_alignment),
+      semi_space_size_(0),
+      last_scavenge_end_(0),
       count_(0),
-      scavenging_(false) {
+      scavenging_(false),
+      had_promotion_failure_(false),
+      promoted_size_(0) {
   // Verify assumptions about the first word in objects which the scavenger is
   // going to use for forwarding pointers.
   ASSERT(Object::tags_offset() == 0);
@@ -276,6 +856,18 @@ Scavenger::Scavenger(Heap* heap, intptr_t max_capacity, uword object_alignment)
 
   survivor_end_ = FirstObjectStart();
 
+  semi_space_size_ = semi_space_size;
+  if (FLAG_adaptive_new_gen) {
+    // Start small and let the survival rate grow the semi spaces.
+    intptr_t initial_size = Utils::RoundUp(semi_space_size / 8,
+                                           VirtualMemory::PageSize());
+    semi_space_size_ = Utils::Maximum(
+        initial_size, static_cast<intptr_t>(FLAG_new_gen_min_semi_space) * KB);
+    semi_space_size_ = Utils::Minimum(semi_space_size_,
+                                      static_cast<intptr_t>(semi_space_size));
+    SetAllocationEnd();
+  }
+
 #if defined(DEBUG)
   memset(to_->pointer(), 0xf3, to_->size());
   memset(from_->pointer(), 0xf3, from_->size());
@@ -332,29 +924,7 @@ void Scavenger::IterateStoreBuffers(Isolate* isolate,
   intptr_t duplicates = 0;
   while (pending != NULL) {
     StoreBuffer::DedupSet* next = pending->next();
-    HashSet* set = pending->set();
-    intptr_t count = set->Count();
-    intptr_t size = set->Size();
-    intptr_t handled = 0;
-    entries += count;
-    for (intptr_t i = 0; i < size; i++) {
-      RawObject** pointer = reinterpret_cast<RawObject**>(set->At(i));
-      if (pointer != NULL) {
-        RawObject* value = *pointer;
-        // Skip entries that have been overwritten with Smis.
-        if (value->IsHeapObject()) {
-          if (from_->Contains(RawObject::ToAddr(value))) {
-            visitor->VisitPointer(pointer);
-          } else {
-            duplicates++;
-          }
-        }
-        handled++;
-        if (handled == count) {
-          break;
-        }
-      }
-    }
+    entries += VisitStoreBufferSet(pending->set(), from_, visitor, &duplicates);
     delete pending;
     pending = next;
   }
@@ -362,27 +932,23 @@ void Scavenger::IterateStoreBuffers(Isolate* isolate,
     OS::PrintErr("StoreBuffer: %"Pd", %"Pd" (entries, dups)\n",
                  entries, duplicates);
   }
-  StoreBufferBlock* block = isolate->store_buffer_block();
-  entries = block->Count();
   duplicates = 0;
-  for (intptr_t i = 0; i < entries; i++) {
-    RawObject** pointer = reinterpret_cast<RawObject**>(block->At(i));
-    RawObject* value = *pointer;
-    if (value->IsHeapObject()) {
-      if (from_->Contains(RawObject::ToAddr(value))) {
-        visitor->VisitPointer(pointer);
-      } else {
-        duplicates++;
-      }
-    }
-  }
-  block->Reset();
+  entries = VisitStoreBufferBlock(isolate->store_buffer_block(),
+                                  from_,
+                                  visitor,
+                                  &duplicates);
   if (FLAG_verbose_gc) {
     OS::PrintErr("StoreBufferBlock: %"Pd", %"Pd" (entries, dups)\n",
                  entries, duplicates);
   }
   // Done iterating through the store buffers.
   visitor->VisitingOldPointers(false);
+  // The slots covered by dirty cards are not recorded in the store buffer,
+  // the cards stay dirty as long as they refer to new objects.
+  intptr_t dirty_cards = heap_->IterateDirtyCards(visitor);
+  if (FLAG_verbose_gc) {
+    OS::PrintErr("Cards: %"Pd" (dirty)\n", dirty_cards);
+  }
 }
 
 
@@ -396,6 +962,77 @@ void Scavenger::IterateRoots(Isolate* isolate,
 }
 
 
+void Scavenger::ParallelScavenge(Isolate* isolate,
+                                 ScavengerVisitor* visitor,
+                                 bool visit_prologue_weak_persistent_handles) {
+  const intptr_t num_tasks = FLAG_scavenger_tasks;
+  ParallelScavengerState state(num_tasks,
+                               isolate->store_buffer()->DedupSets());
+  ParallelScavengerVisitor** visitors =
+      new ParallelScavengerVisitor*[num_tasks];
+  for (intptr_t i = 0; i < num_tasks; i++) {
+    visitors[i] = new ParallelScavengerVisitor(isolate, this, &state);
+  }
+  // The dirty cards are visited before the helpers start promoting objects,
+  // which may add to the large pages.
+  intptr_t dirty_cards = heap_->IterateDirtyCards(visitors[0]);
+  isolate->IncrementGCHelpers();
+  for (intptr_t i = 1; i < num_tasks; i++) {
+    Dart::thread_pool()->RunHelper(
+        new ParallelScavengerTask(isolate, visitors[i], &state));
+  }
+  // The mutator thread takes part as the first task after visiting the roots
+  // which can only be visited from this thread.
+  visitors[0]->VisitStoreBufferBlock(isolate->store_buffer_block());
+  isolate->VisitObjectPointers(visitors[0],
+                               visit_prologue_weak_persistent_handles,
+                               StackFrameIterator::kDontValidateFrames);
+  visitors[0]->Run();
+  state.WaitForHelpers();
+  isolate->DecrementGCHelpers();
+
+  intptr_t entries = 0;
+  intptr_t duplicates = 0;
+  for (intptr_t i = 0; i < num_tasks; i++) {
+    visitors[i]->Finish();
+    entries += visitors[i]->entries();
+    duplicates += visitors[i]->duplicates();
+    if (visitors[i]->had_promotion_failure()) {
+      had_promotion_failure_ = true;
+    }
+  }
+  if (FLAG_verbose_gc) {
+    OS::PrintErr("StoreBuffer: %"Pd", %"Pd" (entries, dups, %"Pd" tasks)\n",
+                 entries, duplicates, num_tasks);
+    OS::PrintErr("Cards: %"Pd" (dirty)\n", dirty_cards);
+  }
+  // Everything below top_ has been scanned. The serial visitor continues from
+  // here.
+  resolved_top_ = top_;
+  for (intptr_t i = 0; i < num_tasks; i++) {
+    visitors[i]->ProcessDelayedWeakProperties(visitor);
+    delete visitors[i];
+  }
+  delete[] visitors;
+  ProcessToSpace(visitor);
+}
+
+
+uword Scavenger::TryAllocateShared(intptr_t size) {
+  ASSERT(Utils::IsAligned(size, kObjectAlignment));
+  uword top = top_;
+  while (static_cast<intptr_t>(end_ - top) >= size) {
+    uword old_top = AtomicOperations::CompareAndSwapWord(&top_, top, top + size);
+    if (old_top == top) {
+      ASSERT((top & kObjectAlignmentMask) == object_alignment_);
+      return top;
+    }
+    top = old_top;
+  }
+  return 0;
+}
+
+
 bool Scavenger::IsUnreachable(RawObject** p) {
   RawObject* raw_obj = *p;
   if (!raw_obj->IsHeapObject()) {
@@ -571,6 +1208,7 @@ void Scavenger::Scavenge(bool invoke_api_callbacks, const char* gc_reason) {
   ASSERT(!scavenging_);
   scavenging_ = true;
   had_promotion_failure_ = false;
+  promoted_size_ = 0;
   Isolate* isolate = Isolate::Current();
   NoHandleScope no_handles(isolate);
 
@@ -585,18 +1223,37 @@ void Scavenger::Scavenge(bool invoke_api_callbacks, const char* gc_reason) {
   }
   Timer timer(FLAG_verbose_gc, "Scavenge");
   timer.Start();
+  intptr_t in_use_before = in_use();
+  int64_t start = OS::GetCurrentTimeMicros();
   // Setup the visitor and run a scavenge.
   ScavengerVisitor visitor(isolate, this);
   Prologue(isolate, invoke_api_callbacks);
-  IterateRoots(isolate, &visitor, !invoke_api_callbacks);
-  ProcessToSpace(&visitor);
+  if ((FLAG_scavenger_tasks > 1) && (Dart::thread_pool() != NULL)) {
+    ParallelScavenge(isolate, &visitor, !invoke_api_callbacks);
+  } else {
+    IterateRoots(isolate, &visitor, !invoke_api_callbacks);
+    ProcessToSpace(&visitor);
+  }
   IterateWeakReferences(isolate, &visitor);
   ScavengerWeakVisitor weak_visitor(this);
   IterateWeakRoots(isolate, &weak_visitor, invoke_api_callbacks);
   visitor.Finalize();
   ProcessPeerReferents();
   Epilogue(isolate, invoke_api_callbacks);
+  if (FLAG_adaptive_new_gen) {
+    AdaptSemiSpaceSize(in_use_before, start, OS::GetCurrentTimeMicros());
+  }
+  SetAllocationEnd();
   timer.Stop();
+  GCEvent event;
+  event.space = Heap::kNew;
+  event.reason = gc_reason;
+  event.start = start;
+  event.end = OS::GetCurrentTimeMicros();
+  event.used_before = in_use_before;
+  event.used_after = in_use();
+  event.promoted = promoted_size_;
+  heap_->RecordGCEvent(event);
   if (FLAG_verbose_gc) {
     OS::PrintErr("Scavenge[%d]: %"Pd64"us\n",
                  count_,
@@ -616,6 +1273,65 @@ void Scavenger::Scavenge(bool invoke_api_callbacks, const char* gc_reason) {
 }
 
 
+void Scavenger::AdaptSemiSpaceSize(intptr_t in_use_before,
+                                   int64_t start,
+                                   int64_t end) {
+  // Survival above kGrowSurvivalRatio percent or spending more than
+  // kGrowTimeRatio percent of the time scavenging grows the semi space. It
+  // is shrunk when survival and scavenging time drop below the shrink ratios
+  // or when the pause target is missed.
+  const int kGrowSurvivalRatio = 25;
+  const int kShrinkSurvivalRatio = 5;
+  const int kGrowTimeRatio = 10;
+  const int kShrinkTimeRatio = 1;
+
+  intptr_t survived = in_use();
+  int survival_ratio = (in_use_before == 0) ?
+      0 : static_cast<int>((100 * survived) / in_use_before);
+  int64_t pause = end - start;
+  int time_ratio = 0;
+  if (last_scavenge_end_ != 0) {
+    int64_t interval = end - last_scavenge_end_;
+    time_ratio = (interval == 0) ? 100 : static_cast<int>((100 * pause) /
+                                                           interval);
+  }
+  last_scavenge_end_ = end;
+
+  intptr_t new_size = semi_space_size_;
+  if (pause > FLAG_new_gen_pause_target) {
+    new_size = semi_space_size_ / 2;
+  } else if (had_promotion_failure_ ||
+             (survival_ratio >= kGrowSurvivalRatio) ||
+             (time_ratio >= kGrowTimeRatio)) {
+    new_size = semi_space_size_ * 2;
+  } else if ((survival_ratio < kShrinkSurvivalRatio) &&
+             (time_ratio < kShrinkTimeRatio)) {
+    new_size = semi_space_size_ / 2;
+  }
+  // Keep room for at least as much allocation as has survived.
+  intptr_t min_size = Utils::Maximum(
+      static_cast<intptr_t>(FLAG_new_gen_min_semi_space) * KB, 2 * survived);
+  new_size = Utils::Maximum(new_size, min_size);
+  new_size = Utils::RoundUp(new_size, VirtualMemory::PageSize());
+  new_size = Utils::Minimum(new_size, static_cast<intptr_t>(to_->size()));
+
+  if (FLAG_verbose_gc) {
+    OS::PrintErr("Scavenger: survival %d%%, pause %"Pd64"us, "
+                 "time %d%% (semi space %"Pd"K -> %"Pd"K)\n",
+                 survival_ratio, pause, time_ratio,
+                 semi_space_size_ / KB, new_size / KB);
+  }
+  semi_space_size_ = new_size;
+}
+
+
+void Scavenger::SetAllocationEnd() {
+  uword end = to_->start() + semi_space_size_;
+  ASSERT(end <= to_->end());
+  end_ = Utils::Maximum(end, top_);
+}
+
+
 void Scavenger::WriteProtect(bool read_only) {
   space_->Protect(
       read_only ? VirtualMemory::kReadOnly : VirtualMemory::kReadWrite);
@@ -20,9 +20,13 @@ namespace dart {
 // Forward declarations.
 class Heap;
 class Isolate;
+class ParallelScavengerVisitor;
 class ScavengerVisitor;
 
 DECLARE_FLAG(bool, gc_at_alloc);
+DECLARE_FLAG(int, scavenger_tasks);
+DECLARE_FLAG(bool, adaptive_new_gen);
+DECLARE_FLAG(int, new_gen_pause_target);
 
 class Scavenger {
  public:
@@ -74,6 +78,11 @@ class Scavenger {
   intptr_t in_use() const { return (top_ - FirstObjectStart()); }
   intptr_t capacity() const { return space_->size(); }
 
+  // The part of the semi space objects are allocated in. With adaptive
+  // sizing it changes after each scavenge, otherwise it is the whole semi
+  // space.
+  intptr_t semi_space_size() const { return semi_space_size_; }
+
   void VisitObjects(ObjectVisitor* visitor) const;
   void VisitObjectPointers(ObjectPointerVisitor* visitor) const;
 
@@ -108,10 +117,24 @@ class Scavenger {
                         HandleVisitor* visitor,
                         bool visit_prologue_weak_persistent_handles);
   void ProcessToSpace(ScavengerVisitor* visitor);
+  // Copies the objects reachable from the roots using several tasks. The
+  // remaining work, e.g. weak properties, is left to the serial visitor.
+  void ParallelScavenge(Isolate* isolate,
+                        ScavengerVisitor* visitor,
+                        bool visit_prologue_weak_persistent_handles);
+  // Allocates size bytes in the to space, safe to call from several threads
+  // at once. Returns 0 if the to space is exhausted.
+  uword TryAllocateShared(intptr_t size);
   uword ProcessWeakProperty(RawWeakProperty* raw_weak,
                             ScavengerVisitor* visitor);
   void Epilogue(Isolate* isolate, bool invoke_api_callbacks);
 
+  // Grows or shrinks the semi space based on the survival rate, the pause
+  // time and the fraction of time spent scavenging.
+  void AdaptSemiSpaceSize(intptr_t in_use_before, int64_t start, int64_t end);
+  // Limits the allocation in the to space to the semi space size.
+  void SetAllocationEnd();
+
   bool IsUnreachable(RawObject** p);
 
   // During a scavenge we need to remember the promoted objects.
@@ -159,13 +182,20 @@ class Scavenger {
   // All object are aligned to this value.
   uword object_alignment_;
 
+  intptr_t semi_space_size_;
+  // End of the previous scavenge in microseconds, zero before the first one.
+  int64_t last_scavenge_end_;
+
   // Scavenge cycle count.
   int count_;
   // Keep track whether a scavenge is currently running.
   bool scavenging_;
   // Keep track whether the scavenge had a promotion failure.
   bool had_promotion_failure_;
+  // The number of bytes promoted by the current scavenge.
+  intptr_t promoted_size_;
 
+  friend class ParallelScavengerVisitor;
   friend class ScavengerVisitor;
   friend class ScavengerWeakVisitor;
 
@@ -889,6 +889,8 @@ void FullSnapshotWriter::WriteFullSnapshot() {
   ASSERT(isolate != NULL);
   ObjectStore* object_store = isolate->object_store();
   ASSERT(object_store != NULL);
+  // Marked objects are written as VM isolate objects.
+  isolate->heap()->FinishSweeping();
 
   // Reserve space in the output buffer for a snapshot header.
   ReserveHeader();
@@ -1155,6 +1157,8 @@ void SnapshotWriter::ArrayWriteTo(intptr_t object_id,
 
 void ScriptSnapshotWriter::WriteScriptSnapshot(const Library& lib) {
   ASSERT(kind() == Snapshot::kScript);
+  // Marked objects are written as VM isolate objects.
+  Isolate::Current()->heap()->FinishSweeping();
 
   // Write out the library object.
   ReserveHeader();
@@ -1178,6 +1182,8 @@ void SnapshotWriterVisitor::VisitPointers(RawObject** first, RawObject** last) {
 
 void MessageWriter::WriteMessage(const Object& obj) {
   ASSERT(kind() == Snapshot::kMessage);
+  // Marked objects are written as VM isolate objects.
+  Isolate::Current()->heap()->FinishSweeping();
   WriteObject(obj.raw());
   UnmarkAll();
 }
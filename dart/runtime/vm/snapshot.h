@@ -12,6 +12,7 @@
 #include "vm/globals.h"
 #include "vm/growable_array.h"
 #include "vm/isolate.h"
+#include "vm/message.h"
 #include "vm/visitor.h"
 
 namespace dart {
@@ -544,15 +545,34 @@ class MessageWriter : public SnapshotWriter {
  public:
   static const intptr_t kIncrementSize = 512;
   MessageWriter(uint8_t** buffer, ReAlloc alloc)
-      : SnapshotWriter(Snapshot::kMessage, buffer, alloc, kIncrementSize) {
+      : SnapshotWriter(Snapshot::kMessage, buffer, alloc, kIncrementSize),
+        transferred_peers_(NULL) {
     ASSERT(buffer != NULL);
     ASSERT(alloc != NULL);
   }
-  ~MessageWriter() { }
+  ~MessageWriter() {
+    // Transferred data which is not handed over to a message is finalized.
+    Message::TransferredPeer::DeleteList(transferred_peers_, true);
+  }
 
   void WriteMessage(const Object& obj);
 
+  // Records external data whose ownership is transferred by the message.
+  void AddTransferredPeer(void* peer, Dart_PeerFinalizer callback) {
+    transferred_peers_ =
+        new Message::TransferredPeer(peer, callback, transferred_peers_);
+  }
+
+  // Hands the transferred data over to the caller, usually a Message.
+  Message::TransferredPeer* TakeTransferredPeers() {
+    Message::TransferredPeer* result = transferred_peers_;
+    transferred_peers_ = NULL;
+    return result;
+  }
+
  private:
+  Message::TransferredPeer* transferred_peers_;
+
   DISALLOW_COPY_AND_ASSIGN(MessageWriter);
 };
 
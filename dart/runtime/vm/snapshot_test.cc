@@ -657,6 +657,93 @@ TEST_CASE(SerializeEmptyByteArray) {
 }
 
 
+static void TransferableByteArrayFinalizer(void* peer) {
+  *static_cast<int*>(peer) += 1;
+}
+
+
+TEST_CASE(SerializeTransferableExternalByteArray) {
+  int peer = 0;
+  uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  const intptr_t kByteArrayLength = ARRAY_SIZE(data);
+  {
+    StackZone zone(Isolate::Current());
+
+    // Write snapshot with object content.
+    uint8_t* buffer;
+    MessageWriter writer(&buffer, &zone_allocator);
+    const ExternalUint8Array& byte_array = ExternalUint8Array::Handle(
+        ExternalUint8Array::New(data, kByteArrayLength,
+                                &peer, TransferableByteArrayFinalizer));
+    byte_array.SetTransferable();
+    writer.WriteMessage(byte_array);
+    intptr_t buffer_len = writer.BytesWritten();
+
+    // The sent array has been neutered.
+    EXPECT_EQ(0, byte_array.Length());
+    EXPECT(byte_array.GetPeer() == NULL);
+
+    // Read object back from the snapshot, it refers to the same data.
+    SnapshotReader reader(buffer, buffer_len,
+                          Snapshot::kMessage, Isolate::Current());
+    ExternalUint8Array& serialized_byte_array = ExternalUint8Array::Handle();
+    serialized_byte_array ^= reader.ReadObject();
+    EXPECT(serialized_byte_array.IsExternalUint8Array());
+    EXPECT(serialized_byte_array.IsTransferable());
+    EXPECT_EQ(kByteArrayLength, serialized_byte_array.Length());
+    EXPECT(serialized_byte_array.GetPeer() == &peer);
+    for (intptr_t i = 0; i < kByteArrayLength; i++) {
+      EXPECT_EQ(i + 1, serialized_byte_array.At(i));
+    }
+    serialized_byte_array.SetAt(0, 42);
+    EXPECT_EQ(42, data[0]);
+
+    // The reader has taken over the data.
+    Message::TransferredPeer* transferred = writer.TakeTransferredPeers();
+    EXPECT(transferred != NULL);
+    EXPECT(transferred->peer() == &peer);
+    EXPECT(transferred->next() == NULL);
+    Message::TransferredPeer::DeleteList(transferred, false);
+  }
+  // Only the receiving array finalizes the data.
+  EXPECT_EQ(0, peer);
+  Isolate::Current()->heap()->CollectGarbage(Heap::kNew);
+  EXPECT_EQ(1, peer);
+
+  {
+    StackZone zone(Isolate::Current());
+
+    // Write snapshot with object content.
+    uint8_t* buffer;
+    MessageWriter writer(&buffer, &zone_allocator);
+    const ExternalUint8Array& byte_array = ExternalUint8Array::Handle(
+        ExternalUint8Array::New(data, kByteArrayLength,
+                                &peer, TransferableByteArrayFinalizer));
+    byte_array.SetTransferable();
+    writer.WriteMessage(byte_array);
+    intptr_t buffer_len = writer.BytesWritten();
+    EXPECT_EQ(0, byte_array.Length());
+
+    // Read object back from the snapshot into a C structure, which takes
+    // over the data.
+    ApiNativeScope scope;
+    ApiMessageReader api_reader(buffer, buffer_len, &zone_allocator);
+    Dart_CObject* root = api_reader.ReadMessage();
+    EXPECT_EQ(Dart_CObject::kExternalUint8Array, root->type);
+    EXPECT_EQ(kByteArrayLength, root->value.as_external_byte_array.length);
+    EXPECT(root->value.as_external_byte_array.data == data);
+    EXPECT(root->value.as_external_byte_array.peer == &peer);
+    EXPECT(root->value.as_external_byte_array.callback ==
+           TransferableByteArrayFinalizer);
+    Message::TransferredPeer::DeleteList(writer.TakeTransferredPeers(), false);
+    root->value.as_external_byte_array.callback(
+        root->value.as_external_byte_array.peer);
+  }
+  Isolate::Current()->heap()->CollectGarbage(Heap::kNew);
+  EXPECT_EQ(2, peer);
+}
+
+
 class TestSnapshotWriter : public SnapshotWriter {
  public:
   static const intptr_t kIncrementSize = 64 * KB;
@@ -5,6 +5,9 @@
 #include "vm/store_buffer.h"
 
 #include "platform/assert.h"
+#include "vm/gc_marker.h"
+#include "vm/heap.h"
+#include "vm/pages.h"
 #include "vm/runtime_entry.h"
 
 namespace dart {
@@ -15,6 +18,12 @@ DEFINE_LEAF_RUNTIME_ENTRY(void, StoreBufferBlockProcess, Isolate* isolate) {
 END_LEAF_RUNTIME_ENTRY
 
 
+DEFINE_LEAF_RUNTIME_ENTRY(void, MarkingBarrierBlockProcess, Isolate* isolate) {
+  isolate->marking_barrier_block()->ProcessBuffer(isolate);
+}
+END_LEAF_RUNTIME_ENTRY
+
+
 void StoreBufferBlock::ProcessBuffer() {
   ProcessBuffer(Isolate::Current());
 }
@@ -40,6 +49,19 @@ bool StoreBufferBlock::Contains(uword pointer) {
 }
 
 
+void MarkingBarrierBlock::ProcessBuffer() {
+  ProcessBuffer(Isolate::Current());
+}
+
+
+void MarkingBarrierBlock::ProcessBuffer(Isolate* isolate) {
+  ConcurrentMarker* marker = isolate->heap()->concurrent_marker();
+  ASSERT(marker != NULL);
+  marker->AddBarrierObjects(pointers_, top_);
+  top_ = 0;  // Reset back to the beginning.
+}
+
+
 StoreBuffer::~StoreBuffer() {
   DedupSet* current = dedup_sets_;
   dedup_sets_ = NULL;
@@ -76,4 +98,14 @@ void StoreBuffer::AddPointer(uword address) {
   }
 }
 
+
+void StoreBuffer::AddObjectPointer(RawObject* raw_obj, uword address) {
+  HeapPage* page = PageSpace::PageFor(raw_obj);
+  if (page->is_card_marked()) {
+    page->MarkCard(address);
+  } else {
+    AddPointer(address);
+  }
+}
+
 }  // namespace dart
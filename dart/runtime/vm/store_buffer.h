@@ -13,6 +13,7 @@ namespace dart {
 
 // Forward declarations.
 class Isolate;
+class RawObject;
 
 class StoreBufferBlock {
  public:
@@ -62,6 +63,60 @@ class StoreBufferBlock {
 };
 
 
+// While a concurrent marker is running, the write barrier records the old
+// objects that are stored into. The marker revisits these objects to find
+// pointers to unmarked objects stored into already visited objects.
+class MarkingBarrierBlock {
+ public:
+  // Each block contains kSize objects.
+  static const int32_t kSize = 1024;
+
+  MarkingBarrierBlock() : is_active_(0), top_(0) {}
+
+  static int is_active_offset() {
+    return OFFSET_OF(MarkingBarrierBlock, is_active_);
+  }
+  static int top_offset() { return OFFSET_OF(MarkingBarrierBlock, top_); }
+  static int pointers_offset() {
+    return OFFSET_OF(MarkingBarrierBlock, pointers_);
+  }
+
+  bool is_active() const { return is_active_ != 0; }
+  void set_is_active(bool value) { is_active_ = value ? 1 : 0; }
+
+  void Reset() { top_ = 0; }
+
+  intptr_t Count() const { return top_; }
+
+  uword At(intptr_t i) const {
+    ASSERT(i >= 0);
+    ASSERT(i < top_);
+    return pointers_[i];
+  }
+
+  // Add an object to the block. The block will be handed to the concurrent
+  // marker if it has been filled by this operation.
+  void AddObject(RawObject* raw_obj) {
+    ASSERT(top_ < kSize);
+    pointers_[top_++] = reinterpret_cast<uword>(raw_obj);
+    if (top_ == kSize) {
+      ProcessBuffer();
+    }
+  }
+
+  // Hand the contents of this block to the concurrent marker.
+  void ProcessBuffer();
+  void ProcessBuffer(Isolate* isolate);
+
+ private:
+  int32_t is_active_;
+  int32_t top_;
+  uword pointers_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(MarkingBarrierBlock);
+};
+
+
 class StoreBuffer {
  public:
   // Simple linked list element containing a HashSet of old->new pointers.
@@ -95,6 +150,10 @@ class StoreBuffer {
 
   void AddPointer(uword address);
 
+  // Remembers a slot of the old object raw_obj referring to a new object.
+  // Slots of objects on card marked pages dirty their card instead.
+  void AddObjectPointer(RawObject* raw_obj, uword address);
+
   void ProcessBlock(StoreBufferBlock* block);
 
   DedupSet* DedupSets() {
@@ -39,6 +39,7 @@ class RawCode;
   V(GetStackPointer)                                                           \
   V(JumpToExceptionHandler)                                                    \
   V(JumpToErrorHandler)                                                        \
+  V(MegamorphicLookup)                                                         \
 
 // Is it permitted for the stubs above to refer to Object::null(), which is
 // allocated in the VM isolate and shared across all isolates.
@@ -52,6 +53,7 @@ class RawCode;
   V(InvokeDartCode)                                                            \
   V(AllocateContext)                                                           \
   V(UpdateStoreBuffer)                                                         \
+  V(MarkingBarrier)                                                            \
   V(OneArgCheckInlineCache)                                                    \
   V(TwoArgsCheckInlineCache)                                                   \
   V(ThreeArgsCheckInlineCache)                                                 \
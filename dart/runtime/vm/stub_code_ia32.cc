@@ -476,6 +476,92 @@ void StubCode::GenerateInstanceFunctionLookupStub(Assembler* assembler) {
 }
 
 
+// Probes the megamorphic cache of the call for the class of the receiver and
+// jumps to the cached target. On a miss the target is resolved and added to
+// the cache; calls that cannot be resolved continue in the instance function
+// lookup stub.
+// Input parameters:
+//   ECX: ic-data.
+//   EDX: arguments descriptor array (num_args is first Smi element).
+//   EBX: megamorphic cache.
+// Uses EDI.
+void StubCode::GenerateMegamorphicLookupStub(Assembler* assembler) {
+  const Immediate raw_null =
+      Immediate(reinterpret_cast<intptr_t>(Object::null()));
+  // Load the receiver's class id as Smi into EAX.
+  __ movl(EAX, FieldAddress(EDX, Array::data_offset()));
+  __ movl(EAX, Address(ESP, EAX, TIMES_2, 0));  // EAX (argument_count) is Smi.
+  Label not_smi, probe;
+  __ testl(EAX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &not_smi, Assembler::kNearJump);
+  __ movl(EAX, Immediate(Smi::RawValue(kSmiCid)));
+  __ jmp(&probe, Assembler::kNearJump);
+  __ Bind(&not_smi);
+  __ LoadClassId(EAX, EAX);
+  __ SmiTag(EAX);
+
+  __ Bind(&probe);
+  // EAX: receiver's class id as Smi.
+  __ pushl(ECX);  // Preserve ic-data.
+  __ pushl(EDX);  // Preserve arguments descriptor array.
+  __ movl(EDX, FieldAddress(EBX, MegamorphicCache::buckets_offset()));
+  __ movl(ECX, FieldAddress(EBX, MegamorphicCache::mask_offset()));
+  // EDX: buckets array, ECX: mask as Smi.
+  __ movl(EDI, EAX);
+  const intptr_t class_id_offset = Array::data_offset() +
+      MegamorphicCache::kClassIdIndex * kWordSize;
+  const intptr_t target_offset = Array::data_offset() +
+      MegamorphicCache::kTargetFunctionIndex * kWordSize;
+  Label loop, found, miss, call_target_function;
+  __ Bind(&loop);
+  __ andl(EDI, ECX);
+  // EDI: bucket index as Smi. A bucket has two array elements, so scaling the
+  // Smi by 4 yields the byte offset of the bucket.
+  __ cmpl(EAX, FieldAddress(EDX, EDI, TIMES_4, class_id_offset));
+  __ j(EQUAL, &found, Assembler::kNearJump);
+  ASSERT(kIllegalCid == 0);
+  __ cmpl(FieldAddress(EDX, EDI, TIMES_4, class_id_offset), Immediate(0));
+  __ j(EQUAL, &miss, Assembler::kNearJump);
+  __ addl(EDI, Immediate(Smi::RawValue(1)));
+  __ jmp(&loop, Assembler::kNearJump);
+
+  __ Bind(&found);
+  __ movl(EAX, FieldAddress(EDX, EDI, TIMES_4, target_offset));
+  __ popl(EDX);  // Restore arguments descriptor array.
+  __ popl(ECX);  // Restore ic-data.
+
+  __ Bind(&call_target_function);
+  // EAX: Target function.
+  __ movl(EAX, FieldAddress(EAX, Function::code_offset()));
+  __ movl(EAX, FieldAddress(EAX, Code::instructions_offset()));
+  __ addl(EAX, Immediate(Instructions::HeaderSize() - kHeapObjectTag));
+  __ jmp(EAX);
+
+  __ Bind(&miss);
+  __ popl(EDX);  // Restore arguments descriptor array.
+  __ popl(ECX);  // Restore ic-data.
+  __ movl(EAX, FieldAddress(EDX, Array::data_offset()));
+  __ movl(EAX, Address(ESP, EAX, TIMES_2, 0));  // Receiver.
+  AssemblerMacros::EnterStubFrame(assembler);
+  __ pushl(EDX);  // Preserve arguments descriptor array.
+  __ pushl(ECX);  // Preserve ic-data.
+  __ pushl(raw_null);  // Setup space on stack for result (target function).
+  __ pushl(EAX);  // Receiver.
+  __ pushl(EBX);  // Megamorphic cache.
+  __ CallRuntime(kMegamorphicCacheMissHandlerRuntimeEntry);
+  __ popl(EAX);  // Remove arguments.
+  __ popl(EAX);
+  __ popl(EAX);  // Pop returned function into EAX (null if not found).
+  __ popl(ECX);  // Restore ic-data.
+  __ popl(EDX);  // Restore arguments descriptor array.
+  __ LeaveFrame();
+  __ cmpl(EAX, raw_null);
+  __ j(NOT_EQUAL, &call_target_function, Assembler::kNearJump);
+  // NoSuchMethod or closure.
+  __ jmp(&StubCode::InstanceFunctionLookupLabel());
+}
+
+
 DECLARE_LEAF_RUNTIME_ENTRY(intptr_t, DeoptimizeCopyFrame,
                            intptr_t deopt_reason,
                            uword saved_registers_address);
@@ -1076,11 +1162,32 @@ DECLARE_LEAF_RUNTIME_ENTRY(void, StoreBufferBlockProcess, Isolate* isolate);
 // Helper stub to implement Assembler::StoreIntoObject.
 // Input parameters:
 //   EAX: Address being stored
+//   ESP + 4 : Object being stored into
 void StubCode::GenerateUpdateStoreBufferStub(Assembler* assembler) {
   // Save values being destroyed.
   __ pushl(EDX);
   __ pushl(ECX);
 
+  // Objects on card marked pages dirty the card of the address instead.
+  // Spilled: EDX, ECX
+  // EAX: Address being stored
+  Label add_to_buffer;
+  __ movl(ECX, Address(ESP, 3 * kWordSize));
+  __ andl(ECX, Immediate(~(PageSpace::kPageSize - 1)));
+  __ movl(EDX, Address(ECX, HeapPage::card_table_offset()));
+  __ testl(EDX, EDX);
+  __ j(ZERO, &add_to_buffer, Assembler::kNearJump);
+  // ECX: HeapPage
+  // EDX: Card table
+  __ negl(ECX);
+  __ addl(ECX, EAX);
+  __ shrl(ECX, Immediate(HeapPage::kCardBits));
+  __ movb(Address(EDX, ECX, TIMES_1, 0), Immediate(1));
+  __ popl(ECX);
+  __ popl(EDX);
+  __ ret();
+
+  __ Bind(&add_to_buffer);
   // Load the isolate out of the context.
   // Spilled: EDX, ECX
   // EAX: Address being stored
@@ -1128,6 +1235,63 @@ void StubCode::GenerateUpdateStoreBufferStub(Assembler* assembler) {
 }
 
 
+DECLARE_LEAF_RUNTIME_ENTRY(void, MarkingBarrierBlockProcess, Isolate* isolate);
+
+
+// Called by the write barrier while concurrent marking is active.
+// Input parameters:
+//   EAX: Object being stored into.
+void StubCode::GenerateMarkingBarrierStub(Assembler* assembler) {
+  // Save values being destroyed.
+  __ pushl(EDX);
+  __ pushl(ECX);
+
+  // Load the isolate out of the context.
+  // Spilled: EDX, ECX
+  // EAX: Object being stored into
+  __ movl(EDX, FieldAddress(CTX, Context::isolate_offset()));
+
+  // Load top_ out of the MarkingBarrierBlock and add the object to the
+  // pointers_.
+  // Spilled: EDX, ECX
+  // EAX: Object being stored into
+  // EDX: Isolate
+  intptr_t top_offset = Isolate::marking_barrier_block_offset() +
+      MarkingBarrierBlock::top_offset();
+  intptr_t pointers_offset = Isolate::marking_barrier_block_offset() +
+      MarkingBarrierBlock::pointers_offset();
+  __ movl(ECX, Address(EDX, top_offset));
+  __ movl(Address(EDX, ECX, TIMES_4, pointers_offset), EAX);
+
+  // Increment top_ and check for overflow.
+  // Spilled: EDX, ECX
+  // ECX: top_
+  // EDX: Isolate
+  Label L;
+  __ incl(ECX);
+  __ movl(Address(EDX, top_offset), ECX);
+  __ cmpl(ECX, Immediate(MarkingBarrierBlock::kSize));
+  // Restore values.
+  // Spilled: EDX, ECX
+  __ popl(ECX);
+  __ popl(EDX);
+  __ j(EQUAL, &L, Assembler::kNearJump);
+  __ ret();
+
+  // Handle overflow: Call the runtime leaf function.
+  __ Bind(&L);
+  // Setup frame, push callee-saved registers.
+
+  __ EnterCallRuntimeFrame(1 * kWordSize);
+  __ movl(EAX, FieldAddress(CTX, Context::isolate_offset()));
+  __ movl(Address(ESP, 0), EAX);  // Push the isolate as the only argument.
+  __ CallRuntime(kMarkingBarrierBlockProcessRuntimeEntry);
+  // Restore callee-saved registers, tear down frame.
+  __ LeaveCallRuntimeFrame();
+  __ ret();
+}
+
+
 // Called for inline allocation of objects.
 // Input parameters:
 //   ESP + 8 : type arguments object (only if class is parameterized).
@@ -1566,8 +1730,12 @@ void StubCode::GenerateNArgsCheckInlineCacheStub(Assembler* assembler,
     ASSERT(FLAG_optimization_counter_threshold > 1);
     // The usage_counter is always less than FLAG_optimization_counter_threshold
     // except when the function gets optimized.
-    __ cmpl(FieldAddress(EBX, Function::usage_counter_offset()),
-        Immediate(FLAG_optimization_counter_threshold - 1));
+    // The threshold is loaded when the stub runs, as it may be changed after
+    // the stubs are generated, e.g. by tests.
+    __ movl(EAX, Address::Absolute(
+        reinterpret_cast<uword>(&FLAG_optimization_counter_threshold)));
+    __ decl(EAX);
+    __ cmpl(FieldAddress(EBX, Function::usage_counter_offset()), EAX);
     // Do not increment to equality with threshold, since a counter greater
     // than threshold denotes a function that was already optimized.
     // The equality should be reached only at exit of the method
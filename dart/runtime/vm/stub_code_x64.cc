@@ -469,6 +469,84 @@ void StubCode::GenerateInstanceFunctionLookupStub(Assembler* assembler) {
 }
 
 
+// Probes the megamorphic cache of the call for the class of the receiver and
+// jumps to the cached target. On a miss the target is resolved and added to
+// the cache; calls that cannot be resolved continue in the instance function
+// lookup stub.
+// Input parameters:
+//   RBX: ic-data.
+//   R10: arguments descriptor array (num_args is first Smi element).
+//   RDI: megamorphic cache.
+void StubCode::GenerateMegamorphicLookupStub(Assembler* assembler) {
+  const Immediate raw_null =
+      Immediate(reinterpret_cast<intptr_t>(Object::null()));
+  // Load the receiver into R13 and its class id as Smi into RAX.
+  __ movq(RAX, FieldAddress(R10, Array::data_offset()));
+  __ movq(R13, Address(RSP, RAX, TIMES_4, 0));  // RAX (argument count) is Smi.
+  Label not_smi, probe;
+  __ testq(R13, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &not_smi, Assembler::kNearJump);
+  __ movq(RAX, Immediate(Smi::RawValue(kSmiCid)));
+  __ jmp(&probe, Assembler::kNearJump);
+  __ Bind(&not_smi);
+  __ LoadClassId(RAX, R13);
+  __ SmiTag(RAX);
+
+  __ Bind(&probe);
+  // RAX: receiver's class id as Smi.
+  __ movq(R12, FieldAddress(RDI, MegamorphicCache::buckets_offset()));
+  __ movq(RCX, FieldAddress(RDI, MegamorphicCache::mask_offset()));
+  // R12: buckets array, RCX: mask as Smi.
+  __ movq(RDX, RAX);
+  const intptr_t class_id_offset = Array::data_offset() +
+      MegamorphicCache::kClassIdIndex * kWordSize;
+  const intptr_t target_offset = Array::data_offset() +
+      MegamorphicCache::kTargetFunctionIndex * kWordSize;
+  Label loop, found, miss, call_target_function;
+  __ Bind(&loop);
+  __ andq(RDX, RCX);
+  // RDX: bucket index as Smi. A bucket has two array elements, so scaling the
+  // Smi by 8 yields the byte offset of the bucket.
+  __ movq(R9, FieldAddress(R12, RDX, TIMES_8, class_id_offset));
+  __ cmpq(R9, RAX);
+  __ j(EQUAL, &found, Assembler::kNearJump);
+  ASSERT(kIllegalCid == 0);
+  __ testq(R9, R9);  // Empty bucket?
+  __ j(ZERO, &miss, Assembler::kNearJump);
+  __ addq(RDX, Immediate(Smi::RawValue(1)));
+  __ jmp(&loop, Assembler::kNearJump);
+
+  __ Bind(&found);
+  __ movq(RAX, FieldAddress(R12, RDX, TIMES_8, target_offset));
+
+  __ Bind(&call_target_function);
+  // RAX: Target function.
+  __ movq(RAX, FieldAddress(RAX, Function::code_offset()));
+  __ movq(RAX, FieldAddress(RAX, Code::instructions_offset()));
+  __ addq(RAX, Immediate(Instructions::HeaderSize() - kHeapObjectTag));
+  __ jmp(RAX);
+
+  __ Bind(&miss);
+  AssemblerMacros::EnterStubFrame(assembler);
+  __ pushq(R10);  // Preserve arguments descriptor array.
+  __ pushq(RBX);  // Preserve ic-data.
+  __ pushq(raw_null);  // Setup space on stack for result (target function).
+  __ pushq(R13);  // Receiver.
+  __ pushq(RDI);  // Megamorphic cache.
+  __ CallRuntime(kMegamorphicCacheMissHandlerRuntimeEntry);
+  __ popq(RAX);  // Remove arguments.
+  __ popq(RAX);
+  __ popq(RAX);  // Pop returned function into RAX (null if not found).
+  __ popq(RBX);  // Restore ic-data.
+  __ popq(R10);  // Restore arguments descriptor array.
+  __ LeaveFrame();
+  __ cmpq(RAX, raw_null);
+  __ j(NOT_EQUAL, &call_target_function, Assembler::kNearJump);
+  // NoSuchMethod or closure.
+  __ jmp(&StubCode::InstanceFunctionLookupLabel());
+}
+
+
 DECLARE_LEAF_RUNTIME_ENTRY(intptr_t, DeoptimizeCopyFrame,
                            intptr_t deopt_reason,
                            uword saved_registers_address);
@@ -1062,11 +1140,31 @@ DECLARE_LEAF_RUNTIME_ENTRY(void, StoreBufferBlockProcess, Isolate* isolate);
 // Helper stub to implement Assembler::StoreIntoObject.
 // Input parameters:
 //   RAX: Address being stored
+//   RSP + 8 : Object being stored into
 void StubCode::GenerateUpdateStoreBufferStub(Assembler* assembler) {
   // Save registers being destroyed.
   __ pushq(RDX);
   __ pushq(RCX);
 
+  // Objects on card marked pages dirty the card of the address instead.
+  // RAX: Address being stored
+  Label add_to_buffer;
+  __ movq(RCX, Address(RSP, 3 * kWordSize));
+  __ andq(RCX, Immediate(~(PageSpace::kPageSize - 1)));
+  __ movq(RDX, Address(RCX, HeapPage::card_table_offset()));
+  __ testq(RDX, RDX);
+  __ j(ZERO, &add_to_buffer, Assembler::kNearJump);
+  // RCX: HeapPage
+  // RDX: Card table
+  __ negq(RCX);
+  __ addq(RCX, RAX);
+  __ shrq(RCX, Immediate(HeapPage::kCardBits));
+  __ movb(Address(RDX, RCX, TIMES_1, 0), Immediate(1));
+  __ popq(RCX);
+  __ popq(RDX);
+  __ ret();
+
+  __ Bind(&add_to_buffer);
   // Load the isolate out of the context.
   // RAX: Address being stored
   __ movq(RDX, FieldAddress(CTX, Context::isolate_offset()));
@@ -1107,6 +1205,56 @@ void StubCode::GenerateUpdateStoreBufferStub(Assembler* assembler) {
 }
 
 
+DECLARE_LEAF_RUNTIME_ENTRY(void, MarkingBarrierBlockProcess, Isolate* isolate);
+
+
+// Called by the write barrier while concurrent marking is active.
+// Input parameters:
+//   RAX: Object being stored into.
+void StubCode::GenerateMarkingBarrierStub(Assembler* assembler) {
+  // Save registers being destroyed.
+  __ pushq(RDX);
+  __ pushq(RCX);
+
+  // Load the isolate out of the context.
+  // RAX: Object being stored into
+  __ movq(RDX, FieldAddress(CTX, Context::isolate_offset()));
+
+  // Load top_ out of the MarkingBarrierBlock and add the object to the
+  // pointers_.
+  // RAX: Object being stored into
+  // RDX: Isolate
+  intptr_t top_offset = Isolate::marking_barrier_block_offset() +
+      MarkingBarrierBlock::top_offset();
+  intptr_t pointers_offset = Isolate::marking_barrier_block_offset() +
+      MarkingBarrierBlock::pointers_offset();
+  __ movl(RCX, Address(RDX, top_offset));
+  __ movq(Address(RDX, RCX, TIMES_8, pointers_offset), RAX);
+
+  // Increment top_ and check for overflow.
+  // RCX: top_
+  // RDX: Isolate
+  Label L;
+  __ incq(RCX);
+  __ movl(Address(RDX, top_offset), RCX);
+  __ cmpl(RCX, Immediate(MarkingBarrierBlock::kSize));
+  // Restore values.
+  __ popq(RCX);
+  __ popq(RDX);
+  __ j(EQUAL, &L, Assembler::kNearJump);
+  __ ret();
+
+  // Handle overflow: Call the runtime leaf function.
+  __ Bind(&L);
+  // Setup frame, push callee-saved registers.
+  __ EnterCallRuntimeFrame(0);
+  __ movq(RDI, FieldAddress(CTX, Context::isolate_offset()));
+  __ CallRuntime(kMarkingBarrierBlockProcessRuntimeEntry);
+  __ LeaveCallRuntimeFrame();
+  __ ret();
+}
+
+
 // Called for inline allocation of objects.
 // Input parameters:
 //   RSP + 16 : type arguments object (only if class is parameterized).
@@ -1543,8 +1691,13 @@ void StubCode::GenerateNArgsCheckInlineCacheStub(Assembler* assembler,
     ASSERT(FLAG_optimization_counter_threshold > 1);
     // The usage_counter is always less than FLAG_optimization_counter_threshold
     // except when the function gets optimized.
-    __ cmpq(FieldAddress(RCX, Function::usage_counter_offset()),
-        Immediate(FLAG_optimization_counter_threshold - 1));
+    // The threshold is loaded when the stub runs, as it may be changed after
+    // the stubs are generated, e.g. by tests.
+    __ movq(RAX, Immediate(reinterpret_cast<int64_t>(
+        &FLAG_optimization_counter_threshold)));
+    __ movsxl(RAX, Address(RAX, 0));
+    __ decq(RAX);
+    __ cmpq(FieldAddress(RCX, Function::usage_counter_offset()), RAX);
     // Do not increment to equality with threshold, since a counter greater
     // than threshold denotes a function that was already optimized.
     // The equality should be reached only at exit of the method
@@ -14,7 +14,7 @@
 
 namespace dart {
 
-RawString* Symbols::predefined_[Symbols::kMaxId];
+RawString* Symbols::predefined_[Symbols::kMaxPredefinedId];
 
 // Turn off population of symbols in the VM symbol table, so that we
 // don't find these symbols while doing a Symbols::New(...).
@@ -54,6 +54,28 @@ void Symbols::InitOnce(Isolate* isolate) {
     Add(symbol_table, str);
     predefined_[i] = str.raw();
   }
+
+  // Create the symbols for the string representation of all tokens. Some
+  // of them are already among the symbols above or are shared by several
+  // tokens.
+  for (intptr_t i = 0; i < Token::kNumTokens; i++) {
+    const char* token_str = Token::Str(static_cast<Token::Kind>(i));
+    intptr_t len = strlen(token_str);
+    if (len == 0) {
+      continue;
+    }
+    const uint8_t* characters = reinterpret_cast<const uint8_t*>(token_str);
+    intptr_t index = FindIndex(symbol_table, characters, len,
+                               String::Hash(characters, len));
+    str ^= symbol_table.At(index);
+    if (str.IsNull()) {
+      str = OneByteString::New(token_str, Heap::kOld);
+      Add(symbol_table, str);
+    }
+    predefined_[kMaxId + i] = str.raw();
+  }
+  // The table was sized to hold all predefined symbols without growing.
+  ASSERT(symbol_table.raw() == isolate->object_store()->symbol_table());
   Object::RegisterSingletonClassNames();
 }
 
@@ -303,7 +325,7 @@ intptr_t Symbols::FindIndex(const Array& symbol_table,
 
 
 intptr_t Symbols::LookupVMSymbol(RawObject* obj) {
-  for (intptr_t i = 1;  i < Symbols::kMaxId; i++) {
+  for (intptr_t i = 1;  i < Symbols::kMaxPredefinedId; i++) {
     if (predefined_[i] == obj) {
       return (i + kMaxPredefinedObjectIds);
     }
@@ -315,7 +337,10 @@ intptr_t Symbols::LookupVMSymbol(RawObject* obj) {
 RawObject* Symbols::GetVMSymbol(intptr_t object_id) {
   ASSERT(IsVMSymbolId(object_id));
   intptr_t i = (object_id - kMaxPredefinedObjectIds);
-  return (i > 0 && i < Symbols::kMaxId) ? predefined_[i] : Object::null();
+  if ((i > 0) && (i < Symbols::kMaxPredefinedId) && (predefined_[i] != NULL)) {
+    return predefined_[i];
+  }
+  return Object::null();
 }
 
 }  // namespace dart
@@ -7,6 +7,7 @@
 
 #include "vm/object.h"
 #include "vm/snapshot_ids.h"
+#include "vm/token.h"
 
 namespace dart {
 
@@ -90,6 +91,7 @@ class ObjectPointerVisitor;
   V(ContextScope, "ContextScope")                                              \
   V(ICData, "ICData")                                                          \
   V(SubtypeTestCache, "SubtypeTestCache")                                      \
+  V(MegamorphicCache, "MegamorphicCache")                                      \
   V(ApiError, "ApiError")                                                      \
   V(LanguageError, "LanguageError")                                            \
   V(UnhandledException, "UnhandledException")                                  \
@@ -152,12 +154,27 @@ PREDEFINED_SYMBOLS_LIST(DEFINE_SYMBOL_INDEX)
     kMaxId,
   };
 
+  // The symbols for the string representation of tokens, e.g. keywords and
+  // operator names, follow the list of strings above. They are used by the
+  // scanner and the core libraries of every isolate and are shared as well.
+  enum {
+    kMaxPredefinedId = kMaxId + Token::kNumTokens,
+  };
+
   // Access methods for symbols stored in the vm isolate.
 #define DEFINE_SYMBOL_ACCESSOR(symbol, literal)                                \
   static RawString* symbol() { return predefined_[k##symbol]; }
 PREDEFINED_SYMBOLS_LIST(DEFINE_SYMBOL_ACCESSOR)
 #undef DEFINE_SYMBOL_ACCESSOR
 
+  // Access the symbol for the string representation of a token. Returns
+  // null for tokens that have none, e.g. kIDENT.
+  static RawString* TokenSymbol(Token::Kind token) {
+    ASSERT((token >= 0) && (token < Token::kNumTokens));
+    RawString* symbol = predefined_[kMaxId + token];
+    return (symbol == NULL) ? String::null() : symbol;
+  }
+
   // Initialize frequently used symbols in the vm isolate.
   static void InitOnce(Isolate* isolate);
 
@@ -181,7 +198,9 @@ PREDEFINED_SYMBOLS_LIST(DEFINE_SYMBOL_ACCESSOR)
 
  private:
   enum {
-    kInitialVMIsolateSymtabSize = ((Symbols::kMaxId + 15) & -16),
+    // Leave enough room for the predefined symbols not to grow the table.
+    kInitialVMIsolateSymtabSize =
+        (((Symbols::kMaxPredefinedId * 4) / 3 + 15) & -16),
     kInitialSymtabSize = 256
   };
 
@@ -212,11 +231,11 @@ PREDEFINED_SYMBOLS_LIST(DEFINE_SYMBOL_ACCESSOR)
   static RawObject* GetVMSymbol(intptr_t object_id);
   static bool IsVMSymbolId(intptr_t object_id) {
     return (object_id >= kMaxPredefinedObjectIds &&
-            object_id < (kMaxPredefinedObjectIds + Symbols::kMaxId));
+            object_id < (kMaxPredefinedObjectIds + Symbols::kMaxPredefinedId));
   }
 
   // List of symbols that are stored in the vm isolate for easy access.
-  static RawString* predefined_[Symbols::kMaxId];
+  static RawString* predefined_[Symbols::kMaxPredefinedId];
 
   friend class SnapshotReader;
   friend class SnapshotWriter;
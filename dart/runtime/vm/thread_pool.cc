@@ -4,22 +4,49 @@
 
 #include "vm/thread_pool.h"
 
+#include "vm/atomic.h"
+
 namespace dart {
 
 DEFINE_FLAG(int, worker_timeout_millis, 5000,
             "Free workers when they have been idle for this amount of time.");
+DEFINE_FLAG(int, max_workers, 0,
+            "Maximum number of workers of the VM thread pool, 0 for no limit. "
+            "Tasks are queued on busy workers when the limit is reached.");
 
+ThreadLocalKey ThreadPool::worker_key_ = Thread::kUnsetThreadLocalKey;
 Monitor* ThreadPool::exit_monitor_ = NULL;
 int* ThreadPool::exit_count_ = NULL;
 
 ThreadPool::ThreadPool()
   : shutting_down_(false),
+    max_workers_(FLAG_max_workers),
     all_workers_(NULL),
     idle_workers_(NULL),
     count_started_(0),
     count_stopped_(0),
     count_running_(0),
-    count_idle_(0) {
+    count_idle_(0),
+    count_queued_(0),
+    count_stolen_(0),
+    next_queue_(0) {
+  ASSERT(max_workers_ >= 0);
+}
+
+
+ThreadPool::ThreadPool(intptr_t max_workers)
+  : shutting_down_(false),
+    max_workers_(max_workers),
+    all_workers_(NULL),
+    idle_workers_(NULL),
+    count_started_(0),
+    count_stopped_(0),
+    count_running_(0),
+    count_idle_(0),
+    count_queued_(0),
+    count_stolen_(0),
+    next_queue_(0) {
+  ASSERT(max_workers_ >= 0);
 }
 
 
@@ -28,7 +55,24 @@ ThreadPool::~ThreadPool() {
 }
 
 
+void ThreadPool::InitOnce() {
+  ASSERT(worker_key_ == Thread::kUnsetThreadLocalKey);
+  worker_key_ = Thread::CreateThreadLocal();
+  ASSERT(worker_key_ != Thread::kUnsetThreadLocalKey);
+}
+
+
 void ThreadPool::Run(Task* task) {
+  Run(task, true);
+}
+
+
+void ThreadPool::RunHelper(Task* task) {
+  Run(task, false);
+}
+
+
+void ThreadPool::Run(Task* task, bool may_queue) {
   Worker* worker = NULL;
   bool new_worker = false;
   {
@@ -38,6 +82,17 @@ void ThreadPool::Run(Task* task) {
     if (shutting_down_) {
       return;
     }
+    if ((idle_workers_ == NULL) &&
+        may_queue &&
+        (max_workers_ > 0) &&
+        (count_running_ >= static_cast<uint64_t>(max_workers_))) {
+      // The pool is full, leave the task to the next worker which is done.
+      // Tasks are only added to queues while holding ThreadPool::mutex_,
+      // so no worker can become idle while a task is queued.
+      SelectQueue()->Enqueue(task);
+      AtomicOperations::FetchAndIncrement(&count_queued_);
+      return;
+    }
     if (idle_workers_ == NULL) {
       worker = new Worker(this);
       ASSERT(worker != NULL);
@@ -97,6 +152,14 @@ void ThreadPool::Shutdown() {
     // because the worker is no longer owned by the ThreadPool.
     Worker* next = current->all_next_;
     current->all_next_ = NULL;
+    // Drop the queued tasks before the worker may go away.
+    Task* task = current->TakeOldest();
+    while (task != NULL) {
+      delete task;
+      AtomicOperations::FetchAndIncrementBy(&count_queued_,
+                                            static_cast<uword>(-1));
+      task = current->TakeOldest();
+    }
     current->Shutdown();
     current = next;
   }
@@ -116,6 +179,26 @@ bool ThreadPool::IsIdle(Worker* worker) {
 }
 
 
+ThreadPool::Worker* ThreadPool::SelectQueue() {
+  ASSERT(all_workers_ != NULL);
+  // Keep the tasks spawned by a task on the worker running it.
+  Worker* current =
+      reinterpret_cast<Worker*>(Thread::GetThreadLocal(worker_key_));
+  if ((current != NULL) && (current->pool_ == this)) {
+    ASSERT(current->owned_);
+    return current;
+  }
+  // Otherwise spread the tasks over the workers in turn.
+  uint64_t index = next_queue_++ % count_running_;
+  Worker* worker = all_workers_;
+  for (uint64_t i = 0; i < index; i++) {
+    worker = worker->all_next_;
+  }
+  ASSERT(worker != NULL);
+  return worker;
+}
+
+
 bool ThreadPool::RemoveWorkerFromIdleList(Worker* worker) {
   ASSERT(worker != NULL && worker->owned_);
   if (idle_workers_ == NULL) {
@@ -171,16 +254,49 @@ bool ThreadPool::RemoveWorkerFromAllList(Worker* worker) {
 }
 
 
-void ThreadPool::SetIdle(Worker* worker) {
+ThreadPool::Task* ThreadPool::StealTask(Worker* thief) {
+  // Called with ThreadPool::mutex_ held.  Since tasks are only queued while
+  // holding it, all queues are empty if no task is found.  The thief's own
+  // queue is included as a task may have been queued on it since it last
+  // looked.
+  for (Worker* current = all_workers_;
+       current != NULL;
+       current = current->all_next_) {
+    Task* task = current->TakeOldest();
+    if (task != NULL) {
+      if (current != thief) {
+        count_stolen_++;
+      }
+      return task;
+    }
+  }
+  return NULL;
+}
+
+
+ThreadPool::Task* ThreadPool::NextTaskOrSetIdle(Worker* worker) {
+  Task* task = worker->TakeNewest();
+  if (task != NULL) {
+    AtomicOperations::FetchAndIncrementBy(&count_queued_,
+                                          static_cast<uword>(-1));
+    return task;
+  }
   MutexLocker ml(&mutex_);
   if (shutting_down_) {
-    return;
+    return NULL;
   }
   ASSERT(worker->owned_ && !IsIdle(worker));
+  task = StealTask(worker);
+  if (task != NULL) {
+    AtomicOperations::FetchAndIncrementBy(&count_queued_,
+                                          static_cast<uword>(-1));
+    return task;
+  }
   worker->idle_next_ = idle_workers_;
   idle_workers_ = worker;
   count_idle_++;
   count_running_--;
+  return NULL;
 }
 
 
@@ -203,7 +319,7 @@ bool ThreadPool::ReleaseIdleWorker(Worker* worker) {
 }
 
 
-ThreadPool::Task::Task() {
+ThreadPool::Task::Task() : prev_(NULL), next_(NULL) {
 }
 
 
@@ -214,6 +330,8 @@ ThreadPool::Task::~Task() {
 ThreadPool::Worker::Worker(ThreadPool* pool)
   : pool_(pool),
     task_(NULL),
+    queue_oldest_(NULL),
+    queue_newest_(NULL),
     owned_(false),
     all_next_(NULL),
     idle_next_(NULL) {
@@ -235,6 +353,51 @@ void ThreadPool::Worker::StartThread() {
 }
 
 
+void ThreadPool::Worker::Enqueue(Task* task) {
+  MutexLocker ml(&queue_mutex_);
+  ASSERT((task->prev_ == NULL) && (task->next_ == NULL));
+  task->prev_ = queue_newest_;
+  if (queue_newest_ == NULL) {
+    queue_oldest_ = task;
+  } else {
+    queue_newest_->next_ = task;
+  }
+  queue_newest_ = task;
+}
+
+
+ThreadPool::Task* ThreadPool::Worker::TakeNewest() {
+  MutexLocker ml(&queue_mutex_);
+  Task* task = queue_newest_;
+  if (task != NULL) {
+    queue_newest_ = task->prev_;
+    if (queue_newest_ == NULL) {
+      queue_oldest_ = NULL;
+    } else {
+      queue_newest_->next_ = NULL;
+    }
+    task->prev_ = NULL;
+  }
+  return task;
+}
+
+
+ThreadPool::Task* ThreadPool::Worker::TakeOldest() {
+  MutexLocker ml(&queue_mutex_);
+  Task* task = queue_oldest_;
+  if (task != NULL) {
+    queue_oldest_ = task->next_;
+    if (queue_oldest_ == NULL) {
+      queue_newest_ = NULL;
+    } else {
+      queue_oldest_->prev_ = NULL;
+    }
+    task->next_ = NULL;
+  }
+  return task;
+}
+
+
 void ThreadPool::Worker::SetTask(Task* task) {
   MonitorLocker ml(&monitor_);
   ASSERT(task_ == NULL);
@@ -280,7 +443,11 @@ void ThreadPool::Worker::Loop() {
       return;
     }
     ASSERT(pool_ != NULL);
-    pool_->SetIdle(this);
+    // Run the queued tasks before becoming idle.
+    task_ = pool_->NextTaskOrSetIdle(this);
+    if (task_ != NULL) {
+      continue;
+    }
     idle_start = OS::GetCurrentTimeMillis();
     while (true) {
       Monitor::WaitResult result = ml.Wait(ComputeTimeout(idle_start));
@@ -312,7 +479,9 @@ void ThreadPool::Worker::Shutdown() {
 // static
 void ThreadPool::Worker::Main(uword args) {
   Worker* worker = reinterpret_cast<Worker*>(args);
+  Thread::SetThreadLocal(worker_key_, reinterpret_cast<uword>(worker));
   worker->Loop();
+  Thread::SetThreadLocal(worker_key_, 0);
 
   // It should be okay to access these unlocked here in this assert.
   ASSERT(!worker->owned_ &&
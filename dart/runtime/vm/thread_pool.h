@@ -23,23 +23,51 @@ class ThreadPool {
     virtual void Run() = 0;
 
    private:
+    friend class ThreadPool;
+
+    // Links in the queue of the worker this task is queued on.
+    Task* prev_;
+    Task* next_;
+
     DISALLOW_COPY_AND_ASSIGN(Task);
   };
 
+  // Creates a thread pool with at most --max_workers workers.
   ThreadPool();
 
+  // Creates a thread pool with at most max_workers workers, or without a
+  // limit if max_workers is 0.
+  explicit ThreadPool(intptr_t max_workers);
+
   // Shuts down this thread pool.  Causes workers to terminate
-  // themselves when they are active again.
+  // themselves when they are active again.  Tasks which are still
+  // queued are deleted without being run.
   ~ThreadPool();
 
-  // Runs a task on the thread pool.
+  static void InitOnce();
+
+  // Runs a task on the thread pool.  If no worker is idle and the pool
+  // has reached its maximum size, the task is queued on a busy worker:
+  // the worker calling Run or else the next one in turn.  A worker which
+  // is done with its task first runs the newest task queued on itself,
+  // then steals the oldest task queued on other workers, and only then
+  // becomes idle.
   void Run(Task* task);
 
+  // Runs a task which its caller, possibly itself a task on this pool,
+  // is going to wait for.  The task is never queued behind other tasks,
+  // even if this exceeds the maximum size of the pool, so that waiting
+  // for it cannot deadlock.
+  void RunHelper(Task* task);
+
   // Some simple stats.
+  intptr_t max_workers() const { return max_workers_; }
   uint64_t workers_running() const { return count_running_; }
   uint64_t workers_idle() const { return count_idle_; }
   uint64_t workers_started() const { return count_started_; }
   uint64_t workers_stopped() const { return count_stopped_; }
+  uint64_t tasks_queued() const { return count_queued_; }
+  uint64_t tasks_stolen() const { return count_stolen_; }
 
  private:
   friend class ThreadPoolTestPeer;
@@ -69,11 +97,24 @@ class ThreadPool {
 
     bool IsDone() const { return pool_ == NULL; }
 
+    // Operations on the queue of tasks waiting for a worker.  The worker
+    // takes the newest task from its own queue, other workers steal the
+    // oldest one.
+    void Enqueue(Task* task);
+    Task* TakeNewest();
+    Task* TakeOldest();
+
     // Fields owned by Worker.
     Monitor monitor_;
     ThreadPool* pool_;
     Task* task_;
 
+    // Tasks queued on this worker.  Tasks are only added while holding
+    // ThreadPool::mutex_.
+    Mutex queue_mutex_;
+    Task* queue_oldest_;  // Protected by queue_mutex_
+    Task* queue_newest_;  // Protected by queue_mutex_
+
     // Fields owned by ThreadPool.  Workers should not look at these
     // directly.  It's like looking at the sun.
     bool owned_;         // Protected by ThreadPool::mutex_
@@ -83,26 +124,38 @@ class ThreadPool {
     DISALLOW_COPY_AND_ASSIGN(Worker);
   };
 
+  void Run(Task* task, bool may_queue);
   void Shutdown();
 
   // Expensive.  Use only in assertions.
   bool IsIdle(Worker* worker);
 
+  // Returns the worker to queue a task on when the pool is full.
+  Worker* SelectQueue();
+
   bool RemoveWorkerFromIdleList(Worker* worker);
   bool RemoveWorkerFromAllList(Worker* worker);
 
   // Worker operations.
-  void SetIdle(Worker* worker);
+  Task* StealTask(Worker* thief);
+  Task* NextTaskOrSetIdle(Worker* worker);
   bool ReleaseIdleWorker(Worker* worker);
 
   Mutex mutex_;
   bool shutting_down_;
+  intptr_t max_workers_;
   Worker* all_workers_;
   Worker* idle_workers_;
   uint64_t count_started_;
   uint64_t count_stopped_;
   uint64_t count_running_;
   uint64_t count_idle_;
+  uword count_queued_;  // Updated atomically.
+  uint64_t count_stolen_;
+  uint64_t next_queue_;
+
+  // The worker running on the current thread, if any.
+  static ThreadLocalKey worker_key_;
 
   static Monitor* exit_monitor_;  // Used only in testing.
   static int* exit_count_;        // Used only in testing.
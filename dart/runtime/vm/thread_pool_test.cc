@@ -215,4 +215,211 @@ UNIT_TEST_CASE(ThreadPool_RecursiveSpawn) {
 }
 
 
+class BlockingTask : public ThreadPool::Task {
+ public:
+  BlockingTask(Monitor* sync, bool* started, bool* release, int* finished)
+      : sync_(sync), started_(started), release_(release), finished_(finished) {
+  }
+
+  void Run() {
+    MonitorLocker ml(sync_);
+    *started_ = true;
+    ml.NotifyAll();
+    while (!*release_) {
+      ml.Wait();
+    }
+    (*finished_)++;
+    ml.NotifyAll();
+  }
+
+ private:
+  Monitor* sync_;
+  bool* started_;
+  bool* release_;
+  int* finished_;
+};
+
+
+class CountTask : public ThreadPool::Task {
+ public:
+  CountTask(Monitor* sync, int* count)
+      : sync_(sync), count_(count) {
+  }
+
+  void Run() {
+    MonitorLocker ml(sync_);
+    (*count_)++;
+    ml.NotifyAll();
+  }
+
+ private:
+  Monitor* sync_;
+  int* count_;
+};
+
+
+UNIT_TEST_CASE(ThreadPool_MaxWorkers) {
+  const int kMaxWorkers = 2;
+  const int kTaskCount = 20;
+  ThreadPool thread_pool(kMaxWorkers);
+  EXPECT_EQ(kMaxWorkers, thread_pool.max_workers());
+
+  // Occupy all workers.
+  Monitor sync;
+  bool started[kMaxWorkers];
+  bool release = false;
+  int finished = 0;
+  for (int i = 0; i < kMaxWorkers; i++) {
+    started[i] = false;
+    thread_pool.Run(new BlockingTask(&sync, &started[i], &release, &finished));
+  }
+  {
+    MonitorLocker ml(&sync);
+    for (int i = 0; i < kMaxWorkers; i++) {
+      while (!started[i]) {
+        ml.Wait();
+      }
+    }
+  }
+
+  // Further tasks are queued instead of starting more workers.
+  int count = 0;
+  for (int i = 0; i < kTaskCount; i++) {
+    thread_pool.Run(new CountTask(&sync, &count));
+  }
+  EXPECT_EQ(static_cast<uint64_t>(kTaskCount), thread_pool.tasks_queued());
+  EXPECT_EQ(static_cast<uint64_t>(kMaxWorkers), thread_pool.workers_started());
+
+  {
+    MonitorLocker ml(&sync);
+    EXPECT_EQ(0, count);
+    release = true;
+    ml.NotifyAll();
+    while ((count < kTaskCount) || (finished < kMaxWorkers)) {
+      ml.Wait();
+    }
+  }
+  EXPECT_EQ(kTaskCount, count);
+  EXPECT_EQ(static_cast<uint64_t>(kMaxWorkers), thread_pool.workers_started());
+}
+
+
+class ParentTask : public ThreadPool::Task {
+ public:
+  ParentTask(ThreadPool* pool,
+             Monitor* sync,
+             int num_children,
+             bool* release,
+             int* count,
+             int* finished)
+      : pool_(pool),
+        sync_(sync),
+        num_children_(num_children),
+        release_(release),
+        count_(count),
+        finished_(finished) {
+  }
+
+  void Run() {
+    // The pool is full: the children are queued on this worker.
+    for (int i = 0; i < num_children_; i++) {
+      pool_->Run(new CountTask(sync_, count_));
+    }
+    // Only another worker stealing them can run them while we wait.
+    MonitorLocker ml(sync_);
+    *release_ = true;
+    ml.NotifyAll();
+    while (*count_ < num_children_) {
+      ml.Wait();
+    }
+    (*finished_)++;
+    ml.NotifyAll();
+  }
+
+ private:
+  ThreadPool* pool_;
+  Monitor* sync_;
+  int num_children_;
+  bool* release_;
+  int* count_;
+  int* finished_;
+};
+
+
+UNIT_TEST_CASE(ThreadPool_StealTasks) {
+  const int kChildren = 10;
+  ThreadPool thread_pool(2);
+  Monitor sync;
+  bool started = false;
+  bool release = false;
+  int count = 0;
+  int finished = 0;
+  thread_pool.Run(new BlockingTask(&sync, &started, &release, &finished));
+  {
+    MonitorLocker ml(&sync);
+    while (!started) {
+      ml.Wait();
+    }
+  }
+  thread_pool.Run(
+      new ParentTask(&thread_pool, &sync, kChildren, &release, &count,
+                     &finished));
+  {
+    MonitorLocker ml(&sync);
+    while (finished < 2) {
+      ml.Wait();
+    }
+  }
+  EXPECT_EQ(kChildren, count);
+  EXPECT_EQ(static_cast<uint64_t>(kChildren), thread_pool.tasks_stolen());
+  EXPECT_EQ(2U, thread_pool.workers_started());
+}
+
+
+class WaitForHelperTask : public ThreadPool::Task {
+ public:
+  WaitForHelperTask(ThreadPool* pool, Monitor* sync, bool* done)
+      : pool_(pool), sync_(sync), done_(done) {
+  }
+
+  void Run() {
+    Monitor helper_sync;
+    bool helper_done = false;
+    pool_->RunHelper(new TestTask(&helper_sync, &helper_done));
+    {
+      MonitorLocker ml(&helper_sync);
+      while (!helper_done) {
+        ml.Wait();
+      }
+    }
+    MonitorLocker ml(sync_);
+    *done_ = true;
+    ml.Notify();
+  }
+
+ private:
+  ThreadPool* pool_;
+  Monitor* sync_;
+  bool* done_;
+};
+
+
+UNIT_TEST_CASE(ThreadPool_RunHelper) {
+  // A helper task is not queued behind the task waiting for it.
+  ThreadPool thread_pool(1);
+  Monitor sync;
+  bool done = false;
+  thread_pool.Run(new WaitForHelperTask(&thread_pool, &sync, &done));
+  {
+    MonitorLocker ml(&sync);
+    while (!done) {
+      ml.Wait();
+    }
+  }
+  EXPECT(done);
+  EXPECT_EQ(2U, thread_pool.workers_started());
+  EXPECT_EQ(0U, thread_pool.tasks_queued());
+}
+
+
 }  // namespace dart